@@ -1,13 +1,25 @@
 #include <Arduino.h>
 #include "DataStore.h"
 
-#if defined(EXTRAFS) || defined(QSPIFLASH)
-  #define MAX_BLOBRECS 100
-#else
-  #define MAX_BLOBRECS 20
+#ifndef MAX_BLOBRECS
+  #if defined(EXTRAFS) || defined(QSPIFLASH)
+    #define MAX_BLOBRECS 100
+  #elif defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+    #define MAX_BLOBRECS 20
+  #elif defined(MAX_CONTACTS)
+    #define MAX_BLOBRECS MAX_CONTACTS   // was one file per contact
+  #else
+    #define MAX_BLOBRECS 100
+  #endif
 #endif
 
-DataStore::DataStore(FILESYSTEM& fs, mesh::RTCClock& clock) : _fs(&fs), _fsExtra(nullptr), _clock(&clock),
+#define MAX_ADVERT_PKT_LEN   (2 + 32 + PUB_KEY_SIZE + 4 + SIGNATURE_SIZE + MAX_ADVERT_DATA_SIZE)
+
+DataStore::DataStore(FILESYSTEM& fs, mesh::RTCClock& clock) : ContactColdStore(MAX_COLD_CONTACTS), _fs(&fs), _fsExtra(nullptr), _clock(&clock),
+#if CONTACTS_LOG_STORE
+    _contacts_log("/contacts3", "/contacts3.log", "/contacts3.tmp", CONTACT_REC_SIZE, MAX_CONTACTS),
+#endif
+    _blobs("/adv_blobs", MAX_BLOBRECS, MAX_ADVERT_PKT_LEN),
 #if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
     identity_store(fs, "")
 #elif defined(RP2040_PLATFORM)
@@ -19,7 +31,11 @@ DataStore::DataStore(FILESYSTEM& fs, mesh::RTCClock& clock) : _fs(&fs), _fsExtra
 }
 
 #if defined(EXTRAFS) || defined(QSPIFLASH)
-DataStore::DataStore(FILESYSTEM& fs, FILESYSTEM& fsExtra, mesh::RTCClock& clock) : _fs(&fs), _fsExtra(&fsExtra), _clock(&clock),
+DataStore::DataStore(FILESYSTEM& fs, FILESYSTEM& fsExtra, mesh::RTCClock& clock) : ContactColdStore(MAX_COLD_CONTACTS), _fs(&fs), _fsExtra(&fsExtra), _clock(&clock),
+#if CONTACTS_LOG_STORE
+    _contacts_log("/contacts3", "/contacts3.log", "/contacts3.tmp", CONTACT_REC_SIZE, MAX_CONTACTS),
+#endif
+    _blobs("/adv_blobs", MAX_BLOBRECS, MAX_ADVERT_PKT_LEN),
 #if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
     identity_store(fs, "")
 #elif defined(RP2040_PLATFORM)
@@ -42,6 +58,65 @@ static File openWrite(FILESYSTEM* fs, const char* filename) {
 #endif
 }
 
+static File openReadWrite(FILESYSTEM* fs, const char* filename) {
+#if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+  return fs->open(filename, FILE_O_WRITE);   // read/write, created if needed
+#else
+  if (!fs->exists(filename)) {
+    File file = openWrite(fs, filename);   // create empty
+    if (file) file.close();
+  }
+  #if defined(RP2040_PLATFORM)
+  return fs->open(filename, "r+");
+  #else
+  return fs->open(filename, "r+", false);
+  #endif
+#endif
+}
+
+static void packContact(const ContactInfo& c, uint8_t rec[CONTACT_REC_SIZE]) {
+  memcpy(&rec[0], c.id.pub_key, 32);
+  memcpy(&rec[32], c.name, 32);
+  rec[64] = c.type;
+  rec[65] = c.flags;
+  rec[66] = 0;   // unused
+  memcpy(&rec[67], &c.sync_since, 4);   // was 'reserved'
+  rec[71] = c.out_path_len;
+  memcpy(&rec[72], &c.last_advert_timestamp, 4);
+  memcpy(&rec[76], c.out_path, 64);
+  memcpy(&rec[140], &c.lastmod, 4);
+  memcpy(&rec[144], &c.gps_lat, 4);
+  memcpy(&rec[148], &c.gps_lon, 4);
+}
+
+static void unpackContact(ContactInfo& c, const uint8_t rec[CONTACT_REC_SIZE]) {
+  c.id = mesh::Identity(&rec[0]);
+  memcpy(c.name, &rec[32], 32);
+  c.type = rec[64];
+  c.flags = rec[65];
+  memcpy(&c.sync_since, &rec[67], 4);
+  c.out_path_len = rec[71];
+  memcpy(&c.last_advert_timestamp, &rec[72], 4);
+  memcpy(c.out_path, &rec[76], 64);
+  memcpy(&c.lastmod, &rec[140], 4);
+  memcpy(&c.gps_lat, &rec[144], 4);
+  memcpy(&c.gps_lon, &rec[148], 4);
+}
+
+static bool readContact(File& file, ContactInfo& c) {
+  uint8_t rec[CONTACT_REC_SIZE];
+  if (file.read(rec, CONTACT_REC_SIZE) != CONTACT_REC_SIZE) return false;
+
+  unpackContact(c, rec);
+  return true;
+}
+
+static bool writeContact(File& file, const ContactInfo& c) {
+  uint8_t rec[CONTACT_REC_SIZE];
+  packContact(c, rec);
+  return file.write(rec, CONTACT_REC_SIZE) == CONTACT_REC_SIZE;
+}
+
 #if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
   static uint32_t _ContactsChannelsTotalBlocks = 0;
 #endif
@@ -53,14 +128,15 @@ void DataStore::begin() {
 
 #if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
   _ContactsChannelsTotalBlocks = _getContactsChannelsFS()->_getFS()->cfg->block_count;
-  checkAdvBlobFile();
   #if defined(EXTRAFS) || defined(QSPIFLASH)
   migrateToSecondaryFS();
   #endif
-#else
-  // init 'blob store' support
-  _fs->mkdir("/bl");
 #endif
+  _blobs.begin(_getContactsChannelsFS());
+#if CONTACTS_LOG_STORE
+  _contacts_log.begin(_getContactsChannelsFS());
+#endif
+  scanColdContacts();
 }
 
 #if defined(ESP32)
@@ -278,68 +354,159 @@ void DataStore::savePrefs(const NodePrefs& _prefs, double node_lat, double node_
   }
 }
 
+#if CONTACTS_LOG_STORE
+class ContactLoader : public RecordLogVisitor {
+  DataStoreHost* _host;
+public:
+  ContactLoader(DataStoreHost* host) : _host(host) { }
+
+  bool onRecordLoaded(const uint8_t* rec) override {
+    ContactInfo c;
+    unpackContact(c, rec);
+    return _host->onContactLoaded(c);
+  }
+};
+#endif
+
 void DataStore::loadContacts(DataStoreHost* host) {
+#if CONTACTS_LOG_STORE
+  ContactLoader loader(host);
+  _contacts_log.load(loader);
+#else
 File file = openRead(_getContactsChannelsFS(), "/contacts3");
     if (file) {
       bool full = false;
       while (!full) {
         ContactInfo c;
-        uint8_t pub_key[32];
-        uint8_t unused;
-
-        bool success = (file.read(pub_key, 32) == 32);
-        success = success && (file.read((uint8_t *)&c.name, 32) == 32);
-        success = success && (file.read(&c.type, 1) == 1);
-        success = success && (file.read(&c.flags, 1) == 1);
-        success = success && (file.read(&unused, 1) == 1);
-        success = success && (file.read((uint8_t *)&c.sync_since, 4) == 4); // was 'reserved'
-        success = success && (file.read((uint8_t *)&c.out_path_len, 1) == 1);
-        success = success && (file.read((uint8_t *)&c.last_advert_timestamp, 4) == 4);
-        success = success && (file.read(c.out_path, 64) == 64);
-        success = success && (file.read((uint8_t *)&c.lastmod, 4) == 4);
-        success = success && (file.read((uint8_t *)&c.gps_lat, 4) == 4);
-        success = success && (file.read((uint8_t *)&c.gps_lon, 4) == 4);
-
-        if (!success) break; // EOF
+        if (!readContact(file, c)) break; // EOF
 
-        c.id = mesh::Identity(pub_key);
         if (!host->onContactLoaded(c)) full = true;
       }
       file.close();
     }
+#endif
 }
 
 void DataStore::saveContacts(DataStoreHost* host, bool (*filter)(const ContactInfo& c)) {
+#if CONTACTS_LOG_STORE
+  bool success = _contacts_log.beginSave();
+  uint32_t idx = 0;
+  ContactInfo c;
+  uint8_t rec[CONTACT_REC_SIZE];
+  while (success && host->getContactForSave(idx++, c)) {
+    if (filter && !filter(c)) continue;
+
+    packContact(c, rec);
+    success = _contacts_log.saveRecord(rec);
+  }
+  if (!_contacts_log.endSave(success)) {
+    compactContacts(host, filter);   // log is full (or torn), re-write instead
+  }
+#else
   File file = openWrite(_getContactsChannelsFS(), "/contacts3");
   if (file) {
     uint32_t idx = 0;
     ContactInfo c;
-    uint8_t unused = 0;
 
     while (host->getContactForSave(idx, c)) {
       if (filter && !filter(c)) {
         idx++;  // advance to next contact
         continue;
       }
-      bool success = (file.write(c.id.pub_key, 32) == 32);
-      success = success && (file.write((uint8_t *)&c.name, 32) == 32);
-      success = success && (file.write(&c.type, 1) == 1);
-      success = success && (file.write(&c.flags, 1) == 1);
-      success = success && (file.write(&unused, 1) == 1);
-      success = success && (file.write((uint8_t *)&c.sync_since, 4) == 4);
-      success = success && (file.write((uint8_t *)&c.out_path_len, 1) == 1);
-      success = success && (file.write((uint8_t *)&c.last_advert_timestamp, 4) == 4);
-      success = success && (file.write(c.out_path, 64) == 64);
-      success = success && (file.write((uint8_t *)&c.lastmod, 4) == 4);
-      success = success && (file.write((uint8_t *)&c.gps_lat, 4) == 4);
-      success = success && (file.write((uint8_t *)&c.gps_lon, 4) == 4);
-
-      if (!success) break; // write failed
+      if (!writeContact(file, c)) break; // write failed
 
       idx++;  // advance to next contact
     }
     file.close();
   }
+#endif
+}
+
+bool DataStore::needsContactsCompact() const {
+#if CONTACTS_LOG_STORE
+  return _contacts_log.needsCompact();
+#else
+  return false;
+#endif
+}
+
+void DataStore::compactContacts(DataStoreHost* host, bool (*filter)(const ContactInfo& c)) {
+#if CONTACTS_LOG_STORE
+  bool success = _contacts_log.beginCompact();
+  uint32_t idx = 0;
+  ContactInfo c;
+  uint8_t rec[CONTACT_REC_SIZE];
+  while (success && host->getContactForSave(idx++, c)) {
+    if (filter && !filter(c)) continue;
+
+    packContact(c, rec);
+    success = _contacts_log.compactRecord(rec);
+  }
+  _contacts_log.endCompact(success);
+#endif
+}
+
+void DataStore::scanColdContacts() {
+  clearRecords();
+  if (getMaxContacts() == 0) return;   // disabled
+
+  File file = openRead(_getContactsChannelsFS(), "/contacts_cold");
+  if (file) {
+    uint8_t pub_key[PUB_KEY_SIZE];
+    uint8_t zeroes[PUB_KEY_SIZE];
+    memset(zeroes, 0, sizeof(zeroes));
+    for (int rec = 0; rec < getMaxContacts(); rec++) {
+      file.seek(rec * CONTACT_COLD_REC_SIZE);
+      if (file.read(pub_key, PUB_KEY_SIZE) != PUB_KEY_SIZE) break;  // EOF
+
+      if (memcmp(pub_key, zeroes, PUB_KEY_SIZE) != 0) setRecordUsed(rec, pub_key[0]);   // all zeroes = erased record
+    }
+    file.close();
+  }
+}
+
+bool DataStore::readRecord(int rec, ContactInfo& dest) {
+  File file = openRead(_getContactsChannelsFS(), "/contacts_cold");
+  if (file) {
+    uint8_t buf[CONTACT_COLD_REC_SIZE];
+    bool success = file.seek(rec * CONTACT_COLD_REC_SIZE) && file.read(buf, CONTACT_COLD_REC_SIZE) == CONTACT_COLD_REC_SIZE;
+    file.close();
+    if (success) {
+      unpackContact(dest, buf);
+
+      uint8_t zeroes[PUB_KEY_SIZE];
+      memset(zeroes, 0, sizeof(zeroes));
+      if (memcmp(&buf[CONTACT_REC_SIZE], zeroes, PUB_KEY_SIZE) != 0) dest.setSharedSecret(&buf[CONTACT_REC_SIZE]);
+    }
+    return success;
+  }
+  return false;
+}
+
+bool DataStore::writeRecord(int rec, const ContactInfo& src) {
+  File file = openReadWrite(_getContactsChannelsFS(), "/contacts_cold");
+  if (file) {
+    uint8_t buf[CONTACT_COLD_REC_SIZE];
+    packContact(src, buf);
+    if (!src.copySharedSecret(&buf[CONTACT_REC_SIZE])) memset(&buf[CONTACT_REC_SIZE], 0, PUB_KEY_SIZE);
+
+    bool success = file.seek(rec * CONTACT_COLD_REC_SIZE) && file.write(buf, CONTACT_COLD_REC_SIZE) == CONTACT_COLD_REC_SIZE;
+    file.close();
+    return success;
+  }
+  return false;
+}
+
+bool DataStore::eraseRecord(int rec) {
+  File file = openReadWrite(_getContactsChannelsFS(), "/contacts_cold");
+  if (file) {
+    uint8_t zeroes[PUB_KEY_SIZE];
+    memset(zeroes, 0, sizeof(zeroes));
+    bool success = file.seek(rec * CONTACT_COLD_REC_SIZE) && file.write(zeroes, PUB_KEY_SIZE) == PUB_KEY_SIZE;
+    file.close();
+    return success;
+  }
+  return false;
 }
 
 void DataStore::loadChannels(DataStoreHost* host) {
@@ -389,29 +556,13 @@ void DataStore::saveChannels(DataStoreHost* host) {
 
 #if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
 
-#define MAX_ADVERT_PKT_LEN   (2 + 32 + PUB_KEY_SIZE + 4 + SIGNATURE_SIZE + MAX_ADVERT_DATA_SIZE)
-
-struct BlobRec {
+struct BlobRec {   // slot format of BlobStore
   uint32_t timestamp;
   uint8_t  key[7];
   uint8_t  len;
   uint8_t  data[MAX_ADVERT_PKT_LEN];
 };
 
-void DataStore::checkAdvBlobFile() {
-  if (!_getContactsChannelsFS()->exists("/adv_blobs")) {
-    File file = openWrite(_getContactsChannelsFS(), "/adv_blobs");
-    if (file) {
-      BlobRec zeroes;
-      memset(&zeroes, 0, sizeof(zeroes));
-      for (int i = 0; i < MAX_BLOBRECS; i++) {     // pre-allocate to fixed size
-        file.write((uint8_t *) &zeroes, sizeof(zeroes));
-      }
-      file.close();
-    }
-  }
-}
-
 void DataStore::migrateToSecondaryFS() {
   // migrate old adv_blobs, contacts3 and channels2 files to secondary FS if they don't already exist
   if (!_fsExtra->exists("/adv_blobs")) {
@@ -520,107 +671,47 @@ void DataStore::migrateToSecondaryFS() {
   }
 }
 
-uint8_t DataStore::getBlobByKey(const uint8_t key[], int key_len, uint8_t dest_buf[]) {
-  File file = openRead(_getContactsChannelsFS(), "/adv_blobs");
-  uint8_t len = 0;  // 0 = not found
-  if (file) {
-    BlobRec tmp;
-    while (file.read((uint8_t *) &tmp, sizeof(tmp)) == sizeof(tmp)) {
-      if (memcmp(key, tmp.key, sizeof(tmp.key)) == 0) {  // only match by 7 byte prefix
-        len = tmp.len;
-        memcpy(dest_buf, tmp.data, len);
-        break;
-      }
-    }
-    file.close();
-  }
-  return len;
-}
-
-bool DataStore::putBlobByKey(const uint8_t key[], int key_len, const uint8_t src_buf[], uint8_t len) {
-  if (len < PUB_KEY_SIZE+4+SIGNATURE_SIZE || len > MAX_ADVERT_PKT_LEN) return false;
-  checkAdvBlobFile();
-  File file = _getContactsChannelsFS()->open("/adv_blobs", FILE_O_WRITE);
-  if (file) {
-    uint32_t pos = 0, found_pos = 0;
-    uint32_t min_timestamp = 0xFFFFFFFF;
-
-    // search for matching key OR evict by oldest timestmap
-    BlobRec tmp;
-    file.seek(0);
-    while (file.read((uint8_t *) &tmp, sizeof(tmp)) == sizeof(tmp)) {
-      if (memcmp(key, tmp.key, sizeof(tmp.key)) == 0) {  // only match by 7 byte prefix
-        found_pos = pos;
-        break;
-      }
-      if (tmp.timestamp < min_timestamp) {
-        min_timestamp = tmp.timestamp;
-        found_pos = pos;
-      }
-
-      pos += sizeof(tmp);
-    }
-
-    memcpy(tmp.key, key, sizeof(tmp.key));  // just record 7 byte prefix of key
-    memcpy(tmp.data, src_buf, len);
-    tmp.len = len;
-    tmp.timestamp = _clock->getCurrentTime();
-
-    file.seek(found_pos);
-    file.write((uint8_t *) &tmp, sizeof(tmp));
+#endif
 
-    file.close();
-    return true;
-  }
-  return false; // error
-}
-bool DataStore::deleteBlobByKey(const uint8_t key[], int key_len) {
-  return true; // this is just a stub on NRF52/STM32 platforms
-}
-#else
-inline void makeBlobPath(const uint8_t key[], int key_len, char* path, size_t path_size) {
+#if !defined(NRF52_PLATFORM) && !defined(STM32_PLATFORM)
+inline void makeBlobPath(const uint8_t key[], int key_len, char* path, size_t path_size) {   // legacy, one file per blob
   char fname[18];
   if (key_len > 8) key_len = 8; // just use first 8 bytes (prefix)
   mesh::Utils::toHex(fname, key, key_len);
   sprintf(path, "/bl/%s", fname);
 }
+#endif
 
 uint8_t DataStore::getBlobByKey(const uint8_t key[], int key_len, uint8_t dest_buf[]) {
-  char path[64];
-  makeBlobPath(key, key_len, path, sizeof(path));
-
-  if (_fs->exists(path)) {
-    File f = openRead(_fs, path);
-    if (f) {
-      int len = f.read(dest_buf, 255); // currently MAX 255 byte blob len supported!!
-      f.close();
-      return len;
+  uint8_t len = _blobs.get(key, dest_buf);
+#if !defined(NRF52_PLATFORM) && !defined(STM32_PLATFORM)
+  if (len == 0) {   // move from legacy blob file, if there is one
+    char path[64];
+    makeBlobPath(key, key_len, path, sizeof(path));
+    if (_fs->exists(path)) {
+      File f = openRead(_fs, path);
+      if (f) {
+        len = f.read(dest_buf, MAX_ADVERT_PKT_LEN);
+        f.close();
+        if (len > 0 && _blobs.put(key, dest_buf, len, _clock->getCurrentTime())) _fs->remove(path);
+      }
     }
   }
-  return 0; // not found
+#endif
+  return len;
 }
 
 bool DataStore::putBlobByKey(const uint8_t key[], int key_len, const uint8_t src_buf[], uint8_t len) {
-  char path[64];
-  makeBlobPath(key, key_len, path, sizeof(path));
-
-  File f = openWrite(_fs, path);
-  if (f) {
-    int n = f.write(src_buf, len);
-    f.close();
-    if (n == len) return true; // success!
-
-    _fs->remove(path); // blob was only partially written!
-  }
-  return false; // error
+  if (len < PUB_KEY_SIZE+4+SIGNATURE_SIZE || len > MAX_ADVERT_PKT_LEN) return false;
+  return _blobs.put(key, src_buf, len, _clock->getCurrentTime());
 }
 
 bool DataStore::deleteBlobByKey(const uint8_t key[], int key_len) {
+#if !defined(NRF52_PLATFORM) && !defined(STM32_PLATFORM)
   char path[64];
   makeBlobPath(key, key_len, path, sizeof(path));
-
   _fs->remove(path);
-  
-  return true; // return true even if file did not exist
-}
 #endif
+  _blobs.remove(key);
+  return true; // return true even if blob did not exist
+}
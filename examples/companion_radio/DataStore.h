@@ -3,8 +3,25 @@
 #include <helpers/IdentityStore.h>
 #include <helpers/ContactInfo.h>
 #include <helpers/ChannelDetails.h>
+#include <helpers/ContactColdStore.h>
+#include <helpers/RecordLog.h>
+#include <helpers/BlobStore.h>
 #include "NodePrefs.h"
 
+#define CONTACT_REC_SIZE  152   // bytes per contact, in /contacts3 (and /contacts_cold)
+#define CONTACT_COLD_REC_SIZE  (CONTACT_REC_SIZE + PUB_KEY_SIZE)   // plus shared secret (all zeroes if not calculated), in /contacts_cold
+
+#ifndef CONTACTS_LOG_STORE
+  #define CONTACTS_LOG_STORE  0   // 1 = saving contacts only appends the changes to /contacts3.log, see RecordLog
+#endif
+#if CONTACTS_LOG_STORE && !defined(MAX_CONTACTS)
+  #define MAX_CONTACTS  100   // same default as MyMesh.h
+#endif
+
+#ifndef MAX_COLD_CONTACTS
+  #define MAX_COLD_CONTACTS  0   // cold contacts tier disabled. Opt-in, eg. 2000 on boards with EXTRAFS or QSPIFLASH
+#endif
+
 class DataStoreHost {
 public:
   virtual bool onContactLoaded(const ContactInfo& contact) =0;
@@ -13,16 +30,24 @@ public:
   virtual bool getChannelForSave(uint8_t channel_idx, ChannelDetails& ch) =0;
 };
 
-class DataStore {
+class DataStore : public ContactColdStore {
   FILESYSTEM* _fs;
   FILESYSTEM* _fsExtra;
   mesh::RTCClock* _clock;
+#if CONTACTS_LOG_STORE
+  RecordLog _contacts_log;
+#endif
+  BlobStore _blobs;   // in "/adv_blobs"
   IdentityStore identity_store;
 
   void loadPrefsInt(const char *filename, NodePrefs& prefs, double& node_lat, double& node_lon);
-#if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
-  void checkAdvBlobFile();
-#endif
+  void scanColdContacts();
+
+protected:
+  // ContactColdStore methods, records are in "/contacts_cold"
+  bool readRecord(int rec, ContactInfo& dest) override;
+  bool writeRecord(int rec, const ContactInfo& src) override;
+  bool eraseRecord(int rec) override;
 
 public:
   DataStore(FILESYSTEM& fs, mesh::RTCClock& clock);
@@ -31,12 +56,15 @@ public:
   bool formatFileSystem();
   FILESYSTEM* getPrimaryFS() const { return _fs; }
   FILESYSTEM* getSecondaryFS() const { return _fsExtra; }
+  FILESYSTEM* getOfflineQueueFS() const { return _getContactsChannelsFS(); }
   bool loadMainIdentity(mesh::LocalIdentity &identity);
   bool saveMainIdentity(const mesh::LocalIdentity &identity);
   void loadPrefs(NodePrefs& prefs, double& node_lat, double& node_lon);
   void savePrefs(const NodePrefs& prefs, double node_lat, double node_lon);
   void loadContacts(DataStoreHost* host);
   void saveContacts(DataStoreHost* host, bool (*filter)(const ContactInfo& c) = NULL);
+  bool needsContactsCompact() const;
+  void compactContacts(DataStoreHost* host, bool (*filter)(const ContactInfo& c) = NULL);
   void loadChannels(DataStoreHost* host);
   void saveChannels(DataStoreHost* host);
   void migrateToSecondaryFS();
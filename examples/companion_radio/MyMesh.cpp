@@ -62,11 +62,13 @@
 #define CMD_SET_DEFAULT_FLOOD_SCOPE   63
 #define CMD_GET_DEFAULT_FLOOD_SCOPE   64
 #define CMD_SEND_RAW_PACKET           65
+#define CMD_GET_CONTACT_CHANGES       66   // with optional epoch + seq of last sync
 
 // Stats sub-types for CMD_GET_STATS
 #define STATS_TYPE_CORE               0
 #define STATS_TYPE_RADIO              1
 #define STATS_TYPE_PACKETS             2
+#define STATS_TYPE_OFFLINE_QUEUE       3
 
 #define RESP_CODE_OK                  0
 #define RESP_CODE_ERR                 1
@@ -97,6 +99,9 @@
 #define RESP_ALLOWED_REPEAT_FREQ      26
 #define RESP_CODE_CHANNEL_DATA_RECV   27
 #define RESP_CODE_DEFAULT_FLOOD_SCOPE 28
+#define RESP_CODE_CONTACT_CHANGES_START 29  // first reply to CMD_GET_CONTACT_CHANGES
+#define RESP_CODE_CONTACT_CHANGES     30    // multiple of these, each with a batch of changes
+#define RESP_CODE_CONTACT_CHANGES_END 31    // last reply to CMD_GET_CONTACT_CHANGES
 
 #define MAX_CHANNEL_DATA_LENGTH       (MAX_FRAME_SIZE - 9)
 
@@ -105,6 +110,7 @@
 #define DIRECT_SEND_PERHOP_FACTOR       6.0f
 #define DIRECT_SEND_PERHOP_EXTRA_MILLIS 250
 #define LAZY_CONTACTS_WRITE_DELAY       5000
+#define CONTACTS_COMPACT_DELAY         30000
 
 #define PUBLIC_GROUP_PSK                "izOH6cXN6mrJ5e26oRXNcg=="
 
@@ -211,47 +217,31 @@ void MyMesh::updateContactFromFrame(ContactInfo &contact, uint32_t& last_mod, co
   }
 }
 
-bool MyMesh::Frame::isChannelMsg() const {
-  return buf[0] == RESP_CODE_CHANNEL_MSG_RECV || buf[0] == RESP_CODE_CHANNEL_MSG_RECV_V3 ||
-         buf[0] == RESP_CODE_CHANNEL_DATA_RECV;
+static bool isChannelMsg(const uint8_t frame[], int len) {   // (these can be evicted when offline queue is full)
+  return frame[0] == RESP_CODE_CHANNEL_MSG_RECV || frame[0] == RESP_CODE_CHANNEL_MSG_RECV_V3 ||
+         frame[0] == RESP_CODE_CHANNEL_DATA_RECV;
 }
 
-void MyMesh::addToOfflineQueue(const uint8_t frame[], int len) {
-  if (offline_queue_len >= OFFLINE_QUEUE_SIZE) {
-    MESH_DEBUG_PRINTLN("WARN: offline_queue is full!");
-    int pos = 0;
-    while (pos < offline_queue_len) {
-      if (offline_queue[pos].isChannelMsg()) {
-        for (int i = pos; i < offline_queue_len - 1; i++) { // delete oldest channel msg from queue
-          offline_queue[i] = offline_queue[i + 1];
-        }
-        MESH_DEBUG_PRINTLN("INFO: removed oldest channel message from queue.");
-        offline_queue[offline_queue_len - 1].len = len;
-        memcpy(offline_queue[offline_queue_len - 1].buf, frame, len);
-        return;
-      }
-      pos++;
-    }
-    MESH_DEBUG_PRINTLN("INFO: no channel messages to remove from queue.");
-  } else {
-    offline_queue[offline_queue_len].len = len;
-    memcpy(offline_queue[offline_queue_len].buf, frame, len);
-    offline_queue_len++;
+bool MyMesh::writeNextOfflineMsg() {
+  int out_len;
+  if ((out_len = getFromOfflineQueue(out_frame)) > 0) {
+    _serial->writeFrame(out_frame, out_len);
+#ifdef DISPLAY_CLASS
+    if (_ui) _ui->msgRead(offline_queue.count());
+#endif
+    return true;
   }
+  out_frame[0] = RESP_CODE_NO_MORE_MESSAGES;
+  _serial->writeFrame(out_frame, 1);
+  return false;
 }
 
-int MyMesh::getFromOfflineQueue(uint8_t frame[]) {
-  if (offline_queue_len > 0) {         // check offline queue
-    size_t len = offline_queue[0].len; // take from top of queue
-    memcpy(frame, offline_queue[0].buf, len);
+void MyMesh::addToOfflineQueue(const uint8_t frame[], int len) {
+  offline_queue.push(frame, len);
+}
 
-    offline_queue_len--;
-    for (int i = 0; i < offline_queue_len; i++) { // delete top item from queue
-      offline_queue[i] = offline_queue[i + 1];
-    }
-    return len;
-  }
-  return 0; // queue is empty
+int MyMesh::getFromOfflineQueue(uint8_t frame[]) {
+  return offline_queue.pop(frame);
 }
 
 float MyMesh::getAirtimeBudgetFactor() const {
@@ -280,8 +270,15 @@ uint8_t MyMesh::getExtraAckTransmitCount() const {
   return _prefs.multi_acks;
 }
 
+void MyMesh::writeMsgWaitingPush() {
+  uint8_t frame[1];
+  frame[0] = PUSH_CODE_MSG_WAITING; // send push 'tickle'
+  _msg_waiting_pending = _serial->writeFrame(frame, 1) == 0;  // if send queue is full, retry from checkSerialInterface()
+}
+
 void MyMesh::logRxRaw(float snr, float rssi, const uint8_t raw[], int len) {
-  if (_serial->isConnected() && len + 3 <= MAX_FRAME_SIZE) {
+  if (_serial->isConnected() && !_serial->isWriteBusy()   // just diagnostics, so give way to other frames
+      && len + 3 <= MAX_FRAME_SIZE) {
     int i = 0;
     out_frame[i++] = PUSH_CODE_LOG_RX_DATA;
     out_frame[i++] = (int8_t)(snr * 4);
@@ -340,6 +337,10 @@ void MyMesh::onContactOverwrite(const uint8_t* pub_key) {
   }
 }
 
+void MyMesh::onContactPagedIn(ContactInfo& contact) {
+  dirty_contacts_expiry = futureMillis(LAZY_CONTACTS_WRITE_DELAY);  // no longer in cold store, so make sure it's saved
+}
+
 void MyMesh::onContactsFull() {
   if (_serial->isConnected()) {
     out_frame[0] = PUSH_CODE_CONTACTS_FULL;
@@ -456,16 +457,14 @@ void MyMesh::queueMessage(const ContactInfo &from, uint8_t txt_type, mesh::Packe
   addToOfflineQueue(out_frame, i);
 
   if (_serial->isConnected()) {
-    uint8_t frame[1];
-    frame[0] = PUSH_CODE_MSG_WAITING; // send push 'tickle'
-    _serial->writeFrame(frame, 1);
+    writeMsgWaitingPush();
   }
 
 #ifdef DISPLAY_CLASS
   // we only want to show text messages on display, not cli data
   bool should_display = txt_type == TXT_TYPE_PLAIN || txt_type == TXT_TYPE_SIGNED_PLAIN;
   if (should_display && _ui) {
-    _ui->newMsg(path_len, from.name, text, offline_queue_len);
+    _ui->newMsg(path_len, from.name, text, offline_queue.count());
     if (!_serial->isConnected()) {
       _ui->notify(UIEventType::contactMessage);
     }
@@ -567,9 +566,7 @@ void MyMesh::onChannelMessageRecv(const mesh::GroupChannel &channel, mesh::Packe
   addToOfflineQueue(out_frame, i);
 
   if (_serial->isConnected()) {
-    uint8_t frame[1];
-    frame[0] = PUSH_CODE_MSG_WAITING; // send push 'tickle'
-    _serial->writeFrame(frame, 1);
+    writeMsgWaitingPush();
   } else {
 #ifdef DISPLAY_CLASS
     if (_ui) _ui->notify(UIEventType::channelMessage);
@@ -582,7 +579,7 @@ void MyMesh::onChannelMessageRecv(const mesh::GroupChannel &channel, mesh::Packe
   if (getChannel(channel_idx, channel_details)) {
     channel_name = channel_details.name;
   }
-  if (_ui) _ui->newMsg(path_len, channel_name, text, offline_queue_len);
+  if (_ui) _ui->newMsg(path_len, channel_name, text, offline_queue.count());
 #endif
 }
 
@@ -615,9 +612,7 @@ void MyMesh::onChannelDataRecv(const mesh::GroupChannel &channel, mesh::Packet *
   addToOfflineQueue(out_frame, i);
 
   if (_serial->isConnected()) {
-    uint8_t frame[1];
-    frame[0] = PUSH_CODE_MSG_WAITING; // send push 'tickle'
-    _serial->writeFrame(frame, 1);
+    writeMsgWaitingPush();
   }
 }
 
@@ -854,15 +849,18 @@ void MyMesh::onSendTimeout() {}
 
 MyMesh::MyMesh(mesh::Radio &radio, mesh::RNG &rng, mesh::RTCClock &rtc, SimpleMeshTables &tables, DataStore& store, AbstractUITask* ui)
     : BaseChatMesh(radio, *new ArduinoMillis(), rng, rtc, *new StaticPoolPacketManager(16), tables),
-      _serial(NULL), telemetry(MAX_PACKET_PAYLOAD - 4), _store(&store), _ui(ui) {
+      _serial(NULL), telemetry(MAX_PACKET_PAYLOAD - 4), _store(&store), _ui(ui),
+      offline_queue("/offline_q", OFFLINE_QUEUE_SIZE, OFFLINE_QUEUE_SPILL_SIZE, isChannelMsg) {
   _iter_started = false;
+  _msg_waiting_pending = false;
   _cli_rescue = false;
-  offline_queue_len = 0;
+  _sync_msgs_left = 0;
   app_target_ver = 0;
   clearPendingReqs();
   next_ack_idx = 0;
   sign_data = NULL;
   dirty_contacts_expiry = 0;
+  compact_contacts_expiry = 0;
   memset(advert_paths, 0, sizeof(advert_paths));
   memset(send_scope.key, 0, sizeof(send_scope.key));
   send_unscoped = false;
@@ -957,9 +955,13 @@ void MyMesh::begin(bool has_display) {
 
   resetContacts();
   _store->loadContacts(this);
+  if (_store->needsContactsCompact()) compact_contacts_expiry = futureMillis(CONTACTS_COMPACT_DELAY);
+  if (_store->getMaxContacts() > 0) setColdStore(_store);
+  setChangeLog(&contact_changes);
   bootstrapRTCfromContacts();
   addChannel("Public", PUBLIC_GROUP_PSK); // pre-configure Andy's public channel
   _store->loadChannels(this);
+  offline_queue.begin(_store->getOfflineQueueFS());   // messages spilled to flash before reboot
 
   radio_driver.setParams(_prefs.freq, _prefs.bw, _prefs.sf, _prefs.cr);
   radio_driver.setTxPower(_prefs.tx_power_dbm);
@@ -1034,6 +1036,7 @@ void MyMesh::handleCmdFrame(size_t len) {
     MESH_DEBUG_PRINTLN("App %s connected", app_name);
 
     _iter_started = false; // stop any left-over ContactsIterator
+    contact_changes.stopSync();
     int i = 0;
     out_frame[i++] = RESP_CODE_SELF_INFO;
     out_frame[i++] = ADV_TYPE_CHAT; // what this node Advert identifies as (maybe node's pronouns too?? :-)
@@ -1175,7 +1178,7 @@ void MyMesh::handleCmdFrame(size_t len) {
       writeErrFrame(ERR_CODE_TABLE_FULL);
     }
   } else if (cmd_frame[0] == CMD_GET_CONTACTS) { // get Contact list
-    if (_iter_started) {
+    if (_iter_started || contact_changes.isSyncing()) {
       writeErrFrame(ERR_CODE_BAD_STATE); // iterator is currently busy
     } else {
       if (len >= 5) { // has optional 'since' param
@@ -1195,6 +1198,27 @@ void MyMesh::handleCmdFrame(size_t len) {
       _iter_started = true;
       _most_recent_lastmod = 0;
     }
+  } else if (cmd_frame[0] == CMD_GET_CONTACT_CHANGES) { // changes to Contact list, since app's last sync
+    if (_iter_started || contact_changes.isSyncing()) {
+      writeErrFrame(ERR_CODE_BAD_STATE); // iterator is currently busy
+    } else {
+      uint32_t epoch = 0, since = 0;
+      bool has_since = len >= 9;
+      if (has_since) {
+        memcpy(&epoch, &cmd_frame[1], 4);
+        memcpy(&since, &cmd_frame[5], 4);
+      }
+      bool full = contact_changes.startSync(has_since, epoch, since);
+
+      int i = 0;
+      out_frame[i++] = RESP_CODE_CONTACT_CHANGES_START;
+      out_frame[i++] = full ? 1 : 0;   // 1 = app must clear its list first
+      epoch = contact_changes.getEpoch();
+      memcpy(&out_frame[i], &epoch, 4); i += 4;
+      uint32_t count = getNumContacts(); // total, NOT changed count
+      memcpy(&out_frame[i], &count, 4); i += 4;
+      _serial->writeFrame(out_frame, i);
+    }
   } else if (cmd_frame[0] == CMD_SET_ADVERT_NAME && len >= 2) {
     int nlen = len - 1;
     if (nlen > sizeof(_prefs.node_name) - 1) nlen = sizeof(_prefs.node_name) - 1; // max len
@@ -1259,6 +1283,7 @@ void MyMesh::handleCmdFrame(size_t len) {
     if (recipient) {
       recipient->out_path_len = OUT_PATH_UNKNOWN;
       // recipient->lastmod = ??   shouldn't be needed, app already has this version of contact
+      markContactChanged(*recipient);   // but other apps may not
       dirty_contacts_expiry = futureMillis(LAZY_CONTACTS_WRITE_DELAY);
       writeOKFrame();
     } else {
@@ -1271,6 +1296,7 @@ void MyMesh::handleCmdFrame(size_t len) {
     if (recipient) {
       updateContactFromFrame(*recipient, last_mod, cmd_frame, len);
       recipient->lastmod = last_mod;
+      markContactChanged(*recipient);
       dirty_contacts_expiry = futureMillis(LAZY_CONTACTS_WRITE_DELAY);
       writeOKFrame();
     } else {
@@ -1352,16 +1378,8 @@ void MyMesh::handleCmdFrame(size_t len) {
       writeErrFrame(ERR_CODE_ILLEGAL_ARG);
     }
   } else if (cmd_frame[0] == CMD_SYNC_NEXT_MESSAGE) {
-    int out_len;
-    if ((out_len = getFromOfflineQueue(out_frame)) > 0) {
-      _serial->writeFrame(out_frame, out_len);
-#ifdef DISPLAY_CLASS
-      if (_ui) _ui->msgRead(offline_queue_len);
-#endif
-    } else {
-      out_frame[0] = RESP_CODE_NO_MORE_MESSAGES;
-      _serial->writeFrame(out_frame, 1);
-    }
+    _sync_msgs_left = len >= 2 && cmd_frame[1] > 1 ? cmd_frame[1] - 1 : 0;  // optional: max messages to send
+    if (!writeNextOfflineMsg()) _sync_msgs_left = 0;
   } else if (cmd_frame[0] == CMD_SET_RADIO_PARAMS) {
     int i = 1;
     uint32_t freq;
@@ -1890,6 +1908,23 @@ void MyMesh::handleCmdFrame(size_t len) {
       memcpy(&out_frame[i], &n_recv_direct, 4); i += 4;
       memcpy(&out_frame[i], &n_recv_errors, 4); i += 4;
       _serial->writeFrame(out_frame, i);
+    } else if (stats_type == STATS_TYPE_OFFLINE_QUEUE) {
+      int i = 0;
+      out_frame[i++] = RESP_CODE_STATS;
+      out_frame[i++] = STATS_TYPE_OFFLINE_QUEUE;
+      uint16_t queued = offline_queue.count();
+      uint16_t in_flash = offline_queue.getNumSpilled();
+      uint16_t flash_size = offline_queue.getSpillSize();
+      uint32_t total_spilled = offline_queue.getTotalSpilled();
+      uint32_t evicted = offline_queue.getNumEvicted();
+      uint32_t dropped = offline_queue.getNumDropped();
+      memcpy(&out_frame[i], &queued, 2); i += 2;
+      memcpy(&out_frame[i], &in_flash, 2); i += 2;
+      memcpy(&out_frame[i], &flash_size, 2); i += 2;
+      memcpy(&out_frame[i], &total_spilled, 4); i += 4;
+      memcpy(&out_frame[i], &evicted, 4); i += 4;
+      memcpy(&out_frame[i], &dropped, 4); i += 4;
+      _serial->writeFrame(out_frame, i);
     } else {
       writeErrFrame(ERR_CODE_ILLEGAL_ARG); // invalid stats sub-type
     }
@@ -1998,6 +2033,7 @@ static bool save_filter(const ContactInfo& c) {
 
 void MyMesh::saveContacts() {
   _store->saveContacts(this, save_filter);
+  if (getColdStore()) onContactsSaved();
 }
 
 void MyMesh::enterCLIRescue() {
@@ -2182,6 +2218,11 @@ void MyMesh::checkSerialInterface() {
   size_t len = _serial->checkRecvFrame(cmd_frame);
   if (len > 0) {
     handleCmdFrame(len);
+  } else if (_msg_waiting_pending && !_serial->isWriteBusy()) {
+    if (_serial->isConnected() && offline_queue.count() > 0) writeMsgWaitingPush(); else _msg_waiting_pending = false;
+  } else if (_sync_msgs_left > 0 && !_serial->isWriteBusy()) {   // rest of a batched CMD_SYNC_NEXT_MESSAGE
+    _sync_msgs_left--;
+    if (!writeNextOfflineMsg()) _sync_msgs_left = 0;
   } else if (_iter_started              // check if our ContactsIterator is 'running'
              && !_serial->isWriteBusy() // don't spam the Serial Interface too quickly!
   ) {
@@ -2208,6 +2249,17 @@ void MyMesh::checkSerialInterface() {
       _serial->writeFrame(out_frame, 5);
       _iter_started = false;
     }
+  } else if (contact_changes.isSyncing() && !_serial->isWriteBusy()) {
+    out_frame[0] = RESP_CODE_CONTACT_CHANGES;
+    int n = contact_changes.writeSyncFrame(this, &out_frame[1], MAX_FRAME_SIZE - 1);
+    if (n > 0) {
+      _serial->writeFrame(out_frame, 1 + n);
+    } else {  // finished
+      out_frame[0] = RESP_CODE_CONTACT_CHANGES_END;
+      uint32_t seq = contact_changes.getSyncEndSeq();  // app saves this (with epoch) for next time
+      memcpy(&out_frame[1], &seq, 4);
+      _serial->writeFrame(out_frame, 5);
+    }
   //} else if (!_serial->isWriteBusy()) {
   //  checkConnections();    // TODO - deprecate the 'Connections' stuff
   }
@@ -2226,6 +2278,10 @@ void MyMesh::loop() {
   if (dirty_contacts_expiry && millisHasNowPassed(dirty_contacts_expiry)) {
     saveContacts();
     dirty_contacts_expiry = 0;
+    if (_store->needsContactsCompact()) compact_contacts_expiry = futureMillis(CONTACTS_COMPACT_DELAY);
+  } else if (compact_contacts_expiry && millisHasNowPassed(compact_contacts_expiry) && _mgr->getOutboundTotal() == 0) {
+    _store->compactContacts(this, save_filter);   // while idle, rather than when next saving
+    compact_contacts_expiry = 0;
   }
 
 #ifdef DISPLAY_CLASS
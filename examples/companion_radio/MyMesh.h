@@ -30,7 +30,9 @@
 #include <helpers/ArduinoHelpers.h>
 #include <helpers/BaseSerialInterface.h>
 #include <helpers/IdentityStore.h>
+#include <helpers/OfflineQueue.h>
 #include <helpers/SimpleMeshTables.h>
+#include <helpers/SimpleMeshCaches.h>
 #include <helpers/StaticPoolPacketManager.h>
 #include <target.h>
 
@@ -63,6 +65,14 @@
 #define OFFLINE_QUEUE_SIZE 16
 #endif
 
+#ifndef OFFLINE_QUEUE_SPILL_SIZE   // frames that can spill to flash (184 bytes each), when RAM queue is full
+  #if (defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)) && !defined(EXTRAFS) && !defined(QSPIFLASH)
+    #define OFFLINE_QUEUE_SPILL_SIZE 0   // internal flash is too small
+  #else
+    #define OFFLINE_QUEUE_SPILL_SIZE 256
+  #endif
+#endif
+
 #ifndef BLE_NAME_PREFIX
 #define BLE_NAME_PREFIX "MeshCore-"
 #endif
@@ -84,7 +94,7 @@ struct AdvertPath {
   uint8_t path[MAX_PATH_SIZE];
 };
 
-class MyMesh : public BaseChatMesh, public DataStoreHost {
+class MyMesh : public BaseChatMesh, public DataStoreHost, public ContactSyncSource {
 public:
   MyMesh(mesh::Radio &radio, mesh::RNG &rng, mesh::RTCClock &rtc, SimpleMeshTables &tables, DataStore& store, AbstractUITask* ui=NULL);
 
@@ -123,6 +133,7 @@ protected:
   uint8_t getAutoAddMaxHops() const override;
   void onContactsFull() override;
   void onContactOverwrite(const uint8_t* pub_key) override;
+  void onContactPagedIn(ContactInfo& contact) override;
   bool onContactPathRecv(ContactInfo& from, uint8_t* in_path, uint8_t in_path_len, uint8_t* out_path, uint8_t out_path_len, uint8_t extra_type, uint8_t* extra, uint8_t extra_len) override;
   void onDiscoveredContact(ContactInfo &contact, bool is_new, uint8_t path_len, const uint8_t* path) override;
   void onContactPathUpdated(const ContactInfo &contact) override;
@@ -159,6 +170,9 @@ protected:
   bool onChannelLoaded(uint8_t channel_idx, const ChannelDetails& ch) override { return setChannel(channel_idx, ch); }
   bool getChannelForSave(uint8_t channel_idx, ChannelDetails& ch) override { return getChannel(channel_idx, ch); }
 
+  // ContactSyncSource methods
+  bool getContactForSync(uint32_t idx, ContactInfo& contact) override { return getContactByIdx(idx, contact); }
+
   void clearPendingReqs() {
     pending_login = pending_status = pending_telemetry = pending_discovery = pending_req = 0;
   }
@@ -185,9 +199,11 @@ private:
   void writeErrFrame(uint8_t err_code);
   void writeDisabledFrame();
   void writeContactRespFrame(uint8_t code, const ContactInfo &contact);
+  void writeMsgWaitingPush();
   void updateContactFromFrame(ContactInfo &contact, uint32_t& last_mod, const uint8_t *frame, int len);
   void addToOfflineQueue(const uint8_t frame[], int len);
   int getFromOfflineQueue(uint8_t frame[]);
+  bool writeNextOfflineMsg();
   int getBlobByKey(const uint8_t key[], int key_len, uint8_t dest_buf[]) override { 
     return _store->getBlobByKey(key, key_len, dest_buf);
   }
@@ -217,6 +233,8 @@ private:
   uint32_t _most_recent_lastmod;
   uint32_t _active_ble_pin;
   bool _iter_started;
+  bool _msg_waiting_pending;   // PUSH_CODE_MSG_WAITING didn't fit in send queue, retry later
+  ContactChangeLog contact_changes;
   bool _cli_rescue;
   bool send_unscoped;   // force un-scoped flood (instead of using send_scope)
   char cli_command[80];
@@ -224,6 +242,7 @@ private:
   uint8_t *sign_data;
   uint32_t sign_data_len;
   unsigned long dirty_contacts_expiry;
+  unsigned long compact_contacts_expiry;
 
   TransportKey send_scope;
 
@@ -231,14 +250,8 @@ private:
   uint8_t out_frame[MAX_FRAME_SIZE + 1];
   CayenneLPP telemetry;
 
-  struct Frame {
-    uint8_t len;
-    uint8_t buf[MAX_FRAME_SIZE];
-
-    bool isChannelMsg() const;
-  };
-  int offline_queue_len;
-  Frame offline_queue[OFFLINE_QUEUE_SIZE];
+  OfflineQueue offline_queue;   // spills to "/offline_q"
+  uint8_t _sync_msgs_left;   // of a batched CMD_SYNC_NEXT_MESSAGE
 
   struct AckTableEntry {
     unsigned long msg_sent;
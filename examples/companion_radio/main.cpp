@@ -93,6 +93,7 @@ static uint32_t _atoi(const char* sp) {
 
 StdRNG fast_rng;
 SimpleMeshTables tables;
+SimpleMeshCaches caches;
 MyMesh the_mesh(radio_driver, fast_rng, rtc_clock, tables, store
    #ifdef DISPLAY_CLASS
       , &ui_task
@@ -112,6 +113,7 @@ void halt() {
 #endif
 
 void setup() {
+  the_mesh.setCaches(&caches);
   Serial.begin(115200);
 
   board.begin();
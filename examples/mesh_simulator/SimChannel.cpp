@@ -0,0 +1,164 @@
+#include "SimChannel.h"
+#include "SimRadio.h"
+#include <math.h>
+
+#define LOST_NONE         0
+#define LOST_COLLISION    1
+#define LOST_HALF_DUPLEX  2
+
+#define INTERFERENCE_MARGIN_DB   10.0f   // links weaker than (threshold - this) are ignored altogether
+#define CAD_MARGIN_DB             5.0f   // preamble is detectable a little below the demod threshold
+
+static const float snr_threshold[] = { -7.5f, -10.0f, -12.5f, -15.0f, -17.5f, -20.0f };   // SF7..12
+
+float SimRadioParams::snrThreshold() const {
+  int i = sf - 7;
+  if (i < 0) i = 0;
+  if (i > 5) i = 5;
+  return snr_threshold[i];
+}
+
+uint32_t SimRadioParams::airtimeFor(int len) const {
+  // Semtech AN1200.13 formula (explicit header, CRC on)
+  double t_sym = pow(2.0, sf) / bw;   // millis
+  int preamble_len = sf <= 8 ? 32 : 16;   // same as RadioLibWrappers
+  int de = t_sym > 16.0 ? 1 : 0;    // low data-rate optimise
+  double num = 8.0*len - 4.0*sf + 28 + 16;
+  double payload_syms = 8 + fmax(ceil(num / (4.0*(sf - 2*de))) * cr, 0.0);
+  return (uint32_t) ((preamble_len + 4.25 + payload_syms) * t_sym + 0.5);
+}
+
+SimChannel::SimChannel(const SimRadioParams& params, uint64_t seed) : _params(params), _rng(seed) {
+  _n_tx = _n_rx_ok = _n_collisions = _n_half_duplex = _n_weak = 0;
+}
+
+int SimChannel::attach(SimRadio* radio) {
+  _radios.push_back(radio);
+  _links.push_back(std::vector<Link>());
+  _inflight.push_back(std::vector<Reception>());
+  return _radios.size() - 1;
+}
+
+float SimChannel::placeRandomly(float area_km) {
+  int n = _radios.size();
+  std::vector<double> x(n), y(n);
+  for (int i = 0; i < n; i++) {
+    x[i] = _rng.nextDouble() * area_km;
+    y[i] = _rng.nextDouble() * area_km;
+  }
+
+  float min_snr = _params.snrThreshold() - INTERFERENCE_MARGIN_DB;
+  int total = 0;
+  for (int i = 0; i < n; i++) {
+    _links[i].clear();
+  }
+  for (int i = 0; i < n; i++) {
+    for (int j = i + 1; j < n; j++) {
+      double d = sqrt((x[i] - x[j])*(x[i] - x[j]) + (y[i] - y[j])*(y[i] - y[j]));
+      if (d < 0.01) d = 0.01;
+      float snr = _params.snr_at_1km - 10.0f*_params.path_loss_exp*log10(d) + _params.shadowing_db*_rng.nextGaussian();
+      if (snr < min_snr) continue;
+
+      Link l;
+      l.snr = snr;   // links are symmetric
+      l.to = j; _links[i].push_back(l);
+      l.to = i; _links[j].push_back(l);
+      total += 2;
+    }
+  }
+  return n > 0 ? (float)total / n : 0.0f;
+}
+
+float SimChannel::linkSuccessProb(float snr, float threshold) {
+  return 1.0f / (1.0f + expf(-(snr - threshold) / 0.75f));   // ~50% at threshold, ~95% at +2.2 dB
+}
+
+void SimChannel::transmit(int from, const uint8_t* bytes, int len, unsigned long now, uint32_t airtime) {
+  _n_tx++;
+
+  // half-duplex: anything this node was in the middle of receiving is now lost
+  for (size_t k = 0; k < _inflight[from].size(); k++) {
+    if (_inflight[from][k].corrupt == LOST_NONE) _inflight[from][k].corrupt = LOST_HALF_DUPLEX;
+  }
+
+  unsigned long end = now + airtime;
+  std::shared_ptr<Frame> frame(new Frame());
+  frame->len = len;
+  memcpy(frame->data, bytes, len);
+
+  const std::vector<Link>& links = _links[from];
+  for (size_t i = 0; i < links.size(); i++) {
+    int to = links[i].to;
+    std::vector<Reception>& inflight = _inflight[to];
+
+    Reception r;
+    r.start = now;
+    r.end = end;
+    r.snr = links[i].snr;
+    r.corrupt = (_radios[to]->isTransmitting() && _radios[to]->getTxEnd() > now) ? LOST_HALF_DUPLEX : LOST_NONE;
+    r.frame = frame;
+
+    // collisions with other transmissions already arriving at this receiver
+    for (size_t k = 0; k < inflight.size(); k++) {
+      Reception& other = inflight[k];
+      if (other.end <= now) continue;   // already finished (just not delivered yet)
+
+      if (r.snr < other.snr + _params.capture_db && r.corrupt == LOST_NONE) r.corrupt = LOST_COLLISION;
+      if (other.snr < r.snr + _params.capture_db && other.corrupt == LOST_NONE) other.corrupt = LOST_COLLISION;
+    }
+    inflight.push_back(r);
+  }
+}
+
+void SimChannel::deliverDue(int node, unsigned long now) {
+  std::vector<Reception>& inflight = _inflight[node];
+  float threshold = _params.snrThreshold();
+
+  size_t k = 0;
+  while (k < inflight.size()) {
+    Reception& r = inflight[k];
+    if (r.end > now) {
+      k++;
+      continue;
+    }
+    if (r.corrupt == LOST_NONE) {
+      if (_rng.nextDouble() < linkSuccessProb(r.snr, threshold)) {
+        _n_rx_ok++;
+        _radios[node]->onFrameReceived(r.frame->data, r.frame->len, r.snr);
+      } else {
+        _n_weak++;
+      }
+    } else if (r.snr >= threshold) {   // only count losses of packets that could otherwise have been decoded
+      if (r.corrupt == LOST_HALF_DUPLEX) {
+        _n_half_duplex++;
+      } else {
+        _n_collisions++;
+      }
+      _radios[node]->onFrameLost(r.corrupt == LOST_HALF_DUPLEX);
+    }
+    inflight[k] = inflight.back();   // order doesn't matter
+    inflight.pop_back();
+  }
+}
+
+bool SimChannel::isReceiving(int node, unsigned long now) const {
+  const std::vector<Reception>& inflight = _inflight[node];
+  float cad_snr = _params.snrThreshold() - CAD_MARGIN_DB;
+  for (size_t k = 0; k < inflight.size(); k++) {
+    if (inflight[k].start <= now && now < inflight[k].end && inflight[k].snr >= cad_snr) return true;
+  }
+  return false;
+}
+
+unsigned long SimChannel::nextReceptionEnd(int node) const {
+  const std::vector<Reception>& inflight = _inflight[node];
+  float min_snr = _params.snrThreshold() - CAD_MARGIN_DB;
+  unsigned long t = 0;
+  for (size_t k = 0; k < inflight.size(); k++) {
+    // already lost (or hopelessly weak) ones are just cleaned up on the node's next wake-up
+    if (inflight[k].corrupt != LOST_NONE || inflight[k].snr < min_snr) continue;
+
+    if (t == 0 || inflight[k].end < t) t = inflight[k].end;
+  }
+  return t;
+}
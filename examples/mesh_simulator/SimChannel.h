@@ -0,0 +1,101 @@
+#pragma once
+
+#include <Mesh.h>
+#include <memory>
+#include <vector>
+#include "SimClock.h"
+
+class SimRadio;
+
+/**
+ * \brief  LoRa modem + propagation parameters shared by every node in a simulation.
+*/
+struct SimRadioParams {
+  int sf;                 // spreading factor, 7..12
+  float bw;               // bandwidth, kHz
+  int cr;                 // coding rate denominator, 5..8
+  float snr_at_1km;       // SNR (dB) of a link at 1 km distance
+  float path_loss_exp;    // path-loss exponent (SNR drops 10*n dB per decade of distance)
+  float shadowing_db;     // std deviation of per-link log-normal shadowing
+  float capture_db;       // a colliding packet survives if it is this much stronger than the others
+  float noise_floor;      // dBm, used for synthesising RSSI
+
+  SimRadioParams() {
+    sf = 11; bw = 250.0f; cr = 5;
+    snr_at_1km = 5.0f; path_loss_exp = 3.0f; shadowing_db = 4.0f;
+    capture_db = 6.0f;
+    noise_floor = -120.0f;
+  }
+
+  /** \returns  the demodulation floor SNR for this spreading factor (same table as RadioLibWrapper) */
+  float snrThreshold() const;
+
+  /** \returns  LoRa time-on-air in milliseconds, for given raw packet length */
+  uint32_t airtimeFor(int len) const;
+};
+
+/**
+ * \brief  The shared RF medium. Tracks every in-flight transmission at each receiver, and decides which
+ *      ones survive (collisions, capture effect, half-duplex, and SNR-dependent loss).
+*/
+class SimChannel {
+  struct Link {
+    int to;
+    float snr;
+  };
+  struct Frame {
+    int len;
+    uint8_t data[MAX_TRANS_UNIT];
+  };
+  struct Reception {
+    unsigned long start, end;
+    float snr;
+    uint8_t corrupt;   // one of LOST_*
+    std::shared_ptr<const Frame> frame;   // shared by all receivers of one transmission
+  };
+
+  SimRadioParams _params;
+  SimRNG _rng;
+  std::vector<SimRadio*> _radios;
+  std::vector<std::vector<Link> > _links;
+  std::vector<std::vector<Reception> > _inflight;   // per receiver
+  uint32_t _n_tx, _n_rx_ok, _n_collisions, _n_half_duplex, _n_weak;
+
+  static float linkSuccessProb(float snr, float threshold);
+
+public:
+  SimChannel(const SimRadioParams& params, uint64_t seed);
+
+  const SimRadioParams& getParams() const { return _params; }
+
+  /** \brief  registers a radio, returns its node index */
+  int attach(SimRadio* radio);
+
+  /**
+   * \brief  Place all attached nodes uniformly in a square of given side (km), and compute link SNRs.
+   *      Links too weak to ever be heard (or to interfere) are omitted.
+   * \returns  average number of neighbours per node
+  */
+  float placeRandomly(float area_km);
+
+  int getNumNeighbours(int node) const { return _links[node].size(); }
+  int getNeighbour(int node, int i) const { return _links[node][i].to; }
+
+  /** \brief  Node 'from' has started transmitting raw bytes, for 'airtime' millis from 'now' */
+  void transmit(int from, const uint8_t* bytes, int len, unsigned long now, uint32_t airtime);
+
+  /** \brief  Hand over all receptions at 'node' that have finished by 'now' */
+  void deliverDue(int node, unsigned long now);
+
+  /** \returns  true if a transmission is currently arriving at 'node' (ie. CAD would report busy) */
+  bool isReceiving(int node, unsigned long now) const;
+
+  /** \returns  the end time of the earliest reception at 'node' that could still be decoded, or 0 if none */
+  unsigned long nextReceptionEnd(int node) const;
+
+  uint32_t getNumTransmits() const { return _n_tx; }
+  uint32_t getNumReceived() const { return _n_rx_ok; }
+  uint32_t getNumCollisions() const { return _n_collisions; }
+  uint32_t getNumHalfDuplexLost() const { return _n_half_duplex; }
+  uint32_t getNumWeakLost() const { return _n_weak; }
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <Mesh.h>
+#include <math.h>
+
+/**
+ * \brief  The virtual (simulated) millisecond clock, shared by all nodes. Only moves when the scheduler advances it.
+*/
+class SimClock : public mesh::MillisecondClock {
+  unsigned long _now;
+
+public:
+  SimClock() { _now = 0; }
+
+  unsigned long getMillis() override { return _now; }
+
+  void advanceTo(unsigned long t) {
+    if (t > _now) _now = t;
+  }
+};
+
+/**
+ * \brief  Per-node RTC, derived from the shared virtual clock. (start_time can differ per node, to model clock skew)
+*/
+class SimRTCClock : public mesh::RTCClock {
+  SimClock* _ms;
+  uint32_t _base_time;
+  unsigned long _base_millis;
+
+public:
+  SimRTCClock(SimClock& ms, uint32_t start_time) : _ms(&ms), _base_time(start_time), _base_millis(ms.getMillis()) { }
+
+  uint32_t getCurrentTime() override { return _base_time + (_ms->getMillis() - _base_millis) / 1000; }
+
+  void setCurrentTime(uint32_t time) override {
+    _base_time = time;
+    _base_millis = _ms->getMillis();
+  }
+};
+
+/**
+ * \brief  Deterministic (seeded) xorshift RNG, so that a simulation run can be replayed exactly.
+*/
+class SimRNG : public mesh::RNG {
+  uint64_t _state;
+
+public:
+  SimRNG(uint64_t seed) { _state = seed ? seed : 0x9E3779B97F4A7C15ULL; }
+
+  uint32_t next32() {
+    _state ^= _state << 13;
+    _state ^= _state >> 7;
+    _state ^= _state << 17;
+    return (uint32_t) (_state >> 16);
+  }
+
+  // uniform in [0, 1)
+  double nextDouble() { return (next32() >> 8) / 16777216.0; }
+
+  // standard normal (Box-Muller)
+  double nextGaussian() {
+    double u1 = nextDouble() + 1e-12, u2 = nextDouble();
+    return sqrt(-2.0 * log(u1)) * cos(6.283185307179586 * u2);
+  }
+
+  void random(uint8_t* dest, size_t sz) override {
+    for (size_t i = 0; i < sz; i++) {
+      dest[i] = (uint8_t) next32();
+    }
+  }
+};
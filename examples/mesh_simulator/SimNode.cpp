@@ -0,0 +1,403 @@
+#include "SimNode.h"
+#include <helpers/PostBatch.h>
+#include <helpers/TxtDataHelpers.h>
+
+#define SIM_POLL_MILLIS   50    // re-check interval when a due outbound packet is held back (eg. by tx budget)
+
+// as per simple_room_server
+#define ROOM_PUSH_INTERVAL        1200
+#define ROOM_ACK_TIMEOUT_FLOOD    12000
+#define ROOM_TIMEOUT_BASE         4000
+#define ROOM_ACK_TIMEOUT_FACTOR   2000
+#define ROOM_MAX_QUEUED           2
+#define ROOM_OUT_PATH_UNKNOWN     0xFF
+#define ROOM_ACK_DELAY            200   // as per TXT_ACK_DELAY
+
+static const uint8_t ROOM_AUTHOR[4] = { 0xA0, 0xA1, 0xA2, 0xA3 };
+
+// ----------------------------------------------------------------------------------------
+
+void SimPacketManager::queueOutbound(mesh::Packet* packet, uint8_t priority, uint32_t scheduled_for) {
+  _out_sched[packet] = scheduled_for;
+  _out_due.insert(scheduled_for);
+  _mgr->queueOutbound(packet, priority, scheduled_for);
+  if ((int)_out_sched.size() != getOutboundTotal()) syncOutbound();   // this packet, or another one, was dropped
+  if (getOutboundTotal() > _max_outbound) _max_outbound = getOutboundTotal();
+}
+
+void SimPacketManager::syncOutbound() {
+  std::map<const mesh::Packet*, unsigned long> queued;
+  for (int i = 0; i < getOutboundTotal(); i++) {
+    auto it = _out_sched.find(getOutboundByIdx(i));
+    if (it != _out_sched.end()) queued.insert(*it);
+  }
+  _out_sched.swap(queued);
+  _out_due.clear();
+  for (auto& e : _out_sched) _out_due.insert(e.second);
+}
+
+void SimPacketManager::onOutboundRemoved(const mesh::Packet* packet) {
+  auto it = _out_sched.find(packet);
+  if (it == _out_sched.end()) return;
+  _out_due.erase(_out_due.find(it->second));
+  _out_sched.erase(it);
+}
+
+mesh::Packet* SimPacketManager::getNextOutbound(uint32_t now) {
+  mesh::Packet* pkt = _mgr->getNextOutbound(now);
+  if (pkt) {
+    auto it = _out_sched.find(pkt);
+    if (it != _out_sched.end()) {
+      SimClassStats& s = _class_stats[FairQueuePacketManager::defaultClassOf(pkt)];
+      uint32_t delay = now - it->second;
+      s.sent++;
+      s.delay_sum += delay;
+      if (delay > s.delay_max) s.delay_max = delay;
+      if (delay > TX_STARVED_MILLIS) s.starved++;
+    }
+    onOutboundRemoved(pkt);
+  }
+  return pkt;
+}
+
+mesh::Packet* SimPacketManager::removeOutboundByIdx(int i) {
+  mesh::Packet* pkt = _mgr->removeOutboundByIdx(i);
+  if (pkt) onOutboundRemoved(pkt);
+  return pkt;
+}
+
+void SimPacketManager::queueInbound(mesh::Packet* packet, uint32_t scheduled_for) {
+  _mgr->queueInbound(packet, scheduled_for);
+  _in_due.insert(scheduled_for);   // rx queue is same size as pool, so can never overflow
+}
+
+mesh::Packet* SimPacketManager::getNextInbound(uint32_t now) {
+  mesh::Packet* pkt = _mgr->getNextInbound(now);
+  if (pkt) _in_due.erase(_in_due.begin());
+  return pkt;
+}
+
+// ----------------------------------------------------------------------------------------
+
+uint32_t SimMsgTracker::registerMsg(int origin, unsigned long now) {
+  Msg m;
+  m.sent_at = now;
+  m.origin = origin;
+  m.reached.assign(_num_nodes, false);
+  m.reached[origin] = true;
+  _msgs.push_back(m);
+  return _msgs.size() - 1;
+}
+
+long SimMsgTracker::onMsgRecv(uint32_t msg_id, int node, unsigned long now) {
+  if (msg_id >= _msgs.size()) return -1;
+
+  Msg& m = _msgs[msg_id];
+  if (m.reached[node]) {
+    app_dups++;
+    return -1;
+  }
+  m.reached[node] = true;
+
+  long latency = now - m.sent_at;
+  deliveries++;
+  latency_sum += latency;
+  if (latency > latency_max) latency_max = latency;
+  return latency;
+}
+
+// ----------------------------------------------------------------------------------------
+
+SimNode::SimNode(SimChannel& channel, SimRadio& radio, SimClock& ms, SimRNG& rng, SimRTCClock& rtc, SimPacketManager& mgr,
+                 SimpleMeshTables& tables, SimMsgTracker& tracker, const SimTraffic& traffic, const mesh::GroupChannel& group)
+  : mesh::Mesh(radio, ms, rng, rtc, mgr, tables), _channel(&channel), _sim_radio(&radio), _sim_mgr(&mgr), _sim_tables(&tables),
+    _tracker(&tracker), _traffic(&traffic), _channel_secret(group)
+{
+  memset(&_stats, 0, sizeof(_stats));
+  next_advert = next_msg = 0;
+  cad_retry_time = 0;
+  _room = NULL;
+  self_id = mesh::LocalIdentity(&rng);
+  setCaches(&_sim_caches);
+}
+
+void SimNode::begin() {
+  mesh::Mesh::begin();
+
+  // stagger the start of each node's traffic
+  if (_traffic->advert_interval_ms) next_advert = futureMillis(getRNG()->nextInt(1, _traffic->advert_interval_ms));
+  if (_traffic->msg_interval_ms) next_msg = futureMillis(getRNG()->nextInt(1, _traffic->msg_interval_ms));
+}
+
+void SimNode::setRoomPeer(SimNode& peer, bool is_server) {
+  _room = new SimRoom();
+  _room->peer = peer.self_id;
+  self_id.calcSharedSecret(_room->secret, peer.self_id);
+  _room->out_path_len = ROOM_OUT_PATH_UNKNOWN;   // server starts with flood, client learns path from server
+  _room->is_server = is_server;
+  memset(&_room->sync, 0, sizeof(_room->sync));
+  _room->sync.reset(0, 0);
+  _room->sync_since = 0;
+  _room->done_at = 0;
+  _room->recv.assign(_traffic->room_posts + 1, false);
+}
+
+int SimNode::calcRxDelay(float score, uint32_t air_time) const {
+  if (_traffic->rx_delay_base <= 0.0f) return 0;
+  return (int)((pow(_traffic->rx_delay_base, 0.85f - score) - 1.0) * air_time);
+}
+
+uint32_t SimNode::getCADFailRetryDelay() const {
+  uint32_t d = mesh::Mesh::getCADFailRetryDelay();
+  const_cast<SimNode*>(this)->cad_retry_time = _ms->getMillis() + d;   // remember, so nextWake() doesn't need to poll
+  return d;
+}
+
+bool SimNode::allowPacketForward(const mesh::Packet* packet) {
+  return packet->getPathHashCount() < _traffic->max_flood_hops;
+}
+
+uint32_t SimNode::getRetransmitDelay(const mesh::Packet* packet) {
+  // same as simple_repeater
+  uint32_t t = (_radio->getEstAirtimeFor(packet->getPathByteLen() + packet->payload_len + 2) * _traffic->tx_delay_factor);
+  return getRNG()->nextInt(0, 5*t + 1);
+}
+
+int SimNode::searchChannelsByHash(const uint8_t* hash, mesh::GroupChannel channels[], int max_matches) {
+  if (max_matches > 0 && memcmp(hash, _channel_secret.hash, PATH_HASH_SIZE) == 0) {
+    channels[0] = _channel_secret;
+    return 1;
+  }
+  return 0;
+}
+
+void SimNode::onGroupDataRecv(mesh::Packet* packet, uint8_t type, const mesh::GroupChannel& channel, uint8_t* data, size_t len) {
+  if (type != PAYLOAD_TYPE_GRP_DATA || len < 4) return;
+
+  uint32_t msg_id;
+  memcpy(&msg_id, data, 4);
+  long latency = _tracker->onMsgRecv(msg_id, getNodeId(), _ms->getMillis());
+  if (latency < 0) {
+    _stats.msg_dups++;    // got past the packet hash table (ie. evicted)
+  } else {
+    _stats.msgs_recv++;
+    _stats.latency_sum += latency;
+    if (latency > _stats.latency_max) _stats.latency_max = latency;
+  }
+}
+
+void SimNode::onAdvertRecv(mesh::Packet* packet, const mesh::Identity& id, uint32_t timestamp, const uint8_t* app_data, size_t app_data_len) {
+  _stats.adverts_heard++;
+}
+
+int SimNode::searchPeersByHash(const uint8_t* hash) {
+  return (_room && _room->peer.isHashMatch(hash)) ? 1 : 0;
+}
+
+void SimNode::getPeerSharedSecret(uint8_t* dest_secret, int peer_idx) {
+  memcpy(dest_secret, _room->secret, PUB_KEY_SIZE);
+}
+
+void SimNode::pushRoomPost(unsigned long now) {
+  SimRoom& r = *_room;
+  r.sync.checkTimeouts(now);
+  if (_mgr->getOutboundTotal() >= ROOM_MAX_QUEUED || !r.sync.canPush(now)) return;
+
+  uint32_t first, last = r.sync.getResendTimestamp(&first);   // post timestamps are just 1..room_posts
+  uint32_t slot_ts = last;
+  if (last == 0) {
+    first = (r.sync_since > r.sync.cursor ? r.sync_since : r.sync.cursor) + 1;
+    last = _traffic->room_posts;
+    if (first > last) return;   // all pushed
+  }
+
+  char text[POST_BATCH_MAX_LEN];
+  int text_len = _traffic->room_post_len;
+  if (text_len < 1) text_len = 1;
+  if (text_len > POST_BATCH_MAX_LEN - POST_BATCH_HEADER_SIZE - POST_BATCH_ENTRY_SIZE) text_len = POST_BATCH_MAX_LEN - POST_BATCH_HEADER_SIZE - POST_BATCH_ENTRY_SIZE;
+  memset(text, 'p', text_len);
+  text[text_len] = 0;
+
+  uint8_t data[MAX_PACKET_PAYLOAD];
+  uint8_t attempt = getRNG()->nextInt(0, 4);
+  int len, num_posts;
+  if (_traffic->room_batch) {
+    PostBatchWriter batch(data, sizeof(data), attempt);
+    for (uint32_t ts = first; ts <= last && batch.add(ts, ROOM_AUTHOR, text); ts++) ;
+    len = batch.finish();
+    num_posts = batch.getCount();
+    if (slot_ts == 0) slot_ts = batch.getLastTimestamp();
+  } else {   // as simple_room_server's pushPostToClient()
+    memcpy(data, &first, 4);
+    data[4] = (TXT_TYPE_SIGNED_PLAIN << 2) | attempt;
+    memcpy(&data[5], ROOM_AUTHOR, 4);
+    memcpy(&data[9], text, text_len);
+    len = 9 + text_len;
+    num_posts = 1;
+    slot_ts = first;
+  }
+
+  uint32_t expected_ack;
+  mesh::Utils::sha256((uint8_t *)&expected_ack, 4, data, len, r.peer.pub_key, PUB_KEY_SIZE);
+  mesh::Packet* pkt = createDatagram(PAYLOAD_TYPE_TXT_MSG, r.peer, r.secret, data, len);
+  if (pkt == NULL) return;
+
+  uint32_t timeout;
+  if (r.out_path_len == ROOM_OUT_PATH_UNKNOWN) {
+    sendFlood(pkt);
+    timeout = ROOM_ACK_TIMEOUT_FLOOD;
+  } else {
+    sendDirect(pkt, r.out_path, r.out_path_len);
+    timeout = ROOM_TIMEOUT_BASE + ROOM_ACK_TIMEOUT_FACTOR * ((r.out_path_len & 63) + 1);
+  }
+  r.sync.onPushed(slot_ts, expected_ack, now, timeout, ROOM_PUSH_INTERVAL, first, num_posts);
+  _stats.room_pushes++;
+}
+
+void SimNode::onRoomAck(uint32_t ack_crc) {
+  uint32_t acked_through;
+  if (!_room->sync.onAck(ack_crc, _ms->getMillis(), acked_through)) return;
+
+  if (acked_through > _room->sync_since) _room->sync_since = acked_through;
+  if (_room->sync_since >= (uint32_t)_traffic->room_posts && _room->done_at == 0) _room->done_at = _ms->getMillis();
+}
+
+void SimNode::onAckRecv(mesh::Packet* packet, uint32_t ack_crc) {
+  if (_room && _room->is_server) {
+    onRoomAck(ack_crc);
+    packet->markDoNotRetransmit();
+  }
+}
+
+bool SimNode::onPeerPathRecv(mesh::Packet* packet, int sender_idx, const uint8_t* secret, uint8_t* path, uint8_t path_len, uint8_t extra_type, uint8_t* extra, uint8_t extra_len) {
+  _room->out_path_len = mesh::Packet::copyPath(_room->out_path, path, path_len);
+  if (_room->is_server && extra_type == PAYLOAD_TYPE_ACK && extra_len >= 4) {
+    uint32_t ack_crc;
+    memcpy(&ack_crc, extra, 4);
+    onRoomAck(ack_crc);
+  }
+  return true;   // send reciprocal path, so client can ACK directly
+}
+
+void SimNode::onPeerDataRecv(mesh::Packet* packet, uint8_t type, int sender_idx, const uint8_t* secret, uint8_t* data, size_t len) {
+  if (type != PAYLOAD_TYPE_TXT_MSG || len <= 9 || _room->is_server) return;
+
+  // as per BaseChatMesh::onPeerDataRecv()
+  data[len] = 0;
+  uint8_t flags = data[4] >> 2;
+  uint32_t ts, ack_hash;
+  if (flags == TXT_TYPE_SIGNED_PLAIN) {
+    memcpy(&ts, data, 4);
+    if (ts < _room->recv.size()) {
+      if (_room->recv[ts]) _stats.room_dups++; else _stats.room_posts_recv++;
+      _room->recv[ts] = true;
+    }
+    mesh::Utils::sha256((uint8_t *) &ack_hash, 4, data, 9 + strlen((char *)&data[9]), self_id.pub_key, PUB_KEY_SIZE);
+  } else if (flags == TXT_TYPE_SIGNED_BATCH) {
+    PostBatchReader batch(data, len);
+    const uint8_t* prefix;
+    char text[256];
+    while (batch.next(ts, prefix, text)) {
+      if (ts >= _room->recv.size()) continue;
+      if (_room->recv[ts]) _stats.room_dups++; else _stats.room_posts_recv++;
+      _room->recv[ts] = true;
+    }
+    mesh::Utils::sha256((uint8_t *) &ack_hash, 4, data, batch.getEnd(), self_id.pub_key, PUB_KEY_SIZE);
+  } else {
+    return;
+  }
+  if (_stats.room_posts_recv >= (uint32_t)_traffic->room_posts && _room->done_at == 0) _room->done_at = _ms->getMillis();
+
+  if (packet->isRouteFlood()) {
+    mesh::Packet* path = createPathReturn(_room->peer, secret, packet->path, packet->path_len, PAYLOAD_TYPE_ACK, (uint8_t *) &ack_hash, 4);
+    if (path) sendFlood(path, ROOM_ACK_DELAY);
+  } else {
+    mesh::Packet* ack = createAck(ack_hash);
+    if (ack == NULL) return;
+    if (_room->out_path_len == ROOM_OUT_PATH_UNKNOWN) {
+      sendFlood(ack, ROOM_ACK_DELAY);
+    } else {
+      sendDirect(ack, _room->out_path, _room->out_path_len, ROOM_ACK_DELAY);
+    }
+  }
+}
+
+void SimNode::sendAdvert() {
+  mesh::Packet* pkt = createAdvert(self_id);
+  if (pkt) {
+    sendFlood(pkt);
+    _stats.adverts_sent++;
+  }
+}
+
+void SimNode::sendTestMsg() {
+  uint8_t data[MAX_GROUP_DATA_LENGTH];
+  int len = _traffic->msg_len;
+  if (len < 4) len = 4;
+  if (len > MAX_GROUP_DATA_LENGTH) len = MAX_GROUP_DATA_LENGTH;
+
+  uint32_t msg_id = _tracker->registerMsg(getNodeId(), _ms->getMillis());
+  memcpy(data, &msg_id, 4);
+  getRNG()->random(&data[4], len - 4);
+
+  mesh::Packet* pkt = createGroupDatagram(PAYLOAD_TYPE_GRP_DATA, _channel_secret, data, len);
+  if (pkt) {
+    sendFlood(pkt);
+    _stats.msgs_sent++;
+  }
+}
+
+void SimNode::step(unsigned long now) {
+  _channel->deliverDue(getNodeId(), now);
+
+  if (next_advert && now >= next_advert) {
+    sendAdvert();
+    next_advert = futureMillis(_traffic->advert_interval_ms);
+  }
+  if (next_msg && now >= next_msg) {
+    sendTestMsg();
+    next_msg = futureMillis(_traffic->msg_interval_ms);
+  }
+
+  if (_room && _room->is_server) pushRoomPost(now);
+
+  loop();
+
+  if (_err_flags & ERR_EVENT_FULL) {
+    _stats.pool_empty++;
+    _err_flags &= ~ERR_EVENT_FULL;
+  }
+}
+
+static void minTime(unsigned long& t, unsigned long candidate) {
+  if (candidate && (t == 0 || candidate < t)) t = candidate;
+}
+
+unsigned long SimNode::nextWake(unsigned long now) const {
+  if (_sim_radio->hasPendingRecv()) return now;
+
+  unsigned long t = 0;
+  minTime(t, next_advert);
+  minTime(t, next_msg);
+  if (_room && _room->is_server && _room->sync_since < (uint32_t)_traffic->room_posts) {
+    minTime(t, now + SIM_POLL_MILLIS * 4);   // window timers (pacing, timeouts)
+  }
+  minTime(t, _channel->nextReceptionEnd(getNodeId()));
+
+  if (_sim_radio->isTransmitting()) {
+    minTime(t, _sim_radio->getTxEnd());   // Dispatcher does nothing else until send is complete
+  } else {
+    unsigned long in = _sim_mgr->nextInboundDue();
+    if (in && in <= now) return now;
+    minTime(t, in);
+
+    unsigned long out = _sim_mgr->nextOutboundDue();
+    if (out && out <= now) {   // is due, but held back by Dispatcher
+      minTime(t, cad_retry_time >= now ? cad_retry_time + 1 : now + SIM_POLL_MILLIS);
+    } else {
+      minTime(t, out);
+    }
+  }
+  if (t && t < now) t = now;
+  return t;
+}
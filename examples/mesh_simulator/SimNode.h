@@ -0,0 +1,199 @@
+#pragma once
+
+#include <Mesh.h>
+#include <helpers/FairQueuePacketManager.h>
+#include <helpers/SimpleMeshTables.h>
+#include <helpers/SimpleMeshCaches.h>
+#include <helpers/PostSyncWindow.h>
+#include <map>
+#include <set>
+#include <vector>
+#include "SimRadio.h"
+
+struct SimClassStats {
+  uint32_t sent, starved;
+  uint64_t delay_sum;
+  uint32_t delay_max;
+};
+
+/**
+ * \brief  Wraps the node's PacketManager, and keeps track of when queued packets become due, so that the
+ *      scheduler can skip straight to the next interesting time instead of polling every millisecond.
+ *      Also measures the queueing delay (due to sent) of each traffic class (TX_CLASS_*), whatever the TX policy.
+*/
+class SimPacketManager : public mesh::PacketManager {
+  mesh::PacketManager* _mgr;
+  std::multiset<unsigned long> _out_due, _in_due;
+  std::map<const mesh::Packet*, unsigned long> _out_sched;
+  SimClassStats _class_stats[TX_NUM_CLASSES];
+  int _max_outbound;
+
+  void syncOutbound();
+  void onOutboundRemoved(const mesh::Packet* packet);
+
+public:
+  SimPacketManager(mesh::PacketManager& mgr) : _mgr(&mgr) {
+    _max_outbound = 0;
+    memset(_class_stats, 0, sizeof(_class_stats));
+  }
+
+  mesh::Packet* allocNew() override { return _mgr->allocNew(); }
+  void free(mesh::Packet* packet) override { _mgr->free(packet); }
+  void queueOutbound(mesh::Packet* packet, uint8_t priority, uint32_t scheduled_for) override;
+  mesh::Packet* getNextOutbound(uint32_t now) override;
+  int getOutboundCount(uint32_t now) const override { return _mgr->getOutboundCount(now); }
+  int getOutboundTotal() const override { return _mgr->getOutboundTotal(); }
+  int getFreeCount() const override { return _mgr->getFreeCount(); }
+  mesh::Packet* getOutboundByIdx(int i) override { return _mgr->getOutboundByIdx(i); }
+  mesh::Packet* removeOutboundByIdx(int i) override;
+  void queueInbound(mesh::Packet* packet, uint32_t scheduled_for) override;
+  mesh::Packet* getNextInbound(uint32_t now) override;
+
+  /** \returns  earliest scheduled time of queued outbound packets, or 0 if none */
+  unsigned long nextOutboundDue() const { return _out_due.empty() ? 0 : *_out_due.begin(); }
+  /** \returns  earliest scheduled time of delayed inbound packets, or 0 if none */
+  unsigned long nextInboundDue() const { return _in_due.empty() ? 0 : *_in_due.begin(); }
+
+  int getMaxOutbound() const { return _max_outbound; }
+  const SimClassStats& getClassStats(int cls) const { return _class_stats[cls]; }
+};
+
+/**
+ * \brief  Records every test message sent, and which nodes it reached (and when).
+*/
+class SimMsgTracker {
+  struct Msg {
+    unsigned long sent_at;
+    int origin;
+    std::vector<bool> reached;
+  };
+  std::vector<Msg> _msgs;
+  int _num_nodes;
+
+public:
+  uint64_t latency_sum;
+  uint32_t latency_max, deliveries, app_dups;
+
+  SimMsgTracker(int num_nodes) : _num_nodes(num_nodes) { latency_sum = latency_max = deliveries = app_dups = 0; }
+
+  uint32_t registerMsg(int origin, unsigned long now);
+
+  /** \returns  latency (millis), or -1 if this node has already received this msg (a duplicate) */
+  long onMsgRecv(uint32_t msg_id, int node, unsigned long now);
+
+  int getNumMsgs() const { return _msgs.size(); }
+  int getNumNodes() const { return _num_nodes; }
+};
+
+struct SimTraffic {
+  uint32_t advert_interval_ms;   // flood advert period (0 = disabled)
+  uint32_t msg_interval_ms;      // group message period (0 = disabled)
+  int msg_len;                   // group message data length
+  int max_flood_hops;
+  float tx_delay_factor;         // as per repeater prefs
+  float rx_delay_base;           // as per repeater prefs (0 = disabled)
+  float airtime_factor;          // as per repeater prefs
+  int room_posts;                // posts for one room client to catch up on (0 = disabled)
+  int room_post_len;             // room post text length
+  bool room_batch;               // push several posts per packet (TXT_TYPE_SIGNED_BATCH)
+
+  SimTraffic() {
+    advert_interval_ms = 12 * 60 * 60 * 1000UL;
+    msg_interval_ms = 4 * 60 * 60 * 1000UL;
+    msg_len = 40;
+    max_flood_hops = 64;
+    tx_delay_factor = 0.5f;
+    rx_delay_base = 0.0f;
+    airtime_factor = 1.0f;
+    room_posts = 0;
+    room_post_len = 40;
+    room_batch = false;
+  }
+};
+
+struct SimNodeStats {
+  uint32_t adverts_sent, adverts_heard;
+  uint32_t msgs_sent, msgs_recv, msg_dups;
+  uint64_t latency_sum;
+  uint32_t latency_max;
+  uint32_t pool_empty;
+  uint32_t room_pushes, room_posts_recv, room_dups;
+};
+
+/**
+ * \brief  Room sync scenario: one node is a room server (pushing posts through a PostSyncWindow, like
+ *     simple_room_server), another is a client that is catching up, and ACKs each push like BaseChatMesh does.
+*/
+struct SimRoom {
+  mesh::Identity peer;
+  uint8_t secret[PUB_KEY_SIZE];
+  uint8_t out_path[MAX_PATH_SIZE];
+  uint8_t out_path_len;
+  bool is_server;
+  PostSyncWindow sync;
+  uint32_t sync_since;
+  unsigned long done_at;     // when all posts were ACK'd (server), or received (client)
+  std::vector<bool> recv;    // (client) posts received, by timestamp
+};
+
+/**
+ * \brief  A simulated node: the real mesh::Mesh/Dispatcher code, behaving like a repeater (forwards all floods)
+ *     that also periodically sends flood adverts and group-channel test messages.
+*/
+class SimNode : public mesh::Mesh {
+  SimChannel* _channel;
+  SimRadio* _sim_radio;
+  SimPacketManager* _sim_mgr;
+  SimpleMeshTables* _sim_tables;
+  SimpleMeshCaches _sim_caches;
+  SimMsgTracker* _tracker;
+  const SimTraffic* _traffic;
+  mesh::GroupChannel _channel_secret;
+  unsigned long next_advert, next_msg;
+  unsigned long cad_retry_time;
+  SimNodeStats _stats;
+  SimRoom* _room;
+
+  void sendAdvert();
+  void sendTestMsg();
+  void pushRoomPost(unsigned long now);
+  void onRoomAck(uint32_t ack_crc);
+
+protected:
+  float getAirtimeBudgetFactor() const override { return _traffic->airtime_factor; }
+  uint32_t getCADFailRetryDelay() const override;
+  int calcRxDelay(float score, uint32_t air_time) const override;
+  bool allowPacketForward(const mesh::Packet* packet) override;
+  uint32_t getRetransmitDelay(const mesh::Packet* packet) override;
+  int searchChannelsByHash(const uint8_t* hash, mesh::GroupChannel channels[], int max_matches) override;
+  void onGroupDataRecv(mesh::Packet* packet, uint8_t type, const mesh::GroupChannel& channel, uint8_t* data, size_t len) override;
+  void onAdvertRecv(mesh::Packet* packet, const mesh::Identity& id, uint32_t timestamp, const uint8_t* app_data, size_t app_data_len) override;
+  int searchPeersByHash(const uint8_t* hash) override;
+  void getPeerSharedSecret(uint8_t* dest_secret, int peer_idx) override;
+  void onPeerDataRecv(mesh::Packet* packet, uint8_t type, int sender_idx, const uint8_t* secret, uint8_t* data, size_t len) override;
+  bool onPeerPathRecv(mesh::Packet* packet, int sender_idx, const uint8_t* secret, uint8_t* path, uint8_t path_len, uint8_t extra_type, uint8_t* extra, uint8_t extra_len) override;
+  void onAckRecv(mesh::Packet* packet, uint32_t ack_crc) override;
+
+public:
+  SimNode(SimChannel& channel, SimRadio& radio, SimClock& ms, SimRNG& rng, SimRTCClock& rtc, SimPacketManager& mgr,
+          SimpleMeshTables& tables, SimMsgTracker& tracker, const SimTraffic& traffic, const mesh::GroupChannel& group);
+
+  void begin();
+
+  /** \brief  makes this node the room server (or client) for the room sync scenario, with 'peer' at the other end */
+  void setRoomPeer(SimNode& peer, bool is_server);
+  const SimRoom* getRoom() const { return _room; }
+  const mesh::Identity& getIdentity() const { return self_id; }
+
+  /** \brief  deliver any finished receptions, run app timers, then one Dispatcher/Mesh loop() */
+  void step(unsigned long now);
+
+  /** \returns  the next (virtual) time at which this node has something to do */
+  unsigned long nextWake(unsigned long now) const;
+
+  int getNodeId() const { return _sim_radio->getNodeId(); }
+  const SimNodeStats& getStats() const { return _stats; }
+  const SimRadio& getRadio() const { return *_sim_radio; }
+  const SimPacketManager& getPacketManager() const { return *_sim_mgr; }
+  const SimpleMeshTables& getSimTables() const { return *_sim_tables; }
+};
@@ -0,0 +1,73 @@
+#include "SimRadio.h"
+
+#define MAX_RX_FRAMES   8    // frames the 'modem' can hold before the Dispatcher reads them
+
+SimRadio::SimRadio(SimChannel& channel, SimClock& ms) : _channel(&channel), _ms(&ms) {
+  _id = channel.attach(this);
+  _tx_active = false;
+  _tx_end = 0;
+  _last_snr = _last_rssi = 0;
+  _n_rx_dropped = _n_collided = _n_half_duplex = 0;
+}
+
+void SimRadio::onFrameReceived(const uint8_t* bytes, int len, float snr) {
+  if (_rx_frames.size() >= MAX_RX_FRAMES) {
+    _n_rx_dropped++;
+    return;
+  }
+  Frame f;
+  f.len = len;
+  f.snr = snr;
+  memcpy(f.data, bytes, len);
+  _rx_frames.push_back(f);
+}
+
+int SimRadio::recvRaw(uint8_t* bytes, int sz) {
+  if (_rx_frames.empty()) return 0;
+
+  const Frame& f = _rx_frames.front();
+  int len = f.len;
+  if (len > sz) len = sz;
+  memcpy(bytes, f.data, len);
+  _last_snr = f.snr;
+  _last_rssi = _channel->getParams().noise_floor + f.snr;
+  _rx_frames.pop_front();
+  return len;
+}
+
+uint32_t SimRadio::getEstAirtimeFor(int len_bytes) {
+  return _channel->getParams().airtimeFor(len_bytes);
+}
+
+float SimRadio::packetScore(float snr, int packet_len) {
+  // same as RadioLibWrapper::packetScoreInt()
+  float threshold = _channel->getParams().snrThreshold();
+  if (snr < threshold) return 0.0f;
+
+  float success_rate_based_on_snr = (snr - threshold) / 10.0f;
+  float collision_penalty = 1 - (packet_len / 256.0f);
+  float score = success_rate_based_on_snr * collision_penalty;
+  return score < 0.0f ? 0.0f : (score > 1.0f ? 1.0f : score);
+}
+
+bool SimRadio::startSendRaw(const uint8_t* bytes, int len) {
+  if (_tx_active) return false;
+
+  uint32_t airtime = getEstAirtimeFor(len);
+  _tx_active = true;
+  _tx_end = _ms->getMillis() + airtime;
+  _channel->transmit(_id, bytes, len, _ms->getMillis(), airtime);
+  return true;
+}
+
+bool SimRadio::isSendComplete() {
+  return _tx_active && _ms->getMillis() >= _tx_end;
+}
+
+void SimRadio::onSendFinished() {
+  _tx_active = false;
+}
+
+bool SimRadio::isReceiving() {
+  return _channel->isReceiving(_id, _ms->getMillis());
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "SimChannel.h"
+#include <deque>
+
+/**
+ * \brief  mesh::Radio implementation that sends/receives via a SimChannel, with airtime and timing
+ *      driven by the virtual SimClock.
+*/
+class SimRadio : public mesh::Radio {
+  struct Frame {
+    uint8_t len;
+    float snr;
+    uint8_t data[MAX_TRANS_UNIT];
+  };
+
+  SimChannel* _channel;
+  SimClock* _ms;
+  int _id;
+  std::deque<Frame> _rx_frames;
+  bool _tx_active;
+  unsigned long _tx_end;
+  float _last_snr, _last_rssi;
+  uint32_t _n_rx_dropped, _n_collided, _n_half_duplex;
+
+public:
+  SimRadio(SimChannel& channel, SimClock& ms);
+
+  int getNodeId() const { return _id; }
+
+  // called by SimChannel
+  void onFrameReceived(const uint8_t* bytes, int len, float snr);
+  void onFrameLost(bool half_duplex) { if (half_duplex) _n_half_duplex++; else _n_collided++; }
+
+  bool hasPendingRecv() const { return !_rx_frames.empty(); }
+  bool isTransmitting() const { return _tx_active; }
+  unsigned long getTxEnd() const { return _tx_end; }
+
+  uint32_t getNumCollided() const { return _n_collided; }
+  uint32_t getNumHalfDuplexLost() const { return _n_half_duplex; }
+  uint32_t getNumRecvDropped() const { return _n_rx_dropped; }
+
+  int recvRaw(uint8_t* bytes, int sz) override;
+  uint32_t getEstAirtimeFor(int len_bytes) override;
+  float packetScore(float snr, int packet_len) override;
+  bool startSendRaw(const uint8_t* bytes, int len) override;
+  bool isSendComplete() override;
+  void onSendFinished() override;
+  bool isInRecvMode() const override { return !_tx_active; }
+  bool isReceiving() override;
+  int getNoiseFloor() const override { return (int) _channel->getParams().noise_floor; }
+  float getLastRSSI() const override { return _last_rssi; }
+  float getLastSNR() const override { return _last_snr; }
+};
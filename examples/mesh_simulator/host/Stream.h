@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+// Minimal host-side stand-in for the Arduino Stream class, enough for Identity and Utils::printHex()
+
+class Stream {
+public:
+  virtual size_t write(uint8_t c) { return 1; }
+  virtual size_t write(const uint8_t* src, size_t len) { return len; }
+  virtual size_t readBytes(uint8_t* dest, size_t len) { return 0; }
+
+  virtual void print(char c) { write((uint8_t) c); }
+  virtual void print(const char* str) { while (*str) write((uint8_t) *str++); }
+  void println() { print('\n'); }
+};
+
+// writes to host stdout
+class HostConsole : public Stream {
+public:
+  size_t write(uint8_t c) override { fputc(c, stdout); return 1; }
+  size_t write(const uint8_t* src, size_t len) override { return fwrite(src, 1, len, stdout); }
+};
@@ -0,0 +1,285 @@
+/*
+ * Host-native discrete-event simulator for the mesh layer.
+ *
+ * Runs N instances of the real mesh::Mesh / Dispatcher code against a shared, simulated LoRa channel
+ * (airtime, collisions with capture effect, half-duplex, SNR-dependent loss), all driven by a single
+ * virtual clock that jumps straight to the next event, so runs are much faster than real time.
+ *
+ *   pio run -e native_sim
+ *   .pio/build/native_sim/program --nodes 500 --hours 24 --csv nodes.csv
+ *
+ * Options:
+ *   --nodes N          number of nodes (default 100)
+ *   --hours H          simulated duration (default 24)
+ *   --seed S           RNG seed (default 1)
+ *   --area KM          side of square area nodes are placed in (default: scaled to keep ~15 neighbours)
+ *   --sf SF --bw KHZ --cr CR          LoRa modem params (default 11, 250, 5)
+ *   --snr1km DB --ple N --shadow DB  propagation model (default 5, 3.0, 4)
+ *   --advert-mins M    flood advert interval per node (0 = off, default 720)
+ *   --msg-mins M       group message interval per node (0 = off, default 240)
+ *   --msg-len BYTES    group message length (default 40)
+ *   --hops N           max flood hops (default 64)
+ *   --txdelay F        tx_delay_factor (default 0.5)
+ *   --rxdelay F        rx_delay_base (default 0, off)
+ *   --af F             airtime budget factor (default 1.0)
+ *   --pool N           packet pool size per node (default 16)
+ *   --sched P          transmit scheduling: 'priority' (default) or 'fair' (FairQueuePacketManager)
+ *   --room-posts N     room sync scenario: node 0 is a room server, pushing N posts to a catching-up client (default 0, off)
+ *   --room-client I    node index of the room client (default: last node)
+ *   --room-post-len C  room post text length (default 40)
+ *   --room-batch 0|1   push several posts per packet, TXT_TYPE_SIGNED_BATCH (default 0)
+ *   --csv FILE         write per-node stats to FILE
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <queue>
+#include <vector>
+
+#include <helpers/StaticPoolPacketManager.h>
+#include "SimNode.h"
+
+#define DEFAULT_NEIGHBOURS   15
+
+struct WakeEvent {
+  unsigned long time;
+  int node;
+  bool operator>(const WakeEvent& other) const { return time > other.time || (time == other.time && node > other.node); }
+};
+
+static const char* optArg(int argc, char* argv[], int& i) {
+  if (i + 1 >= argc) {
+    fprintf(stderr, "missing value for %s\n", argv[i]);
+    exit(1);
+  }
+  return argv[++i];
+}
+
+int main(int argc, char* argv[]) {
+  int num_nodes = 100;
+  float hours = 24.0f;
+  uint64_t seed = 1;
+  float area_km = 0;
+  int pool_size = 16;
+  bool fair_sched = false;
+  const char* csv_path = NULL;
+  int room_client = -1;
+  SimRadioParams params;
+  SimTraffic traffic;
+
+  for (int i = 1; i < argc; i++) {
+    const char* a = argv[i];
+    if (strcmp(a, "--nodes") == 0) num_nodes = atoi(optArg(argc, argv, i));
+    else if (strcmp(a, "--hours") == 0) hours = atof(optArg(argc, argv, i));
+    else if (strcmp(a, "--seed") == 0) seed = strtoull(optArg(argc, argv, i), NULL, 10);
+    else if (strcmp(a, "--area") == 0) area_km = atof(optArg(argc, argv, i));
+    else if (strcmp(a, "--sf") == 0) params.sf = atoi(optArg(argc, argv, i));
+    else if (strcmp(a, "--bw") == 0) params.bw = atof(optArg(argc, argv, i));
+    else if (strcmp(a, "--cr") == 0) params.cr = atoi(optArg(argc, argv, i));
+    else if (strcmp(a, "--snr1km") == 0) params.snr_at_1km = atof(optArg(argc, argv, i));
+    else if (strcmp(a, "--ple") == 0) params.path_loss_exp = atof(optArg(argc, argv, i));
+    else if (strcmp(a, "--shadow") == 0) params.shadowing_db = atof(optArg(argc, argv, i));
+    else if (strcmp(a, "--advert-mins") == 0) traffic.advert_interval_ms = (uint32_t)(atof(optArg(argc, argv, i)) * 60000);
+    else if (strcmp(a, "--msg-mins") == 0) traffic.msg_interval_ms = (uint32_t)(atof(optArg(argc, argv, i)) * 60000);
+    else if (strcmp(a, "--msg-len") == 0) traffic.msg_len = atoi(optArg(argc, argv, i));
+    else if (strcmp(a, "--hops") == 0) traffic.max_flood_hops = atoi(optArg(argc, argv, i));
+    else if (strcmp(a, "--txdelay") == 0) traffic.tx_delay_factor = atof(optArg(argc, argv, i));
+    else if (strcmp(a, "--rxdelay") == 0) traffic.rx_delay_base = atof(optArg(argc, argv, i));
+    else if (strcmp(a, "--af") == 0) traffic.airtime_factor = atof(optArg(argc, argv, i));
+    else if (strcmp(a, "--pool") == 0) pool_size = atoi(optArg(argc, argv, i));
+    else if (strcmp(a, "--csv") == 0) csv_path = optArg(argc, argv, i);
+    else if (strcmp(a, "--room-posts") == 0) traffic.room_posts = atoi(optArg(argc, argv, i));
+    else if (strcmp(a, "--room-client") == 0) room_client = atoi(optArg(argc, argv, i));
+    else if (strcmp(a, "--room-post-len") == 0) traffic.room_post_len = atoi(optArg(argc, argv, i));
+    else if (strcmp(a, "--room-batch") == 0) traffic.room_batch = atoi(optArg(argc, argv, i)) != 0;
+    else if (strcmp(a, "--sched") == 0) {
+      const char* p = optArg(argc, argv, i);
+      if (strcmp(p, "fair") == 0) fair_sched = true;
+      else if (strcmp(p, "priority") != 0) {
+        fprintf(stderr, "unknown scheduler: %s\n", p);
+        return 1;
+      }
+    }
+    else {
+      fprintf(stderr, "unknown option: %s\n", a);
+      return 1;
+    }
+  }
+  if (num_nodes < 2) num_nodes = 2;
+
+  if (area_km <= 0) {   // pick area so that nodes average roughly DEFAULT_NEIGHBOURS neighbours in decode range
+    float range_km = pow(10.0, (params.snr_at_1km - params.snrThreshold()) / (10.0f * params.path_loss_exp));
+    area_km = sqrt(num_nodes * M_PI * range_km * range_km / DEFAULT_NEIGHBOURS);
+  }
+
+  SimClock sim_clock;
+  SimChannel channel(params, seed);
+  SimMsgTracker tracker(num_nodes);
+
+  mesh::GroupChannel group;
+  memset(&group, 0, sizeof(group));
+  {
+    const char* psk = "mesh_simulator_channel";
+    mesh::Utils::sha256(group.secret, CIPHER_KEY_SIZE, (const uint8_t *) psk, strlen(psk));
+    mesh::Utils::sha256(group.hash, sizeof(group.hash), group.secret, CIPHER_KEY_SIZE);
+  }
+
+  std::vector<SimNode*> nodes;
+  for (int i = 0; i < num_nodes; i++) {
+    SimRNG* rng = new SimRNG(seed * 1000003ULL + i + 1);
+    SimRadio* radio = new SimRadio(channel, sim_clock);
+    SimRTCClock* rtc = new SimRTCClock(sim_clock, 1735689600 + rng->nextInt(0, 120));   // 2025-01-01, up to 2 mins skew
+    mesh::PacketManager* mgr = new StaticPoolPacketManager(pool_size);
+    if (fair_sched) mgr = new FairQueuePacketManager(*mgr, *radio, pool_size);
+    nodes.push_back(new SimNode(channel, *radio, sim_clock, *rng, *rtc, *new SimPacketManager(*mgr),
+                                *new SimpleMeshTables(), tracker, traffic, group));
+  }
+  float avg_neighbours = channel.placeRandomly(area_km);
+  if (room_client <= 0 || room_client >= num_nodes) room_client = num_nodes - 1;
+  if (traffic.room_posts > 0) {
+    nodes[0]->setRoomPeer(*nodes[room_client], true);
+    nodes[room_client]->setRoomPeer(*nodes[0], false);
+  }
+
+  printf("nodes=%d area=%.1fkm avg_links=%.1f SF%d BW%.1f CR4/%d airtime(50 bytes)=%ums hours=%.1f sched=%s\n",
+      num_nodes, area_km, avg_neighbours, params.sf, params.bw, params.cr, params.airtimeFor(50), hours,
+      fair_sched ? "fair" : "priority");
+
+  std::priority_queue<WakeEvent, std::vector<WakeEvent>, std::greater<WakeEvent> > events;
+  std::vector<unsigned long> scheduled(num_nodes, 0);
+
+  for (int i = 0; i < num_nodes; i++) {
+    nodes[i]->begin();
+    scheduled[i] = nodes[i]->nextWake(sim_clock.getMillis());
+    if (scheduled[i]) events.push({ scheduled[i], i });
+  }
+
+  unsigned long end_time = (unsigned long) (hours * 3600000.0);
+  uint64_t num_steps = 0;
+  clock_t wall_start = clock();
+
+  while (!events.empty()) {
+    WakeEvent ev = events.top();
+    events.pop();
+    if (ev.time != scheduled[ev.node]) continue;   // stale entry, node was re-scheduled
+    if (ev.time > end_time) break;
+
+    sim_clock.advanceTo(ev.time);
+    SimNode* node = nodes[ev.node];
+    uint32_t tx_before = channel.getNumTransmits();
+
+    node->step(sim_clock.getMillis());
+    num_steps++;
+
+    scheduled[ev.node] = node->nextWake(sim_clock.getMillis());
+    if (scheduled[ev.node]) events.push({ scheduled[ev.node], ev.node });
+
+    if (channel.getNumTransmits() != tx_before) {   // new reception(s) in flight at neighbours, may need an earlier wake-up
+      for (int k = 0; k < channel.getNumNeighbours(ev.node); k++) {
+        int j = channel.getNeighbour(ev.node, k);
+        unsigned long t = nodes[j]->nextWake(sim_clock.getMillis());
+        if (t && t != scheduled[j] && (scheduled[j] == 0 || t < scheduled[j])) {
+          scheduled[j] = t;
+          events.push({ t, j });
+        }
+      }
+    }
+  }
+  double wall_secs = (double)(clock() - wall_start) / CLOCKS_PER_SEC;
+
+  // -------- report --------
+  uint64_t sent_flood = 0, sent_direct = 0, recv_flood = 0, recv_direct = 0, air_time = 0;
+  uint64_t flood_dups = 0, direct_dups = 0, pool_empty = 0, adverts_sent = 0, msgs_sent = 0;
+  int max_queue = 0;
+  uint64_t budget_holds = 0;
+  double budget_used = 0;
+  SimClassStats class_stats[TX_NUM_CLASSES];
+  memset(class_stats, 0, sizeof(class_stats));
+  for (int i = 0; i < num_nodes; i++) {
+    SimNode* n = nodes[i];
+    sent_flood += n->getNumSentFlood();
+    sent_direct += n->getNumSentDirect();
+    recv_flood += n->getNumRecvFlood();
+    recv_direct += n->getNumRecvDirect();
+    air_time += n->getTotalAirTime();
+    flood_dups += n->getSimTables().getNumFloodDups();
+    direct_dups += n->getSimTables().getNumDirectDups();
+    pool_empty += n->getStats().pool_empty;
+    adverts_sent += n->getStats().adverts_sent;
+    msgs_sent += n->getStats().msgs_sent;
+    if (n->getPacketManager().getMaxOutbound() > max_queue) max_queue = n->getPacketManager().getMaxOutbound();
+    budget_holds += n->getNumBudgetHolds();
+    budget_used += n->getTxBudgetUtilisation();
+    for (int c = 0; c < TX_NUM_CLASSES; c++) {
+      const SimClassStats& s = n->getPacketManager().getClassStats(c);
+      class_stats[c].sent += s.sent;
+      class_stats[c].starved += s.starved;
+      class_stats[c].delay_sum += s.delay_sum;
+      if (s.delay_max > class_stats[c].delay_max) class_stats[c].delay_max = s.delay_max;
+    }
+  }
+  double sim_secs = sim_clock.getMillis() / 1000.0;
+  uint64_t expected = msgs_sent * (num_nodes - 1);
+
+  printf("simulated %.0fs in %.1fs wall (%.0fx real time), %llu node steps\n", sim_secs, wall_secs,
+      wall_secs > 0 ? sim_secs / wall_secs : 0.0, (unsigned long long) num_steps);
+  printf("channel: tx=%u rx_ok=%u collisions=%u half_duplex=%u weak=%u\n", channel.getNumTransmits(),
+      channel.getNumReceived(), channel.getNumCollisions(), channel.getNumHalfDuplexLost(), channel.getNumWeakLost());
+  printf("packets: sent flood=%llu direct=%llu, recv flood=%llu direct=%llu, dups flood=%llu direct=%llu\n",
+      (unsigned long long) sent_flood, (unsigned long long) sent_direct, (unsigned long long) recv_flood,
+      (unsigned long long) recv_direct, (unsigned long long) flood_dups, (unsigned long long) direct_dups);
+  printf("packet hashes: calculated=%u reused=%u\n", mesh::Packet::getNumHashCalcs(), mesh::Packet::getNumHashReused());
+  printf("airtime: total=%.1fs, avg per node=%.2f%% duty, pool empty events=%llu, max outbound queue=%d\n",
+      air_time / 1000.0, sim_secs > 0 ? 100.0 * air_time / 1000.0 / sim_secs / num_nodes : 0.0,
+      (unsigned long long) pool_empty, max_queue);
+  printf("adverts sent=%llu, msgs sent=%llu, delivered=%u/%llu (%.1f%%), app dups=%u, latency avg=%.0fms max=%ums\n",
+      (unsigned long long) adverts_sent, (unsigned long long) msgs_sent, tracker.deliveries, (unsigned long long) expected,
+      expected ? 100.0 * tracker.deliveries / expected : 0.0, tracker.app_dups,
+      tracker.deliveries ? (double) tracker.latency_sum / tracker.deliveries : 0.0, tracker.latency_max);
+
+  printf("tx budget: avg utilisation=%.1f%%, holds=%llu\n", 100.0 * budget_used / num_nodes, (unsigned long long) budget_holds);
+  const char* class_names[TX_NUM_CLASSES] = { "ack", "direct", "flood", "advert" };
+  for (int c = 0; c < TX_NUM_CLASSES; c++) {
+    const SimClassStats& s = class_stats[c];
+    if (s.sent == 0) continue;
+    printf("tx queue %-6s: sent=%u delay avg=%.0fms max=%ums starved=%u\n", class_names[c], s.sent,
+        (double) s.delay_sum / s.sent, s.delay_max, s.starved);
+  }
+
+  if (traffic.room_posts > 0) {
+    const SimRoom* server = nodes[0]->getRoom();
+    uint32_t synced = server->sync.num_synced;
+    printf("room sync (%s, %d byte posts): client=%d posts=%d synced=%u recv=%u dups=%u pushes=%u, all ACK'd at %.1fs, "
+        "airtime per synced post=%.0fms (all nodes, turn other traffic off)\n",
+        traffic.room_batch ? "batched" : "single", traffic.room_post_len, room_client, traffic.room_posts, synced,
+        nodes[room_client]->getStats().room_posts_recv, nodes[room_client]->getStats().room_dups,
+        nodes[0]->getStats().room_pushes, server->done_at / 1000.0,
+        synced ? (double) air_time / synced : 0.0);
+  }
+
+  if (csv_path) {
+    FILE* f = fopen(csv_path, "w");
+    if (f == NULL) {
+      fprintf(stderr, "can't open %s\n", csv_path);
+      return 1;
+    }
+    fprintf(f, "node,neighbours,sent_flood,sent_direct,recv_flood,recv_direct,tx_airtime_ms,rx_airtime_ms,"
+               "flood_dups,direct_dups,collided,half_duplex,msgs_sent,msgs_recv,msg_dups,latency_avg_ms,latency_max_ms,"
+               "adverts_heard,pool_empty,max_outbound\n");
+    for (int i = 0; i < num_nodes; i++) {
+      SimNode* n = nodes[i];
+      const SimNodeStats& s = n->getStats();
+      fprintf(f, "%d,%d,%u,%u,%u,%u,%lu,%lu,%u,%u,%u,%u,%u,%u,%u,%.0f,%u,%u,%u,%d\n", i, channel.getNumNeighbours(i),
+          n->getNumSentFlood(), n->getNumSentDirect(), n->getNumRecvFlood(), n->getNumRecvDirect(),
+          n->getTotalAirTime(), n->getReceiveAirTime(), n->getSimTables().getNumFloodDups(), n->getSimTables().getNumDirectDups(),
+          n->getRadio().getNumCollided(), n->getRadio().getNumHalfDuplexLost(), s.msgs_sent, s.msgs_recv, s.msg_dups,
+          s.msgs_recv ? (double) s.latency_sum / s.msgs_recv : 0.0, s.latency_max, s.adverts_heard, s.pool_empty,
+          n->getPacketManager().getMaxOutbound());
+    }
+    fclose(f);
+  }
+  return 0;
+}
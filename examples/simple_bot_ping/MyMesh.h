@@ -15,6 +15,7 @@
 #include "helpers/ArduinoHelpers.h"
 #include <helpers/IdentityStore.h>
 #include <helpers/SimpleMeshTables.h>
+#include <helpers/SimpleMeshCaches.h>
 #include <helpers/StaticPoolPacketManager.h>
 #include <target.h>
 
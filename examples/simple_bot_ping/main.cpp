@@ -9,6 +9,7 @@ static UITask ui_task(display);
 
 StdRNG fast_rng;
 SimpleMeshTables tables;
+SimpleMeshCaches caches;
 MyMesh the_mesh(radio_driver, fast_rng, rtc_clock, tables);
 
 [[noreturn]] void halt() {
@@ -17,6 +18,7 @@ MyMesh the_mesh(radio_driver, fast_rng, rtc_clock, tables);
 }
 
 void setup() {
+  the_mesh.setCaches(&caches);
   Serial.begin(115200);
 
   board.begin();
@@ -608,21 +608,12 @@ void MyMesh::onAnonDataRecv(mesh::Packet *packet, const uint8_t *secret, const m
 }
 
 int MyMesh::searchPeersByHash(const uint8_t *hash) {
-  int n = 0;
-  for (int i = 0; i < acl.getNumClients(); i++) {
-    if (acl.getClientByIdx(i)->id.isHashMatch(hash)) {
-      matching_peer_indexes[n++] = i; // store the INDEXES of matching contacts (for subsequent 'peer' methods)
-    }
-  }
-  return n;
+  return acl.searchByHash(hash, matching_peer_indexes, MAX_CLIENTS);
 }
 
 void MyMesh::getPeerSharedSecret(uint8_t *dest_secret, int peer_idx) {
   int i = matching_peer_indexes[peer_idx];
-  if (i >= 0 && i < acl.getNumClients()) {
-    // lookup pre-calculated shared_secret
-    memcpy(dest_secret, acl.getClientByIdx(i)->shared_secret, PUB_KEY_SIZE);
-  } else {
+  if (!acl.getSharedSecret(i, dest_secret)) {
     MESH_DEBUG_PRINTLN("getPeerSharedSecret: Invalid peer idx: %d", i);
   }
 }
@@ -650,11 +641,11 @@ void MyMesh::onAdvertRecv(mesh::Packet *packet, const mesh::Identity &id, uint32
 void MyMesh::onPeerDataRecv(mesh::Packet *packet, uint8_t type, int sender_idx, const uint8_t *secret,
                             uint8_t *data, size_t len) {
   int i = matching_peer_indexes[sender_idx];
-  if (i < 0 || i >= acl.getNumClients()) { // get from our known_clients table (sender SHOULD already be known in this context)
+  ClientInfo* client = acl.getMatchingClient(i);   // (pages in client, if in cold store)
+  if (client == NULL) { // get from our known_clients table (sender SHOULD already be known in this context)
     MESH_DEBUG_PRINTLN("onPeerDataRecv: invalid peer idx: %d", i);
     return;
   }
-  ClientInfo* client = acl.getClientByIdx(i);
 
   if (type == PAYLOAD_TYPE_REQ) { // request (from a Known admin client!)
     uint32_t timestamp;
@@ -754,10 +745,10 @@ bool MyMesh::onPeerPathRecv(mesh::Packet *packet, int sender_idx, const uint8_t
                             uint8_t path_len, uint8_t extra_type, uint8_t *extra, uint8_t extra_len) {
   // TODO: prevent replay attacks
   int i = matching_peer_indexes[sender_idx];
+  ClientInfo* client = acl.getMatchingClient(i);   // (pages in client, if in cold store)
 
-  if (i >= 0 && i < acl.getNumClients()) { // get from our known_clients table (sender SHOULD already be known in this context)
+  if (client) { // get from our known_clients table (sender SHOULD already be known in this context)
     MESH_DEBUG_PRINTLN("PATH to client, path_len=%d", (uint32_t)path_len);
-    auto client = acl.getClientByIdx(i);
 
     // store a copy of path, for sendDirect()
     client->out_path_len = mesh::Packet::copyPath(client->out_path, path, path_len);
@@ -845,9 +836,19 @@ void MyMesh::sendNodeDiscoverReq() {
   }
 }
 
+static mesh::PacketManager* newPacketManager(mesh::Radio& radio, int pool_size) {
+#ifdef TX_FAIR_QUEUE
+  // weighted fair queuing between ACKs, direct, flood and advert traffic, instead of strictly by priority
+  return new FairQueuePacketManager(*new StaticPoolPacketManager(pool_size), radio, pool_size);
+#else
+  return new StaticPoolPacketManager(pool_size);
+#endif
+}
+
 MyMesh::MyMesh(mesh::MainBoard &board, mesh::Radio &radio, mesh::MillisecondClock &ms, mesh::RNG &rng,
                mesh::RTCClock &rtc, mesh::MeshTables &tables)
-    : mesh::Mesh(radio, ms, rng, rtc, *new StaticPoolPacketManager(32), tables),
+    : mesh::Mesh(radio, ms, rng, rtc, *newPacketManager(radio, 32), tables),
+      cold_clients("/s_clients_cold", MAX_COLD_CLIENTS),
       region_map(key_store), temp_map(key_store),
       _cli(board, rtc, sensors, region_map, acl, &_prefs, this),
       telemetry(MAX_PACKET_PAYLOAD - 4),
@@ -929,8 +930,9 @@ void MyMesh::begin(FILESYSTEM *fs) {
   _fs = fs;
   // load persisted prefs
   _cli.loadPrefs(_fs);
+  if (cold_clients.getMaxClients() > 0) acl.setColdStore(&cold_clients);
   acl.load(_fs, self_id);
-  // TODO: key_store.begin();
+  key_store.load(_fs);
   region_map.load(_fs);
 
   // establish default-scope
@@ -1301,6 +1303,9 @@ void MyMesh::loop() {
     dirty_contacts_expiry = 0;
   }
 
+  // persist newly derived region keys (lazily)
+  key_store.loopSave(_fs, _ms->getMillis(), LAZY_CONTACTS_WRITE_DELAY);
+
   // update uptime
   uint32_t now = millis();
   uptime_millis += now - last_millis;
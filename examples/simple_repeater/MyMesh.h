@@ -29,7 +29,9 @@
 #include <helpers/CommonCLI.h>
 #include <helpers/IdentityStore.h>
 #include <helpers/SimpleMeshTables.h>
+#include <helpers/SimpleMeshCaches.h>
 #include <helpers/StaticPoolPacketManager.h>
+#include <helpers/FairQueuePacketManager.h>
 #include <helpers/StatsFormatHelper.h>
 #include <helpers/TxtDataHelpers.h>
 #include <helpers/RegionMap.h>
@@ -61,6 +63,10 @@ struct RepeaterStats {
   #define MAX_CLIENTS           32
 #endif
 
+#ifndef MAX_COLD_CLIENTS    // clients moved out of RAM when the ACL is full (in flash, ~134 bytes each)
+  #define MAX_COLD_CLIENTS   0   // cold clients tier disabled. Opt-in, eg. 32 on NRF52/STM32, 256 on ESP32
+#endif
+
 struct NeighbourInfo {
   mesh::Identity id;
   uint32_t advert_timestamp;
@@ -88,6 +94,7 @@ class MyMesh : public mesh::Mesh, public CommonCLICallbacks {
   bool _logging;
   NodePrefs _prefs;
   ClientACL  acl;
+  ClientColdStore cold_clients;
   CommonCLI _cli;
   uint8_t reply_data[MAX_PACKET_PAYLOAD];
   uint8_t reply_path[MAX_PATH_SIZE];
@@ -10,6 +10,7 @@
 
 StdRNG fast_rng;
 SimpleMeshTables tables;
+SimpleMeshCaches caches;
 
 MyMesh the_mesh(board, radio_driver, *new ArduinoMillis(), fast_rng, rtc_clock, tables);
 
@@ -28,6 +29,7 @@ static unsigned long userBtnDownAt = 0;
 #endif
 
 void setup() {
+  the_mesh.setCaches(&caches);
   Serial.begin(115200);
   delay(1000);
 
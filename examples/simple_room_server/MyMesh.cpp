@@ -10,6 +10,12 @@
 
 #define POST_SYNC_DELAY_SECS        6
 
+#define SYNC_PUSH_GAP               300   // min millis between pushes (any client)
+#define SYNC_MAX_QUEUED             2     // only push when fewer packets than this are waiting to send
+#define SYNC_MAX_PUSH_FAILURES      3
+
+#define IDLE_CHECK_INTERVAL         (60*60*1000UL)   // millis
+
 #define FIRMWARE_VER_LEVEL       1
 
 #define REQ_TYPE_GET_STATUS         0x01 // same as _GET_STATS
@@ -40,17 +46,15 @@ struct ServerStats {
 
 void MyMesh::addPost(ClientInfo *client, const char *postData) {
   // TODO: suggested postData format: <title>/<descrption>
-  posts[next_post_idx].author = client->id; // add to cyclic queue
-  StrHelper::strncpy(posts[next_post_idx].text, postData, MAX_POST_TEXT_LEN);
-
-  posts[next_post_idx].post_timestamp = getRTCClock()->getCurrentTimeUnique();
-  next_post_idx = (next_post_idx + 1) % MAX_UNSYNCED_POSTS;
-
+  if (post_store.addPost(client->id.pub_key, getRTCClock()->getCurrentTimeUnique(), postData) == 0) {   // (replaces oldest, if full)
+    MESH_DEBUG_PRINTLN("addPost: unable to store post");
+    return;
+  }
   next_push = futureMillis(PUSH_NOTIFY_DELAY_MILLIS);
   _num_posted++; // stats
 }
 
-void MyMesh::pushPostToClient(ClientInfo *client, PostInfo &post) {
+bool MyMesh::pushPostToClient(ClientInfo *client, const StoredPost &post) {
   int len = 0;
   memcpy(&reply_data[len], &post.post_timestamp, 4);
   len += 4; // this is a PAST timestamp... but should be accepted by client
@@ -59,55 +63,118 @@ void MyMesh::pushPostToClient(ClientInfo *client, PostInfo &post) {
   getRNG()->random(&attempt, 1); // need this for re-tries, so packet hash (and ACK) will be different
   reply_data[len++] = (TXT_TYPE_SIGNED_PLAIN << 2) | (attempt & 3); // 'signed' plain text
 
-  // encode prefix of post.author.pub_key
-  memcpy(&reply_data[len], post.author.pub_key, 4);
+  // encode prefix of post.author
+  memcpy(&reply_data[len], post.author, 4);
   len += 4; // just first 4 bytes
 
   int text_len = strlen(post.text);
   memcpy(&reply_data[len], post.text, text_len);
   len += text_len;
 
+  return sendSyncPush(client, len, post.post_timestamp, post.post_timestamp, 1);
+}
+
+bool MyMesh::pushBatchToClient(ClientInfo *client, uint32_t since, uint32_t until, uint32_t slot_timestamp, int min_posts) {
+  uint8_t attempt;
+  getRNG()->random(&attempt, 1); // as for single posts, so packet hash (and ACK) differ on re-tries
+  PostBatchWriter batch(reply_data, sizeof(reply_data), attempt);
+
+  uint32_t ts = since;
+  while ((ts = post_store.getNextTimestamp(ts, client->id.pub_key)) != 0 && ts <= until) {
+    auto p = post_store.getPost(ts);
+    if (p && !batch.add(ts, p->author, p->text)) break;   // full
+  }
+  if (batch.getCount() < min_posts) return false;
+
+  int len = batch.finish();
+  if (slot_timestamp == 0) slot_timestamp = batch.getLastTimestamp();
+  if (!sendSyncPush(client, len, slot_timestamp, batch.getFirstTimestamp(), batch.getCount())) return false;
+  MESH_DEBUG_PRINTLN("pushed batch of %d to client %02X", batch.getCount(), (uint32_t)client->id.pub_key[0]);
+  return true;
+}
+
+bool MyMesh::sendSyncPush(ClientInfo *client, int len, uint32_t slot_timestamp, uint32_t first_timestamp, int num_posts) {
   // calc expected ACK reply
-  mesh::Utils::sha256((uint8_t *)&client->extra.room.pending_ack, 4, reply_data, len, client->id.pub_key, PUB_KEY_SIZE);
-  client->extra.room.push_post_timestamp = post.post_timestamp;
+  uint32_t expected_ack;
+  mesh::Utils::sha256((uint8_t *)&expected_ack, 4, reply_data, len, client->id.pub_key, PUB_KEY_SIZE);
 
   auto reply = createDatagram(PAYLOAD_TYPE_TXT_MSG, client->id, client->shared_secret, reply_data, len);
   if (reply) {
+    uint32_t timeout;
     if (client->out_path_len == OUT_PATH_UNKNOWN) {
       unsigned long delay_millis = 0;
       sendFloodScoped(default_scope, reply, delay_millis, _prefs.path_hash_mode + 1); // REVISIT
-      client->extra.room.ack_timeout = futureMillis(PUSH_ACK_TIMEOUT_FLOOD);
+      timeout = PUSH_ACK_TIMEOUT_FLOOD;
     } else {
       sendDirect(reply, client->out_path, client->out_path_len);
 
       uint8_t path_hash_count = client->out_path_len & 63;
-      client->extra.room.ack_timeout = futureMillis(PUSH_TIMEOUT_BASE + PUSH_ACK_TIMEOUT_FACTOR * (path_hash_count + 1));
+      timeout = PUSH_TIMEOUT_BASE + PUSH_ACK_TIMEOUT_FACTOR * (path_hash_count + 1);
     }
+    syncWindow(client).onPushed(slot_timestamp, expected_ack, _ms->getMillis(), timeout, SYNC_PUSH_INTERVAL,
+                                first_timestamp, num_posts);
     _num_post_pushes++; // stats
-  } else {
-    client->extra.room.pending_ack = 0;
-    MESH_DEBUG_PRINTLN("Unable to push post to client");
+    return true;
   }
+  MESH_DEBUG_PRINTLN("Unable to push post to client");
+  return false;
 }
 
-uint8_t MyMesh::getUnsyncedCount(ClientInfo *client) {
-  uint8_t count = 0;
-  for (int k = 0; k < MAX_UNSYNCED_POSTS; k++) {
-    if (posts[k].post_timestamp > client->extra.room.sync_since // is new post for this Client?
-        && !posts[k].author.matches(client->id)) {   // don't push posts to the author
-      count++;
+void MyMesh::advanceSyncSince(ClientInfo *client, uint32_t acked_through) {
+  if (acked_through > client->extra.room.sync_since) {
+    client->extra.room.sync_since = acked_through; // advance Client's SINCE timestamp, over all ACK'd posts
+  }
+}
+
+bool MyMesh::pushNextPost(ClientInfo *client) {
+  auto& sync = syncWindow(client);
+
+  // re-send any timed out post first (oldest first)
+  uint32_t resend, first;
+  while ((resend = sync.getResendTimestamp(&first)) != 0) {
+    if (first < resend) {   // was a batch, so re-build it from whichever of its posts are still stored
+      if (pushBatchToClient(client, first - 1, resend, resend, 1)) return true;
+    } else {
+      auto p = post_store.getPost(resend);
+      if (p) return pushPostToClient(client, *p);
     }
+
+    uint32_t acked_through;
+    sync.dropPost(resend, _ms->getMillis(), acked_through);   // post has since been replaced in store
+    advanceSyncSince(client, acked_through);
   }
-  return count;
+
+  // otherwise, the oldest post not yet pushed
+  uint32_t since = client->extra.room.sync_since > sync.cursor ? client->extra.room.sync_since : sync.cursor;
+  uint32_t next_ts = post_store.getNextTimestamp(since, client->id.pub_key);   // don't push posts to the author
+  uint32_t now = getRTCClock()->getCurrentTime();
+  if (next_ts == 0 || now < next_ts + POST_SYNC_DELAY_SECS) return false;
+
+  if ((client->extra.room.features & LOGIN_FEATURE_POST_BATCH) && pushBatchToClient(client, since, now - POST_SYNC_DELAY_SECS, 0, 2)) {
+    return true;   // catching up, so several posts in one packet
+  }
+
+  auto next = post_store.getPost(next_ts);
+  if (next == NULL) return false;
+
+  if (!pushPostToClient(client, *next)) return false;
+  MESH_DEBUG_PRINTLN("pushed to client %02X: %s", (uint32_t)client->id.pub_key[0], next->text);
+  return true;
+}
+
+uint8_t MyMesh::getUnsyncedCount(ClientInfo *client) {
+  int count = post_store.countSince(client->extra.room.sync_since, client->id.pub_key);   // not including their own posts
+  return count > 255 ? 255 : count;
 }
 
 bool MyMesh::processAck(const uint8_t *data) {
   for (int i = 0; i < acl.getNumClients(); i++) {
     auto client = acl.getClientByIdx(i);
-    if (client->extra.room.pending_ack && memcmp(data, &client->extra.room.pending_ack, 4) == 0) { // got an ACK from Client!
-      client->extra.room.pending_ack = 0; // clear this, so next push can happen
+    uint32_t ack_crc, acked_through;
+    memcpy(&ack_crc, data, 4);
+    if (syncWindow(client).onAck(ack_crc, _ms->getMillis(), acked_through)) { // got an ACK from Client! (maybe for an earlier attempt)
       client->extra.room.push_failures = 0;
-      client->extra.room.sync_since = client->extra.room.push_post_timestamp; // advance Client's SINCE timestamp, to sync next post
+      advanceSyncSince(client, acked_through);
       return true;
     }
   }
@@ -350,7 +417,7 @@ void MyMesh::onAnonDataRecv(mesh::Packet *packet, const uint8_t *secret, const m
       MESH_DEBUG_PRINTLN("Login success!");
       client->last_timestamp = sender_timestamp;
       client->extra.room.sync_since = sender_sync_since;
-      client->extra.room.pending_ack = 0;
+      syncWindow(client).reset(sender_sync_since, _ms->getMillis());
       client->extra.room.push_failures = 0;
 
       client->last_activity = getRTCClock()->getCurrentTime();
@@ -361,6 +428,9 @@ void MyMesh::onAnonDataRecv(mesh::Packet *packet, const uint8_t *secret, const m
       dirty_contacts_expiry = futureMillis(LAZY_CONTACTS_WRITE_DELAY);
     }
 
+    int pw_len = strlen((char *)&data[8]);
+    client->extra.room.features = (9 + pw_len < len) ? data[9 + pw_len] : 0;   // (older clients don't send this)
+
     if (packet->isRouteFlood()) {
       client->out_path_len = OUT_PATH_UNKNOWN;  // need to rediscover out_path
     }
@@ -397,21 +467,12 @@ void MyMesh::onAnonDataRecv(mesh::Packet *packet, const uint8_t *secret, const m
 }
 
 int MyMesh::searchPeersByHash(const uint8_t *hash) {
-  int n = 0;
-  for (int i = 0; i < acl.getNumClients(); i++) {
-    if (acl.getClientByIdx(i)->id.isHashMatch(hash)) {
-      matching_peer_indexes[n++] = i; // store the INDEXES of matching contacts (for subsequent 'peer' methods)
-    }
-  }
-  return n;
+  return acl.searchByHash(hash, matching_peer_indexes, MAX_CLIENTS);
 }
 
 void MyMesh::getPeerSharedSecret(uint8_t *dest_secret, int peer_idx) {
   int i = matching_peer_indexes[peer_idx];
-  if (i >= 0 && i < acl.getNumClients()) {
-    // lookup pre-calculated shared_secret
-    memcpy(dest_secret, acl.getClientByIdx(i)->shared_secret, PUB_KEY_SIZE);
-  } else {
+  if (!acl.getSharedSecret(i, dest_secret)) {
     MESH_DEBUG_PRINTLN("getPeerSharedSecret: Invalid peer idx: %d", i);
   }
 }
@@ -419,11 +480,11 @@ void MyMesh::getPeerSharedSecret(uint8_t *dest_secret, int peer_idx) {
 void MyMesh::onPeerDataRecv(mesh::Packet *packet, uint8_t type, int sender_idx, const uint8_t *secret,
                             uint8_t *data, size_t len) {
   int i = matching_peer_indexes[sender_idx];
-  if (i < 0 || i >= acl.getNumClients()) { // get from our known_clients table (sender SHOULD already be known in this context)
+  ClientInfo* client = acl.getMatchingClient(i);   // (pages in client, if in cold store)
+  if (client == NULL) { // get from our known_clients table (sender SHOULD already be known in this context)
     MESH_DEBUG_PRINTLN("onPeerDataRecv: invalid peer idx: %d", i);
     return;
   }
-  auto client = acl.getClientByIdx(i);
   if (type == PAYLOAD_TYPE_TXT_MSG && len > 5) { // a CLI command or new Post
     uint32_t sender_timestamp;
     memcpy(&sender_timestamp, data, 4); // timestamp (by sender's RTC clock - which could be wrong)
@@ -542,10 +603,9 @@ void MyMesh::onPeerDataRecv(mesh::Packet *packet, uint8_t type, int sender_idx,
         }
         if (forceSince > 0) {
           client->extra.room.sync_since = forceSince; // force-update the 'sync since'
+          syncWindow(client).reset(forceSince, _ms->getMillis());   // and start pushing again from there
         }
 
-        client->extra.room.pending_ack = 0;
-
         // TODO: Throttle KEEP_ALIVE requests!
         // if client sends too quickly, evict()
 
@@ -588,10 +648,10 @@ bool MyMesh::onPeerPathRecv(mesh::Packet *packet, int sender_idx, const uint8_t
                             uint8_t path_len, uint8_t extra_type, uint8_t *extra, uint8_t extra_len) {
   // TODO: prevent replay attacks
   int i = matching_peer_indexes[sender_idx];
+  ClientInfo* client = acl.getMatchingClient(i);   // (pages in client, if in cold store)
 
-  if (i >= 0 && i < acl.getNumClients()) { // get from our known_clients table (sender SHOULD already be known in this context)
+  if (client) { // get from our known_clients table (sender SHOULD already be known in this context)
     MESH_DEBUG_PRINTLN("PATH to client, path_len=%d", (uint32_t)path_len);
-    auto client = acl.getClientByIdx(i);
     client->out_path_len = mesh::Packet::copyPath(client->out_path, path, path_len); // store a copy of path, for sendDirect()
     client->last_activity = getRTCClock()->getCurrentTime();
   } else {
@@ -616,9 +676,9 @@ void MyMesh::onAckRecv(mesh::Packet *packet, uint32_t ack_crc) {
 MyMesh::MyMesh(mesh::MainBoard &board, mesh::Radio &radio, mesh::MillisecondClock &ms, mesh::RNG &rng,
                mesh::RTCClock &rtc, mesh::MeshTables &tables)
     : mesh::Mesh(radio, ms, rng, rtc, *new StaticPoolPacketManager(32), tables),
-      region_map(key_store), temp_map(key_store),
+      region_map(key_store), temp_map(key_store), cold_clients("/s_clients_cold", MAX_COLD_CLIENTS),
       _cli(board, rtc, sensors, region_map, acl, &_prefs, this),
-      telemetry(MAX_PACKET_PAYLOAD - 4)
+      telemetry(MAX_PACKET_PAYLOAD - 4), post_store("/posts", MAX_STORED_POSTS, MAX_UNSYNCED_POSTS)
 {
   last_millis = 0;
   uptime_millis = 0;
@@ -627,6 +687,7 @@ MyMesh::MyMesh(mesh::MainBoard &board, mesh::Radio &radio, mesh::MillisecondCloc
   _logging = false;
   region_load_active = false;
   set_radio_at = revert_radio_at = 0;
+  acl.setSlotData(sync_windows, sizeof(PostSyncWindow));
 
   // defaults
   memset(&_prefs, 0, sizeof(_prefs));
@@ -659,10 +720,9 @@ MyMesh::MyMesh(mesh::MainBoard &board, mesh::Radio &radio, mesh::MillisecondCloc
   _prefs.gps_interval = 0;
   _prefs.advert_loc_policy = ADVERT_LOC_PREFS;
 
-  next_post_idx = 0;
   next_client_idx = 0;
   next_push = 0;
-  memset(posts, 0, sizeof(posts));
+  next_idle_check = 0;
   _num_posted = _num_post_pushes = 0;
 
   memset(default_scope.key, 0, sizeof(default_scope.key));
@@ -674,9 +734,16 @@ void MyMesh::begin(FILESYSTEM *fs) {
   // load persisted prefs
   _cli.loadPrefs(_fs);
 
+  if (cold_clients.getMaxClients() > 0) acl.setColdStore(&cold_clients);
   acl.load(_fs, self_id);
+  key_store.load(_fs);
   region_map.load(_fs);
 
+  post_store.begin(_fs);
+  if (getRTCClock()->getCurrentTime() < post_store.getNewestTimestamp()) {   // clock was reset, don't let it go backwards
+    getRTCClock()->setCurrentTime(post_store.getNewestTimestamp() + 1);
+  }
+
   // establish default-scope
   {
     RegionEntry* r = region_map.getDefaultRegion();
@@ -934,6 +1001,33 @@ void MyMesh::handleCommand(uint32_t sender_timestamp, char *command, char *reply
       Serial.printf("\n");
     }
     reply[0] = 0;
+  } else if (strcmp(command, "get sync") == 0) {   // post sync rates, per client
+    uint32_t now_ms = _ms->getMillis();
+    if (sender_timestamp == 0) {
+      Serial.println("Sync: (pubkey, posts/min, rtt, window, in flight, failures)");
+    }
+    char* dp = reply;
+    for (int i = 0; i < acl.getNumClients(); i++) {
+      auto c = acl.getClientByIdx(i);
+      auto& sync = syncWindow(c);
+      if (c->last_activity == 0 || sync.num_synced == 0) continue;  // skip evicted, or not synced yet
+
+      if (sender_timestamp == 0) {
+        mesh::Utils::printHex(Serial, c->id.pub_key, 4);
+        Serial.printf(" %u %u %u %d %u\n", sync.getPostsPerMin(now_ms), (uint32_t)sync.srtt, (uint32_t)sync.getWindow(),
+                      sync.numInFlight(), (uint32_t)c->extra.room.push_failures);
+      }
+      if (dp - reply < 120) {   // remote reply: as many as will fit
+        mesh::Utils::toHex(dp, c->id.pub_key, 2);
+        dp += 4;
+        dp += sprintf(dp, ":%u/min,%ums,w%u ", sync.getPostsPerMin(now_ms), (uint32_t)sync.srtt, (uint32_t)sync.getWindow());
+      }
+    }
+    if (dp == reply) {
+      strcpy(reply, "(none)");
+    } else {
+      dp[-1] = 0;   // remove trailing space
+    }
   } else{
     _cli.handleCommand(sender_timestamp, command, reply);  // common CLI commands
   }
@@ -947,44 +1041,35 @@ void MyMesh::loop() {
   mesh::Mesh::loop();
 
   if (millisHasNowPassed(next_push) && acl.getNumClients() > 0) {
+    uint32_t now_ms = _ms->getMillis();
     // check for ACK timeouts
     for (int i = 0; i < acl.getNumClients(); i++) {
       auto c = acl.getClientByIdx(i);
-      if (c->extra.room.pending_ack && millisHasNowPassed(c->extra.room.ack_timeout)) {
+      int n = syncWindow(c).checkTimeouts(now_ms);   // NOTE: these stay in window, in case ACKs arrive LATER, after we retry
+      if (n > 0) {
         c->extra.room.push_failures++;
-        c->extra.room.pending_ack = 0; // reset  (TODO: keep prev expected_ack's in a list, incase they arrive LATER, after we retry)
         MESH_DEBUG_PRINTLN("pending ACK timed out: push_failures: %d", (uint32_t)c->extra.room.push_failures);
       }
     }
-    // check next Round-Robin client, and sync next new post
-    auto client = acl.getClientByIdx(next_client_idx);
+
+    // find next Round-Robin client that has room in its window, and sync next new (or timed out) post
     bool did_push = false;
-    if (client->extra.room.pending_ack == 0 && client->last_activity != 0 &&
-        client->extra.room.push_failures < 3) { // not already waiting for ACK, AND not evicted, AND retries not max
-      MESH_DEBUG_PRINTLN("loop - checking for client %02X", (uint32_t)client->id.pub_key[0]);
-      uint32_t now = getRTCClock()->getCurrentTime();
-      for (int k = 0, idx = next_post_idx; k < MAX_UNSYNCED_POSTS; k++) {
-        auto p = &posts[idx];
-        if (now >= p->post_timestamp + POST_SYNC_DELAY_SECS &&
-            p->post_timestamp > client->extra.room.sync_since // is new post for this Client?
-            && !p->author.matches(client->id)) {   // don't push posts to the author
-          // push this post to Client, then wait for ACK
-          pushPostToClient(client, *p);
-          did_push = true;
-          MESH_DEBUG_PRINTLN("loop - pushed to client %02X: %s", (uint32_t)client->id.pub_key[0], p->text);
-          break;
+    if (_mgr->getOutboundTotal() < SYNC_MAX_QUEUED) {   // don't flood our own send queue
+      if (next_client_idx >= acl.getNumClients()) next_client_idx = 0;   // (clients may have been removed)
+      for (int k = 0; k < acl.getNumClients() && !did_push; k++) {
+        auto client = acl.getClientByIdx(next_client_idx);
+        next_client_idx = (next_client_idx + 1) % acl.getNumClients(); // round robin polling for each client
+
+        if (client->last_activity != 0 && client->extra.room.push_failures < SYNC_MAX_PUSH_FAILURES  // not evicted, AND retries not max
+            && syncWindow(client).canPush(now_ms)) {
+          did_push = pushNextPost(client);
         }
-        idx = (idx + 1) % MAX_UNSYNCED_POSTS; // wrap to start of cyclic queue
       }
-    } else {
-      MESH_DEBUG_PRINTLN("loop - skipping busy (or evicted) client %02X", (uint32_t)client->id.pub_key[0]);
     }
-    next_client_idx = (next_client_idx + 1) % acl.getNumClients(); // round robin polling for each client
 
     if (did_push) {
-      next_push = futureMillis(SYNC_PUSH_INTERVAL);
+      next_push = futureMillis(SYNC_PUSH_GAP);   // (each client's window does its own pacing)
     } else {
-      // were no unsynced posts for curr client, so process next client much quicker! (in next loop())
       next_push = futureMillis(SYNC_PUSH_INTERVAL / 8);
     }
   }
@@ -1021,7 +1106,16 @@ void MyMesh::loop() {
     dirty_contacts_expiry = 0;
   }
 
-  // TODO: periodically check for OLD/inactive entries in known_clients[], and evict
+  // persist newly derived region keys (lazily)
+  key_store.loopSave(_fs, _ms->getMillis(), LAZY_CONTACTS_WRITE_DELAY);
+
+  if (millisHasNowPassed(next_idle_check)) {   // move long inactive clients out of RAM
+    int n = acl.evictIdle(getRTCClock()->getCurrentTime(), CLIENT_IDLE_EVICT_SECS);
+    if (n > 0) {
+      MESH_DEBUG_PRINTLN("%d idle clients moved to cold store", n);
+    }
+    next_idle_check = futureMillis(IDLE_CHECK_INTERVAL);
+  }
 
   // update uptime
   uint32_t now = millis();
@@ -14,12 +14,16 @@
 #include <helpers/ArduinoHelpers.h>
 #include <helpers/StaticPoolPacketManager.h>
 #include <helpers/SimpleMeshTables.h>
+#include <helpers/SimpleMeshCaches.h>
 #include <helpers/IdentityStore.h>
 #include <helpers/AdvertDataHelpers.h>
 #include <helpers/TxtDataHelpers.h>
 #include <helpers/CommonCLI.h>
 #include <helpers/StatsFormatHelper.h>
 #include <helpers/ClientACL.h>
+#include <helpers/PostSyncWindow.h>
+#include <helpers/PostStore.h>
+#include <helpers/PostBatch.h>
 #include <helpers/RegionMap.h>
 #include <RTClib.h>
 #include <target.h>
@@ -65,7 +69,23 @@
 #endif
 
 #ifndef MAX_UNSYNCED_POSTS
-  #define MAX_UNSYNCED_POSTS    32
+  #define MAX_UNSYNCED_POSTS    16    // most recent posts, cached in RAM
+#endif
+
+#ifndef MAX_STORED_POSTS    // post history, in flash (~192 bytes each)
+  #if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+    #define MAX_STORED_POSTS    48    // small internal flash
+  #else
+    #define MAX_STORED_POSTS   256
+  #endif
+#endif
+
+#ifndef MAX_COLD_CLIENTS    // clients moved out of RAM when the ACL is full (in flash, ~134 bytes each)
+  #define MAX_COLD_CLIENTS   0   // cold clients tier disabled. Opt-in, eg. 32 on NRF52/STM32, 256 on ESP32
+#endif
+
+#ifndef CLIENT_IDLE_EVICT_SECS
+  #define CLIENT_IDLE_EVICT_SECS   (24*60*60)   // then moved out of RAM, to cold store
 #endif
 
 #ifndef SERVER_RESPONSE_DELAY
@@ -82,12 +102,6 @@
 
 #define MAX_POST_TEXT_LEN    (160-9)
 
-struct PostInfo {
-  mesh::Identity author;
-  uint32_t post_timestamp;   // by OUR clock
-  char text[MAX_POST_TEXT_LEN+1];
-};
-
 class MyMesh : public mesh::Mesh, public CommonCLICallbacks {
   FILESYSTEM* _fs;
   uint32_t last_millis;
@@ -99,15 +113,17 @@ class MyMesh : public mesh::Mesh, public CommonCLICallbacks {
   TransportKeyStore key_store;
   RegionMap region_map, temp_map;
   ClientACL acl;
+  PostSyncWindow sync_windows[MAX_CLIENTS];   // posts in flight, alongside acl's clients[] (see ClientACL::setSlotData())
+  ClientColdStore cold_clients;
   CommonCLI _cli;
   unsigned long dirty_contacts_expiry;
   uint8_t reply_data[MAX_PACKET_PAYLOAD];
   unsigned long next_push;
+  unsigned long next_idle_check;
   uint16_t _num_posted, _num_post_pushes;
   int next_client_idx;  // for round-robin polling
-  int next_post_idx;
-  PostInfo posts[MAX_UNSYNCED_POSTS];   // cyclic queue
   CayenneLPP telemetry;
+  PostStore post_store;
   RegionEntry* load_stack[8];
   RegionEntry* recv_pkt_region;
   TransportKey default_scope;
@@ -119,7 +135,12 @@ class MyMesh : public mesh::Mesh, public CommonCLICallbacks {
   int  matching_peer_indexes[MAX_CLIENTS];
 
   void addPost(ClientInfo* client, const char* postData);
-  void pushPostToClient(ClientInfo* client, PostInfo& post);
+  bool pushPostToClient(ClientInfo* client, const StoredPost& post);
+  bool pushBatchToClient(ClientInfo* client, uint32_t since, uint32_t until, uint32_t slot_timestamp, int min_posts);
+  bool sendSyncPush(ClientInfo* client, int len, uint32_t slot_timestamp, uint32_t first_timestamp, int num_posts);
+  bool pushNextPost(ClientInfo* client);
+  void advanceSyncSince(ClientInfo* client, uint32_t acked_through);
+  PostSyncWindow& syncWindow(const ClientInfo* client) { return sync_windows[acl.getClientIdx(client)]; }
   uint8_t getUnsyncedCount(ClientInfo* client);
   bool processAck(const uint8_t *data);
   mesh::Packet* createSelfAdvert();
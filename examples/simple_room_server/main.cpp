@@ -10,6 +10,7 @@
 
 StdRNG fast_rng;
 SimpleMeshTables tables;
+SimpleMeshCaches caches;
 MyMesh the_mesh(board, radio_driver, *new ArduinoMillis(), fast_rng, rtc_clock, tables);
 
 void halt() {
@@ -19,6 +20,7 @@ void halt() {
 static char command[MAX_POST_TEXT_LEN+1];
 
 void setup() {
+  the_mesh.setCaches(&caches);
   Serial.begin(115200);
   delay(1000);
 
@@ -12,6 +12,7 @@
 #include <helpers/ArduinoHelpers.h>
 #include <helpers/StaticPoolPacketManager.h>
 #include <helpers/SimpleMeshTables.h>
+#include <helpers/SimpleMeshCaches.h>
 #include <helpers/IdentityStore.h>
 #include <RTClib.h>
 #include <target.h>
@@ -549,6 +550,7 @@ public:
 
 StdRNG fast_rng;
 SimpleMeshTables tables;
+SimpleMeshCaches caches;
 MyMesh the_mesh(radio_driver, fast_rng, rtc_clock, tables);
 
 void halt() {
@@ -556,6 +558,7 @@ void halt() {
 }
 
 void setup() {
+  the_mesh.setCaches(&caches);
   Serial.begin(115200);
 
   board.begin();
@@ -478,21 +478,12 @@ void SensorMesh::onAnonDataRecv(mesh::Packet* packet, const uint8_t* secret, con
 }
 
 int SensorMesh::searchPeersByHash(const uint8_t* hash) {
-  int n = 0;
-  for (int i = 0; i < acl.getNumClients() && n < MAX_SEARCH_RESULTS; i++) {
-    if (acl.getClientByIdx(i)->id.isHashMatch(hash)) {
-      matching_peer_indexes[n++] = i;  // store the INDEXES of matching contacts (for subsequent 'peer' methods)
-    }
-  }
-  return n;
+  return acl.searchByHash(hash, matching_peer_indexes, MAX_SEARCH_RESULTS);   // (no cold store, so all are in clients[])
 }
 
 void SensorMesh::getPeerSharedSecret(uint8_t* dest_secret, int peer_idx) {
   int i = matching_peer_indexes[peer_idx];
-  if (i >= 0 && i < acl.getNumClients()) {
-    // lookup pre-calculated shared_secret
-    memcpy(dest_secret, acl.getClientByIdx(i)->shared_secret, PUB_KEY_SIZE);
-  } else {
+  if (!acl.getSharedSecret(i, dest_secret)) {
     MESH_DEBUG_PRINTLN("getPeerSharedSecret: Invalid peer idx: %d", i);
   }
 }
@@ -742,6 +733,7 @@ void SensorMesh::begin(FILESYSTEM* fs) {
   _cli.loadPrefs(_fs);
 
   acl.load(_fs, self_id);
+  key_store.load(_fs);
   region_map.load(_fs);
 
   // establish default-scope
@@ -971,4 +963,7 @@ void SensorMesh::loop() {
     acl.save(_fs);
     dirty_contacts_expiry = 0;
   }
+
+  // persist newly derived region keys (lazily)
+  key_store.loopSave(_fs, _ms->getMillis(), LAZY_CONTACTS_WRITE_DELAY);
 }
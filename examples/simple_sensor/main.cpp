@@ -43,6 +43,7 @@ protected:
 
 StdRNG fast_rng;
 SimpleMeshTables tables;
+SimpleMeshCaches caches;
 
 MyMesh the_mesh(board, radio_driver, *new ArduinoMillis(), fast_rng, rtc_clock, tables);
 
@@ -53,6 +54,7 @@ void halt() {
 static char command[160];
 
 void setup() {
+  the_mesh.setCaches(&caches);
   Serial.begin(115200);
   delay(1000);
 
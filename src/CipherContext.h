@@ -0,0 +1,26 @@
+#pragma once
+
+#include <MeshCore.h>
+#include <AES.h>
+#include <SHA256.h>
+
+namespace mesh {
+
+/**
+ * \brief  Pre-computed cipher state for one shared secret: the expanded AES128 key schedule, and the HMAC-SHA256
+ *     hash states after absorbing the inner and outer pad blocks. Using this with the Utils encrypt/decrypt overloads
+ *     saves the key expansion, plus two SHA256 blocks, on every call.
+*/
+class CipherContext {
+public:
+  AES128 aes;
+  SHA256 hmac_inner;    // after absorbing (secret ^ ipad)
+  SHA256 hmac_outer;    // after absorbing (secret ^ opad)
+
+  /**
+   * \param  shared_secret   PUB_KEY_SIZE bytes (first CIPHER_KEY_SIZE bytes are the AES key)
+  */
+  void setKey(const uint8_t* shared_secret);
+};
+
+}
@@ -125,6 +125,8 @@ class Dispatcher {
   uint32_t n_recv_flood, n_recv_direct;
   unsigned long tx_budget_ms;
   unsigned long last_budget_update;
+  unsigned long budget_start;
+  uint32_t n_budget_holds;
   unsigned long duty_cycle_window_ms;
 
   void processRecvPacket(Packet* pkt);
@@ -149,6 +151,8 @@ protected:
     prev_isrecv_mode = true;
     tx_budget_ms = 0;
     last_budget_update = 0;
+    budget_start = 0;
+    n_budget_holds = 0;
     duty_cycle_window_ms = 3600000;
   }
 
@@ -180,12 +184,17 @@ public:
   unsigned long getTotalAirTime() const { return total_air_time; }
   unsigned long getReceiveAirTime() const {return rx_air_time; }
   unsigned long getRemainingTxBudget() const { return tx_budget_ms; }
+  uint32_t getNumBudgetHolds() const { return n_budget_holds; }    // times a due packet was held back for tx budget
+
+  /** \returns  transmit airtime so far, as a fraction of the airtime allowed by the duty cycle (since begin()) */
+  float getTxBudgetUtilisation() const;
   uint32_t getNumSentFlood() const { return n_sent_flood; }
   uint32_t getNumSentDirect() const { return n_sent_direct; }
   uint32_t getNumRecvFlood() const { return n_recv_flood; }
   uint32_t getNumRecvDirect() const { return n_recv_direct; }
   void resetStats() {
     n_sent_flood = n_sent_direct = n_recv_flood = n_recv_direct = 0;
+    n_budget_holds = 0;
     _err_flags = 0;
   }
 
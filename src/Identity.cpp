@@ -6,10 +6,6 @@
 
 namespace mesh {
 
-Identity::Identity() {
-  memset(pub_key, 0, sizeof(pub_key));
-}
-
 Identity::Identity(const char* pub_hex) {
   Utils::fromHex(pub_key, PUB_KEY_SIZE, pub_hex);
 }
@@ -12,7 +12,7 @@ class Identity {
 public:
   uint8_t pub_key[PUB_KEY_SIZE];
 
-  Identity();
+  Identity() { memset(pub_key, 0, sizeof(pub_key)); }
   Identity(const char* pub_hex);
   Identity(const uint8_t* _pub) { memcpy(pub_key, _pub, PUB_KEY_SIZE); }
 
@@ -38,6 +38,25 @@ int Mesh::searchChannelsByHash(const uint8_t* hash, GroupChannel channels[], int
   return 0;  // not found
 }
 
+// same as the Utils:: versions, but using pre-computed cipher state if caches provide it
+int Mesh::encryptThenMAC(const uint8_t* secret, uint8_t* dest, const uint8_t* src, int src_len) {
+  CipherContext* ctx = NULL;
+  if (_caches) {
+    ctx = _caches->getCipherContext(secret);
+    if (ctx == NULL) ctx = _caches->putCipherContext(secret);   // we chose this destination, so worth caching
+  }
+  return ctx ? Utils::encryptThenMAC(*ctx, dest, src, src_len) : Utils::encryptThenMAC(secret, dest, src, src_len);
+}
+
+int Mesh::MACThenDecrypt(const uint8_t* secret, uint8_t* dest, const uint8_t* src, int src_len) {
+  CipherContext* ctx = _caches ? _caches->getCipherContext(secret) : NULL;
+  if (ctx) return Utils::MACThenDecrypt(*ctx, dest, src, src_len);
+
+  int len = Utils::MACThenDecrypt(secret, dest, src, src_len);
+  if (len > 0 && _caches) _caches->putCipherContext(secret);   // only cache on valid MAC, so junk/mis-matched candidates don't churn the LRU
+  return len;
+}
+
 DispatcherAction Mesh::onRecvPacket(Packet* pkt) {
   if (pkt->isRouteDirect() && pkt->getPayloadType() == PAYLOAD_TYPE_TRACE) {
     if (pkt->path_len < MAX_PATH_SIZE) {
@@ -141,16 +160,19 @@ DispatcherAction Mesh::onRecvPacket(Packet* pkt) {
 
         if (self_id.isHashMatch(&dest_hash)) {
           // scan contacts DB, for all matching hashes of 'src_hash' (max 4 matches supported ATM)
+          // NOTE: searchPeersByHash() impls should put most likely sender first, as we stop at first MAC match
           int num = searchPeersByHash(&src_hash);
+          if (num > 0) _n_peer_searches++;
           // for each matching contact, try to decrypt data
           bool found = false;
           for (int j = 0; j < num; j++) {
             uint8_t secret[PUB_KEY_SIZE];
             getPeerSharedSecret(secret, j);
+            _n_peer_tries++;
 
             // decrypt, checking MAC is valid
             uint8_t data[MAX_PACKET_PAYLOAD];
-            int len = Utils::MACThenDecrypt(secret, data, macAndData, pkt->payload_len - i);
+            int len = MACThenDecrypt(secret, data, macAndData, pkt->payload_len - i);
             if (len > 0) {  // success!
               if (pkt->getPayloadType() == PAYLOAD_TYPE_PATH) {
                 int k = 0;
@@ -176,6 +198,7 @@ DispatcherAction Mesh::onRecvPacket(Packet* pkt) {
             }
           }
           if (found) {
+            _n_peer_matches++;
             pkt->markDoNotRetransmit();  // packet was for this node, so don't retransmit
           } else {
             MESH_DEBUG_PRINTLN("%s recv matches no peers, src_hash=%02X", getLogDateTime(), (uint32_t)src_hash);
@@ -198,12 +221,17 @@ DispatcherAction Mesh::onRecvPacket(Packet* pkt) {
           Identity sender(sender_pub_key);
 
           uint8_t secret[PUB_KEY_SIZE];
-          self_id.calcSharedSecret(secret, sender);
+          bool is_cached = _caches && _caches->getSharedSecret(secret, sender_pub_key);
+          if (!is_cached) {
+            self_id.calcSharedSecret(secret, sender);
+          }
 
           // decrypt, checking MAC is valid
           uint8_t data[MAX_PACKET_PAYLOAD];
-          int len = Utils::MACThenDecrypt(secret, data, macAndData, pkt->payload_len - i);
+          int len = is_cached ? MACThenDecrypt(secret, data, macAndData, pkt->payload_len - i)   // known genuine sender
+                              : Utils::MACThenDecrypt(secret, data, macAndData, pkt->payload_len - i);
           if (len > 0) {  // success!
+            if (!is_cached && _caches) _caches->putSharedSecret(sender_pub_key, secret);   // only cache for genuine senders
             onAnonDataRecv(pkt, secret, sender, data, len);
             pkt->markDoNotRetransmit();
           }
@@ -228,7 +256,7 @@ DispatcherAction Mesh::onRecvPacket(Packet* pkt) {
         for (int j = 0; j < num; j++) {
           // decrypt, checking MAC is valid
           uint8_t data[MAX_PACKET_PAYLOAD];
-          int len = Utils::MACThenDecrypt(channels[j].secret, data, macAndData, pkt->payload_len - i);
+          int len = MACThenDecrypt(channels[j].secret, data, macAndData, pkt->payload_len - i);
           if (len > 0) {  // success!
             onGroupDataRecv(pkt, pkt->getPayloadType(), channels[j], data, len);
             break;
@@ -258,7 +286,9 @@ DispatcherAction Mesh::onRecvPacket(Packet* pkt) {
 
         // check that signature is valid
         bool is_ok;
-        {
+        if (_caches && _caches->isVerifiedAdvert(id.pub_key, timestamp, signature, app_data, app_data_len)) {
+          is_ok = true;   // exact same advert was verified earlier
+        } else {
           uint8_t message[PUB_KEY_SIZE + 4 + MAX_ADVERT_DATA_SIZE];
           int msg_len = 0;
           memcpy(&message[msg_len], id.pub_key, PUB_KEY_SIZE); msg_len += PUB_KEY_SIZE;
@@ -266,6 +296,7 @@ DispatcherAction Mesh::onRecvPacket(Packet* pkt) {
           memcpy(&message[msg_len], app_data, app_data_len); msg_len += app_data_len;
 
           is_ok = id.verify(signature, message, msg_len);
+          if (is_ok && _caches) _caches->setVerifiedAdvert(id.pub_key, timestamp, signature, app_data, app_data_len);
         }
         if (is_ok) {
           MESH_DEBUG_PRINTLN("%s Mesh::onRecvPacket(): valid advertisement received!", getLogDateTime());
@@ -462,7 +493,7 @@ Packet* Mesh::createPathReturn(const uint8_t* dest_hash, const uint8_t* secret,
       getRNG()->random(&data[data_len], 4); data_len += 4;
     }
 
-    len += Utils::encryptThenMAC(secret, &packet->payload[len], data, data_len);
+    len += encryptThenMAC(secret, &packet->payload[len], data, data_len);
   }
 
   packet->payload_len = len;
@@ -487,7 +518,7 @@ Packet* Mesh::createDatagram(uint8_t type, const Identity& dest, const uint8_t*
   int len = 0;
   len += dest.copyHashTo(&packet->payload[len]);  // dest hash
   len += self_id.copyHashTo(&packet->payload[len]);  // src hash
-  len += Utils::encryptThenMAC(secret, &packet->payload[len], data, data_len);
+  len += encryptThenMAC(secret, &packet->payload[len], data, data_len);
 
   packet->payload_len = len;
 
@@ -535,7 +566,7 @@ Packet* Mesh::createGroupDatagram(uint8_t type, const GroupChannel& channel, con
 
   int len = 0;
   memcpy(&packet->payload[len], channel.hash, PATH_HASH_SIZE); len += PATH_HASH_SIZE;
-  len += Utils::encryptThenMAC(channel.secret, &packet->payload[len], data, data_len);
+  len += encryptThenMAC(channel.secret, &packet->payload[len], data, data_len);
 
   packet->payload_len = len;
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <Dispatcher.h>
+#include <CipherContext.h>
 
 namespace mesh {
 
@@ -19,6 +20,39 @@ public:
   virtual void clear(const Packet* packet) = 0;   // remove this packet hash from table
 };
 
+/**
+ * \brief  Optional caches of expensive crypto results (signature verifies, key exchanges, key expansions), kept
+ *     separate from MeshTables so that only nodes running a Mesh pay for them. See Mesh::setCaches()
+*/
+class MeshCaches {
+public:
+  /**
+   * \brief  whether this exact advert has had its signature verified before (so can skip verifying again)
+   */
+  virtual bool isVerifiedAdvert(const uint8_t* pub_key, uint32_t timestamp, const uint8_t* signature, const uint8_t* app_data, int app_data_len) { return false; }
+  virtual void setVerifiedAdvert(const uint8_t* pub_key, uint32_t timestamp, const uint8_t* signature, const uint8_t* app_data, int app_data_len) { }
+
+  /**
+   * \brief  look up a previously calculated ECDH shared secret with other party (eg. sender of an ANON_REQ)
+   * \param  secret  OUT - PUB_KEY_SIZE bytes
+   * \returns  false if not known
+   */
+  virtual bool getSharedSecret(uint8_t* secret, const uint8_t* pub_key) { return false; }
+  virtual void putSharedSecret(const uint8_t* pub_key, const uint8_t* secret) { }
+
+  /**
+   * \brief  get pre-computed cipher state for given shared secret (valid until next call)
+   * \returns  NULL if not cached
+   */
+  virtual CipherContext* getCipherContext(const uint8_t* secret) { return NULL; }
+
+  /**
+   * \brief  compute and cache the cipher state for given shared secret (valid until next call)
+   * \returns  NULL if not supported
+   */
+  virtual CipherContext* putCipherContext(const uint8_t* secret) { return NULL; }
+};
+
 /**
  * \brief  The next layer in the basic Dispatcher task, Mesh recognises the particular Payload TYPES,
  *     and provides virtual methods for sub-classes on handling incoming, and also preparing outbound Packets.
@@ -27,11 +61,15 @@ class Mesh : public Dispatcher {
   RTCClock* _rtc;
   RNG* _rng;
   MeshTables* _tables;
+  MeshCaches* _caches;
+  uint32_t _n_peer_searches, _n_peer_tries, _n_peer_matches;
 
   void removeSelfFromPath(Packet* packet);
   void routeDirectRecvAcks(Packet* packet, uint32_t delay_millis);
   //void routeRecvAcks(Packet* packet, uint32_t delay_millis);
   DispatcherAction forwardMultipartDirect(Packet* pkt);
+  int encryptThenMAC(const uint8_t* secret, uint8_t* dest, const uint8_t* src, int src_len);
+  int MACThenDecrypt(const uint8_t* secret, uint8_t* dest, const uint8_t* src, int src_len);
 
 protected:
   DispatcherAction onRecvPacket(Packet* pkt) override;
@@ -166,8 +204,9 @@ protected:
   virtual void onAckRecv(Packet* packet, uint32_t ack_crc) { }
 
   Mesh(Radio& radio, MillisecondClock& ms, RNG& rng, RTCClock& rtc, PacketManager& mgr, MeshTables& tables)
-    : Dispatcher(radio, ms, mgr), _rng(&rng), _rtc(&rtc), _tables(&tables)
+    : Dispatcher(radio, ms, mgr), _rng(&rng), _rtc(&rtc), _tables(&tables), _caches(NULL)
   {
+    resetPeerStats();
   }
 
   MeshTables* getTables() const { return _tables; }
@@ -181,6 +220,17 @@ public:
   RNG* getRNG() const { return _rng; }
   RTCClock* getRTCClock() const { return _rtc; }
 
+  /**
+   * \brief  optionally provide caches of crypto results (NULL for none, the default)
+  */
+  void setCaches(MeshCaches* caches) { _caches = caches; }
+  MeshCaches* getCaches() const { return _caches; }
+
+  uint32_t getNumPeerSearches() const { return _n_peer_searches; }   // data packets for us, from sender hash with candidate peers
+  uint32_t getNumPeerTries() const { return _n_peer_tries; }         // candidate MAC checks (avg per packet = tries / searches)
+  uint32_t getNumPeerMatches() const { return _n_peer_matches; }
+  void resetPeerStats() { _n_peer_searches = _n_peer_tries = _n_peer_matches = 0; }
+
   Packet* createAdvert(const LocalIdentity& id, const uint8_t* app_data=NULL, size_t app_data_len=0);
   Packet* createDatagram(uint8_t type, const Identity& dest, const uint8_t* secret, const uint8_t* data, size_t len);
   Packet* createAnonDatagram(uint8_t type, const LocalIdentity& sender, const Identity& dest, const uint8_t* secret, const uint8_t* data, size_t data_len);
@@ -40,6 +40,12 @@ namespace mesh {
  * \brief  The fundamental transmission unit.
 */
 class Packet {
+  mutable uint8_t _hash[MAX_HASH_SIZE];   // cached result of calculatePacketHash()
+  mutable uint8_t _hash_type;             // payload type the cached hash is for, or 0xFF if none
+  mutable uint16_t _hash_payload_len, _hash_path_len;
+
+  static uint32_t _n_hash_calcs, _n_hash_reused;
+
 public:
   Packet();
 
@@ -56,6 +62,23 @@ public:
    */
   void calculatePacketHash(uint8_t* dest_hash) const;
 
+  /**
+   * \brief  the packet hash (as per calculatePacketHash()), which is only re-calculated if the payload type
+   *     or length (or path_len, for TRACE) have changed since last time. If payload is modified in-place
+   *     (with same length), invalidateHash() MUST be called.
+   * \returns  pointer to MAX_HASH_SIZE bytes, valid until packet is next modified
+   */
+  const uint8_t* getPacketHash() const;
+
+  /**
+   * \brief  discard cached packet hash, eg. when re-using this Packet instance for new content.
+   */
+  void invalidateHash() { _hash_type = 0xFF; }
+
+  static uint32_t getNumHashCalcs() { return _n_hash_calcs; }   // number of actual SHA256 hash calculations
+  static uint32_t getNumHashReused() { return _n_hash_reused; }  // number of times a cached hash was used instead
+  static void resetHashStats() { _n_hash_calcs = _n_hash_reused = 0; }
+
   /**
    * \returns  one of ROUTE_ values
    */
@@ -1,6 +1,5 @@
 #include "Utils.h"
-#include <AES.h>
-#include <SHA256.h>
+#include "CipherContext.h"
 
 #ifdef ARDUINO
   #include <Arduino.h>
@@ -27,12 +26,30 @@ void Utils::sha256(uint8_t *hash, size_t hash_len, const uint8_t* frag1, int fra
   sha.finalize(hash, hash_len);
 }
 
-int Utils::decrypt(const uint8_t* shared_secret, uint8_t* dest, const uint8_t* src, int src_len) {
-  AES128 aes;
+#define HMAC_BLOCK_SIZE   64
+#define HMAC_HASH_SIZE    32
+
+void CipherContext::setKey(const uint8_t* shared_secret) {
+  aes.setKey(shared_secret, CIPHER_KEY_SIZE);
+
+  uint8_t pad[HMAC_BLOCK_SIZE];
+  memset(pad, 0x36, sizeof(pad));    // inner pad
+  for (int i = 0; i < PUB_KEY_SIZE; i++) pad[i] ^= shared_secret[i];
+  hmac_inner.reset();
+  hmac_inner.update(pad, sizeof(pad));
+
+  memset(pad, 0x5C, sizeof(pad));    // outer pad
+  for (int i = 0; i < PUB_KEY_SIZE; i++) pad[i] ^= shared_secret[i];
+  hmac_outer.reset();
+  hmac_outer.update(pad, sizeof(pad));
+
+  memset(pad, 0, sizeof(pad));
+}
+
+static int decryptBlocks(AES128& aes, uint8_t* dest, const uint8_t* src, int src_len) {
   uint8_t* dp = dest;
   const uint8_t* sp = src;
 
-  aes.setKey(shared_secret, CIPHER_KEY_SIZE);
   while (sp - src < src_len) {
     aes.decryptBlock(dp, sp);
     dp += 16; sp += 16;
@@ -41,11 +58,9 @@ int Utils::decrypt(const uint8_t* shared_secret, uint8_t* dest, const uint8_t* s
   return sp - src;  // will always be multiple of 16
 }
 
-int Utils::encrypt(const uint8_t* shared_secret, uint8_t* dest, const uint8_t* src, int src_len) {
-  AES128 aes;
+static int encryptBlocks(AES128& aes, uint8_t* dest, const uint8_t* src, int src_len) {
   uint8_t* dp = dest;
 
-  aes.setKey(shared_secret, CIPHER_KEY_SIZE);
   while (src_len >= 16) {
     aes.encryptBlock(dp, src);
     dp += 16; src += 16; src_len -= 16;
@@ -60,6 +75,30 @@ int Utils::encrypt(const uint8_t* shared_secret, uint8_t* dest, const uint8_t* s
   return dp - dest;  // will always be multiple of 16
 }
 
+// HMAC, resuming from the pre-computed pad states
+static void calcMAC(const CipherContext& ctx, uint8_t* mac, const uint8_t* data, int data_len) {
+  uint8_t inner_hash[HMAC_HASH_SIZE];
+  SHA256 sha = ctx.hmac_inner;
+  sha.update(data, data_len);
+  sha.finalize(inner_hash, sizeof(inner_hash));
+
+  sha = ctx.hmac_outer;
+  sha.update(inner_hash, sizeof(inner_hash));
+  sha.finalize(mac, CIPHER_MAC_SIZE);
+}
+
+int Utils::decrypt(const uint8_t* shared_secret, uint8_t* dest, const uint8_t* src, int src_len) {
+  AES128 aes;
+  aes.setKey(shared_secret, CIPHER_KEY_SIZE);
+  return decryptBlocks(aes, dest, src, src_len);
+}
+
+int Utils::encrypt(const uint8_t* shared_secret, uint8_t* dest, const uint8_t* src, int src_len) {
+  AES128 aes;
+  aes.setKey(shared_secret, CIPHER_KEY_SIZE);
+  return encryptBlocks(aes, dest, src, src_len);
+}
+
 int Utils::encryptThenMAC(const uint8_t* shared_secret, uint8_t* dest, const uint8_t* src, int src_len) {
   int enc_len = encrypt(shared_secret, dest + CIPHER_MAC_SIZE, src, src_len);
 
@@ -87,6 +126,31 @@ int Utils::MACThenDecrypt(const uint8_t* shared_secret, uint8_t* dest, const uin
   return 0; // invalid HMAC
 }
 
+int Utils::decrypt(CipherContext& ctx, uint8_t* dest, const uint8_t* src, int src_len) {
+  return decryptBlocks(ctx.aes, dest, src, src_len);
+}
+
+int Utils::encrypt(CipherContext& ctx, uint8_t* dest, const uint8_t* src, int src_len) {
+  return encryptBlocks(ctx.aes, dest, src, src_len);
+}
+
+int Utils::encryptThenMAC(CipherContext& ctx, uint8_t* dest, const uint8_t* src, int src_len) {
+  int enc_len = encryptBlocks(ctx.aes, dest + CIPHER_MAC_SIZE, src, src_len);
+  calcMAC(ctx, dest, dest + CIPHER_MAC_SIZE, enc_len);
+  return CIPHER_MAC_SIZE + enc_len;
+}
+
+int Utils::MACThenDecrypt(CipherContext& ctx, uint8_t* dest, const uint8_t* src, int src_len) {
+  if (src_len <= CIPHER_MAC_SIZE) return 0;  // invalid src bytes
+
+  uint8_t hmac[CIPHER_MAC_SIZE];
+  calcMAC(ctx, hmac, src + CIPHER_MAC_SIZE, src_len - CIPHER_MAC_SIZE);
+  if (memcmp(hmac, src, CIPHER_MAC_SIZE) == 0) {
+    return decryptBlocks(ctx.aes, dest, src + CIPHER_MAC_SIZE, src_len - CIPHER_MAC_SIZE);
+  }
+  return 0; // invalid HMAC
+}
+
 static const char hex_chars[] = "0123456789ABCDEF";
 
 void Utils::toHex(char* dest, const uint8_t* src, size_t len) {
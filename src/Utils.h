@@ -6,6 +6,8 @@
 
 namespace mesh {
 
+class CipherContext;
+
 class RNG {
 public:
   virtual void random(uint8_t* dest, size_t sz) = 0;
@@ -54,6 +56,14 @@ public:
   */
   static int MACThenDecrypt(const uint8_t* shared_secret, uint8_t* dest, const uint8_t* src, int src_len);
 
+  /**
+   * \brief  same as the above, but using a CipherContext pre-computed for the shared secret.
+  */
+  static int encrypt(CipherContext& ctx, uint8_t* dest, const uint8_t* src, int src_len);
+  static int decrypt(CipherContext& ctx, uint8_t* dest, const uint8_t* src, int src_len);
+  static int encryptThenMAC(CipherContext& ctx, uint8_t* dest, const uint8_t* src, int src_len);
+  static int MACThenDecrypt(CipherContext& ctx, uint8_t* dest, const uint8_t* src, int src_len);
+
   /**
    * \brief  converts 'src' bytes with given length to Hex representation, and null terminates.
   */
@@ -1,4 +1,6 @@
 #include <helpers/BaseChatMesh.h>
+#include <helpers/PeerCandidates.h>
+#include <helpers/PostBatch.h>
 #include <Utils.h>
 
 #ifndef SERVER_RESPONSE_DELAY
@@ -67,11 +69,17 @@ void BaseChatMesh::bootstrapRTCfromContacts() {
   }
 }
 
+static uint32_t lastActive(const ContactInfo& c) {
+  return c.last_rx > c.lastmod ? c.last_rx : c.lastmod;
+}
+
 ContactInfo* BaseChatMesh::allocateContactSlot(bool transient_only) {
   if (num_contacts < MAX_CONTACTS) {
     return &contacts[num_contacts++];
-  } else if (transient_only || shouldOverwriteWhenFull()) {
-    // Find oldest non-favourite contact by oldest lastmod timestamp
+  }
+  bool spill = !transient_only && _cold_store != NULL;
+  if (transient_only || spill || shouldOverwriteWhenFull()) {
+    // Find oldest non-favourite contact by oldest lastmod timestamp (or last active, if moving to cold store)
     int oldest_idx = -1;
     uint32_t oldest_lastmod = 0xFFFFFFFF;
     for (int i = 0; i < num_contacts; i++) {
@@ -82,20 +90,110 @@ ContactInfo* BaseChatMesh::allocateContactSlot(bool transient_only) {
         }
       } else {
         bool is_favourite = (contacts[i].flags & 0x01) != 0;
-        if (!is_favourite && contacts[i].lastmod < oldest_lastmod && contacts[i].type != ADV_TYPE_NONE) {
-          oldest_lastmod = contacts[i].lastmod;
+        uint32_t lastmod = spill ? lastActive(contacts[i]) : contacts[i].lastmod;
+        if (!is_favourite && lastmod < oldest_lastmod && contacts[i].type != ADV_TYPE_NONE) {
+          oldest_lastmod = lastmod;
           oldest_idx = i;
         }
       }
     }
     if (oldest_idx >= 0) {
-      onContactOverwrite(contacts[oldest_idx].id.pub_key);
+      if (spill) contacts[oldest_idx].getSharedSecret(self_id);   // so it's kept in the cold record, see getPeerSharedSecret()
+      if (spill && _cold_store->store(contacts[oldest_idx])) {
+        MESH_DEBUG_PRINTLN("allocateContactSlot: moved contact to cold store: %s", contacts[oldest_idx].name);
+      } else if (transient_only || shouldOverwriteWhenFull()) {
+        onContactOverwrite(contacts[oldest_idx].id.pub_key);
+        if (_change_log) _change_log->onDeleted(contacts[oldest_idx]);   // (a spilled contact is still a contact)
+      } else {
+        return NULL;  // cold store is full (or write failed)
+      }
+      contact_index.remove(oldest_idx);
       return &contacts[oldest_idx];
     }
   }
   return NULL; // no space, no overwrite or all contacts are all favourites
 }
 
+void BaseChatMesh::setColdStore(ContactColdStore* store) {
+  _cold_store = store;
+  _cold_peer_rec = -1;
+  for (int i = 0; i < num_contacts; i++) {   // remove any left in cold store, if contacts[] was saved after moving them
+    int rec = store->findByPubKey(contacts[i].id.pub_key, PUB_KEY_SIZE);
+    if (rec >= 0) store->remove(rec);
+  }
+}
+
+void BaseChatMesh::setChangeLog(ContactChangeLog* log) {
+  _change_log = log;
+  uint32_t epoch;
+  getRNG()->random((uint8_t *) &epoch, sizeof(epoch));
+  log->reset(epoch);
+  for (int i = 0; i < num_contacts; i++) {
+    log->onChanged(contacts[i]);
+  }
+}
+
+void BaseChatMesh::resetContacts() {
+  num_contacts = 0;
+  contact_index.clear();
+  if (_change_log) _change_log->reset(_change_log->getEpoch() + 1);   // client apps need a full sync
+}
+
+ContactInfo* BaseChatMesh::pageInContact(int rec) {
+  ContactInfo c;
+  if (rec == _cold_peer_rec) {
+    c = _cold_peer;   // already loaded (and shared secret calculated) by getPeerSharedSecret() or onAdvertRecv()
+  } else if (!_cold_store->load(rec, c)) {
+    return NULL;
+  }
+  _cold_peer_rec = -1;
+
+  ContactInfo* dest = allocateContactSlot();
+  if (dest == NULL) return NULL;
+
+  *dest = c;
+  contact_index.add(dest - contacts);
+  // cold record is left in place until contacts[] is saved (or setColdStore() removes it at next boot)
+  if (_num_paged_in < MAX_PAGED_IN_RECS) _paged_in_recs[_num_paged_in++] = rec;
+  markContactChanged(*dest);
+  onContactPagedIn(*dest);
+  return dest;
+}
+
+void BaseChatMesh::onContactsSaved() {
+  for (int j = 0; j < _num_paged_in; j++) {
+    ContactInfo c;
+    // only if still in contacts[] (if spilled again since, the record was re-used for it)
+    if (_cold_store->load(_paged_in_recs[j], c) && contact_index.find(c.id.pub_key, PUB_KEY_SIZE) >= 0) {
+      _cold_store->remove(_paged_in_recs[j]);
+    }
+  }
+  _num_paged_in = 0;
+  _cold_peer_rec = -1;
+}
+
+void BaseChatMesh::removePagedInRecord(const uint8_t* pub_key) {
+  for (int j = 0; j < _num_paged_in; j++) {
+    ContactInfo c;
+    if (_cold_store->load(_paged_in_recs[j], c) && memcmp(c.id.pub_key, pub_key, PUB_KEY_SIZE) == 0) {
+      _cold_store->remove(_paged_in_recs[j]);
+      _paged_in_recs[j] = _paged_in_recs[--_num_paged_in];
+      _cold_peer_rec = -1;
+      return;
+    }
+  }
+}
+
+ContactInfo* BaseChatMesh::getMatchingPeer(int peer_idx) {
+  int i = matching_peer_indexes[peer_idx];
+  if (i < 0 && _cold_store) {
+    ContactInfo* c = pageInContact(coldPeerIndex(i));
+    if (c) matching_peer_indexes[peer_idx] = c - contacts;
+    return c;
+  }
+  return (i >= 0 && i < num_contacts) ? &contacts[i] : NULL;
+}
+
 void BaseChatMesh::populateContactFromAdvert(ContactInfo& ci, const mesh::Identity& id, const AdvertDataParser& parser, uint32_t timestamp) {
   memset(&ci, 0, sizeof(ci));
   ci.id = id;
@@ -118,14 +216,24 @@ void BaseChatMesh::onAdvertRecv(mesh::Packet* packet, const mesh::Identity& id,
   }
 
   ContactInfo* from = NULL;
-  for (int i = 0; i < num_contacts; i++) {
-    if (id.matches(contacts[i].id)) {  // is from one of our contacts
-      from = &contacts[i];
-      if (timestamp <= from->last_advert_timestamp) {  // check for replay attacks!!
-        MESH_DEBUG_PRINTLN("onAdvertRecv: Possible replay attack, name: %s", from->name);
+  int i = contact_index.find(id.pub_key, PUB_KEY_SIZE);
+  if (i < 0 && _cold_store) {
+    int rec = _cold_store->findByPubKey(id.pub_key, PUB_KEY_SIZE);
+    if (rec >= 0 && _cold_store->load(rec, _cold_peer)) {
+      _cold_peer_rec = rec;
+      if (timestamp <= _cold_peer.last_advert_timestamp) {  // check for replay attacks, before paging in (and evicting another)
+        MESH_DEBUG_PRINTLN("onAdvertRecv: Possible replay attack, name: %s", _cold_peer.name);
         return;
       }
-      break;
+      ContactInfo* c = pageInContact(rec);
+      if (c) i = c - contacts;
+    }
+  }
+  if (i >= 0) {  // is from one of our contacts
+    from = &contacts[i];
+    if (timestamp <= from->last_advert_timestamp) {  // check for replay attacks!!
+      MESH_DEBUG_PRINTLN("onAdvertRecv: Possible replay attack, name: %s", from->name);
+      return;
     }
   }
 
@@ -170,6 +278,7 @@ void BaseChatMesh::onAdvertRecv(mesh::Packet* packet, const mesh::Identity& id,
     populateContactFromAdvert(*from, id, parser, timestamp);
     from->sync_since = 0;
     from->shared_secret_valid = false;
+    contact_index.add(from - contacts);
   }
 
   // update
@@ -182,37 +291,64 @@ void BaseChatMesh::onAdvertRecv(mesh::Packet* packet, const mesh::Identity& id,
   }
   from->last_advert_timestamp = timestamp;
   from->lastmod = getRTCClock()->getCurrentTime();
+  markContactChanged(*from);
 
   onDiscoveredContact(*from, is_new, packet->path_len, packet->path);       // let UI know
 }
 
 int BaseChatMesh::searchPeersByHash(const uint8_t* hash) {
-  int n = 0;
-  for (int i = 0; i < num_contacts && n < MAX_SEARCH_RESULTS; i++) {
+  PeerCandidates found(matching_peer_indexes, MAX_SEARCH_RESULTS);
+  const uint16_t* slots;
+  int n = contact_index.findByHash(hash[0], slots);
+  for (int j = 0; j < n; j++) {
+    int i = slots[j];
     if (contacts[i].id.isHashMatch(hash)) {
-      matching_peer_indexes[n++] = i;  // store the INDEXES of matching contacts (for subsequent 'peer' methods)
+      found.add(i, contacts[i].last_rx);  // store the INDEXES of matching contacts (for subsequent 'peer' methods)
     }
   }
-  return n;
+  int count = found.count();
+  if (_cold_store && count < MAX_SEARCH_RESULTS) {   // then any in cold store. Mesh stops at first MAC match, so these are only read if none of contacts[] match
+    uint16_t recs[MAX_SEARCH_RESULTS];
+    int num = _cold_store->findByHash(hash[0], recs, MAX_SEARCH_RESULTS);
+    for (int j = 0; j < num && count < MAX_SEARCH_RESULTS; j++) {
+      int k = 0;
+      while (k < _num_paged_in && _paged_in_recs[k] != recs[j]) k++;
+      if (k < _num_paged_in) continue;   // paged in, but record not removed yet (ie. already in contacts[])
+
+      matching_peer_indexes[count++] = coldPeerIndex(recs[j]);
+    }
+  }
+  return count;
 }
 
 void BaseChatMesh::getPeerSharedSecret(uint8_t* dest_secret, int peer_idx) {
   int i = matching_peer_indexes[peer_idx];
   if (i >= 0 && i < num_contacts) {
     memcpy(dest_secret, contacts[i].getSharedSecret(self_id), PUB_KEY_SIZE);
+  } else if (i < 0 && _cold_store) {
+    // only paged in to contacts[] if the MAC matches, see getMatchingPeer()
+    if (_cold_peer_rec != coldPeerIndex(i)) {
+      _cold_peer_rec = _cold_store->load(coldPeerIndex(i), _cold_peer) ? coldPeerIndex(i) : -1;
+    }
+    if (_cold_peer_rec >= 0) {
+      memcpy(dest_secret, _cold_peer.getSharedSecret(self_id), PUB_KEY_SIZE);   // normally kept in cold record, so no key exchange
+    } else {
+      MESH_DEBUG_PRINTLN("getPeerSharedSecret: unable to load cold contact: %d", coldPeerIndex(i));
+    }
   } else {
     MESH_DEBUG_PRINTLN("getPeerSharedSecret: Invalid peer idx: %d", i);
   }
 }
 
 void BaseChatMesh::onPeerDataRecv(mesh::Packet* packet, uint8_t type, int sender_idx, const uint8_t* secret, uint8_t* data, size_t len) {
-  int i = matching_peer_indexes[sender_idx];
-  if (i < 0 || i >= num_contacts) {
-    MESH_DEBUG_PRINTLN("onPeerDataRecv: Invalid sender idx: %d", i);
+  ContactInfo* sender = getMatchingPeer(sender_idx);
+  if (sender == NULL) {
+    MESH_DEBUG_PRINTLN("onPeerDataRecv: Invalid sender idx: %d", matching_peer_indexes[sender_idx]);
     return;
   }
 
-  ContactInfo& from = contacts[i];
+  ContactInfo& from = *sender;
+  from.last_rx = getRTCClock()->getCurrentTime();
 
   if (type == PAYLOAD_TYPE_TXT_MSG && len > 5) {
     uint32_t timestamp;
@@ -224,6 +360,7 @@ void BaseChatMesh::onPeerDataRecv(mesh::Packet* packet, uint8_t type, int sender
 
     if (flags == TXT_TYPE_PLAIN) {
       from.lastmod = getRTCClock()->getCurrentTime(); // update last heard time
+      markContactChanged(from);
       onMessageRecv(from, packet, timestamp, (const char *) &data[5]);  // let UI know
 
       int text_len = strlen((char *)&data[5]);
@@ -255,6 +392,7 @@ void BaseChatMesh::onPeerDataRecv(mesh::Packet* packet, uint8_t type, int sender
         from.sync_since = timestamp;
       }
       from.lastmod = getRTCClock()->getCurrentTime(); // update last heard time
+      markContactChanged(from);
       onSignedMessageRecv(from, packet, timestamp, &data[5], (const char *) &data[9]);  // let UI know
 
       uint32_t ack_hash;    // calc truncated hash of the message timestamp + text + OUR pub_key, to prove to sender that we got it
@@ -268,6 +406,30 @@ void BaseChatMesh::onPeerDataRecv(mesh::Packet* packet, uint8_t type, int sender
       } else {
         sendAckTo(from, (uint8_t *) &ack_hash);
       }
+    } else if (flags == TXT_TYPE_SIGNED_BATCH) {
+      PostBatchReader batch(data, len);
+      uint32_t post_timestamp;
+      const uint8_t* author_prefix;
+      char text[256];
+      while (batch.next(post_timestamp, author_prefix, text)) {
+        if (post_timestamp > from.sync_since) {  // make sure 'sync_since' is up-to-date
+          from.sync_since = post_timestamp;
+        }
+        onSignedMessageRecv(from, packet, post_timestamp, author_prefix, text);  // let UI know
+      }
+      from.lastmod = getRTCClock()->getCurrentTime(); // update last heard time
+      markContactChanged(from);
+
+      uint32_t ack_hash;    // as for SIGNED_PLAIN, but over the whole batch
+      mesh::Utils::sha256((uint8_t *) &ack_hash, 4, data, batch.getEnd(), self_id.pub_key, PUB_KEY_SIZE);
+
+      if (packet->isRouteFlood()) {
+        mesh::Packet* path = createPathReturn(from.id, secret, packet->path, packet->path_len,
+                                                PAYLOAD_TYPE_ACK, (uint8_t *) &ack_hash, 4);
+        if (path) sendFloodScoped(from, path, TXT_ACK_DELAY);
+      } else {
+        sendAckTo(from, (uint8_t *) &ack_hash);
+      }
     } else {
       MESH_DEBUG_PRINTLN("onPeerDataRecv: unsupported message type: %u", (uint32_t) flags);
     }
@@ -302,13 +464,14 @@ void BaseChatMesh::onPeerDataRecv(mesh::Packet* packet, uint8_t type, int sender
 }
 
 bool BaseChatMesh::onPeerPathRecv(mesh::Packet* packet, int sender_idx, const uint8_t* secret, uint8_t* path, uint8_t path_len, uint8_t extra_type, uint8_t* extra, uint8_t extra_len) {
-  int i = matching_peer_indexes[sender_idx];
-  if (i < 0 || i >= num_contacts) {
-    MESH_DEBUG_PRINTLN("onPeerPathRecv: Invalid sender idx: %d", i);
+  ContactInfo* sender = getMatchingPeer(sender_idx);
+  if (sender == NULL) {
+    MESH_DEBUG_PRINTLN("onPeerPathRecv: Invalid sender idx: %d", matching_peer_indexes[sender_idx]);
     return false;
   }
 
-  ContactInfo& from = contacts[i];
+  ContactInfo& from = *sender;
+  from.last_rx = getRTCClock()->getCurrentTime();
 
   return onContactPathRecv(from, packet->path, packet->path_len, path, path_len, extra_type, extra, extra_len);
 }
@@ -318,6 +481,7 @@ bool BaseChatMesh::onContactPathRecv(ContactInfo& from, uint8_t* in_path, uint8_
   // FUTURE: could store multiple out_paths per contact, and try to find which is the 'best'(?)
   from.out_path_len = mesh::Packet::copyPath(from.out_path, out_path, out_path_len);  // store a copy of path, for sendDirect()
   from.lastmod = getRTCClock()->getCurrentTime();
+  markContactChanged(from);
 
   onContactPathUpdated(from);
 
@@ -561,14 +725,16 @@ int BaseChatMesh::sendLogin(const ContactInfo& recipient, const char* password,
   mesh::Packet* pkt;
   {
     int tlen;
-    uint8_t temp[24];
+    uint8_t temp[26];
     uint32_t now = getRTCClock()->getCurrentTimeUnique();
     memcpy(temp, &now, 4);   // mostly an extra blob to help make packet_hash unique
     if (recipient.type == ADV_TYPE_ROOM) {
       memcpy(&temp[4], &recipient.sync_since, 4);
       int len = strlen(password); if (len > 15) len = 15;  // max 15 chars currently
       memcpy(&temp[8], password, len);
-      tlen = 8 + len;
+      temp[8 + len] = 0;   // (older servers stop at null terminator)
+      temp[9 + len] = LOGIN_FEATURE_POST_BATCH;
+      tlen = 10 + len;
     } else {
       int len = strlen(password); if (len > 15) len = 15;  // max 15 chars currently
       memcpy(&temp[4], password, len);
@@ -790,24 +956,11 @@ void BaseChatMesh::checkConnections() {
 
 void BaseChatMesh::resetPathTo(ContactInfo& recipient) {
   recipient.out_path_len = OUT_PATH_UNKNOWN;
-}
-
-static ContactInfo* table;  // pass via global :-(
-
-static int cmp_adv_timestamp(const void *a, const void *b) {
-  int a_idx = *((int *)a);
-  int b_idx = *((int *)b);
-  if (table[b_idx].last_advert_timestamp > table[a_idx].last_advert_timestamp) return 1;
-  if (table[b_idx].last_advert_timestamp < table[a_idx].last_advert_timestamp) return -1;
-  return 0;
+  markContactChanged(recipient);
 }
 
 void BaseChatMesh::scanRecentContacts(int last_n, ContactVisitor* visitor) {
-  for (int i = 0; i < num_contacts; i++) {  // sort the INDEXES into contacts[]
-    sort_array[i] = i;
-  }
-  table = contacts; // pass via global *sigh* :-(
-  qsort(sort_array, num_contacts, sizeof(sort_array[0]), cmp_adv_timestamp);
+  const uint16_t* sort_array = contact_index.sortByRecent();  // the INDEXES into contacts[]
 
   if (last_n == 0) {
     last_n = num_contacts;   // scan ALL
@@ -829,9 +982,12 @@ ContactInfo* BaseChatMesh::searchContactsByPrefix(const char* name_prefix) {
 }
 
 ContactInfo* BaseChatMesh::lookupContactByPubKey(const uint8_t* pub_key, int prefix_len) {
-  for (int i = 0; i < num_contacts; i++) {
-    auto c = &contacts[i];
-    if (memcmp(c->id.pub_key, pub_key, prefix_len) == 0) return c;
+  int i = contact_index.find(pub_key, prefix_len);
+  if (i >= 0) return &contacts[i];
+
+  if (_cold_store) {
+    int rec = _cold_store->findByPubKey(pub_key, prefix_len);
+    if (rec >= 0) return pageInContact(rec);
   }
   return NULL;  // not found
 }
@@ -841,19 +997,23 @@ bool BaseChatMesh::addContact(const ContactInfo& contact) {
   if (dest) {
     *dest = contact;
     dest->shared_secret_valid = false; // mark shared_secret as needing calculation
+    dest->last_rx = 0;
+    contact_index.add(dest - contacts);
+    markContactChanged(*dest);
     return true;  // success
   }
   return false;
 }
 
 bool BaseChatMesh::removeContact(ContactInfo& contact) {
-  int idx = 0;
-  while (idx < num_contacts && !contacts[idx].id.matches(contact.id)) {
-    idx++;
-  }
-  if (idx >= num_contacts) return false;   // not found
+  int idx = contact_index.find(contact.id.pub_key, PUB_KEY_SIZE);
+  if (idx < 0) return false;   // not found
+
+  if (_cold_store) removePagedInRecord(contact.id.pub_key);   // so it doesn't come back from cold store
 
   // remove from contacts array
+  if (_change_log) _change_log->onDeleted(contacts[idx]);
+  contact_index.remove(idx, true);
   num_contacts--;
   while (idx < num_contacts) {
     contacts[idx] = contacts[idx + 1];
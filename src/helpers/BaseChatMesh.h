@@ -8,6 +8,9 @@
 #define MAX_TEXT_LEN    (10*CIPHER_BLOCK_SIZE)  // must be LESS than (MAX_PACKET_PAYLOAD - 4 - CIPHER_MAC_SIZE - 1)
 
 #include "ContactInfo.h"
+#include "ContactIndex.h"
+#include "ContactColdStore.h"
+#include "ContactChangeLog.h"
 
 #define MAX_SEARCH_RESULTS   8
 
@@ -39,6 +42,8 @@ public:
 
 #define MAX_ANON_CONTACTS  8
 
+#define MAX_PAGED_IN_RECS  8   // cold records of paged-in contacts, kept until contacts[] is next saved
+
 #ifndef MAX_CONNECTIONS
   #define MAX_CONNECTIONS  16
 #endif
@@ -62,8 +67,14 @@ class BaseChatMesh : public mesh::Mesh {
 
   ContactInfo contacts[MAX_CONTACTS+MAX_ANON_CONTACTS];
   int num_contacts;
-  int sort_array[MAX_CONTACTS+MAX_ANON_CONTACTS];
-  int matching_peer_indexes[MAX_SEARCH_RESULTS];
+  ContactIndex contact_index;
+  int matching_peer_indexes[MAX_SEARCH_RESULTS];   // < 0 for contacts in cold store, see coldPeerIndex()
+  ContactColdStore* _cold_store;
+  ContactChangeLog* _change_log;
+  ContactInfo _cold_peer;   // cold store candidate being tried by Mesh (not paged in yet)
+  int _cold_peer_rec;
+  int _paged_in_recs[MAX_PAGED_IN_RECS];
+  int _num_paged_in;
   unsigned long txt_send_timeout;
 #ifdef MAX_GROUP_CHANNELS
   ChannelDetails channels[MAX_GROUP_CHANNELS];
@@ -73,14 +84,23 @@ class BaseChatMesh : public mesh::Mesh {
   uint8_t temp_buf[MAX_TRANS_UNIT];
   ConnectionInfo connections[MAX_CONNECTIONS];
 
+  static int coldPeerIndex(int rec) { return -1 - rec; }
+  ContactInfo* pageInContact(int rec);
+  void removePagedInRecord(const uint8_t* pub_key);
+  ContactInfo* getMatchingPeer(int peer_idx);
+
   mesh::Packet* composeMsgPacket(const ContactInfo& recipient, uint32_t timestamp, uint8_t attempt, const char *text, uint32_t& expected_ack);
   void sendAckTo(const ContactInfo& dest, const uint8_t* ack_hash, uint8_t ack_len=4);
 
 protected:
   BaseChatMesh(mesh::Radio& radio, mesh::MillisecondClock& ms, mesh::RNG& rng, mesh::RTCClock& rtc, mesh::PacketManager& mgr, mesh::MeshTables& tables)
-      : mesh::Mesh(radio, ms, rng, rtc, mgr, tables)
+      : mesh::Mesh(radio, ms, rng, rtc, mgr, tables), contact_index(contacts, MAX_CONTACTS+MAX_ANON_CONTACTS)
   { 
     num_contacts = 0;
+    _cold_store = NULL;
+    _change_log = NULL;
+    _cold_peer_rec = -1;
+    _num_paged_in = 0;
   #ifdef MAX_GROUP_CHANNELS
     memset(channels, 0, sizeof(channels));
     num_channels = 0;
@@ -91,9 +111,27 @@ protected:
   }
 
   void bootstrapRTCfromContacts();
-  void resetContacts() { num_contacts = 0; }
+  void resetContacts();
   void populateContactFromAdvert(ContactInfo& ci, const mesh::Identity& id, const AdvertDataParser& parser, uint32_t timestamp);
-  ContactInfo* allocateContactSlot(bool transient_only=false); // helper to find slot for new contact
+  /**
+   * \brief  Adds a second tier of contacts, for when contacts[] is full. The least recently active (non-favourite)
+   *     contacts are then moved to 'store' to make room, and paged back in when they are next heard from, or looked up.
+  */
+  void setColdStore(ContactColdStore* store);
+  ContactColdStore* getColdStore() const { return _cold_store; }
+  /**
+   * \brief  sub-classes must call this after saving contacts[], so the cold records of contacts paged in since
+   *     the last save can be removed. (Until then they're kept, in case of a reboot before the save)
+  */
+  void onContactsSaved();
+  /**
+   * \brief  Versions all changes to contacts[] (including those made by sub-classes, via markContactChanged()),
+   *     so client apps can sync just the changes. Sequence numbers restart with a new (random) epoch.
+  */
+  void setChangeLog(ContactChangeLog* log);
+  ContactChangeLog* getChangeLog() const { return _change_log; }
+  void markContactChanged(ContactInfo& contact) { if (_change_log) _change_log->onChanged(contact); }
+  ContactInfo* allocateContactSlot(bool transient_only=false); // helper to find slot for new contact (caller must then fill it, and add to contact_index)
 
   // 'UI' concepts, for sub-classes to implement
   virtual bool isAutoAddEnabled() const { return true; }
@@ -102,6 +140,7 @@ protected:
   virtual bool shouldOverwriteWhenFull() const { return false; }
   virtual uint8_t getAutoAddMaxHops() const { return 0; }  // 0 = no limit, 1 = direct (0 hops), N = up to N-1 hops
   virtual void onContactOverwrite(const uint8_t* pub_key) {};
+  virtual void onContactPagedIn(ContactInfo& contact) { }   // moved from cold store to contacts[]
   virtual void onDiscoveredContact(ContactInfo& contact, bool is_new, uint8_t path_len, const uint8_t* path) = 0;
   virtual ContactInfo* processAck(const uint8_t *data) = 0;
   virtual void onContactPathUpdated(const ContactInfo& contact) = 0;
@@ -15,6 +15,10 @@ public:
 
   virtual bool isConnected() const = 0;
 
+  /**
+   * \brief  backpressure for the app: true if send queue is getting full, so bulk senders (eg. contacts sync)
+   *     should hold off, leaving room for replies and push notifications. writeFrame() drops frames that don't fit.
+  */
   virtual bool isWriteBusy() const = 0;
   virtual size_t writeFrame(const uint8_t src[], size_t len) = 0;
   virtual size_t checkRecvFrame(uint8_t dest[]) = 0;
@@ -0,0 +1,223 @@
+#include "BlobStore.h"
+
+#define NONE  0xFFFF
+
+static File openFile(FILESYSTEM* fs, const char* path, char mode) {   // mode: 'r', 'u' (update in place) or 'a'
+#if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+  return fs->open(path, mode == 'r' ? FILE_O_READ : FILE_O_WRITE);   // positioned at end, if FILE_O_WRITE
+#elif defined(RP2040_PLATFORM)
+  return fs->open(path, mode == 'r' ? "r" : mode == 'u' ? "r+" : "a");
+#else
+  return fs->open(path, mode == 'r' ? "r" : mode == 'u' ? "r+" : "a", mode == 'a');
+#endif
+}
+
+BlobStore::BlobStore(const char* path, int max_blobs, int max_len) {
+  _fs = NULL;
+  _path = path;
+  _max_blobs = max_blobs;
+  _max_len = max_len;
+  _rec_size = (BLOB_STORE_HEADER_SIZE + max_len + 3) & ~3;   // padded, as per original struct BlobRec
+  _num_blobs = 0;
+
+  int num_buckets = 1;
+  while (num_buckets < max_blobs) num_buckets <<= 1;
+  _bucket_mask = num_buckets - 1;
+
+  _keys = new uint8_t[max_blobs][BLOB_STORE_KEY_SIZE];
+  _lens = new uint8_t[max_blobs];
+  _chain = new uint16_t[max_blobs];
+  _buckets = new uint16_t[num_buckets];
+  _newer = new uint16_t[max_blobs];
+  _older = new uint16_t[max_blobs];
+  _newest = _oldest = NONE;
+}
+
+int BlobStore::findSlot(const uint8_t key[]) const {
+  for (uint16_t slot = _buckets[bucketOf(key)]; slot != NONE; slot = _chain[slot]) {
+    if (memcmp(_keys[slot], key, BLOB_STORE_KEY_SIZE) == 0) return slot;
+  }
+  return -1;  // not found
+}
+
+void BlobStore::addToBucket(int slot) {
+  int b = bucketOf(_keys[slot]);
+  _chain[slot] = _buckets[b];
+  _buckets[b] = slot;
+}
+
+void BlobStore::removeFromBucket(int slot) {
+  uint16_t* p = &_buckets[bucketOf(_keys[slot])];
+  while (*p != NONE && *p != slot) p = &_chain[*p];
+  if (*p == slot) *p = _chain[slot];
+}
+
+void BlobStore::unlink(int slot) {
+  if (_newer[slot] != NONE) _older[_newer[slot]] = _older[slot]; else _newest = _older[slot];
+  if (_older[slot] != NONE) _newer[_older[slot]] = _newer[slot]; else _oldest = _newer[slot];
+}
+
+void BlobStore::linkNewest(int slot) {
+  _newer[slot] = NONE;
+  _older[slot] = _newest;
+  if (_newest != NONE) _newer[_newest] = slot; else _oldest = slot;
+  _newest = slot;
+}
+
+void BlobStore::linkOldest(int slot) {
+  _older[slot] = NONE;
+  _newer[slot] = _oldest;
+  if (_oldest != NONE) _older[_oldest] = slot; else _newest = slot;
+  _oldest = slot;
+}
+
+bool BlobStore::begin(FILESYSTEM* fs) {
+  _fs = fs;
+  _num_blobs = 0;
+  _newest = _oldest = NONE;
+  memset(_buckets, 0xFF, (_bucket_mask + 1) * sizeof(uint16_t));
+
+  int num_slots = 0;
+  File file = openFile(_fs, _path, 'r');
+  if (file) {
+    uint32_t size = file.size();
+    file.close();
+    if (size % _rec_size != 0) {
+      MESH_DEBUG_PRINTLN("BlobStore: %s has bad size, re-creating", _path);
+      _fs->remove(_path);
+    } else {
+      num_slots = size / _rec_size;
+    }
+  }
+  if (num_slots < _max_blobs) {   // pre-allocate to fixed size
+    file = openFile(_fs, _path, 'a');
+    if (!file) return false;
+
+    uint8_t zeroes[32];
+    memset(zeroes, 0, sizeof(zeroes));
+    for (uint32_t n = (uint32_t)(_max_blobs - num_slots) * _rec_size; n > 0; ) {
+      int len = n < sizeof(zeroes) ? n : sizeof(zeroes);
+      if (file.write(zeroes, len) != (size_t)len) break;
+      n -= len;
+    }
+    file.close();
+  }
+
+  // read slot headers, and sort used slots by timestamp
+  uint32_t* timestamps = new uint32_t[_max_blobs];
+  uint16_t* order = new uint16_t[_max_blobs];
+  int num_used = 0;
+  file = openFile(_fs, _path, 'r');
+  for (int slot = 0; slot < _max_blobs; slot++) {
+    uint8_t hdr[BLOB_STORE_HEADER_SIZE];
+    _lens[slot] = 0;
+    if (file && slot < num_slots && file.seek(slot * _rec_size) && file.read(hdr, sizeof(hdr)) == sizeof(hdr)) {
+      if (hdr[BLOB_STORE_HEADER_SIZE - 1] > 0 && hdr[BLOB_STORE_HEADER_SIZE - 1] <= _max_len) {
+        memcpy(&timestamps[slot], hdr, 4);
+        memcpy(_keys[slot], &hdr[4], BLOB_STORE_KEY_SIZE);
+        _lens[slot] = hdr[BLOB_STORE_HEADER_SIZE - 1];
+
+        int i = num_used++;
+        while (i > 0 && timestamps[order[i - 1]] > timestamps[slot]) {
+          order[i] = order[i - 1];
+          i--;
+        }
+        order[i] = slot;
+      }
+    }
+    if (_lens[slot] == 0) linkOldest(slot);   // free slots
+  }
+  if (file) file.close();
+
+  for (int i = 0; i < num_used; i++) {   // oldest first
+    int slot = order[i];
+    int dup = findSlot(_keys[slot]);
+    if (dup >= 0) {   // shouldn't happen, but keep the newer one
+      removeFromBucket(dup);
+      _lens[dup] = 0;
+      unlink(dup);
+      linkOldest(dup);
+      _num_blobs--;
+    }
+    addToBucket(slot);
+    linkNewest(slot);
+    _num_blobs++;
+  }
+  delete[] order;
+  delete[] timestamps;
+  return true;
+}
+
+bool BlobStore::writeSlot(int slot, const uint8_t* rec, int len) {
+  File file = openFile(_fs, _path, 'u');
+  if (!file) return false;
+
+  bool success = file.seek(slot * _rec_size) && file.write(rec, len) == (size_t)len;
+  file.close();
+  return success;
+}
+
+uint8_t BlobStore::get(const uint8_t key[], uint8_t dest[]) {
+  int slot = findSlot(key);
+  if (slot < 0) return 0;   // not found
+
+  File file = openFile(_fs, _path, 'r');
+  if (!file) return 0;
+
+  uint8_t len = _lens[slot];
+  if (!file.seek(slot * _rec_size + BLOB_STORE_HEADER_SIZE) || file.read(dest, len) != len) len = 0;
+  file.close();
+
+  if (len > 0) {   // now the most recently used
+    unlink(slot);
+    linkNewest(slot);
+  }
+  return len;
+}
+
+bool BlobStore::put(const uint8_t key[], const uint8_t src[], uint8_t len, uint32_t timestamp) {
+  if (len == 0 || len > _max_len || _oldest == NONE) return false;
+
+  int slot = findSlot(key);
+  if (slot < 0) {
+    slot = _oldest;   // free slot, or least recently used
+  }
+  if (_lens[slot] > 0) {
+    removeFromBucket(slot);
+    _lens[slot] = 0;
+    _num_blobs--;
+  }
+  unlink(slot);
+
+  uint8_t rec[BLOB_STORE_HEADER_SIZE + 255];
+  memcpy(rec, &timestamp, 4);
+  memcpy(&rec[4], key, BLOB_STORE_KEY_SIZE);
+  rec[BLOB_STORE_HEADER_SIZE - 1] = len;
+  memcpy(&rec[BLOB_STORE_HEADER_SIZE], src, len);
+  if (!writeSlot(slot, rec, BLOB_STORE_HEADER_SIZE + len)) {
+    linkOldest(slot);   // contents unknown now, so treat as free
+    return false;
+  }
+
+  memcpy(_keys[slot], key, BLOB_STORE_KEY_SIZE);
+  _lens[slot] = len;
+  addToBucket(slot);
+  linkNewest(slot);
+  _num_blobs++;
+  return true;
+}
+
+bool BlobStore::remove(const uint8_t key[]) {
+  int slot = findSlot(key);
+  if (slot < 0) return true;   // not found, same result
+
+  removeFromBucket(slot);
+  _lens[slot] = 0;
+  _num_blobs--;
+  unlink(slot);
+  linkOldest(slot);
+
+  uint8_t hdr[BLOB_STORE_HEADER_SIZE];
+  memset(hdr, 0, sizeof(hdr));
+  return writeSlot(slot, hdr, sizeof(hdr));
+}
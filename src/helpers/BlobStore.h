@@ -0,0 +1,60 @@
+#pragma once
+
+#include <helpers/IdentityStore.h>   // for FILESYSTEM
+
+#define BLOB_STORE_KEY_SIZE     7    // blobs are matched by this key prefix
+#define BLOB_STORE_HEADER_SIZE  (4 + BLOB_STORE_KEY_SIZE + 1)   // timestamp, key, len
+
+/**
+ * \brief  Key/value store of small blobs (eg. last advert packet per contact), in a single file of fixed size slots.
+ *     Each slot is: timestamp(4), key(7), len(1), data(max_len), padded to a multiple of 4 bytes. This is the same layout as the original NRF52
+ *     "/adv_blobs" file, so existing files load as-is. A zero len marks a free slot.
+ *     The keys are indexed in RAM (loaded at begin()), with a hash table for O(1) lookups, and an LRU list for
+ *     choosing the slot to replace when full. Lookups re-order the LRU list in RAM only (no flash writes), and at boot
+ *     the order is restored from the slot timestamps (ie. time of last put).
+ *     RAM cost is ~16 bytes per slot.
+*/
+class BlobStore {
+  FILESYSTEM* _fs;
+  const char* _path;
+  int _max_blobs, _max_len, _rec_size;
+  int _num_blobs;
+  uint8_t (*_keys)[BLOB_STORE_KEY_SIZE];
+  uint8_t* _lens;       // 0 = free slot
+  uint16_t* _chain;     // next slot in same hash bucket
+  uint16_t* _buckets;   // first slot in each bucket
+  uint16_t _bucket_mask;
+  uint16_t* _newer;     // LRU list, by slot
+  uint16_t* _older;
+  uint16_t _newest, _oldest;
+
+  int bucketOf(const uint8_t key[]) const { return (key[0] | (key[1] << 8)) & _bucket_mask; }
+  int findSlot(const uint8_t key[]) const;
+  void addToBucket(int slot);
+  void removeFromBucket(int slot);
+  void unlink(int slot);
+  void linkNewest(int slot);
+  void linkOldest(int slot);
+  bool writeSlot(int slot, const uint8_t* rec, int len);
+
+public:
+  /**
+   * \param  max_blobs   number of slots in file
+   * \param  max_len   max length of a blob
+  */
+  BlobStore(const char* path, int max_blobs, int max_len);
+
+  /** \brief  creates (or extends) the file to 'max_blobs' slots, and loads the key index */
+  bool begin(FILESYSTEM* fs);
+
+  /** \returns  length of blob copied to 'dest', or 0 if not found */
+  uint8_t get(const uint8_t key[], uint8_t dest[]);
+
+  /** \brief  add blob, or replace the one with same key. If full, the least recently used blob is replaced. */
+  bool put(const uint8_t key[], const uint8_t src[], uint8_t len, uint32_t timestamp);
+
+  bool remove(const uint8_t key[]);
+
+  int getNumBlobs() const { return _num_blobs; }
+  int getMaxBlobs() const { return _max_blobs; }
+};
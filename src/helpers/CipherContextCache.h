@@ -0,0 +1,80 @@
+#pragma once
+
+#include <CipherContext.h>
+#include <string.h>
+
+#ifndef CIPHER_CONTEXT_CACHE_SIZE
+  #if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+    #define CIPHER_CONTEXT_CACHE_SIZE  4
+  #else
+    #define CIPHER_CONTEXT_CACHE_SIZE  8
+  #endif
+#endif
+
+/**
+ * \brief  Small LRU table of pre-computed CipherContexts, keyed on the shared secret, so the busy contacts, channels
+ *     and clients don't need a key expansion (and HMAC pad blocks) on every packet.
+ *     Each entry is a few hundred bytes, hence a small cache rather than one per contact/channel/client.
+*/
+class CipherContextCache {
+  uint8_t _keys[CIPHER_CONTEXT_CACHE_SIZE][PUB_KEY_SIZE];
+  mesh::CipherContext _contexts[CIPHER_CONTEXT_CACHE_SIZE];
+  uint32_t _used[CIPHER_CONTEXT_CACHE_SIZE];    // LRU stamp, 0 = empty slot
+  uint32_t _lru_clock;
+  uint32_t _hits, _misses, _evictions;
+
+public:
+  CipherContextCache() { clear(); resetStats(); }
+
+  void clear() {
+    memset(_keys, 0, sizeof(_keys));
+    memset(_used, 0, sizeof(_used));
+    _lru_clock = 0;
+  }
+
+  /**
+   * \returns  the cached context for given shared secret, or NULL if not cached. Only valid until next call.
+  */
+  mesh::CipherContext* find(const uint8_t* shared_secret) {
+    for (int j = 0; j < CIPHER_CONTEXT_CACHE_SIZE; j++) {
+      if (_used[j] && memcmp(_keys[j], shared_secret, PUB_KEY_SIZE) == 0) {
+        _used[j] = ++_lru_clock;
+        _hits++;
+        return &_contexts[j];
+      }
+    }
+    _misses++;
+    return NULL;
+  }
+
+  /**
+   * \brief  computes the context for given shared secret, in place of the least recently used (or an empty) entry.
+   *     Must not already be cached.
+   * \returns  the new context, only valid until next call.
+  */
+  mesh::CipherContext* put(const uint8_t* shared_secret) {
+    int i = 0;
+    for (int j = 1; j < CIPHER_CONTEXT_CACHE_SIZE; j++) {   // find empty or least recently used slot
+      if (_used[j] < _used[i]) i = j;
+    }
+    if (_used[i]) _evictions++;
+
+    memcpy(_keys[i], shared_secret, PUB_KEY_SIZE);
+    _contexts[i].setKey(shared_secret);
+    _used[i] = ++_lru_clock;
+    return &_contexts[i];
+  }
+
+  /**
+   * \returns  the context for given shared secret, computing it if not cached. Only valid until next call.
+  */
+  mesh::CipherContext* get(const uint8_t* shared_secret) {
+    mesh::CipherContext* ctx = find(shared_secret);
+    return ctx ? ctx : put(shared_secret);
+  }
+
+  uint32_t getNumHits() const { return _hits; }
+  uint32_t getNumMisses() const { return _misses; }
+  uint32_t getNumEvictions() const { return _evictions; }
+  void resetStats() { _hits = _misses = _evictions = 0; }
+};
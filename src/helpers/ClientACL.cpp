@@ -1,4 +1,5 @@
 #include "ClientACL.h"
+#include "PeerCandidates.h"
 
 static File openWrite(FILESYSTEM* _fs, const char* filename) {
   #if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
@@ -11,9 +12,26 @@ static File openWrite(FILESYSTEM* _fs, const char* filename) {
   #endif
 }
 
+static bool writeClient(File& file, const ClientInfo* c) {
+  uint8_t unused[2];
+  memset(unused, 0, sizeof(unused));
+
+  bool success = (file.write(c->id.pub_key, 32) == 32);
+  success = success && (file.write((uint8_t *) &c->permissions, 1) == 1);
+  success = success && (file.write((uint8_t *) &c->extra.room.sync_since, 4) == 4);
+  success = success && (file.write(unused, 2) == 2);
+  success = success && (file.write((uint8_t *)&c->out_path_len, 1) == 1);
+  success = success && (file.write(c->out_path, 64) == 64);
+  success = success && (file.write(c->shared_secret, PUB_KEY_SIZE) == PUB_KEY_SIZE);
+  return success;
+}
+
 void ClientACL::load(FILESYSTEM* fs, const mesh::LocalIdentity& self_id) {
   _fs = fs;
   num_clients = 0;
+  _index.clear();
+  _cold_peer_rec = -1;
+  if (_cold_store) _cold_store->begin(fs);   // any that don't fit in clients[] go back in here
   if (_fs->exists("/s_contacts")) {
   #if defined(RP2040_PLATFORM)
     File file = _fs->open("/s_contacts", "r");
@@ -42,8 +60,10 @@ void ClientACL::load(FILESYSTEM* fs, const mesh::LocalIdentity& self_id) {
         c.id = mesh::Identity(pub_key);
         self_id.calcSharedSecret(c.shared_secret, pub_key);  // recalculate shared secrets in case our private key changed
         if (num_clients < MAX_CLIENTS) {
-          clients[num_clients++] = c;
-        } else {
+          clients[num_clients] = c;
+          clearSlotData(num_clients);
+          _index.add(num_clients++);
+        } else if (_cold_store == NULL || !_cold_store->store(c)) {
           full = true;
         }
       }
@@ -56,22 +76,19 @@ void ClientACL::save(FILESYSTEM* fs, bool (*filter)(ClientInfo*)) {
   _fs = fs;
   File file = openWrite(_fs, "/s_contacts");
   if (file) {
-    uint8_t unused[2];
-    memset(unused, 0, sizeof(unused));
-
-    for (int i = 0; i < num_clients; i++) {
+    bool success = true;
+    for (int i = 0; i < num_clients && success; i++) {
       auto c = &clients[i];
       if (c->permissions == 0 || (filter && !filter(c))) continue;    // skip deleted entries, or by filter function
 
-      bool success = (file.write(c->id.pub_key, 32) == 32);
-      success = success && (file.write((uint8_t *) &c->permissions, 1) == 1);
-      success = success && (file.write((uint8_t *) &c->extra.room.sync_since, 4) == 4);
-      success = success && (file.write(unused, 2) == 2);
-      success = success && (file.write((uint8_t *)&c->out_path_len, 1) == 1);
-      success = success && (file.write(c->out_path, 64) == 64);
-      success = success && (file.write(c->shared_secret, PUB_KEY_SIZE) == PUB_KEY_SIZE);
+      success = writeClient(file, c);
+    }
+    for (int rec = 0; _cold_store && rec < _cold_store->getMaxClients() && success; rec++) {   // then any in cold store
+      ClientInfo c;
+      if (!_cold_store->isUsed(rec) || !_cold_store->load(rec, c)) continue;
+      if (c.permissions == 0 || (filter && !filter(&c))) continue;
 
-      if (!success) break; // write failed
+      success = writeClient(file, &c);
     }
     file.close();
   }
@@ -83,53 +100,107 @@ bool ClientACL::clear() {
     _fs->remove("/s_contacts");
   }
   memset(clients, 0, sizeof(clients));
+  if (_slot_data) memset(_slot_data, 0, MAX_CLIENTS * _slot_data_size);
   num_clients = 0;
+  _index.clear();
+  _cold_peer_rec = -1;
+  if (_cold_store) _cold_store->begin(_fs);
   return true;
 }
 
 ClientInfo* ClientACL::getClient(const uint8_t* pubkey, int key_len) {
-  for (int i = 0; i < num_clients; i++) {
-    if (memcmp(pubkey, clients[i].id.pub_key, key_len) == 0) return &clients[i];  // already known
+  int i = _index.find(pubkey, key_len);
+  if (i >= 0) return &clients[i];  // already known
+
+  if (_cold_store) {
+    int rec = _cold_store->findByPubKey(pubkey, key_len);
+    if (rec >= 0) return pageIn(rec);
   }
   return NULL;  // not found
 }
 
-ClientInfo* ClientACL::putClient(const mesh::Identity& id, uint8_t init_perms) {
+void ClientACL::moveSlot(int from, int to) {
+  clients[to] = clients[from];
+  if (_slot_data) memcpy(&_slot_data[to * _slot_data_size], &_slot_data[from * _slot_data_size], _slot_data_size);
+}
+
+void ClientACL::clearSlotData(int i) {
+  if (_slot_data) memset(&_slot_data[i * _slot_data_size], 0, _slot_data_size);
+}
+
+ClientInfo* ClientACL::allocateSlot() {
+  if (num_clients < MAX_CLIENTS) {
+    clearSlotData(num_clients);
+    return &clients[num_clients++];
+  }
+
   uint32_t min_time = 0xFFFFFFFF;
-  ClientInfo* oldest = &clients[MAX_CLIENTS - 1];
+  int oldest = MAX_CLIENTS - 1;
   for (int i = 0; i < num_clients; i++) {
-    if (id.matches(clients[i].id)) return &clients[i];  // already known
     if (!clients[i].isAdmin() && clients[i].last_activity < min_time) {
-      oldest = &clients[i];
-      min_time = oldest->last_activity;
+      oldest = i;
+      min_time = clients[i].last_activity;
     }
   }
+  if (_cold_store && _cold_store->store(clients[oldest])) {
+    MESH_DEBUG_PRINTLN("ClientACL: moved client %02X to cold store", (uint32_t) clients[oldest].id.pub_key[0]);
+  }   // otherwise, evict least active client
+  _index.remove(oldest);
+  clearSlotData(oldest);
+  return &clients[oldest];
+}
 
-  ClientInfo* c;
-  if (num_clients < MAX_CLIENTS) {
-    c = &clients[num_clients++];
-  } else {
-    c = oldest;  // evict least active contact
+ClientInfo* ClientACL::pageIn(int rec) {
+  ClientInfo c;
+  if (rec == _cold_peer_rec) {
+    c = _cold_peer;   // already loaded by getSharedSecret()
+  } else if (!_cold_store->load(rec, c)) {
+    return NULL;
   }
+  _cold_peer_rec = -1;   // record numbers are about to change
+
+  _cold_store->remove(rec);   // first, so there's room to move another client to cold store
+  ClientInfo* dest = allocateSlot();
+  *dest = c;
+  _index.add(dest - clients);
+  return dest;
+}
+
+ClientInfo* ClientACL::putClient(const mesh::Identity& id, uint8_t init_perms) {
+  ClientInfo* c = getClient(id.pub_key, PUB_KEY_SIZE);
+  if (c) return c;  // already known
+
+  c = allocateSlot();
   memset(c, 0, sizeof(*c));
   c->permissions = init_perms;
   c->id = id;
   c->out_path_len = OUT_PATH_UNKNOWN;
+  _index.add(c - clients);
   return c;
 }
 
+void ClientACL::removeAt(int i) {
+  num_clients--;   // delete from clients[]
+  while (i < num_clients) {
+    moveSlot(i + 1, i);
+    i++;
+  }
+  rebuildIndex();
+}
+
+void ClientACL::rebuildIndex() {
+  _index.clear();   // slots have moved (rare, so just re-build)
+  for (int i = 0; i < num_clients; i++) _index.add(i);
+  _cold_peer_rec = -1;
+}
+
 bool ClientACL::applyPermissions(const mesh::LocalIdentity& self_id, const uint8_t* pubkey, int key_len, uint8_t perms) {
   ClientInfo* c;
   if ((perms & PERM_ACL_ROLE_MASK) == PERM_ACL_GUEST) {  // guest role is not persisted in contacts
     c = getClient(pubkey, key_len);
     if (c == NULL) return false;   // partial pubkey not found
 
-    num_clients--;   // delete from contacts[]
-    int i = c - clients;
-    while (i < num_clients) {
-      clients[i] = clients[i + 1];
-      i++;
-    }
+    removeAt(c - clients);
   } else {
     if (key_len < PUB_KEY_SIZE) return false;   // need complete pubkey when adding/modifying
 
@@ -141,3 +212,81 @@ bool ClientACL::applyPermissions(const mesh::LocalIdentity& self_id, const uint8
   }
   return true;
 }
+
+int ClientACL::searchByHash(const uint8_t* hash, int dest[], int max_num) {
+  if (max_num > MAX_CLIENTS) max_num = MAX_CLIENTS;
+
+  uint32_t last_heard[MAX_CLIENTS];
+  PeerCandidates found(dest, last_heard, max_num);
+  int slots[MAX_CLIENTS];
+  int n = _index.findByHash(hash[0], slots, MAX_CLIENTS);
+  for (int j = 0; j < n; j++) {
+    ClientInfo* client = &clients[slots[j]];
+    if (client->id.isHashMatch(hash)) {
+      found.add(slots[j], client->last_activity);
+    }
+  }
+  int count = found.count();
+  if (_cold_store && count < max_num) {   // then any in cold store, tried after all of clients[]
+    int recs[MAX_CLIENTS];
+    int num = _cold_store->findByHash(hash[0], recs, max_num - count);
+    for (int j = 0; j < num; j++) {
+      dest[count++] = coldIndex(recs[j]);
+    }
+  }
+  return count;
+}
+
+bool ClientACL::getSharedSecret(int idx, uint8_t* dest_secret) {
+  if (idx >= 0 && idx < num_clients) {
+    memcpy(dest_secret, clients[idx].shared_secret, PUB_KEY_SIZE);   // pre-calculated
+    return true;
+  }
+  if (idx < 0 && _cold_store) {
+    int rec = coldIndex(idx);
+    // only paged in to clients[] if the MAC matches, see getMatchingClient()
+    if (_cold_peer_rec != rec) {
+      _cold_peer_rec = _cold_store->load(rec, _cold_peer) ? rec : -1;
+    }
+    if (_cold_peer_rec >= 0) {
+      memcpy(dest_secret, _cold_peer.shared_secret, PUB_KEY_SIZE);
+      return true;
+    }
+  }
+  return false;
+}
+
+ClientInfo* ClientACL::getMatchingClient(int& idx) {
+  if (idx < 0 && _cold_store) {
+    ClientInfo* c = pageIn(coldIndex(idx));
+    if (c) idx = c - clients;
+    return c;
+  }
+  return (idx >= 0 && idx < num_clients) ? &clients[idx] : NULL;
+}
+
+int ClientACL::evictIdle(uint32_t now, uint32_t max_idle_secs) {
+  int n = 0, j = 0;
+  for (int i = 0; i < num_clients; i++) {
+    ClientInfo& c = clients[i];
+    bool evict = false;
+    if (!c.isAdmin() && c.last_activity != 0 && now > c.last_activity + max_idle_secs) {
+      if (_cold_store) {
+        evict = _cold_store->store(c);
+      } else {
+        evict = (c.permissions & PERM_ACL_ROLE_MASK) == PERM_ACL_GUEST;   // nothing that needs remembering
+      }
+    }
+    if (evict) {
+      n++;
+    } else {
+      if (j != i) moveSlot(i, j);
+      j++;
+    }
+  }
+  if (n > 0) {
+    num_clients = j;
+    rebuildIndex();
+  }
+  return n;
+}
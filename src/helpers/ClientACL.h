@@ -3,58 +3,100 @@
 #include <Arduino.h>   // needed for PlatformIO
 #include <Mesh.h>
 #include <helpers/IdentityStore.h>
-
-#define PERM_ACL_ROLE_MASK     3   // lower 2 bits
-#define PERM_ACL_GUEST         0
-#define PERM_ACL_READ_ONLY     1
-#define PERM_ACL_READ_WRITE    2
-#define PERM_ACL_ADMIN         3
-
-#define OUT_PATH_UNKNOWN  0xFF
-
-struct ClientInfo {
-  mesh::Identity id;
-  uint8_t permissions;
-  uint8_t out_path_len;
-  uint8_t out_path[MAX_PATH_SIZE];
-  uint8_t shared_secret[PUB_KEY_SIZE];
-  uint32_t last_timestamp;   // by THEIR clock  (transient)
-  uint32_t last_activity;    // by OUR clock    (transient)
-  union  {
-    struct {
-      uint32_t sync_since;  // sync messages SINCE this timestamp (by OUR clock)
-      uint32_t pending_ack;
-      uint32_t push_post_timestamp;
-      unsigned long ack_timeout;
-      uint8_t  push_failures;
-    } room;
-  } extra;
-  
-  bool isAdmin() const { return (permissions & PERM_ACL_ROLE_MASK) == PERM_ACL_ADMIN; }
-};
+#include <helpers/ClientInfo.h>
+#include <helpers/ClientIndex.h>
+#include <helpers/ClientColdStore.h>
 
 #ifndef MAX_CLIENTS
   #define MAX_CLIENTS           20
 #endif
 
+/**
+ * \brief  The clients (eg. logged in, or with permissions) of a server. clients[] is the 'hot' tier in RAM, indexed by
+ *     pub_key hash. When full, the least recently active non-admin client is moved to the optional cold store (see
+ *     setColdStore()), or forgotten if there is none, and clients are paged back in from it when they next send a
+ *     packet. Peer search results (see searchByHash()) are indexes into clients[], or < 0 for a client in the cold
+ *     store (see getMatchingClient()).
+*/
 class ClientACL {
   FILESYSTEM* _fs;
   ClientInfo clients[MAX_CLIENTS];
   int num_clients;
+  ClientIndex _index;
+  ClientColdStore* _cold_store;
+  ClientInfo _cold_peer;   // last cold client loaded by getSharedSecret()
+  int _cold_peer_rec;
+  uint8_t* _slot_data;     // optional, see setSlotData()
+  size_t _slot_data_size;
+
+  static int coldIndex(int rec) { return -1 - rec; }
+  ClientInfo* allocateSlot();
+  ClientInfo* pageIn(int rec);
+  void removeAt(int i);
+  void rebuildIndex();
+  void moveSlot(int from, int to);
+  void clearSlotData(int i);
 
 public:
-  ClientACL() { 
+  ClientACL() : _index(clients, MAX_CLIENTS) {
     memset(clients, 0, sizeof(clients));
     num_clients = 0;
+    _fs = NULL;
+    _cold_store = NULL;
+    _cold_peer_rec = -1;
+    _slot_data = NULL;
+    _slot_data_size = 0;
   }
   void load(FILESYSTEM* _fs, const mesh::LocalIdentity& self_id);
   void save(FILESYSTEM* _fs, bool (*filter)(ClientInfo*)=NULL);
   bool clear();
 
+  /** \brief  enables the second tier, call before load() */
+  void setColdStore(ClientColdStore* store) { _cold_store = store; }
+  ClientColdStore* getColdStore() const { return _cold_store; }
+
+  /** \returns  the client (paged in to clients[], if in the cold store), or NULL if not known */
   ClientInfo* getClient(const uint8_t* pubkey, int key_len);
   ClientInfo* putClient(const mesh::Identity& id, uint8_t init_perms);
   bool applyPermissions(const mesh::LocalIdentity& self_id, const uint8_t* pubkey, int key_len, uint8_t perms);
 
+  /**
+   * \brief  for Mesh::searchPeersByHash(). Clients in clients[] come first, most recently active first.
+   * \param  dest   set to indexes of matching clients (< 0 for those in the cold store)
+   * \returns  number of matches
+  */
+  int searchByHash(const uint8_t* hash, int dest[], int max_num);
+
+  /** \brief  for Mesh::getPeerSharedSecret(), 'idx' is from searchByHash().  \returns false if invalid */
+  bool getSharedSecret(int idx, uint8_t* dest_secret);
+
+  /**
+   * \brief  resolves an index from searchByHash(), paging the client in to clients[] if in the cold store. Other
+   *     indexes from the same search are no longer valid after this.
+   * \param  idx   updated to the index in clients[]
+   * \returns  NULL if invalid (or couldn't page in)
+  */
+  ClientInfo* getMatchingClient(int& idx);
+
+  /**
+   * \brief  moves non-admin clients not active for 'max_idle_secs' out of clients[] (to the cold store, if there is
+   *     one, otherwise only those with the guest role are forgotten).  Clients not yet active since boot are left.
+   * \returns  number of clients moved out
+  */
+  int evictIdle(uint32_t now, uint32_t max_idle_secs);
+
+  /**
+   * \brief  optional per-client (transient) data that a server keeps alongside clients[], eg. only a room server
+   *     needs a PostSyncWindow per client. Items are moved along with their client in clients[], and zeroed for a new one.
+   * \param  data   array of MAX_CLIENTS items, each 'item_size' bytes
+  */
+  void setSlotData(void* data, size_t item_size) {
+    _slot_data = (uint8_t *) data;
+    _slot_data_size = item_size;
+    memset(_slot_data, 0, MAX_CLIENTS * item_size);
+  }
+
   int getNumClients() const { return num_clients; }
   ClientInfo* getClientByIdx(int idx) { return &clients[idx]; }
+  int getClientIdx(const ClientInfo* client) const { return client - clients; }
 };
@@ -0,0 +1,118 @@
+#include "ClientColdStore.h"
+
+static File openFile(FILESYSTEM* fs, const char* path, char mode) {   // mode: 'r', 'u' (update in place) or 'a'
+#if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+  return fs->open(path, mode == 'r' ? FILE_O_READ : FILE_O_WRITE);   // positioned at end, if FILE_O_WRITE
+#elif defined(RP2040_PLATFORM)
+  return fs->open(path, mode == 'r' ? "r" : mode == 'u' ? "r+" : "a");
+#else
+  return fs->open(path, mode == 'r' ? "r" : mode == 'u' ? "r+" : "a", mode == 'a');
+#endif
+}
+
+ClientColdStore::ClientColdStore(const char* path, int max_records) {
+  _fs = NULL;
+  _path = path;
+  _max = max_records;
+  _hashes = new uint8_t[max_records > 0 ? max_records : 1];
+  _used = new uint8_t[(max_records + 7) / 8 + 1];
+  memset(_used, 0, (_max + 7) / 8 + 1);
+  _num = _file_recs = 0;
+}
+
+bool ClientColdStore::begin(FILESYSTEM* fs) {
+  _fs = fs;
+  memset(_used, 0, (_max + 7) / 8 + 1);
+  _num = _file_recs = 0;
+  if (_fs && _fs->exists(_path)) _fs->remove(_path);
+  return _fs != NULL;
+}
+
+bool ClientColdStore::readRecord(int rec, ClientInfo& dest) {
+  File file = openFile(_fs, _path, 'r');
+  if (!file) return false;
+
+  uint8_t buf[CLIENT_COLD_REC_SIZE];
+  bool success = file.seek(rec * CLIENT_COLD_REC_SIZE) && file.read(buf, CLIENT_COLD_REC_SIZE) == (size_t)CLIENT_COLD_REC_SIZE;
+  file.close();
+  if (!success) return false;
+
+  int i = 0;
+  dest = ClientInfo();
+  memcpy(dest.id.pub_key, &buf[i], PUB_KEY_SIZE); i += PUB_KEY_SIZE;
+  dest.permissions = buf[i++];
+  memcpy(&dest.extra.room.sync_since, &buf[i], 4); i += 4;
+  dest.out_path_len = buf[i++];
+  memcpy(dest.out_path, &buf[i], MAX_PATH_SIZE); i += MAX_PATH_SIZE;
+  memcpy(dest.shared_secret, &buf[i], PUB_KEY_SIZE);
+  return true;
+}
+
+bool ClientColdStore::writeRecord(int rec, const ClientInfo& src) {
+  uint8_t buf[CLIENT_COLD_REC_SIZE];
+  int i = 0;
+  memcpy(&buf[i], src.id.pub_key, PUB_KEY_SIZE); i += PUB_KEY_SIZE;
+  buf[i++] = src.permissions;
+  memcpy(&buf[i], &src.extra.room.sync_since, 4); i += 4;
+  buf[i++] = src.out_path_len;
+  memcpy(&buf[i], src.out_path, MAX_PATH_SIZE); i += MAX_PATH_SIZE;
+  memcpy(&buf[i], src.shared_secret, PUB_KEY_SIZE);
+
+  if (rec > _file_recs) return false;   // (records are allocated lowest first, so file only grows by one at a time)
+
+  File file = openFile(_fs, _path, rec == _file_recs ? 'a' : 'u');
+  if (!file) return false;
+  bool success = (rec == _file_recs || file.seek(rec * CLIENT_COLD_REC_SIZE)) && file.write(buf, CLIENT_COLD_REC_SIZE) == (size_t)CLIENT_COLD_REC_SIZE;
+  file.close();
+  if (success && rec == _file_recs) _file_recs++;
+  return success;
+}
+
+int ClientColdStore::findByHash(uint8_t hash, int dest[], int max_num) const {
+  int n = 0;
+  for (int rec = 0; rec < _max && n < max_num; rec++) {
+    if (_hashes[rec] == hash && isUsed(rec)) dest[n++] = rec;
+  }
+  return n;
+}
+
+int ClientColdStore::findByPubKey(const uint8_t* pub_key, int prefix_len) {
+  ClientInfo c;
+  for (int rec = 0; rec < _max; rec++) {
+    if (_hashes[rec] != pub_key[0] || !isUsed(rec)) continue;
+
+    if (readRecord(rec, c) && memcmp(c.id.pub_key, pub_key, prefix_len) == 0) return rec;
+  }
+  return -1;  // not found
+}
+
+bool ClientColdStore::load(int rec, ClientInfo& dest) {
+  if (_fs == NULL || rec < 0 || rec >= _max || !isUsed(rec)) return false;
+  return readRecord(rec, dest);
+}
+
+bool ClientColdStore::store(const ClientInfo& client) {
+  if (_fs == NULL) return false;
+
+  int rec = findByPubKey(client.id.pub_key, PUB_KEY_SIZE);
+  if (rec < 0) {
+    rec = 0;
+    while (rec < _max && isUsed(rec)) rec++;   // find free record
+    if (rec >= _max) return false;   // full
+  }
+  if (!writeRecord(rec, client)) return false;
+
+  if (!isUsed(rec)) {
+    _used[rec >> 3] |= (1 << (rec & 7));
+    _num++;
+  }
+  _hashes[rec] = client.id.pub_key[0];
+  return true;
+}
+
+void ClientColdStore::remove(int rec) {
+  if (rec < 0 || rec >= _max || !isUsed(rec)) return;
+
+  _used[rec >> 3] &= ~(1 << (rec & 7));   // (record is just left in file, to be re-used)
+  _num--;
+}
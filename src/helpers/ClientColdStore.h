@@ -0,0 +1,53 @@
+#pragma once
+
+#include <helpers/ClientInfo.h>
+#include <helpers/IdentityStore.h>   // for FILESYSTEM
+
+#define CLIENT_COLD_REC_SIZE   (PUB_KEY_SIZE + 1 + 4 + 1 + MAX_PATH_SIZE + PUB_KEY_SIZE)   // pub_key, permissions, sync_since, out_path_len, out_path, secret
+
+/**
+ * \brief  Second ('cold') tier of ClientACL, for when its in-RAM clients[] table is full. Least recently active
+ *     clients are spilled here, and paged back in when a packet from them arrives, so a server can know many more
+ *     clients than it has RAM for. Records are fixed size slots in a file, which only grows as needed, and only the
+ *     first pub_key byte (the 1-byte hash) of each is kept in RAM, so hash matching doesn't touch the file.
+ *     RAM cost is ~1 byte per client. Contents don't survive a reboot on their own: ClientACL::save() writes out the
+ *     cold clients too, and load() spills whatever doesn't fit in RAM back here.
+*/
+class ClientColdStore {
+  FILESYSTEM* _fs;
+  const char* _path;
+  uint8_t* _hashes;   // pub_key[0] of each record
+  uint8_t* _used;     // bitmap of records in use
+  int _max, _num, _file_recs;
+
+  bool readRecord(int rec, ClientInfo& dest);
+  bool writeRecord(int rec, const ClientInfo& src);
+
+public:
+  ClientColdStore(const char* path, int max_records);
+  ~ClientColdStore() { delete[] _hashes; delete[] _used; }
+
+  /** \brief  starts empty (any previous file is removed) */
+  bool begin(FILESYSTEM* fs);
+
+  bool isUsed(int rec) const { return (_used[rec >> 3] & (1 << (rec & 7))) != 0; }
+  int getNumClients() const { return _num; }
+  int getMaxClients() const { return _max; }
+
+  /**
+   * \param  dest   set to the record numbers of clients whose pub_key starts with 'hash'
+   * \returns  number of records
+  */
+  int findByHash(uint8_t hash, int dest[], int max_num) const;
+
+  /** \returns  record number of client whose pub_key starts with pub_key[0..prefix_len-1], or -1 if not found */
+  int findByPubKey(const uint8_t* pub_key, int prefix_len);
+
+  /** \brief  loads a client, with all transient fields zeroed */
+  bool load(int rec, ClientInfo& dest);
+
+  /** \brief  add client, or replace the record with same pub_key.  \returns false if full, or write error */
+  bool store(const ClientInfo& client);
+
+  void remove(int rec);
+};
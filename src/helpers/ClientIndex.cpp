@@ -0,0 +1,64 @@
+#include "ClientIndex.h"
+
+ClientIndex::ClientIndex(const ClientInfo* table, int max_entries) {
+  _table = table;
+  _max = max_entries;
+  int size = 4;
+  while (size < max_entries * 2) size <<= 1;   // keep load factor <= 0.5, so probe runs stay short
+  _mask = size - 1;
+  _shift = 0;
+  while ((256 << _shift) < size) _shift++;
+  _buckets = new uint16_t[size];
+  clear();
+}
+
+void ClientIndex::clear() {
+  memset(_buckets, 0, (_mask + 1) * sizeof(_buckets[0]));
+  _num = 0;
+}
+
+bool ClientIndex::add(int slot) {
+  if (_num >= _max) return false;
+
+  int i = home(_table[slot].id.pub_key[0]);
+  while (_buckets[i]) i = (i + 1) & _mask;
+  _buckets[i] = slot + 1;
+  _num++;
+  return true;
+}
+
+void ClientIndex::remove(int slot) {
+  int i = home(_table[slot].id.pub_key[0]);
+  while (_buckets[i] && _buckets[i] != slot + 1) i = (i + 1) & _mask;
+  if (_buckets[i] == 0) return;   // not indexed
+
+  // backward shift deletion: move later entries of the probe run into the gap, where that doesn't put them before their home
+  _buckets[i] = 0;
+  _num--;
+  for (int j = (i + 1) & _mask; _buckets[j]; j = (j + 1) & _mask) {
+    int h = home(_table[_buckets[j] - 1].id.pub_key[0]);
+    bool can_move = (i <= j) ? (h <= i || h > j) : (h <= i && h > j);   // ie. 'h' is not cyclically in (i, j]
+    if (can_move) {
+      _buckets[i] = _buckets[j];
+      _buckets[j] = 0;
+      i = j;
+    }
+  }
+}
+
+int ClientIndex::find(const uint8_t* key, int len) const {
+  for (int i = home(key[0]); _buckets[i]; i = (i + 1) & _mask) {
+    int slot = _buckets[i] - 1;
+    if (memcmp(_table[slot].id.pub_key, key, len) == 0) return slot;
+  }
+  return -1;
+}
+
+int ClientIndex::findByHash(uint8_t hash, int dest[], int max_num) const {
+  int n = 0;
+  for (int i = home(hash); _buckets[i] && n < max_num; i = (i + 1) & _mask) {
+    int slot = _buckets[i] - 1;
+    if (_table[slot].id.pub_key[0] == hash) dest[n++] = slot;
+  }
+  return n;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <helpers/ClientInfo.h>
+
+/**
+ * \brief  Hash index over a ClientInfo table (ie. ClientACL's clients[]), so finding a client by pub_key (or prefix),
+ *     or all clients matching a 1-byte hash, doesn't need to scan the table. Open addressing with linear probing,
+ *     keyed on pub_key[0] (which is already uniformly random), in a power of 2 sized table at least twice the number
+ *     of entries. Each bucket holds a slot number (index into table) + 1, or zero if empty.
+ *     The owner must keep the index in step: add() after a slot has been filled, remove() BEFORE a slot is overwritten.
+*/
+class ClientIndex {
+  const ClientInfo* _table;
+  uint16_t* _buckets;
+  int _mask, _shift, _max, _num;
+
+  int home(uint8_t hash) const { return (hash << _shift) & _mask; }   // (spread over all buckets, if more than 256)
+
+public:
+  /**
+   * \param  table   the ClientInfo table, of at least 'max_entries'
+  */
+  ClientIndex(const ClientInfo* table, int max_entries);
+  ~ClientIndex() { delete[] _buckets; }
+
+  void clear();
+  int count() const { return _num; }
+
+  /** \brief  index the (just filled) table[slot] */
+  bool add(int slot);
+
+  /** \brief  un-index table[slot]. Must be called while the slot still holds the client */
+  void remove(int slot);
+
+  /** \returns  slot of a client whose pub_key starts with key[0..len-1], or -1 if none */
+  int find(const uint8_t* key, int len) const;
+
+  /**
+   * \param  dest   set to the slots of clients whose pub_key starts with 'hash' byte
+   * \returns  number of slots
+  */
+  int findByHash(uint8_t hash, int dest[], int max_num) const;
+};
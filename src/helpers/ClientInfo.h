@@ -0,0 +1,30 @@
+#pragma once
+
+#include <Mesh.h>
+
+#define PERM_ACL_ROLE_MASK     3   // lower 2 bits
+#define PERM_ACL_GUEST         0
+#define PERM_ACL_READ_ONLY     1
+#define PERM_ACL_READ_WRITE    2
+#define PERM_ACL_ADMIN         3
+
+#define OUT_PATH_UNKNOWN  0xFF
+
+struct ClientInfo {
+  mesh::Identity id;
+  uint8_t permissions;
+  uint8_t out_path_len;
+  uint8_t out_path[MAX_PATH_SIZE];
+  uint8_t shared_secret[PUB_KEY_SIZE];
+  uint32_t last_timestamp;   // by THEIR clock  (transient)
+  uint32_t last_activity;    // by OUR clock    (transient)
+  union  {
+    struct {
+      uint32_t sync_since;  // sync messages SINCE this timestamp (by OUR clock)
+      uint8_t  push_failures;
+      uint8_t  features;    // LOGIN_FEATURE_* flags, from client's login (transient)
+    } room;
+  } extra;
+  
+  bool isAdmin() const { return (permissions & PERM_ACL_ROLE_MASK) == PERM_ACL_ADMIN; }
+};
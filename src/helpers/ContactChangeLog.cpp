@@ -0,0 +1,106 @@
+#include "ContactChangeLog.h"
+#include <helpers/AdvertDataHelpers.h>
+
+#define MAX_ENTRY_SIZE  (PUB_KEY_SIZE + 3 + MAX_PATH_SIZE + 16 + 1 + 32)
+
+ContactChangeLog::ContactChangeLog() {
+  _syncing = false;
+  reset(0);
+}
+
+void ContactChangeLog::reset(uint32_t epoch) {
+  _epoch = epoch;
+  _seq = _lost_seq = 0;
+  _num_deleted = _next_deleted = 0;
+  if (_syncing) _sync_end_seq = 0;   // client will have to do full sync next time
+}
+
+void ContactChangeLog::onDeleted(const ContactInfo& contact) {
+  if (contact.type == ADV_TYPE_NONE) return;   // transient, never sent to client
+
+  DeletedEntry* d = &_deleted[_next_deleted];
+  if (_num_deleted < CONTACT_CHANGE_LOG_DELETES) {
+    _num_deleted++;
+  } else if (d->seq > _lost_seq) {
+    _lost_seq = d->seq;   // oldest is dropped
+  }
+  memcpy(d->pub_key, contact.id.pub_key, PUB_KEY_SIZE);
+  d->seq = ++_seq;
+  _next_deleted = (_next_deleted + 1) % CONTACT_CHANGE_LOG_DELETES;
+
+  if (_syncing) _sync_end_seq = _sync_since;   // contacts[] (and ring) shifted, this sync may miss one, so repeat it next time
+}
+
+bool ContactChangeLog::startSync(bool has_since, uint32_t epoch, uint32_t since) {
+  bool full = !(has_since && canSyncFrom(epoch, since));
+  _syncing = true;
+  _sync_since = full ? 0 : since;
+  _sync_end_seq = _seq;
+  _sync_idx = 0;
+  _sync_del = full ? _num_deleted : 0;   // full sync doesn't need deletions
+  return full;
+}
+
+int ContactChangeLog::writeChangedEntry(uint8_t dest[], const ContactInfo& contact) {
+  int i = 0;
+  memcpy(&dest[i], contact.id.pub_key, PUB_KEY_SIZE); i += PUB_KEY_SIZE;
+  dest[i++] = contact.type;
+  dest[i++] = contact.flags;
+  dest[i++] = contact.out_path_len;
+  int hash_size = (contact.out_path_len >> 6) + 1;
+  int path_bytes = (contact.out_path_len & 63) * hash_size;
+  if (contact.out_path_len == OUT_PATH_UNKNOWN || hash_size == 4 || path_bytes > MAX_PATH_SIZE) path_bytes = 0;
+  memcpy(&dest[i], contact.out_path, path_bytes); i += path_bytes;
+  memcpy(&dest[i], &contact.last_advert_timestamp, 4); i += 4;
+  memcpy(&dest[i], &contact.gps_lat, 4); i += 4;
+  memcpy(&dest[i], &contact.gps_lon, 4); i += 4;
+  memcpy(&dest[i], &contact.lastmod, 4); i += 4;
+  int name_len = strnlen(contact.name, sizeof(contact.name) - 1);
+  dest[i++] = name_len;
+  memcpy(&dest[i], contact.name, name_len); i += name_len;
+  return i;
+}
+
+int ContactChangeLog::writeDeletedEntry(uint8_t dest[], const uint8_t* pub_key) {
+  memcpy(dest, pub_key, PUB_KEY_SIZE);
+  dest[PUB_KEY_SIZE] = ADV_TYPE_NONE;
+  return PUB_KEY_SIZE + 1;
+}
+
+int ContactChangeLog::writeSyncFrame(ContactSyncSource* src, uint8_t dest[], int max_len) {
+  if (!_syncing) return 0;
+
+  int len = 1, count = 0;
+  uint8_t entry[MAX_ENTRY_SIZE];
+
+  // deletions first, in case a contact was deleted then re-added
+  while (_sync_del < _num_deleted) {
+    const DeletedEntry* d = &_deleted[(_next_deleted - _num_deleted + _sync_del + CONTACT_CHANGE_LOG_DELETES) % CONTACT_CHANGE_LOG_DELETES];
+    if (d->seq > _sync_since) {
+      if (len + PUB_KEY_SIZE + 1 > max_len) break;   // frame is full
+      len += writeDeletedEntry(&dest[len], d->pub_key);
+      count++;
+    }
+    _sync_del++;
+  }
+
+  // then changed contacts
+  ContactInfo c;
+  while (_sync_del >= _num_deleted && src->getContactForSync(_sync_idx, c)) {
+    if (c.type != ADV_TYPE_NONE && c.change_seq > _sync_since) {
+      int n = writeChangedEntry(entry, c);
+      if (len + n > max_len) break;   // frame is full
+      memcpy(&dest[len], entry, n);
+      len += n;
+      count++;
+    }
+    _sync_idx++;
+  }
+
+  if (count == 0) {
+    _syncing = false;   // finished
+    return 0;
+  }
+  dest[0] = count;
+  return len;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <helpers/ContactInfo.h>
+
+#ifndef CONTACT_CHANGE_LOG_DELETES
+  #define CONTACT_CHANGE_LOG_DELETES  32   // deleted contacts remembered, for delta syncs
+#endif
+
+class ContactSyncSource {
+public:
+  virtual bool getContactForSync(uint32_t idx, ContactInfo& dest) = 0;
+};
+
+/**
+ * \brief  Versioning of the contacts table, so a client app can fetch just the changes since its last sync.
+ *     Every mutation of a contact stamps it with the next sequence number (ContactInfo::change_seq), and deletions
+ *     are kept in a small ring. The epoch changes whenever sequence numbers restart (eg. at boot), and when a client's
+ *     sequence number is older than the ring's oldest deletion, a full sync is done instead.
+ *     Sync frames pack as many entries as fit in a frame: each entry is the pub_key(32) and type(1), and for changed
+ *     contacts then flags(1), out_path_len(1), out_path(only the bytes used), last_advert_timestamp(4), gps_lat(4),
+ *     gps_lon(4), lastmod(4), name_len(1) and name. A type of zero (ADV_TYPE_NONE) marks a deleted contact.
+*/
+class ContactChangeLog {
+  struct DeletedEntry {
+    uint8_t pub_key[PUB_KEY_SIZE];
+    uint32_t seq;
+  };
+
+  uint32_t _epoch, _seq;
+  uint32_t _lost_seq;   // highest seq of deletions dropped from ring
+  DeletedEntry _deleted[CONTACT_CHANGE_LOG_DELETES];
+  int _num_deleted, _next_deleted;
+
+  // current sync
+  bool _syncing;
+  uint32_t _sync_since, _sync_end_seq;
+  uint32_t _sync_idx;   // next contact
+  int _sync_del;        // next deleted entry (from oldest)
+
+public:
+  ContactChangeLog();
+
+  /** \brief  forgets all changes, and restarts sequence numbers under 'epoch' */
+  void reset(uint32_t epoch);
+  uint32_t getEpoch() const { return _epoch; }
+  uint32_t getSeq() const { return _seq; }
+
+  void onChanged(ContactInfo& contact) { contact.change_seq = ++_seq; }
+  void onDeleted(const ContactInfo& contact);
+
+  /** \returns  true if all changes since 'seq' (from a previous sync under 'epoch') are still known */
+  bool canSyncFrom(uint32_t epoch, uint32_t seq) const { return epoch == _epoch && seq >= _lost_seq && seq <= _seq; }
+
+  /**
+   * \brief  starts sending the changes since client's last sync, or all contacts if not possible.
+   * \returns  true if a full sync (client must clear its list first)
+  */
+  bool startSync(bool has_since, uint32_t epoch, uint32_t since);
+  bool isSyncing() const { return _syncing; }
+  void stopSync() { _syncing = false; }
+
+  /**
+   * \brief  writes the next batch: count(1) then entries (see above).
+   * \returns  length written, or 0 if no more (sync is then finished)
+  */
+  int writeSyncFrame(ContactSyncSource* src, uint8_t dest[], int max_len);
+
+  /** \returns  seq the client should save for next time, once sync is finished */
+  uint32_t getSyncEndSeq() const { return _sync_end_seq; }
+
+  static int writeChangedEntry(uint8_t dest[], const ContactInfo& contact);
+  static int writeDeletedEntry(uint8_t dest[], const uint8_t* pub_key);
+};
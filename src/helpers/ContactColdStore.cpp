@@ -0,0 +1,70 @@
+#include "ContactColdStore.h"
+
+ContactColdStore::ContactColdStore(int max_records) {
+  _max = max_records;
+  _hashes = new uint8_t[max_records > 0 ? max_records : 1];
+  _used = new uint8_t[(max_records + 7) / 8 + 1];
+  clearRecords();
+}
+
+void ContactColdStore::clearRecords() {
+  memset(_used, 0, (_max + 7) / 8 + 1);
+  _num = 0;
+}
+
+void ContactColdStore::setRecordUsed(int rec, uint8_t hash) {
+  if (rec < 0 || rec >= _max) return;
+  if (!isUsed(rec)) {
+    _used[rec >> 3] |= (1 << (rec & 7));
+    _num++;
+  }
+  _hashes[rec] = hash;
+}
+
+int ContactColdStore::findByHash(uint8_t hash, uint16_t dest[], int max_num) const {
+  int n = 0;
+  for (int rec = 0; rec < _max && n < max_num; rec++) {
+    if (_hashes[rec] == hash && isUsed(rec)) dest[n++] = rec;
+  }
+  return n;
+}
+
+int ContactColdStore::findByPubKey(const uint8_t* pub_key, int prefix_len) {
+  ContactInfo c;
+  for (int rec = 0; rec < _max; rec++) {
+    if (_hashes[rec] != pub_key[0] || !isUsed(rec)) continue;
+
+    if (readRecord(rec, c) && memcmp(c.id.pub_key, pub_key, prefix_len) == 0) return rec;
+  }
+  return -1;  // not found
+}
+
+bool ContactColdStore::load(int rec, ContactInfo& dest) {
+  if (rec < 0 || rec >= _max || !isUsed(rec)) return false;
+  dest.shared_secret_valid = false;
+  if (!readRecord(rec, dest)) return false;
+
+  dest.last_rx = 0;
+  return true;
+}
+
+bool ContactColdStore::store(const ContactInfo& contact) {
+  int rec = findByPubKey(contact.id.pub_key, PUB_KEY_SIZE);
+  if (rec < 0) {
+    rec = 0;
+    while (rec < _max && isUsed(rec)) rec++;   // find free record
+    if (rec >= _max) return false;   // full
+  }
+  if (!writeRecord(rec, contact)) return false;
+
+  setRecordUsed(rec, contact.id.pub_key[0]);
+  return true;
+}
+
+void ContactColdStore::remove(int rec) {
+  if (rec < 0 || rec >= _max || !isUsed(rec)) return;
+
+  eraseRecord(rec);
+  _used[rec >> 3] &= ~(1 << (rec & 7));
+  _num--;
+}
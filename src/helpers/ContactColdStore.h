@@ -0,0 +1,48 @@
+#pragma once
+
+#include <helpers/ContactInfo.h>
+
+/**
+ * \brief  Second ('cold') tier of contacts, for when BaseChatMesh's in-RAM contacts[] table is full. Least recently
+ *     active contacts are spilled here, and paged back in to contacts[] when a packet or advert from them arrives.
+ *     Records are kept by the sub-class (eg. in a flash file). Only the first pub_key byte (the 1-byte hash) of each
+ *     record is kept in RAM, so hash matching doesn't touch storage, and the RAM cost is ~1 byte per cold contact.
+ *     Sub-classes must call setRecordUsed() for each existing record, when opening the storage. Records should
+ *     also keep the contact's shared secret (if calculated), so that trying a cold contact doesn't need a key exchange.
+*/
+class ContactColdStore {
+  uint8_t* _hashes;   // pub_key[0] of each record
+  uint8_t* _used;     // bitmap of records in use
+  int _max, _num;
+
+protected:
+  virtual bool readRecord(int rec, ContactInfo& dest) = 0;   // dest.shared_secret_valid is false on entry
+  virtual bool writeRecord(int rec, const ContactInfo& src) = 0;
+  virtual bool eraseRecord(int rec) = 0;
+
+  void setRecordUsed(int rec, uint8_t hash);
+  void clearRecords();
+
+public:
+  ContactColdStore(int max_records);
+
+  bool isUsed(int rec) const { return (_used[rec >> 3] & (1 << (rec & 7))) != 0; }
+  int getNumContacts() const { return _num; }
+  int getMaxContacts() const { return _max; }
+
+  /**
+   * \param  dest   set to the record numbers of contacts whose pub_key starts with 'hash'
+   * \returns  number of records
+  */
+  int findByHash(uint8_t hash, uint16_t dest[], int max_num) const;
+
+  /** \returns  record number of contact whose pub_key starts with pub_key[0..prefix_len-1], or -1 if not found */
+  int findByPubKey(const uint8_t* pub_key, int prefix_len);
+
+  bool load(int rec, ContactInfo& dest);
+
+  /** \brief  add contact, or replace the record with same pub_key.  \returns false if full, or write error */
+  bool store(const ContactInfo& contact);
+
+  void remove(int rec);
+};
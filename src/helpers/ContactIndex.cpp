@@ -0,0 +1,119 @@
+#include "ContactIndex.h"
+
+ContactIndex::ContactIndex(const ContactInfo* table, int max_entries) {
+  _table = table;
+  _max = max_entries;
+  _by_key = new uint16_t[max_entries];
+  _by_recent = new uint16_t[max_entries];
+  clear();
+}
+
+void ContactIndex::clear() {
+  _num = 0;
+  memset(_bucket_end, 0, sizeof(_bucket_end));
+}
+
+int ContactIndex::lowerBound(const uint8_t* key, int len) const {
+  int lo = bucketStart(key[0]);
+  int hi = _bucket_end[key[0]];
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    if (memcmp(_table[_by_key[mid]].id.pub_key, key, len) < 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+bool ContactIndex::add(int slot) {
+  if (_num >= _max) return false;
+
+  const uint8_t* key = _table[slot].id.pub_key;
+  int pos = lowerBound(key, PUB_KEY_SIZE);
+  while (pos < _bucket_end[key[0]] && memcmp(_table[_by_key[pos]].id.pub_key, key, PUB_KEY_SIZE) == 0) {
+    pos++;   // duplicate key (shouldn't happen), keep in order added
+  }
+  memmove(&_by_key[pos + 1], &_by_key[pos], (_num - pos) * sizeof(_by_key[0]));
+  _by_key[pos] = slot;
+  for (int h = key[0]; h < 256; h++) {
+    _bucket_end[h]++;
+  }
+
+  uint32_t timestamp = _table[slot].last_advert_timestamp;
+  int j = _num;
+  while (j > 0 && _table[_by_recent[j - 1]].last_advert_timestamp < timestamp) {
+    _by_recent[j] = _by_recent[j - 1];
+    j--;
+  }
+  _by_recent[j] = slot;
+
+  _num++;
+  return true;
+}
+
+void ContactIndex::removeByKey(int slot) {
+  const uint8_t* key = _table[slot].id.pub_key;
+  int end = _bucket_end[key[0]];
+  int pos = lowerBound(key, PUB_KEY_SIZE);
+  while (pos < end && _by_key[pos] != slot) pos++;
+  if (pos >= end) return;   // not indexed
+
+  memmove(&_by_key[pos], &_by_key[pos + 1], (_num - pos - 1) * sizeof(_by_key[0]));
+  for (int h = key[0]; h < 256; h++) {
+    _bucket_end[h]--;
+  }
+}
+
+void ContactIndex::removeByRecent(int slot) {
+  int i = 0;
+  while (i < _num && _by_recent[i] != slot) i++;
+  if (i >= _num) return;   // not indexed
+
+  memmove(&_by_recent[i], &_by_recent[i + 1], (_num - i - 1) * sizeof(_by_recent[0]));
+  _num--;
+}
+
+void ContactIndex::remove(int slot, bool shift_down) {
+  removeByKey(slot);
+  removeByRecent(slot);
+
+  if (shift_down) {
+    for (int i = 0; i < _num; i++) {
+      if (_by_key[i] > slot) _by_key[i]--;
+      if (_by_recent[i] > slot) _by_recent[i]--;
+    }
+  }
+}
+
+int ContactIndex::find(const uint8_t* key, int len) const {
+  if (len <= 0) return _num > 0 ? _by_key[0] : -1;
+
+  int pos = lowerBound(key, len);
+  if (pos < _bucket_end[key[0]] && memcmp(_table[_by_key[pos]].id.pub_key, key, len) == 0) {
+    return _by_key[pos];
+  }
+  return -1;  // not found
+}
+
+int ContactIndex::findByHash(uint8_t hash, const uint16_t*& slots) const {
+  int start = bucketStart(hash);
+  slots = &_by_key[start];
+  return _bucket_end[hash] - start;
+}
+
+const uint16_t* ContactIndex::sortByRecent() {
+  // insertion sort: only the contacts whose timestamp changed since last time need to move
+  for (int i = 1; i < _num; i++) {
+    uint16_t slot = _by_recent[i];
+    uint32_t timestamp = _table[slot].last_advert_timestamp;
+    int j = i;
+    while (j > 0 && _table[_by_recent[j - 1]].last_advert_timestamp < timestamp) {
+      _by_recent[j] = _by_recent[j - 1];
+      j--;
+    }
+    _by_recent[j] = slot;
+  }
+  return _by_recent;
+}
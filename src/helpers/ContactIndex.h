@@ -0,0 +1,56 @@
+#pragma once
+
+#include <helpers/ContactInfo.h>
+
+/**
+ * \brief  Index over a ContactInfo table (eg. BaseChatMesh::contacts[]), so the per-packet lookups don't need to
+ *     scan every contact. Holds the slot numbers (indexes into the table) twice:
+ *       - ordered by pub_key, with a table of where each first-byte (1-byte hash) bucket ends. Hash matching is then
+ *         a bucket lookup, and pub_key (or pub_key prefix) lookup is a binary search within the bucket.
+ *       - ordered by last_advert_timestamp, most recent first. New contacts are inserted in order, and sortByRecent()
+ *         repairs the order after timestamps have been updated (which is cheap when only a few have moved).
+ *     The owner must keep the index in step: add() after a slot has been filled, remove() BEFORE a slot is overwritten
+ *     or removed. The pub_key of an indexed slot must not be changed in-between.
+*/
+class ContactIndex {
+  const ContactInfo* _table;
+  uint16_t* _by_key;
+  uint16_t* _by_recent;
+  uint16_t _bucket_end[256];   // _by_key[] positions: bucket N is [_bucket_end[N-1], _bucket_end[N])
+  int _max, _num;
+
+  int bucketStart(uint8_t hash) const { return hash == 0 ? 0 : _bucket_end[hash - 1]; }
+  int lowerBound(const uint8_t* key, int len) const;
+  void removeByKey(int slot);
+  void removeByRecent(int slot);
+
+public:
+  /**
+   * \param  table   the ContactInfo table, of at least 'max_entries'
+  */
+  ContactIndex(const ContactInfo* table, int max_entries);
+
+  void clear();
+  int count() const { return _num; }
+
+  /** \brief  index the (just filled) table[slot] */
+  bool add(int slot);
+
+  /**
+   * \brief  un-index table[slot]. Must be called while the slot still holds the contact.
+   * \param  shift_down   true if the owner is about to move all slots after 'slot' down by one (ie. array removal)
+  */
+  void remove(int slot, bool shift_down=false);
+
+  /** \returns  slot of the contact with lowest pub_key starting with key[0..len-1], or -1 if none */
+  int find(const uint8_t* key, int len) const;
+
+  /**
+   * \param  slots  set to the slots of all contacts whose pub_key starts with 'hash' byte
+   * \returns  number of slots
+  */
+  int findByHash(uint8_t hash, const uint16_t*& slots) const;
+
+  /** \returns  all slots, most recent last_advert_timestamp first */
+  const uint16_t* sortByRecent();
+};
@@ -17,6 +17,8 @@ struct ContactInfo {
   uint32_t lastmod;  // by OUR clock
   int32_t gps_lat, gps_lon;    // 6 dec places
   uint32_t sync_since;
+  uint32_t last_rx;   // by OUR clock, when last decrypted a packet from them (transient)
+  uint32_t change_seq;   // see ContactChangeLog (transient)
 
   const uint8_t* getSharedSecret(const mesh::LocalIdentity& self_id) const {
     if (!shared_secret_valid) {
@@ -26,6 +28,19 @@ struct ContactInfo {
     return shared_secret;
   }
 
+  /** \brief  copies the shared secret, if already calculated (eg. for persisting with the contact)  \returns false if not */
+  bool copySharedSecret(uint8_t* dest) const {
+    if (!shared_secret_valid) return false;
+    memcpy(dest, shared_secret, PUB_KEY_SIZE);
+    return true;
+  }
+
+  /** \brief  restores a previously calculated shared secret (eg. loaded with the contact) */
+  void setSharedSecret(const uint8_t* secret) {
+    memcpy(shared_secret, secret, PUB_KEY_SIZE);
+    shared_secret_valid = true;
+  }
+
 private:
   mutable uint8_t shared_secret[PUB_KEY_SIZE];
 };
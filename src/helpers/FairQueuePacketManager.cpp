@@ -0,0 +1,155 @@
+#include "FairQueuePacketManager.h"
+
+static bool tagBefore(uint32_t a, uint32_t b) {   // (tags can wrap around, as with millis)
+  return (int32_t)(a - b) < 0;
+}
+
+FairQueuePacketManager::FairQueuePacketManager(mesh::PacketManager& pool, mesh::Radio& radio, int max_queued)
+  : _pool(&pool), _radio(&radio)
+{
+  _table = new Entry[max_queued];
+  _size = max_queued;
+  _num = 0;
+  _next_seq = 0;
+  _vtime = 0;
+  _backlogged = 0;
+  for (int c = 0; c < TX_NUM_CLASSES; c++) {
+    _vstart[c] = _vfinish[c] = 0;
+  }
+  _weight[TX_CLASS_ACK] = TX_WEIGHT_ACK;
+  _weight[TX_CLASS_DIRECT] = TX_WEIGHT_DIRECT;
+  _weight[TX_CLASS_FLOOD] = TX_WEIGHT_FLOOD;
+  _weight[TX_CLASS_ADVERT] = TX_WEIGHT_ADVERT;
+  resetStats();
+}
+
+uint8_t FairQueuePacketManager::defaultClassOf(const mesh::Packet* packet) {
+  uint8_t type = packet->getPayloadType();
+  if (type == PAYLOAD_TYPE_ACK || type == PAYLOAD_TYPE_PATH) return TX_CLASS_ACK;
+  if (packet->isRouteDirect()) return TX_CLASS_DIRECT;
+  if (type == PAYLOAD_TYPE_ADVERT || type == PAYLOAD_TYPE_CONTROL) return TX_CLASS_ADVERT;
+  return TX_CLASS_FLOOD;
+}
+
+void FairQueuePacketManager::resetStats() {
+  memset(_stats, 0, sizeof(_stats));
+}
+
+int FairQueuePacketManager::getQueuedCount(int cls) const {
+  int n = 0;
+  for (int i = 0; i < _num; i++) {
+    if (_table[i].cls == cls) n++;
+  }
+  return n;
+}
+
+mesh::Packet* FairQueuePacketManager::removeAt(int i) {
+  mesh::Packet* item = _table[i].packet;
+  _num--;
+  while (i < _num) {
+    _table[i] = _table[i+1];
+    i++;
+  }
+  return item;
+}
+
+bool FairQueuePacketManager::isTopWeight(int cls) const {
+  for (int c = 0; c < TX_NUM_CLASSES; c++) {
+    if (_weight[c] > _weight[cls]) return false;
+  }
+  return true;
+}
+
+bool FairQueuePacketManager::evictFor(int cls) {
+  // newest packet of the lowest weight class, if lower than 'cls'
+  int victim = -1;
+  for (int i = 0; i < _num; i++) {
+    uint8_t w = _weight[_table[i].cls];
+    if (w >= _weight[cls]) continue;
+    if (victim < 0 || w < _weight[_table[victim].cls] || (w == _weight[_table[victim].cls] && _table[i].seq > _table[victim].seq)) {
+      victim = i;
+    }
+  }
+  if (victim < 0) return false;
+
+  _stats[_table[victim].cls].num_dropped++;
+  _pool->free(removeAt(victim));
+  return true;
+}
+
+void FairQueuePacketManager::queueOutbound(mesh::Packet* packet, uint8_t priority, uint32_t scheduled_for) {
+  uint8_t cls = classify(packet);
+  if (cls >= TX_NUM_CLASSES) cls = TX_CLASS_FLOOD;
+
+  bool pool_low = _pool->getFreeCount() < TX_POOL_RESERVE;
+  if (_num == _size || pool_low) {   // make way, if a lower weight class is queued
+    if (!evictFor(cls) && (_num == _size || !isTopWeight(cls))) {
+      MESH_DEBUG_PRINTLN("queueOutbound: send queue full, dropping packet");
+      _stats[cls].num_dropped++;
+      _pool->free(packet);
+      return;
+    }
+  }
+
+  uint32_t cost = _radio->getEstAirtimeFor(packet->getRawLength());
+  Entry* e = &_table[_num++];
+  e->packet = packet;
+  e->scheduled_for = scheduled_for;
+  e->seq = _next_seq++;
+  e->cost = cost == 0 ? 1 : (cost > 0xFFFF ? 0xFFFF : cost);
+  e->priority = priority;
+  e->cls = cls;
+}
+
+mesh::Packet* FairQueuePacketManager::getNextOutbound(uint32_t now) {
+  // most important due packet in each class
+  int best[TX_NUM_CLASSES];
+  for (int c = 0; c < TX_NUM_CLASSES; c++) best[c] = -1;
+  for (int i = 0; i < _num; i++) {
+    const Entry& e = _table[i];
+    if ((int32_t)(e.scheduled_for - now) > 0) continue;   // scheduled for future... ignore for now
+    int b = best[e.cls];
+    if (b < 0 || e.priority < _table[b].priority) best[e.cls] = i;   // (table is in insertion order, so FIFO within a priority)
+  }
+
+  // class with earliest start tag goes next. A class that had no due packets starts again from current virtual time
+  int cls = -1;
+  for (int c = 0; c < TX_NUM_CLASSES; c++) {
+    if (best[c] < 0) {
+      _backlogged &= ~(1 << c);
+      continue;
+    }
+    if ((_backlogged & (1 << c)) == 0) {
+      _vstart[c] = tagBefore(_vtime, _vfinish[c]) ? _vfinish[c] : _vtime;
+      _backlogged |= (1 << c);
+    }
+    if (cls < 0 || tagBefore(_vstart[c], _vstart[cls])) cls = c;
+  }
+  if (cls < 0) return NULL;   // empty, or all items are still in the future
+
+  const Entry& e = _table[best[cls]];
+  _vtime = _vstart[cls];
+  _vfinish[cls] = _vstart[cls] + (uint32_t)e.cost * TX_COST_SCALE / _weight[cls];
+  _vstart[cls] = _vfinish[cls];
+
+  ClassStats& s = _stats[cls];
+  uint32_t delay = now - e.scheduled_for;
+  s.num_sent++;
+  s.airtime_sent += e.cost;
+  s.delay_sum += delay;
+  if (delay > s.delay_max) s.delay_max = delay;
+  if (delay > TX_STARVED_MILLIS) s.num_starved++;
+
+  return removeAt(best[cls]);
+}
+
+int FairQueuePacketManager::getOutboundCount(uint32_t now) const {
+  if (now == 0xFFFFFFFF) return _num;  // sentinel: count all entries regardless of schedule
+
+  int n = 0;
+  for (int i = 0; i < _num; i++) {
+    if ((int32_t)(_table[i].scheduled_for - now) > 0) continue;   // scheduled for future... ignore for now
+    n++;
+  }
+  return n;
+}
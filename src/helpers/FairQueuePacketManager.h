@@ -0,0 +1,112 @@
+#pragma once
+
+#include <Dispatcher.h>
+
+#define TX_CLASS_ACK       0   // ACKs and returned paths (any route)
+#define TX_CLASS_DIRECT    1   // everything else that is direct-routed
+#define TX_CLASS_FLOOD     2   // flooded messages, requests, etc.
+#define TX_CLASS_ADVERT    3   // flooded adverts and control packets
+#define TX_NUM_CLASSES     4
+
+#ifndef TX_WEIGHT_ACK
+  #define TX_WEIGHT_ACK      8
+#endif
+#ifndef TX_WEIGHT_DIRECT
+  #define TX_WEIGHT_DIRECT   4
+#endif
+#ifndef TX_WEIGHT_FLOOD
+  #define TX_WEIGHT_FLOOD    2
+#endif
+#ifndef TX_WEIGHT_ADVERT
+  #define TX_WEIGHT_ADVERT   1
+#endif
+
+#define TX_COST_SCALE     64   // fixed point, for airtime / weight
+
+#ifndef TX_POOL_RESERVE
+  #define TX_POOL_RESERVE    4   // when fewer Packets than this are free, only the top weight class can take them
+#endif
+
+#ifndef TX_STARVED_MILLIS
+  #define TX_STARVED_MILLIS  10000   // a packet sent this long after it was due counts as 'starved'
+#endif
+
+/**
+ * \brief  A PacketManager that transmits using weighted fair queuing between traffic classes (see TX_CLASS_*),
+ *     instead of strictly by priority. Each class is charged the estimated airtime of what it sends, divided
+ *     by its weight, and the due class with the least charge goes next, so a flood storm (eg. of adverts) can
+ *     only take its share of the airtime, and ACKs/direct traffic are not starved. Within a class, packets go
+ *     in the usual order (most important priority amongst due packets, FIFO within a priority).
+ *     When the queue is full, or the pool is nearly empty, lower weight classes make way for higher ones.
+ *     Wraps another PacketManager, which provides the Packet pool and the inbound queue (its outbound queue is
+ *     not used).
+*/
+class FairQueuePacketManager : public mesh::PacketManager {
+public:
+  struct ClassStats {
+    uint32_t num_sent;
+    uint32_t num_dropped;     // queue full or pool low (new packet, or evicted for a higher weight class)
+    uint32_t num_starved;     // sent more than TX_STARVED_MILLIS after being due
+    uint32_t airtime_sent;    // estimated millis
+    uint32_t delay_sum;       // millis between being due and being sent
+    uint32_t delay_max;
+  };
+
+private:
+  struct Entry {
+    mesh::Packet* packet;
+    uint32_t scheduled_for;
+    uint32_t seq;       // insertion order
+    uint16_t cost;      // estimated airtime (millis)
+    uint8_t priority;
+    uint8_t cls;
+  };
+
+  mesh::PacketManager* _pool;
+  mesh::Radio* _radio;
+  Entry* _table;
+  int _size, _num;
+  uint32_t _next_seq;
+  uint32_t _vtime;                      // start tag of the last packet sent
+  uint32_t _vstart[TX_NUM_CLASSES];     // start tag of each class' next packet (while it has due packets)
+  uint32_t _vfinish[TX_NUM_CLASSES];    // finish tag of each class' last packet sent
+  uint8_t _backlogged;                  // bit per class, had due packets at last getNextOutbound()
+  uint8_t _weight[TX_NUM_CLASSES];
+  ClassStats _stats[TX_NUM_CLASSES];
+
+  mesh::Packet* removeAt(int i);
+  bool isTopWeight(int cls) const;
+  bool evictFor(int cls);
+
+protected:
+  /** \returns  the TX_CLASS_* for packet. Override for a custom classification */
+  virtual uint8_t classify(const mesh::Packet* packet) const { return defaultClassOf(packet); }
+
+public:
+  /**
+   * \param  pool  provides the Packet pool and inbound queue
+   * \param  radio   for the airtime estimates
+   * \param  max_queued  max outbound packets (normally the pool size)
+  */
+  FairQueuePacketManager(mesh::PacketManager& pool, mesh::Radio& radio, int max_queued);
+
+  static uint8_t defaultClassOf(const mesh::Packet* packet);
+
+  void setWeight(int cls, uint8_t weight) { _weight[cls] = weight > 0 ? weight : 1; }
+  uint8_t getWeight(int cls) const { return _weight[cls]; }
+  int getQueuedCount(int cls) const;
+  const ClassStats& getClassStats(int cls) const { return _stats[cls]; }
+  void resetStats();
+
+  mesh::Packet* allocNew() override { return _pool->allocNew(); }
+  void free(mesh::Packet* packet) override { _pool->free(packet); }
+  void queueOutbound(mesh::Packet* packet, uint8_t priority, uint32_t scheduled_for) override;
+  mesh::Packet* getNextOutbound(uint32_t now) override;
+  int getOutboundCount(uint32_t now) const override;
+  int getOutboundTotal() const override { return _num; }
+  int getFreeCount() const override { return _pool->getFreeCount(); }
+  mesh::Packet* getOutboundByIdx(int i) override { return i < _num ? _table[i].packet : NULL; }
+  mesh::Packet* removeOutboundByIdx(int i) override { return i < _num ? removeAt(i) : NULL; }
+  void queueInbound(mesh::Packet* packet, uint32_t scheduled_for) override { _pool->queueInbound(packet, scheduled_for); }
+  mesh::Packet* getNextInbound(uint32_t now) override { return _pool->getNextInbound(now); }
+};
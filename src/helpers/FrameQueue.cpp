@@ -0,0 +1,80 @@
+#include "FrameQueue.h"
+#include <string.h>
+
+FrameQueue::FrameQueue(uint32_t size) {
+  _buf = new uint8_t[size];
+  _size = size;
+  _head = _tail = 0;
+  _num_pushed = _num_popped = 0;
+}
+
+void FrameQueue::copyIn(uint32_t pos, const uint8_t* src, uint32_t len) {
+  uint32_t i = pos >= _size ? pos - _size : pos;
+  uint32_t n = _size - i;   // bytes before end of buffer
+  if (n > len) n = len;
+  memcpy(&_buf[i], src, n);
+  memcpy(_buf, &src[n], len - n);   // rest wraps around
+}
+
+void FrameQueue::copyOut(uint32_t pos, uint8_t* dest, uint32_t len) const {
+  uint32_t i = pos >= _size ? pos - _size : pos;
+  uint32_t n = _size - i;
+  if (n > len) n = len;
+  memcpy(dest, &_buf[i], n);
+  memcpy(&dest[n], _buf, len - n);
+}
+
+size_t FrameQueue::getFreeSpace() const {
+  uint32_t avail = _size - used();
+  if (avail <= 1) return 0;
+  avail--;   // the length byte
+  return avail > 255 ? 255 : avail;
+}
+
+bool FrameQueue::push(const uint8_t src[], size_t len) {
+  if (len == 0 || len > getFreeSpace()) return false;
+
+  uint8_t n = len;
+  copyIn(_tail, &n, 1);
+  copyIn(wrap(_tail + 1), src, len);
+  __sync_synchronize();
+  _tail = wrap(_tail + 1 + len);   // publish to consumer, only once frame is complete
+  _num_pushed++;
+  return true;
+}
+
+size_t FrameQueue::peekLen() const {
+  if (isEmpty()) return 0;
+  uint8_t n;
+  copyOut(_head, &n, 1);
+  return n;
+}
+
+size_t FrameQueue::peek(uint8_t dest[]) const {
+  size_t len = peekLen();
+  if (len > 0) copyOut(wrap(_head + 1), dest, len);
+  return len;
+}
+
+void FrameQueue::pop() {
+  size_t len = peekLen();
+  if (len > 0) {
+    __sync_synchronize();   // done reading frame, before consumer lets producer overwrite it
+    _head = wrap(_head + 1 + len);
+    _num_popped++;
+  }
+}
+
+size_t FrameQueue::popFramed(uint8_t dest[], size_t max_len, uint8_t hdr) {
+  size_t total = 0;
+  size_t len;
+  while ((len = peekLen()) > 0 && total + 3 + len <= max_len) {
+    dest[total++] = hdr;
+    dest[total++] = len & 0xFF;  // LSB
+    dest[total++] = len >> 8;    // MSB
+    copyOut(wrap(_head + 1), &dest[total], len);
+    total += len;
+    pop();
+  }
+  return total;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef SERIAL_SEND_QUEUE_SIZE
+  #define SERIAL_SEND_QUEUE_SIZE  (16*(MAX_FRAME_SIZE+1))   // bytes, for frames waiting to go to the app
+#endif
+#ifndef SERIAL_RECV_QUEUE_SIZE
+  #define SERIAL_RECV_QUEUE_SIZE  (8*(MAX_FRAME_SIZE+1))    // bytes, for frames received from the app
+#endif
+#ifndef SERIAL_SEND_QUEUE_RESERVE
+  #define SERIAL_SEND_QUEUE_RESERVE  (2*(MAX_FRAME_SIZE+1))   // isWriteBusy() when less than this is free
+#endif
+
+/**
+ * \brief  Ring buffer of variable length frames, for the BaseSerialInterface implementations. Each frame takes
+ *     only its length + 1 bytes, so many more of the (mostly small) frames fit than with fixed MAX_FRAME_SIZE slots.
+ *     Safe for one producer and one consumer in different contexts (eg. a BLE stack callback, and the main loop),
+ *     as push() only advances the tail, and pop() only the head. clear() is not, so only call when idle.
+*/
+class FrameQueue {
+  uint8_t* _buf;
+  uint32_t _size;
+  volatile uint32_t _head, _tail;   // both in range [0, 2*_size), so that full and empty can be told apart
+  volatile uint32_t _num_pushed, _num_popped;
+
+  uint32_t used() const { return _tail >= _head ? _tail - _head : 2*_size - _head + _tail; }
+  uint32_t wrap(uint32_t pos) const { return pos >= 2*_size ? pos - 2*_size : pos; }
+  void copyIn(uint32_t pos, const uint8_t* src, uint32_t len);
+  void copyOut(uint32_t pos, uint8_t* dest, uint32_t len) const;
+
+public:
+  /** \param  size  bytes of storage */
+  FrameQueue(uint32_t size);
+
+  void clear() { _head = _tail = 0; _num_popped = _num_pushed; }
+
+  /** \returns  false if frame doesn't fit (queue is unchanged), or 'len' is zero or over 255 */
+  bool push(const uint8_t src[], size_t len);
+
+  bool isEmpty() const { return _head == _tail; }
+  int count() const { return _num_pushed - _num_popped; }
+
+  /** \returns  length of the largest frame that push() will currently accept */
+  size_t getFreeSpace() const;
+  size_t getFreeBytes() const { return _size - used(); }
+  size_t getCapacity() const { return _size; }
+
+  /** \returns  length of the first frame (copied to 'dest'), or zero if empty. Frame stays in queue. */
+  size_t peek(uint8_t dest[]) const;
+  size_t peekLen() const;
+
+  /** \brief  removes first frame */
+  void pop();
+  size_t pop(uint8_t dest[]) { size_t len = peek(dest); if (len > 0) pop(); return len; }
+
+  /**
+   * \brief  coalesces frames into one write: pops as many whole frames as fit in 'max_len', each with the
+   *     3 byte header of the serial framing, ie. 'hdr', then length as unsigned 16-bit little endian.
+   * \returns  total bytes written to 'dest'
+  */
+  size_t popFramed(uint8_t dest[], size_t max_len, uint8_t hdr);
+};
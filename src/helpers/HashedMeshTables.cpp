@@ -0,0 +1,116 @@
+#include "HashedMeshTables.h"
+
+static const uint8_t zero_hash[MAX_HASH_SIZE] = { 0 };   // marks an unused (or cleared) cyclic table entry
+
+HashedMeshTables::HashedMeshTables(int capacity) {
+  if (capacity < 1) capacity = 1;
+  if (capacity > 32767) capacity = 32767;
+  _capacity = capacity;
+
+  int index_size = 1;
+  while (index_size < capacity*2) index_size <<= 1;   // keep load factor <= 0.5
+  _index_mask = index_size - 1;
+
+  _hashes = new uint8_t[capacity*MAX_HASH_SIZE];
+  _index = new uint16_t[index_size];
+  memset(_hashes, 0, capacity*MAX_HASH_SIZE);
+  memset(_index, 0, index_size*sizeof(uint16_t));
+  _next_idx = _num_hashes = 0;
+  _direct_dups = _flood_dups = 0;
+}
+
+int HashedMeshTables::homeSlot(const uint8_t* hash) const {
+  uint32_t h;
+  memcpy(&h, hash, sizeof(h));   // packet hash is already uniformly distributed (SHA256)
+  return h & _index_mask;
+}
+
+int HashedMeshTables::findSlot(const uint8_t* hash) const {
+  int slot = homeSlot(hash);
+  while (_index[slot]) {
+    if (memcmp(&_hashes[(_index[slot] - 1)*MAX_HASH_SIZE], hash, MAX_HASH_SIZE) == 0) return slot;
+    slot = (slot + 1) & _index_mask;
+  }
+  return -1;
+}
+
+void HashedMeshTables::removeSlot(int slot) {
+  // backward-shift deletion, so no tombstones are needed
+  int hole = slot;
+  int j = slot;
+  while (true) {
+    j = (j + 1) & _index_mask;
+    if (_index[j] == 0) break;
+
+    int home = homeSlot(&_hashes[(_index[j] - 1)*MAX_HASH_SIZE]);
+    // can entry at j be moved into hole? (ie. its home is NOT cyclically within (hole, j])
+    bool in_range = hole <= j ? (home > hole && home <= j) : (home > hole || home <= j);
+    if (!in_range) {
+      _index[hole] = _index[j];
+      hole = j;
+    }
+  }
+  _index[hole] = 0;
+  _num_hashes--;
+}
+
+void HashedMeshTables::insert(const uint8_t* hash) {
+  if (memcmp(hash, zero_hash, MAX_HASH_SIZE) == 0) return;   // (astronomically unlikely) can't be stored
+
+  uint8_t* dest = &_hashes[_next_idx*MAX_HASH_SIZE];
+  if (memcmp(dest, zero_hash, MAX_HASH_SIZE) != 0) {   // evict oldest
+    int slot = findSlot(dest);
+    if (slot >= 0) removeSlot(slot);
+  }
+  memcpy(dest, hash, MAX_HASH_SIZE);
+
+  int slot = homeSlot(hash);
+  while (_index[slot]) slot = (slot + 1) & _index_mask;
+  _index[slot] = _next_idx + 1;
+  _num_hashes++;
+
+  _next_idx = (_next_idx + 1) % _capacity;  // cyclic table
+}
+
+void HashedMeshTables::rebuildIndex() {
+  memset(_index, 0, (_index_mask + 1)*sizeof(uint16_t));
+  _num_hashes = 0;
+  if (_next_idx < 0 || _next_idx >= _capacity) _next_idx = 0;
+
+  for (int i = 0; i < _capacity; i++) {
+    const uint8_t* hash = &_hashes[i*MAX_HASH_SIZE];
+    if (memcmp(hash, zero_hash, MAX_HASH_SIZE) == 0 || findSlot(hash) >= 0) continue;
+
+    int slot = homeSlot(hash);
+    while (_index[slot]) slot = (slot + 1) & _index_mask;
+    _index[slot] = i + 1;
+    _num_hashes++;
+  }
+}
+
+bool HashedMeshTables::hasSeenHash(const uint8_t* hash, bool is_direct) {
+  if (findSlot(hash) >= 0) {
+    if (is_direct) {
+      _direct_dups++;   // keep some stats
+    } else {
+      _flood_dups++;
+    }
+    return true;
+  }
+  insert(hash);
+  return false;
+}
+
+bool HashedMeshTables::hasSeen(const mesh::Packet* packet) {
+  return hasSeenHash(packet->getPacketHash(), packet->isRouteDirect());
+}
+
+void HashedMeshTables::clear(const mesh::Packet* packet) {
+  const uint8_t* hash = packet->getPacketHash();
+
+  int slot = findSlot(hash);
+  if (slot >= 0) {
+    memset(&_hashes[(_index[slot] - 1)*MAX_HASH_SIZE], 0, MAX_HASH_SIZE);
+    removeSlot(slot);
+  }
+}
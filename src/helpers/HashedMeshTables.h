@@ -0,0 +1,67 @@
+#pragma once
+
+#include <Mesh.h>
+
+#ifdef ESP32
+  #include <FS.h>
+#endif
+
+#ifndef HASHED_TABLES_CAPACITY
+  #define HASHED_TABLES_CAPACITY  1024
+#endif
+
+/**
+ * \brief  Drop-in alternative to SimpleMeshTables, for larger capacities. Packet hashes are kept in a cyclic
+ *     (FIFO eviction) table as before, plus an open-addressed (linear probing) index into that table, so that
+ *     hasSeen() and clear() are constant time instead of a memcmp() scan of every entry.
+*/
+class HashedMeshTables : public mesh::MeshTables {
+  uint8_t* _hashes;       // cyclic table, _capacity * MAX_HASH_SIZE
+  uint16_t* _index;       // open-addressed, holds (cyclic table idx + 1), or 0 if empty
+  int _capacity, _index_mask;
+  int _next_idx, _num_hashes;
+  uint32_t _direct_dups, _flood_dups;
+
+  int homeSlot(const uint8_t* hash) const;
+  int findSlot(const uint8_t* hash) const;   // returns index slot, or -1 if not found
+  void removeSlot(int slot);
+  void insert(const uint8_t* hash);
+
+public:
+  /**
+   * \param  capacity  max number of packet hashes remembered (max 32767)
+  */
+  HashedMeshTables(int capacity = HASHED_TABLES_CAPACITY);
+
+#ifdef ESP32
+  void restoreFrom(File f) {
+    f.read(_hashes, _capacity*MAX_HASH_SIZE);
+    f.read((uint8_t *) &_next_idx, sizeof(_next_idx));
+    rebuildIndex();
+  }
+  void saveTo(File f) {
+    f.write(_hashes, _capacity*MAX_HASH_SIZE);
+    f.write((const uint8_t *) &_next_idx, sizeof(_next_idx));
+  }
+#endif
+
+  /** \brief  re-creates the index from the cyclic table (eg. after restoring from storage) */
+  void rebuildIndex();
+
+  bool hasSeen(const mesh::Packet* packet) override;
+  void clear(const mesh::Packet* packet) override;
+
+  /**
+   * \brief  same as hasSeen(packet), but with packet hash already calculated
+   * \param  hash  MAX_HASH_SIZE bytes
+  */
+  bool hasSeenHash(const uint8_t* hash, bool is_direct);
+
+  int getCapacity() const { return _capacity; }
+  int getCount() const { return _num_hashes; }
+
+  uint32_t getNumDirectDups() const { return _direct_dups; }
+  uint32_t getNumFloodDups() const { return _flood_dups; }
+
+  void resetStats() { _direct_dups = _flood_dups = 0; }
+};
@@ -0,0 +1,165 @@
+#include "HeapPacketManager.h"
+
+ScheduledPacketQueue::ScheduledPacketQueue(int max_entries) {
+  _ready = new Entry[max_entries];
+  _pending = new Entry[max_entries];
+  _size = max_entries;
+  _num_ready = _num_pending = 0;
+  _next_seq = 0;
+}
+
+bool ScheduledPacketQueue::readyBefore(const Entry& a, const Entry& b) {
+  if (a.priority != b.priority) return a.priority < b.priority;
+  return (int32_t)(a.seq - b.seq) < 0;
+}
+
+bool ScheduledPacketQueue::pendingBefore(const Entry& a, const Entry& b) {
+  return (int32_t)(a.scheduled_for - b.scheduled_for) < 0;   // handles millis() wrap-around
+}
+
+void ScheduledPacketQueue::siftUp(Entry* heap, int i, bool (*before)(const Entry&, const Entry&)) {
+  Entry e = heap[i];
+  while (i > 0) {
+    int parent = (i - 1) / 2;
+    if (!before(e, heap[parent])) break;
+    heap[i] = heap[parent];
+    i = parent;
+  }
+  heap[i] = e;
+}
+
+void ScheduledPacketQueue::siftDown(Entry* heap, int num, int i, bool (*before)(const Entry&, const Entry&)) {
+  Entry e = heap[i];
+  while (true) {
+    int child = 2*i + 1;
+    if (child >= num) break;
+    if (child + 1 < num && before(heap[child + 1], heap[child])) child++;
+    if (!before(heap[child], e)) break;
+    heap[i] = heap[child];
+    i = child;
+  }
+  heap[i] = e;
+}
+
+mesh::Packet* ScheduledPacketQueue::removeAt(Entry* heap, int& num, int i, bool (*before)(const Entry&, const Entry&)) {
+  mesh::Packet* item = heap[i].packet;
+  num--;
+  if (i < num) {
+    heap[i] = heap[num];   // fill hole with last entry, then restore heap order
+    siftDown(heap, num, i, before);
+    siftUp(heap, i, before);
+  }
+  return item;
+}
+
+void ScheduledPacketQueue::promote(uint32_t now) {
+  while (_num_pending > 0 && (int32_t)(_pending[0].scheduled_for - now) <= 0) {
+    _ready[_num_ready] = _pending[0];
+    siftUp(_ready, _num_ready++, readyBefore);
+
+    _pending[0] = _pending[--_num_pending];
+    if (_num_pending > 0) siftDown(_pending, _num_pending, 0, pendingBefore);
+  }
+}
+
+bool ScheduledPacketQueue::add(mesh::Packet* packet, uint8_t priority, uint32_t scheduled_for) {
+  if (count() == _size) {
+    return false;
+  }
+  Entry& e = _pending[_num_pending];
+  e.packet = packet;
+  e.priority = priority;
+  e.scheduled_for = scheduled_for;
+  e.seq = _next_seq++;
+  siftUp(_pending, _num_pending++, pendingBefore);   // will be promoted to ready heap when due
+  return true;
+}
+
+mesh::Packet* ScheduledPacketQueue::get(uint32_t now) {
+  promote(now);
+  if (_num_ready == 0) return NULL;   // empty, or all items are still in the future
+
+  return removeAt(_ready, _num_ready, 0, readyBefore);
+}
+
+int ScheduledPacketQueue::countBefore(uint32_t now) {
+  if (now == 0xFFFFFFFF) return count();  // sentinel: count all entries regardless of schedule
+
+  promote(now);
+  return _num_ready;
+}
+
+mesh::Packet* ScheduledPacketQueue::itemAt(int i) const {
+  if (i < _num_ready) return _ready[i].packet;
+  i -= _num_ready;
+  return i < _num_pending ? _pending[i].packet : NULL;
+}
+
+mesh::Packet* ScheduledPacketQueue::removeByIdx(int i) {
+  if (i < 0 || i >= count()) return NULL;  // invalid index
+
+  if (i < _num_ready) return removeAt(_ready, _num_ready, i, readyBefore);
+  return removeAt(_pending, _num_pending, i - _num_ready, pendingBefore);
+}
+
+HeapPacketManager::HeapPacketManager(int pool_size): send_queue(pool_size), rx_queue(pool_size) {
+  _unused = new mesh::Packet*[pool_size];
+  _pool_size = pool_size;
+  // load up our unusued Packet pool
+  for (_num_unused = 0; _num_unused < pool_size; _num_unused++) {
+    _unused[_num_unused] = new mesh::Packet();
+  }
+}
+
+mesh::Packet* HeapPacketManager::allocNew() {
+  if (_num_unused == 0) return NULL;
+  return _unused[--_num_unused];
+}
+
+void HeapPacketManager::free(mesh::Packet* packet) {
+  if (_num_unused < _pool_size) {
+    _unused[_num_unused++] = packet;
+  }
+}
+
+void HeapPacketManager::queueOutbound(mesh::Packet* packet, uint8_t priority, uint32_t scheduled_for) {
+  if (!send_queue.add(packet, priority, scheduled_for)) {
+    MESH_DEBUG_PRINTLN("queueOutbound: send queue full, dropping packet");
+    free(packet);
+  }
+}
+
+mesh::Packet* HeapPacketManager::getNextOutbound(uint32_t now) {
+  return send_queue.get(now);
+}
+
+int HeapPacketManager::getOutboundCount(uint32_t now) const {
+  if (now != 0xFFFFFFFF && !send_queue.hasDue(now)) return 0;   // fast path for the common case
+  return send_queue.countBefore(now);
+}
+
+int HeapPacketManager::getOutboundTotal() const {
+  return send_queue.count();
+}
+
+int HeapPacketManager::getFreeCount() const {
+  return _num_unused;
+}
+
+mesh::Packet* HeapPacketManager::getOutboundByIdx(int i) {
+  return send_queue.itemAt(i);
+}
+mesh::Packet* HeapPacketManager::removeOutboundByIdx(int i) {
+  return send_queue.removeByIdx(i);
+}
+
+void HeapPacketManager::queueInbound(mesh::Packet* packet, uint32_t scheduled_for) {
+  if (!rx_queue.add(packet, 0, scheduled_for)) {
+    MESH_DEBUG_PRINTLN("queueInbound: rx queue full, dropping packet");
+    free(packet);
+  }
+}
+mesh::Packet* HeapPacketManager::getNextInbound(uint32_t now) {
+  if (!rx_queue.hasDue(now)) return NULL;
+  return rx_queue.get(now);
+}
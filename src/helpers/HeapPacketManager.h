@@ -0,0 +1,72 @@
+#pragma once
+
+#include <Dispatcher.h>
+
+/**
+ * \brief  A packet queue ordered by (due-time, priority), using two binary heaps:
+ *     'pending' (keyed by scheduled_for) holds entries still in the future, and 'ready' (keyed by priority,
+ *     then insertion order) holds entries that are due. Entries migrate from pending to ready as time passes.
+ *     add() and get() are O(log n), and "anything due?" is O(1).
+*/
+class ScheduledPacketQueue {
+  struct Entry {
+    mesh::Packet* packet;
+    uint32_t scheduled_for;
+    uint32_t seq;      // insertion order, so equal priorities are FIFO (same as PacketQueue)
+    uint8_t priority;
+  };
+
+  Entry* _ready;
+  Entry* _pending;
+  int _size, _num_ready, _num_pending;
+  uint32_t _next_seq;
+
+  static bool readyBefore(const Entry& a, const Entry& b);
+  static bool pendingBefore(const Entry& a, const Entry& b);
+  static void siftUp(Entry* heap, int i, bool (*before)(const Entry&, const Entry&));
+  static void siftDown(Entry* heap, int num, int i, bool (*before)(const Entry&, const Entry&));
+  static mesh::Packet* removeAt(Entry* heap, int& num, int i, bool (*before)(const Entry&, const Entry&));
+
+public:
+  ScheduledPacketQueue(int max_entries);
+
+  /** \brief  moves all entries that have become due (at 'now') into the ready heap */
+  void promote(uint32_t now);
+
+  bool add(mesh::Packet* packet, uint8_t priority, uint32_t scheduled_for);
+  mesh::Packet* get(uint32_t now);
+  int count() const { return _num_ready + _num_pending; }
+  int countBefore(uint32_t now);
+  bool hasDue(uint32_t now) const {
+    return _num_ready > 0 || (_num_pending > 0 && (int32_t)(_pending[0].scheduled_for - now) <= 0);
+  }
+  mesh::Packet* itemAt(int i) const;   // NOTE: index order is NOT schedule order
+  mesh::Packet* removeByIdx(int i);
+};
+
+/**
+ * \brief  Alternative to StaticPoolPacketManager, for busy nodes with larger pools. Same scheduling semantics
+ *     (highest priority amongst due packets, FIFO within a priority), but O(log n) queue/dequeue, O(1) checks
+ *     for due packets, and O(1) alloc/free.
+*/
+class HeapPacketManager : public mesh::PacketManager {
+  mesh::Packet** _unused;
+  int _pool_size, _num_unused;
+  mutable ScheduledPacketQueue send_queue;   // getOutboundCount() is const, but promotes due entries
+  ScheduledPacketQueue rx_queue;
+
+public:
+  HeapPacketManager(int pool_size);
+
+  mesh::Packet* allocNew() override;
+  void free(mesh::Packet* packet) override;
+  void queueOutbound(mesh::Packet* packet, uint8_t priority, uint32_t scheduled_for) override;
+  mesh::Packet* getNextOutbound(uint32_t now) override;
+  int getOutboundCount(uint32_t now) const override;
+  int getOutboundTotal() const override;
+  int getFreeCount() const override;
+  mesh::Packet* getOutboundByIdx(int i) override;
+  mesh::Packet* removeOutboundByIdx(int i) override;
+  void queueInbound(mesh::Packet* packet, uint32_t scheduled_for) override;
+  mesh::Packet* getNextInbound(uint32_t now) override;
+};
@@ -8,6 +8,9 @@
   #define FILESYSTEM  Adafruit_LittleFS
 
   using namespace Adafruit_LittleFS_Namespace;
+#else
+  #include <FS.h>   // eg. native tests, see test/mocks/FS.h
+  #define FILESYSTEM  fs::FS
 #endif
 #include <Identity.h>
 
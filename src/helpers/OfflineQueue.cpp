@@ -0,0 +1,242 @@
+#include "OfflineQueue.h"
+
+#define EVICTABLE  0x8000   // flag in _order[]
+
+static File openFile(FILESYSTEM* fs, const char* path, char mode) {   // mode: 'r', 'u' (update in place) or 'a'
+#if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+  return fs->open(path, mode == 'r' ? FILE_O_READ : FILE_O_WRITE);   // positioned at end, if FILE_O_WRITE
+#elif defined(RP2040_PLATFORM)
+  return fs->open(path, mode == 'r' ? "r" : mode == 'u' ? "r+" : "a");
+#else
+  return fs->open(path, mode == 'r' ? "r" : mode == 'u' ? "r+" : "a", mode == 'a');
+#endif
+}
+
+OfflineQueue::OfflineQueue(const char* path, int ram_size, int spill_size, bool (*evictable)(const uint8_t frame[], int len)) {
+  _fs = NULL;
+  _path = path;
+  _evictable = evictable;
+  _ram = new Frame[ram_size];
+  _ram_size = ram_size;
+  _ram_head = _ram_len = 0;
+  _spill_size = spill_size;
+  _rec_size = (OFFLINE_QUEUE_HEADER_SIZE + MAX_FRAME_SIZE + 3) & ~3;
+  _order = spill_size > 0 ? new uint16_t[spill_size] : NULL;
+  _free = spill_size > 0 ? new uint16_t[spill_size] : NULL;
+  _order_head = _spill_len = _num_free = 0;
+  _next_seq = 1;
+  _total_spilled = _num_dropped = _num_evicted = 0;
+}
+
+bool OfflineQueue::begin(FILESYSTEM* fs) {
+  _fs = _spill_size > 0 ? fs : NULL;
+  _order_head = _spill_len = _num_free = 0;
+  _next_seq = 1;
+  if (_fs == NULL) return true;
+
+  int num_slots = 0;
+  File file = openFile(_fs, _path, 'r');
+  if (file) {
+    uint32_t size = file.size();
+    file.close();
+    if (size % _rec_size != 0) {
+      MESH_DEBUG_PRINTLN("OfflineQueue: %s has bad size, re-creating", _path);
+      _fs->remove(_path);
+    } else {
+      num_slots = size / _rec_size;
+    }
+  }
+  if (num_slots < _spill_size) {   // pre-allocate to fixed size
+    file = openFile(_fs, _path, 'a');
+    if (!file) { _fs = NULL; return false; }
+
+    uint8_t zeroes[32];
+    memset(zeroes, 0, sizeof(zeroes));
+    for (uint32_t n = (uint32_t)(_spill_size - num_slots) * _rec_size; n > 0; ) {
+      int len = n < sizeof(zeroes) ? n : sizeof(zeroes);
+      if (file.write(zeroes, len) != (size_t)len) break;
+      n -= len;
+    }
+    file.close();
+  }
+
+  // read slots, and sort used ones by seq
+  uint32_t* seqs = new uint32_t[_spill_size];
+  file = openFile(_fs, _path, 'r');
+  for (int slot = _spill_size - 1; slot >= 0; slot--) {   // (backwards, so that free stack has lowest slot on top)
+    Frame f;
+    uint8_t hdr[OFFLINE_QUEUE_HEADER_SIZE];
+    f.len = 0;
+    if (file && slot < num_slots && file.seek(slot * _rec_size) && file.read(hdr, sizeof(hdr)) == sizeof(hdr)) {
+      f.len = hdr[4];
+      if (f.len > MAX_FRAME_SIZE || file.read(f.buf, f.len) != f.len) f.len = 0;   // junk
+    }
+    if (f.len == 0) {
+      _free[_num_free++] = slot;
+      continue;
+    }
+    memcpy(&seqs[slot], hdr, 4);
+    if (seqs[slot] >= _next_seq) _next_seq = seqs[slot] + 1;
+
+    int i = _spill_len++;
+    while (i > 0 && seqs[_order[i - 1] & ~EVICTABLE] > seqs[slot]) {
+      _order[i] = _order[i - 1];
+      i--;
+    }
+    _order[i] = slot | (_evictable && _evictable(f.buf, f.len) ? EVICTABLE : 0);
+  }
+  if (file) file.close();
+  delete[] seqs;
+
+  if (_spill_len > 0) {
+    MESH_DEBUG_PRINTLN("OfflineQueue: %d frames restored from %s", _spill_len, _path);
+  }
+  return true;
+}
+
+void OfflineQueue::appendRam(const uint8_t frame[], int len) {
+  Frame* f = &_ram[(_ram_head + _ram_len) % _ram_size];
+  f->len = len;
+  memcpy(f->buf, frame, len);
+  _ram_len++;
+}
+
+bool OfflineQueue::evictFromRam() {
+  if (_evictable == NULL) return false;
+
+  for (int i = 0; i < _ram_len; i++) {
+    Frame* f = &_ram[(_ram_head + i) % _ram_size];
+    if (_evictable(f->buf, f->len)) {
+      for (int j = i; j > 0; j--) {   // close the gap, by moving the older ones up
+        _ram[(_ram_head + j) % _ram_size] = _ram[(_ram_head + j - 1) % _ram_size];
+      }
+      _ram_head = (_ram_head + 1) % _ram_size;
+      _ram_len--;
+      _num_evicted++;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool OfflineQueue::evictFromSpill() {
+  for (int i = 0; i < _spill_len; i++) {
+    if (orderAt(i) & EVICTABLE) {
+      int slot = orderAt(i) & ~EVICTABLE;
+      File file = openFile(_fs, _path, 'u');
+      if (!file) return false;
+
+      uint8_t hdr[OFFLINE_QUEUE_HEADER_SIZE];
+      memset(hdr, 0, sizeof(hdr));   // mark slot as free
+      bool success = file.seek(slot * _rec_size) && file.write(hdr, sizeof(hdr)) == sizeof(hdr);
+      file.close();
+      if (!success) return false;
+
+      for (int j = i; j > 0; j--) {   // close the gap
+        orderAt(j) = orderAt(j - 1);
+      }
+      _order_head = (_order_head + 1) % _spill_size;
+      _spill_len--;
+      _free[_num_free++] = slot;
+      _num_evicted++;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool OfflineQueue::appendSpill(const uint8_t frame[], int len) {
+  if (_fs == NULL || _num_free == 0) return false;
+
+  File file = openFile(_fs, _path, 'u');
+  if (!file) return false;
+
+  int slot = _free[_num_free - 1];
+  uint8_t rec[OFFLINE_QUEUE_HEADER_SIZE + MAX_FRAME_SIZE];
+  memcpy(rec, &_next_seq, 4);
+  rec[4] = len;
+  memcpy(&rec[OFFLINE_QUEUE_HEADER_SIZE], frame, len);
+  int n = OFFLINE_QUEUE_HEADER_SIZE + len;
+  bool success = file.seek(slot * _rec_size) && file.write(rec, n) == (size_t)n;
+  file.close();
+
+  if (success) {
+    _num_free--;
+    orderAt(_spill_len++) = slot | (_evictable && _evictable(frame, len) ? EVICTABLE : 0);
+    _next_seq++;
+    _total_spilled++;
+  }
+  return success;
+}
+
+int OfflineQueue::refillFromSpill(int max_frames) {
+  if (_spill_len == 0) return 0;
+
+  File file = openFile(_fs, _path, 'u');
+  if (!file) return 0;
+
+  int moved = 0;
+  uint8_t hdr[OFFLINE_QUEUE_HEADER_SIZE];
+  while (moved < max_frames && _spill_len > 0 && _ram_len < _ram_size) {
+    int slot = _order[_order_head] & ~EVICTABLE;
+    Frame* f = &_ram[(_ram_head + _ram_len) % _ram_size];
+    f->len = 0;
+    if (file.seek(slot * _rec_size) && file.read(hdr, sizeof(hdr)) == sizeof(hdr)) {
+      f->len = hdr[4];
+    }
+    if (f->len > 0 && f->len <= MAX_FRAME_SIZE && file.read(f->buf, f->len) == f->len) {
+      _ram_len++;
+    } else {
+      _num_dropped++;   // read error
+    }
+    moved++;
+
+    memset(hdr, 0, sizeof(hdr));   // mark slot as free
+    file.seek(slot * _rec_size);
+    file.write(hdr, sizeof(hdr));
+
+    _order_head = (_order_head + 1) % _spill_size;
+    _spill_len--;
+    _free[_num_free++] = slot;
+  }
+  file.close();
+  return moved;
+}
+
+bool OfflineQueue::push(const uint8_t frame[], int len) {
+  if (len <= 0 || len > MAX_FRAME_SIZE) return false;
+
+  if (_spill_len == 0 && _ram_len < _ram_size) {   // nothing spilled, so can still go in RAM
+    appendRam(frame, len);
+    return true;
+  }
+  if (appendSpill(frame, len)) return true;
+
+  MESH_DEBUG_PRINTLN("WARN: offline queue is full!");
+  if (evictFromRam()) {
+    if (_spill_len > 0) refillFromSpill(1);   // oldest spilled frame moves into gap, to make room at end
+    if (_spill_len == 0 && _ram_len < _ram_size) {
+      appendRam(frame, len);
+      return true;
+    }
+    if (appendSpill(frame, len)) return true;
+  } else if (_fs && evictFromSpill() && appendSpill(frame, len)) {
+    return true;
+  }
+  _num_dropped++;
+  return false;
+}
+
+int OfflineQueue::pop(uint8_t frame[]) {
+  if (_ram_len == 0 && _spill_len > 0) {
+    int n = _ram_size < OFFLINE_QUEUE_SPILL_BATCH ? _ram_size : OFFLINE_QUEUE_SPILL_BATCH;
+    while (_ram_len == 0 && refillFromSpill(n) > 0) { }   // (skipping any that can't be read)
+  }
+  if (_ram_len == 0) return 0;   // empty
+
+  Frame* f = &_ram[_ram_head];
+  memcpy(frame, f->buf, f->len);
+  _ram_head = (_ram_head + 1) % _ram_size;
+  _ram_len--;
+  return f->len;
+}
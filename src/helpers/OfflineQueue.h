@@ -0,0 +1,70 @@
+#pragma once
+
+#include <helpers/IdentityStore.h>   // for FILESYSTEM
+#include <helpers/BaseSerialInterface.h>   // for MAX_FRAME_SIZE
+
+#define OFFLINE_QUEUE_HEADER_SIZE  5   // seq, len
+
+#ifndef OFFLINE_QUEUE_SPILL_BATCH
+  #define OFFLINE_QUEUE_SPILL_BATCH  4   // frames moved from flash to RAM at a time
+#endif
+
+/**
+ * \brief  FIFO of frames waiting for the app (eg. received messages), with the oldest frames in a small RAM window
+ *     and any overflow spilled to fixed size slots in a single (pre-allocated) file. Once anything is spilled, new
+ *     frames also go to the file, so that order is kept, and frames are moved back to RAM in batches as the app
+ *     drains the queue. Spilled frames survive a reboot (the RAM window doesn't, as before).
+ *     Each slot is: seq(4), len(1), frame(MAX_FRAME_SIZE), padded to a multiple of 4 bytes. A zero len marks a free slot.
+ *     The order of spilled frames is kept in RAM (restored from the seqs at boot), ~4 bytes per slot.
+ *     When completely full, the oldest 'evictable' frame (RAM or file) is dropped to make room, or failing that,
+ *     the new frame is dropped.
+*/
+class OfflineQueue {
+  struct Frame {
+    uint8_t len;
+    uint8_t buf[MAX_FRAME_SIZE];
+  };
+
+  FILESYSTEM* _fs;
+  const char* _path;
+  bool (*_evictable)(const uint8_t frame[], int len);
+  Frame* _ram;
+  int _ram_size, _ram_head, _ram_len;
+  int _spill_size, _rec_size;
+  uint16_t* _order;   // spilled frames, oldest first: slot | EVICTABLE flag
+  uint16_t* _free;    // stack of free slots
+  int _order_head, _spill_len, _num_free;
+  uint32_t _next_seq;
+  uint32_t _total_spilled, _num_dropped, _num_evicted;
+
+  uint16_t& orderAt(int i) { return _order[(_order_head + i) % _spill_size]; }
+  void appendRam(const uint8_t frame[], int len);
+  bool evictFromRam();
+  bool evictFromSpill();
+  bool appendSpill(const uint8_t frame[], int len);
+  int refillFromSpill(int max_frames);
+
+public:
+  /**
+   * \param  ram_size  frames in RAM window
+   * \param  spill_size  slots in file. Zero to disable spilling.
+   * \param  evictable  which frames can be dropped when full (eg. channel messages)
+  */
+  OfflineQueue(const char* path, int ram_size, int spill_size, bool (*evictable)(const uint8_t frame[], int len));
+
+  /** \brief  loads any frames spilled before reboot. 'fs' can be NULL (no spilling) */
+  bool begin(FILESYSTEM* fs);
+
+  /** \returns  false if frame was dropped */
+  bool push(const uint8_t frame[], int len);
+
+  /** \returns  length of oldest frame (which is removed), or zero if empty */
+  int pop(uint8_t frame[]);
+
+  int count() const { return _ram_len + _spill_len; }
+  int getNumSpilled() const { return _spill_len; }    // frames currently in file
+  int getSpillSize() const { return _fs ? _spill_size : 0; }
+  uint32_t getTotalSpilled() const { return _total_spilled; }
+  uint32_t getNumDropped() const { return _num_dropped; }
+  uint32_t getNumEvicted() const { return _num_evicted; }
+};
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifndef MAX_PEER_CANDIDATES
+  #define MAX_PEER_CANDIDATES  8
+#endif
+
+/**
+ * \brief  Helper for Mesh::searchPeersByHash() implementations. Collects the indexes of peers matching the (1-byte)
+ *     src hash, most recently heard from first. Mesh tries them in that order and stops at the first MAC match,
+ *     so the likely sender is usually the only one whose shared secret (and HMAC) is needed.
+ *     If there are more matches than fit, the least recently heard are dropped. Without a 'last_heard' buffer,
+ *     at most MAX_PEER_CANDIDATES are kept.
+*/
+class PeerCandidates {
+  int* _dest;
+  uint32_t* _last_heard;
+  uint32_t _own_last_heard[MAX_PEER_CANDIDATES];
+  int _max_num, _num;
+
+public:
+  /**
+   * \param  dest   where to store the peer indexes (eg. matching_peer_indexes)
+   * \param  max_num   size of 'dest'
+  */
+  PeerCandidates(int dest[], int max_num) {
+    _dest = dest;
+    _last_heard = _own_last_heard;
+    _max_num = max_num < MAX_PEER_CANDIDATES ? max_num : MAX_PEER_CANDIDATES;
+    _num = 0;
+  }
+
+  /**
+   * \param  last_heard   scratch space, for when more than MAX_PEER_CANDIDATES are wanted
+   * \param  max_num   size of 'dest' and 'last_heard'
+  */
+  PeerCandidates(int dest[], uint32_t last_heard[], int max_num) {
+    _dest = dest;
+    _last_heard = last_heard;
+    _max_num = max_num;
+    _num = 0;
+  }
+
+  /**
+   * \param  last_heard   when we last heard from this peer, by any (wrap-free) clock. Ties keep table order.
+  */
+  void add(int peer_idx, uint32_t last_heard) {
+    int j = _num < _max_num ? _num++ : _num;   // when full, least recent drops off the end
+    while (j > 0 && _last_heard[j-1] < last_heard) {
+      if (j < _max_num) {
+        _dest[j] = _dest[j-1];
+        _last_heard[j] = _last_heard[j-1];
+      }
+      j--;
+    }
+    if (j < _max_num) {
+      _dest[j] = peer_idx;
+      _last_heard[j] = last_heard;
+    }
+  }
+
+  int count() const { return _num; }
+};
@@ -0,0 +1,47 @@
+#include "PostBatch.h"
+#include "TxtDataHelpers.h"
+#include <string.h>
+
+PostBatchWriter::PostBatchWriter(uint8_t* buf, int max_len, uint8_t attempt) {
+  _buf = buf;
+  _max_len = max_len > POST_BATCH_MAX_LEN ? POST_BATCH_MAX_LEN : max_len;
+  _count = 0;
+  _first = _last = 0;
+  memset(_buf, 0, 4);
+  _buf[4] = (TXT_TYPE_SIGNED_BATCH << 2) | (attempt & 3);
+  _len = POST_BATCH_HEADER_SIZE;
+}
+
+bool PostBatchWriter::add(uint32_t post_timestamp, const uint8_t* author_prefix, const char* text) {
+  int text_len = strlen(text);
+  if (text_len > 255 || _len + entrySize(text_len) > _max_len) return false;
+
+  memcpy(&_buf[_len], &post_timestamp, 4);
+  memcpy(&_buf[_len + 4], author_prefix, 4);
+  _buf[_len + 8] = text_len;
+  memcpy(&_buf[_len + POST_BATCH_ENTRY_SIZE], text, text_len);
+  _len += entrySize(text_len);
+
+  if (_count++ == 0) _first = post_timestamp;
+  _last = post_timestamp;
+  return true;
+}
+
+int PostBatchWriter::finish() {
+  memcpy(_buf, &_last, 4);   // so that receiver's 'sync since' can be updated, as with a single post
+  return _len;
+}
+
+bool PostBatchReader::next(uint32_t& post_timestamp, const uint8_t*& author_prefix, char* text) {
+  if (_pos + POST_BATCH_ENTRY_SIZE > _len) return false;
+
+  memcpy(&post_timestamp, &_data[_pos], 4);
+  int text_len = _data[_pos + 8];
+  if (post_timestamp == 0 || _pos + POST_BATCH_ENTRY_SIZE + text_len > _len) return false;   // padding (or junk)
+
+  author_prefix = &_data[_pos + 4];
+  memcpy(text, &_data[_pos + POST_BATCH_ENTRY_SIZE], text_len);
+  text[text_len] = 0;
+  _pos += POST_BATCH_ENTRY_SIZE + text_len;
+  return true;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <MeshCore.h>
+#include <stdint.h>
+
+#define POST_BATCH_HEADER_SIZE   5    // timestamp (of newest post), flags
+#define POST_BATCH_ENTRY_SIZE    9    // timestamp, author prefix(4), text len.  Then the text (no null terminator)
+#define POST_BATCH_MAX_LEN       (MAX_PACKET_PAYLOAD - CIPHER_MAC_SIZE - (CIPHER_BLOCK_SIZE-1))   // as per Mesh::createDatagram()
+
+#define LOGIN_FEATURE_POST_BATCH  0x01   // in room login, client can receive TXT_TYPE_SIGNED_BATCH
+
+/**
+ * \brief  Packs several short posts into one TXT_MSG datagram (TXT_TYPE_SIGNED_BATCH), eg. for a room server client
+ *     that is catching up. The whole batch is ACK'd once, with the same hash as for TXT_TYPE_SIGNED_PLAIN, but over
+ *     the batch's data.
+*/
+class PostBatchWriter {
+  uint8_t* _buf;
+  int _len, _max_len, _count;
+  uint32_t _first, _last;
+
+public:
+  /** \param  buf   must be at least 'max_len' bytes */
+  PostBatchWriter(uint8_t* buf, int max_len, uint8_t attempt);
+
+  /** \returns  false if post won't fit */
+  bool add(uint32_t post_timestamp, const uint8_t* author_prefix, const char* text);
+
+  /** \returns  total length of batch data */
+  int finish();
+
+  int getCount() const { return _count; }
+  uint32_t getFirstTimestamp() const { return _first; }
+  uint32_t getLastTimestamp() const { return _last; }
+
+  /** \returns  bytes needed to add a post with given text length */
+  static int entrySize(int text_len) { return POST_BATCH_ENTRY_SIZE + text_len; }
+};
+
+/**
+ * \brief  Reads the posts of a TXT_TYPE_SIGNED_BATCH datagram. Decrypted data can have trailing (zero) padding,
+ *     which is where the posts end.
+*/
+class PostBatchReader {
+  const uint8_t* _data;
+  int _len, _pos;
+
+public:
+  PostBatchReader(const uint8_t* data, int len) : _data(data), _len(len), _pos(POST_BATCH_HEADER_SIZE) { }
+
+  /**
+   * \param  text  is null terminated, must be at least 256 bytes
+   * \returns  false if no more posts
+  */
+  bool next(uint32_t& post_timestamp, const uint8_t*& author_prefix, char* text);
+
+  /** \returns  length of batch data so far (ie. without the padding, once next() has returned false) */
+  int getEnd() const { return _pos; }
+};
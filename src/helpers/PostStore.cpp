@@ -0,0 +1,249 @@
+#include "PostStore.h"
+
+static File openFile(FILESYSTEM* fs, const char* path, char mode) {   // mode: 'r', 'u' (update in place) or 'a'
+#if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+  return fs->open(path, mode == 'r' ? FILE_O_READ : FILE_O_WRITE);   // positioned at end, if FILE_O_WRITE
+#elif defined(RP2040_PLATFORM)
+  return fs->open(path, mode == 'r' ? "r" : mode == 'u' ? "r+" : "a");
+#else
+  return fs->open(path, mode == 'r' ? "r" : mode == 'u' ? "r+" : "a", mode == 'a');
+#endif
+}
+
+static uint32_t calcCheck(const uint8_t* data, int len) {   // FNV-1a
+  uint32_t hash = 2166136261UL;
+  for (int i = 0; i < len; i++) {
+    hash = (hash ^ data[i]) * 16777619UL;
+  }
+  return hash;
+}
+
+static uint32_t prefixOf(const uint8_t* pub_key) {
+  uint32_t prefix;
+  memcpy(&prefix, pub_key, 4);
+  return prefix;
+}
+
+PostStore::PostStore(const char* path, int max_posts, int cache_size) {
+  _fs = NULL;
+  _path = path;
+  _max_posts = max_posts > cache_size ? max_posts : cache_size;
+  _index = new IndexEntry[_max_posts];
+  _free = new uint16_t[_max_posts];
+  _cache = new StoredPost[cache_size];
+  _cache_size = cache_size;
+  _num_flash_reads = _num_cache_hits = 0;
+  resetIndex(cache_size);
+}
+
+void PostStore::resetIndex(int capacity) {
+  _capacity = capacity;
+  _head = _num = 0;
+  _num_free = 0;
+  for (int slot = capacity - 1; slot >= 0; slot--) {   // (backwards, so that free stack has lowest slot on top)
+    _free[_num_free++] = slot;
+  }
+  memset(_cache, 0, sizeof(StoredPost) * _cache_size);
+  _cache_next = 0;
+}
+
+bool PostStore::begin(FILESYSTEM* fs) {
+  _fs = fs;
+  resetIndex(_cache_size);
+  if (_fs == NULL) return true;   // RAM only
+
+  int num_slots = 0;
+  File file = openFile(_fs, _path, 'r');
+  if (file) {
+    uint32_t size = file.size();
+    file.close();
+    if (size % POST_STORE_REC_SIZE != 0 || size / POST_STORE_REC_SIZE > (uint32_t)_max_posts) {
+      MESH_DEBUG_PRINTLN("PostStore: %s has bad size, re-creating", _path);
+      _fs->remove(_path);
+    } else {
+      num_slots = size / POST_STORE_REC_SIZE;
+    }
+  }
+  if (num_slots < _max_posts) {   // pre-allocate to fixed size
+    file = openFile(_fs, _path, 'a');
+    if (!file) { _fs = NULL; return false; }
+
+    uint8_t zeroes[32];
+    memset(zeroes, 0, sizeof(zeroes));
+    for (uint32_t n = (uint32_t)(_max_posts - num_slots) * POST_STORE_REC_SIZE; n > 0; ) {
+      int len = n < sizeof(zeroes) ? n : sizeof(zeroes);
+      if (file.write(zeroes, len) != (size_t)len) break;
+      n -= len;
+    }
+    file.close();
+  }
+
+  // read slots, and sort used ones by timestamp
+  _capacity = _max_posts;
+  _num_free = 0;
+  uint8_t rec[POST_STORE_REC_SIZE];
+  file = openFile(_fs, _path, 'r');
+  for (int slot = _max_posts - 1; slot >= 0; slot--) {
+    uint32_t ts = 0, check;
+    if (file && slot < num_slots && file.seek(slot * POST_STORE_REC_SIZE) && file.read(rec, POST_STORE_REC_SIZE) == (size_t)POST_STORE_REC_SIZE) {
+      int len = POST_STORE_HEADER_SIZE + rec[POST_STORE_HEADER_SIZE - 1];
+      memcpy(&check, &rec[POST_STORE_REC_SIZE - 4], 4);
+      if (len <= POST_STORE_HEADER_SIZE + POST_STORE_MAX_TEXT && check == calcCheck(rec, len)) memcpy(&ts, rec, 4);   // otherwise, free or torn
+    }
+    if (ts == 0) {
+      _free[_num_free++] = slot;
+      continue;
+    }
+    int i = _num++;
+    while (i > 0 && _index[i - 1].post_timestamp > ts) {
+      _index[i] = _index[i - 1];
+      i--;
+    }
+    _index[i].post_timestamp = ts;
+    _index[i].author_prefix = prefixOf(&rec[4]);
+    _index[i].slot = slot;
+  }
+  if (file) file.close();
+
+  for (int i = 1; i < _num; i++) {   // shouldn't happen (timestamps are kept unique), but free any dups
+    if (_index[i].post_timestamp == _index[i - 1].post_timestamp) {
+      _free[_num_free++] = _index[i - 1].slot;
+      memmove(&_index[i - 1], &_index[i], (_num - i) * sizeof(IndexEntry));
+      _num--;
+      i--;
+    }
+  }
+
+  if (_num > 0) {
+    MESH_DEBUG_PRINTLN("PostStore: %d posts restored from %s", _num, _path);
+  }
+  return true;
+}
+
+int PostStore::findFirstAfter(uint32_t since) const {
+  int lo = 0, hi = _num;   // binary search, index is sorted by timestamp
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    if (at(mid).post_timestamp > since) {
+      hi = mid;
+    } else {
+      lo = mid + 1;
+    }
+  }
+  return lo;
+}
+
+const StoredPost* PostStore::loadAt(int i) {
+  const IndexEntry& e = at(i);
+  if (_fs == NULL) return &_cache[e.slot];
+
+  for (int k = 0; k < _cache_size; k++) {
+    if (_cache[k].post_timestamp == e.post_timestamp) {
+      _num_cache_hits++;
+      return &_cache[k];
+    }
+  }
+
+  File file = openFile(_fs, _path, 'r');
+  if (!file) return NULL;
+
+  uint8_t rec[POST_STORE_REC_SIZE];
+  bool success = file.seek(e.slot * POST_STORE_REC_SIZE) && file.read(rec, POST_STORE_REC_SIZE) == (size_t)POST_STORE_REC_SIZE;
+  file.close();
+  _num_flash_reads++;
+  if (!success) return NULL;
+
+  int len = rec[POST_STORE_HEADER_SIZE - 1];
+  uint32_t ts, check;
+  memcpy(&ts, rec, 4);
+  memcpy(&check, &rec[POST_STORE_REC_SIZE - 4], 4);
+  if (len > POST_STORE_MAX_TEXT || check != calcCheck(rec, POST_STORE_HEADER_SIZE + len) || ts != e.post_timestamp) {
+    MESH_DEBUG_PRINTLN("PostStore: slot %d is corrupt", (int) e.slot);
+    return NULL;
+  }
+
+  _scratch.post_timestamp = ts;
+  memcpy(_scratch.author, &rec[4], PUB_KEY_SIZE);
+  memcpy(_scratch.text, &rec[POST_STORE_HEADER_SIZE], len);
+  _scratch.text[len] = 0;
+  return &_scratch;
+}
+
+bool PostStore::isAuthor(int i, const uint8_t* pub_key) {
+  if (pub_key == NULL || at(i).author_prefix != prefixOf(pub_key)) return false;
+
+  const StoredPost* p = loadAt(i);   // confirm with full key
+  return p && memcmp(p->author, pub_key, PUB_KEY_SIZE) == 0;
+}
+
+uint32_t PostStore::addPost(const uint8_t* author, uint32_t post_timestamp, const char* text) {
+  if (_num > 0 && post_timestamp <= getNewestTimestamp()) {
+    post_timestamp = getNewestTimestamp() + 1;   // keep index sorted
+  }
+
+  int slot;
+  if (_num_free > 0) {
+    slot = _free[--_num_free];
+  } else {   // full, so re-use oldest slot
+    slot = at(0).slot;
+    _head = (_head + 1) % _capacity;
+    _num--;
+  }
+
+  StoredPost* p = _fs ? &_cache[_cache_next] : &_cache[slot];
+  if (_fs) _cache_next = (_cache_next + 1) % _cache_size;
+  memcpy(p->author, author, PUB_KEY_SIZE);
+  p->post_timestamp = post_timestamp;
+  strncpy(p->text, text, POST_STORE_MAX_TEXT);
+  p->text[POST_STORE_MAX_TEXT] = 0;   // truncates if needed
+
+  if (_fs) {
+    uint8_t rec[POST_STORE_REC_SIZE];
+    int text_len = strlen(p->text);
+    memset(rec, 0, POST_STORE_REC_SIZE);
+    memcpy(rec, &post_timestamp, 4);
+    memcpy(&rec[4], author, PUB_KEY_SIZE);
+    rec[POST_STORE_HEADER_SIZE - 1] = text_len;
+    memcpy(&rec[POST_STORE_HEADER_SIZE], p->text, text_len);
+    uint32_t check = calcCheck(rec, POST_STORE_HEADER_SIZE + text_len);
+    memcpy(&rec[POST_STORE_REC_SIZE - 4], &check, 4);
+
+    File file = openFile(_fs, _path, 'u');
+    bool success = file && file.seek(slot * POST_STORE_REC_SIZE) && file.write(rec, POST_STORE_REC_SIZE) == (size_t)POST_STORE_REC_SIZE;
+    if (file) file.close();
+    if (!success) {
+      MESH_DEBUG_PRINTLN("PostStore: write failed, slot %d", slot);
+      p->post_timestamp = 0;   // drop from cache
+      _free[_num_free++] = slot;   // (may be torn, but its check value won't match)
+      return 0;
+    }
+  }
+
+  IndexEntry& e = at(_num++);
+  e.post_timestamp = post_timestamp;
+  e.author_prefix = prefixOf(author);
+  e.slot = slot;
+  return post_timestamp;
+}
+
+uint32_t PostStore::getNextTimestamp(uint32_t since, const uint8_t* not_author) {
+  for (int i = findFirstAfter(since); i < _num; i++) {
+    if (!isAuthor(i, not_author)) return at(i).post_timestamp;
+  }
+  return 0;
+}
+
+int PostStore::countSince(uint32_t since, const uint8_t* not_author) {
+  uint32_t prefix = not_author ? prefixOf(not_author) : 0;
+  int n = 0;
+  for (int i = findFirstAfter(since); i < _num; i++) {
+    if (not_author == NULL || at(i).author_prefix != prefix) n++;   // (RAM only, no need to confirm author)
+  }
+  return n;
+}
+
+const StoredPost* PostStore::getPost(uint32_t post_timestamp) {
+  int i = findFirstAfter(post_timestamp - 1);
+  if (i >= _num || at(i).post_timestamp != post_timestamp) return NULL;
+  return loadAt(i);
+}
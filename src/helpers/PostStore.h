@@ -0,0 +1,84 @@
+#pragma once
+
+#include <Identity.h>
+#include <helpers/IdentityStore.h>   // for FILESYSTEM
+
+#ifndef POST_STORE_MAX_TEXT
+  #define POST_STORE_MAX_TEXT   (160-9)
+#endif
+
+#define POST_STORE_HEADER_SIZE  (4 + PUB_KEY_SIZE + 1)   // timestamp, author, text len
+#define POST_STORE_REC_SIZE     ((POST_STORE_HEADER_SIZE + POST_STORE_MAX_TEXT + 4 + 3) & ~3)   // + check, padded
+
+struct StoredPost {
+  uint8_t author[PUB_KEY_SIZE];
+  uint32_t post_timestamp;   // by OUR clock
+  char text[POST_STORE_MAX_TEXT+1];
+};
+
+/**
+ * \brief  Post history for a room server, in a (pre-allocated) file of fixed size slots, each written once when the
+ *     post is added (the oldest post's slot is re-used when full). Post timestamps are kept strictly increasing, so
+ *     a RAM index of (timestamp, author prefix, slot), oldest first, finds the next post after a given timestamp
+ *     with a binary search. The most recent posts are also cached in RAM, as all clients will want those.
+ *     Each slot is: timestamp(4), author(32), len(1), text, check(4), padded to a multiple of 4 bytes.
+ *     RAM cost is ~12 bytes per post, plus the cache. Without a filesystem, the cache is the whole store.
+*/
+class PostStore {
+  struct IndexEntry {
+    uint32_t post_timestamp;
+    uint32_t author_prefix;
+    uint16_t slot;
+  };
+
+  FILESYSTEM* _fs;
+  const char* _path;
+  int _max_posts, _capacity;
+  IndexEntry* _index;   // ring, oldest first
+  int _head, _num;
+  uint16_t* _free;      // stack of free slots
+  int _num_free;
+  StoredPost* _cache;   // most recent posts (or slots, if no filesystem)
+  int _cache_size, _cache_next;
+  StoredPost _scratch;
+  uint32_t _num_flash_reads, _num_cache_hits;
+
+  IndexEntry& at(int i) const { return _index[(_head + i) % _capacity]; }
+  int findFirstAfter(uint32_t since) const;
+  bool isAuthor(int i, const uint8_t* pub_key);
+  const StoredPost* loadAt(int i);
+  void resetIndex(int capacity);
+
+public:
+  /**
+   * \param  max_posts  slots in file
+   * \param  cache_size  most recent posts kept in RAM (and max posts, if no filesystem)
+  */
+  PostStore(const char* path, int max_posts, int cache_size);
+
+  /** \brief  loads the index of posts from before reboot. 'fs' can be NULL (RAM only) */
+  bool begin(FILESYSTEM* fs);
+
+  /**
+   * \brief  adds a post, replacing the oldest if full
+   * \returns  the post's timestamp, which is bumped if not newer than the newest post (eg. RTC was reset),
+   *      or zero if it couldn't be written (then it isn't added)
+  */
+  uint32_t addPost(const uint8_t* author, uint32_t post_timestamp, const char* text);
+
+  /** \returns  timestamp of oldest post newer than 'since', and not by 'not_author' (can be NULL). Zero if none */
+  uint32_t getNextTimestamp(uint32_t since, const uint8_t* not_author);
+
+  /** \returns  number of posts newer than 'since', and not by 'not_author' (by pub_key prefix only, so is a hint) */
+  int countSince(uint32_t since, const uint8_t* not_author);
+
+  /** \returns  the post, or NULL if not (or no longer) stored. Only valid until next call */
+  const StoredPost* getPost(uint32_t post_timestamp);
+
+  int count() const { return _num; }
+  int getCapacity() const { return _capacity; }
+  bool isPersistent() const { return _fs != NULL; }
+  uint32_t getNewestTimestamp() const { return _num > 0 ? at(_num - 1).post_timestamp : 0; }
+  uint32_t getNumFlashReads() const { return _num_flash_reads; }
+  uint32_t getNumCacheHits() const { return _num_cache_hits; }
+};
@@ -0,0 +1,174 @@
+#include "PostSyncWindow.h"
+#include <string.h>
+
+#define SLOT_SENT    1
+#define SLOT_LOST    2   // timed out, needs re-send
+#define SLOT_ACKED   3
+
+static bool timeHasPassed(uint32_t now, uint32_t t) {   // (millis can wrap around)
+  return (int32_t)(now - t) >= 0;
+}
+
+void PostSyncWindow::reset(uint32_t since, uint32_t now) {
+  if (numInFlight() > 0) busy_millis += now - busy_since;
+  memset(slots, 0, sizeof(slots));
+  cursor = since;
+  next_push_at = now;
+  cwnd = acks_in_cwnd = backoff = 0;
+}
+
+int PostSyncWindow::numInFlight() const {
+  int n = 0;
+  for (int i = 0; i < SYNC_WINDOW_MAX; i++) {
+    if (slots[i].post_timestamp) n++;
+  }
+  return n;
+}
+
+bool PostSyncWindow::canPush(uint32_t now) const {
+  if (!timeHasPassed(now, next_push_at)) return false;
+
+  int n_sent = 0;
+  bool room = false;
+  for (int i = 0; i < SYNC_WINDOW_MAX; i++) {
+    if (slots[i].post_timestamp == 0 || slots[i].state == SLOT_LOST) room = true;
+    if (slots[i].post_timestamp && slots[i].state == SLOT_SENT) n_sent++;
+  }
+  return room && n_sent < getWindow();
+}
+
+uint32_t PostSyncWindow::getResendTimestamp(uint32_t* first_timestamp) const {
+  const Slot* oldest = NULL;
+  for (int i = 0; i < SYNC_WINDOW_MAX; i++) {
+    const Slot& s = slots[i];
+    if (s.post_timestamp && s.state == SLOT_LOST && (oldest == NULL || s.post_timestamp < oldest->post_timestamp)) oldest = &s;
+  }
+  if (first_timestamp) *first_timestamp = oldest ? oldest->first_timestamp : 0;
+  return oldest ? oldest->post_timestamp : 0;
+}
+
+uint32_t PostSyncWindow::calcTimeout(uint32_t fallback) const {
+  uint32_t t = fallback;
+  if (srtt) {
+    t = srtt + 4*(uint32_t)rttvar;
+    if (t < SYNC_RTO_MIN) t = SYNC_RTO_MIN;
+  }
+  t <<= backoff;
+  return t > SYNC_RTO_MAX ? SYNC_RTO_MAX : t;
+}
+
+void PostSyncWindow::onPushed(uint32_t post_timestamp, uint32_t ack_crc, uint32_t now, uint32_t timeout, uint32_t gap,
+                              uint32_t first_timestamp, uint8_t num_posts) {
+  Slot* s = NULL;
+  for (int i = 0; i < SYNC_WINDOW_MAX && s == NULL; i++) {
+    if (slots[i].post_timestamp == post_timestamp) s = &slots[i];   // is a re-send
+  }
+  if (s) {
+    s->prev_ack_crc = s->ack_crc;
+    s->attempts++;
+  } else {
+    for (int i = 0; i < SYNC_WINDOW_MAX && s == NULL; i++) {
+      if (slots[i].post_timestamp == 0) s = &slots[i];
+    }
+    if (s == NULL) return;   // window full (caller should have checked canPush())
+
+    if (numInFlight() == 0) busy_since = now;
+    s->post_timestamp = post_timestamp;
+    s->prev_ack_crc = 0;
+    s->attempts = 1;
+    if (post_timestamp > cursor) cursor = post_timestamp;
+  }
+  if (s->attempts == 1) {   // (a re-sent batch keeps its original range)
+    s->first_timestamp = (first_timestamp && first_timestamp < post_timestamp) ? first_timestamp : post_timestamp;
+  }
+  s->num_posts = num_posts ? num_posts : 1;
+  s->ack_crc = ack_crc;
+  s->sent_at = now;
+  s->timeout_at = now + calcTimeout(timeout);
+  s->state = SLOT_SENT;
+
+  next_push_at = now + (srtt ? srtt / getWindow() : gap);
+}
+
+uint32_t PostSyncWindow::advance(uint32_t now) {
+  // free leading run of ACK'd posts (oldest first)
+  uint32_t acked_through = 0;
+  for (;;) {
+    Slot* oldest = NULL;
+    for (int i = 0; i < SYNC_WINDOW_MAX; i++) {
+      if (slots[i].post_timestamp && (oldest == NULL || slots[i].post_timestamp < oldest->post_timestamp)) oldest = &slots[i];
+    }
+    if (oldest == NULL || oldest->state != SLOT_ACKED) break;
+
+    acked_through = oldest->post_timestamp;
+    oldest->post_timestamp = 0;
+  }
+  if (acked_through && numInFlight() == 0) busy_millis += now - busy_since;
+  return acked_through;
+}
+
+bool PostSyncWindow::onAck(uint32_t ack_crc, uint32_t now, uint32_t& acked_through) {
+  acked_through = 0;
+  for (int i = 0; i < SYNC_WINDOW_MAX; i++) {
+    Slot& s = slots[i];
+    if (s.post_timestamp == 0 || s.state == SLOT_ACKED) continue;
+    if (s.ack_crc != ack_crc && (s.prev_ack_crc == 0 || s.prev_ack_crc != ack_crc)) continue;
+
+    if (s.attempts == 1) {   // only measure RTT when there's no doubt which attempt the ACK is for
+      int32_t r = now - s.sent_at;
+      if (r > 0xFFFF) r = 0xFFFF;
+      if (srtt == 0) {
+        srtt = r;
+        rttvar = r / 2;
+      } else {
+        int32_t err = r - srtt;
+        srtt += err / 8;
+        rttvar += ((err < 0 ? -err : err) - (int32_t)rttvar) / 4;
+      }
+    }
+    s.state = SLOT_ACKED;
+    backoff = 0;
+    num_synced += s.num_posts;
+    if (++acks_in_cwnd >= getWindow()) {   // a window's worth ACK'd, so open up by one
+      acks_in_cwnd = 0;
+      if (getWindow() < SYNC_WINDOW_MAX) cwnd = getWindow() + 1;
+    }
+    acked_through = advance(now);
+    return true;
+  }
+  return false;
+}
+
+void PostSyncWindow::dropPost(uint32_t post_timestamp, uint32_t now, uint32_t& acked_through) {
+  acked_through = 0;
+  for (int i = 0; i < SYNC_WINDOW_MAX; i++) {
+    if (slots[i].post_timestamp == post_timestamp) {
+      slots[i].state = SLOT_ACKED;
+      acked_through = advance(now);
+      return;
+    }
+  }
+}
+
+int PostSyncWindow::checkTimeouts(uint32_t now) {
+  int n = 0;
+  for (int i = 0; i < SYNC_WINDOW_MAX; i++) {
+    Slot& s = slots[i];
+    if (s.post_timestamp && s.state == SLOT_SENT && timeHasPassed(now, s.timeout_at)) {
+      s.state = SLOT_LOST;   // NOTE: ack_crc is kept, in case the ACK arrives later
+      n++;
+    }
+  }
+  if (n > 0) {
+    cwnd = getWindow() > 1 ? getWindow() / 2 : 1;
+    acks_in_cwnd = 0;
+    if (backoff < SYNC_MAX_BACKOFF) backoff++;
+  }
+  return n;
+}
+
+uint32_t PostSyncWindow::getPostsPerMin(uint32_t now) const {
+  uint32_t busy = busy_millis;
+  if (numInFlight() > 0) busy += now - busy_since;
+  return busy ? (uint32_t)((uint64_t)num_synced * 60000 / busy) : 0;
+}
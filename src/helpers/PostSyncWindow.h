@@ -0,0 +1,91 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef SYNC_WINDOW_MAX
+  #define SYNC_WINDOW_MAX    4    // max posts in flight, per client
+#endif
+#ifndef SYNC_WINDOW_INIT
+  #define SYNC_WINDOW_INIT   2
+#endif
+
+#define SYNC_RTO_MIN       2000    // millis
+#define SYNC_RTO_MAX      30000
+#define SYNC_MAX_BACKOFF      3    // ie. up to 8x RTO, after repeated timeouts
+
+/**
+ * \brief  Sliding window for pushing posts to one room client. Several posts can be in flight, each ACK'd
+ *     individually (in any order, and ACKs for earlier attempts of a re-sent post still count), and the client's
+ *     'sync since' only advances over posts that have all been ACK'd. Timeouts and pacing adapt to the
+ *     measured round-trip time, and the window shrinks on timeouts (and grows again as ACKs come in).
+ *     All zeroes is a valid (empty) state, so can be kept alongside a server's clients (see ClientACL::setSlotData()).
+*/
+struct PostSyncWindow {
+  struct Slot {
+    uint32_t post_timestamp;   // zero if slot is free (newest post, if a batch)
+    uint32_t first_timestamp;  // oldest post, if a batch
+    uint32_t ack_crc;
+    uint32_t prev_ack_crc;     // from previous attempt, in case that ACK arrives late
+    uint32_t sent_at;          // millis
+    uint32_t timeout_at;
+    uint8_t state;
+    uint8_t attempts;
+    uint8_t num_posts;
+  };
+
+  Slot slots[SYNC_WINDOW_MAX];
+  uint32_t cursor;         // timestamp of newest post pushed
+  uint32_t next_push_at;   // millis, for pacing
+  uint16_t srtt, rttvar;   // millis (zero if not measured yet)
+  uint8_t cwnd;            // current window size (zero = SYNC_WINDOW_INIT)
+  uint8_t acks_in_cwnd;
+  uint8_t backoff;
+  uint32_t num_synced;     // posts ACK'd, including those in batches (stats)
+  uint32_t busy_millis;    // total time with posts in flight (stats)
+  uint32_t busy_since;     // millis, if posts in flight
+
+  /** \brief  forget anything in flight, and start again from 'since' (eg. on login) */
+  void reset(uint32_t since, uint32_t now);
+
+  int numInFlight() const;
+  uint8_t getWindow() const { return cwnd ? cwnd : SYNC_WINDOW_INIT; }
+
+  /** \returns  true if a (new or re-sent) post can be pushed now */
+  bool canPush(uint32_t now) const;
+
+  /**
+   * \returns  timestamp of oldest post (or batch) that timed out, to re-send first. Zero if none
+   * \param  first_timestamp   if not NULL, set to oldest post of the batch (same as returned, if a single post)
+  */
+  uint32_t getResendTimestamp(uint32_t* first_timestamp = NULL) const;
+
+  /**
+   * \brief  records a post that has just been pushed (or re-sent)
+   * \param  timeout   ACK timeout to use until round-trip time has been measured
+   * \param  gap   pacing until round-trip time has been measured
+   * \param  first_timestamp, num_posts   if several posts were pushed as one batch (which is ACK'd once), the oldest
+   *      of them and how many. 'post_timestamp' is the newest
+  */
+  void onPushed(uint32_t post_timestamp, uint32_t ack_crc, uint32_t now, uint32_t timeout, uint32_t gap,
+                uint32_t first_timestamp = 0, uint8_t num_posts = 1);
+
+  /**
+   * \returns  true if ack_crc was for a post in this window
+   * \param  acked_through   set to the new 'sync since' timestamp, if it can be advanced, otherwise zero
+  */
+  bool onAck(uint32_t ack_crc, uint32_t now, uint32_t& acked_through);
+
+  /** \brief  a post in flight no longer exists, so stop waiting for it (see onAck() for 'acked_through') */
+  void dropPost(uint32_t post_timestamp, uint32_t now, uint32_t& acked_through);
+
+  /** \returns  number of posts that have just timed out */
+  int checkTimeouts(uint32_t now);
+
+  /** \returns  posts ACK'd per minute, while posts were in flight */
+  uint32_t getPostsPerMin(uint32_t now) const;
+
+private:
+  uint32_t calcTimeout(uint32_t fallback) const;
+  uint32_t advance(uint32_t now);
+};
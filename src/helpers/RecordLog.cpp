@@ -0,0 +1,277 @@
+#include "RecordLog.h"
+
+#define OP_PUT     'P'
+#define OP_DELETE  'D'
+#define OP_COMPACTED  'C'   // last entry of a log that a completed compaction (ie. the temp file) supersedes
+
+struct LogMapEntry {
+  uint8_t key[RECORD_LOG_KEY_SIZE];
+  uint32_t offset;   // of last entry for this key
+  uint8_t op;
+};
+
+static File openFile(FILESYSTEM* fs, const char* path, char mode) {   // mode: 'r', 'w' or 'a'
+#if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+  if (mode == 'r') return fs->open(path, FILE_O_READ);
+  if (mode == 'w') fs->remove(path);
+  return fs->open(path, FILE_O_WRITE);   // positioned at end
+#elif defined(RP2040_PLATFORM)
+  return fs->open(path, mode == 'r' ? "r" : mode == 'w' ? "w" : "a");
+#else
+  return fs->open(path, mode == 'r' ? "r" : mode == 'w' ? "w" : "a", mode != 'r');
+#endif
+}
+
+static uint32_t calcHash(const uint8_t* data, int len, uint32_t hash = 2166136261UL) {   // FNV-1a
+  for (int i = 0; i < len; i++) {
+    hash = (hash ^ data[i]) * 16777619UL;
+  }
+  return hash;
+}
+
+RecordLog::RecordLog(const char* snapshot_path, const char* log_path, const char* tmp_path, int rec_size, int max_records) {
+  _fs = NULL;
+  _snapshot_path = snapshot_path;
+  _log_path = log_path;
+  _tmp_path = tmp_path;
+  _rec_size = rec_size;
+  _max_saved = max_records;
+  _keys = new uint8_t[max_records][RECORD_LOG_KEY_SIZE];
+  _hashes = new uint32_t[max_records];
+  _seen = new bool[max_records];
+  _num_saved = _hint = _num_log = 0;
+  _log_bad = false;
+  _file_ok = false;
+}
+
+int RecordLog::findSaved(const uint8_t* key) {
+  for (int n = 0; n < _num_saved; n++) {
+    int i = (_hint + n) % _num_saved;   // records are usually saved in same order as last time
+    if (memcmp(_keys[i], key, RECORD_LOG_KEY_SIZE) == 0) {
+      _hint = i + 1;
+      return i;
+    }
+  }
+  return -1;  // not found
+}
+
+bool RecordLog::addSaved(const uint8_t* rec) {
+  if (_num_saved >= _max_saved) return false;
+
+  memcpy(_keys[_num_saved], rec, RECORD_LOG_KEY_SIZE);
+  _hashes[_num_saved] = calcHash(rec, _rec_size);
+  _seen[_num_saved] = true;
+  _num_saved++;
+  return true;
+}
+
+bool RecordLog::appendEntry(uint8_t op, const uint8_t* data, int len) {
+  uint32_t check = calcHash(data, len, calcHash(&op, 1));
+  bool success = (_file.write(&op, 1) == 1);
+  success = success && (_file.write(data, len) == (size_t)len);
+  success = success && (_file.write((uint8_t *)&check, 4) == 4);
+  if (success) {
+    _num_log++;
+  } else {
+    _file_ok = false;
+    _log_bad = true;  // may have written part of an entry
+  }
+  return success;
+}
+
+int RecordLog::readEntry(File& file, uint8_t* buf, uint8_t& op) {
+  if (file.read(&op, 1) != 1) return 0;   // EOF
+
+  int len = op == OP_PUT ? _rec_size : (op == OP_DELETE ? RECORD_LOG_KEY_SIZE : -1);
+  if (len < 0) return -1;   // corrupt
+
+  uint32_t check;
+  if (file.read(buf, len) != (size_t)len || file.read((uint8_t *)&check, 4) != 4) return -1;   // torn write
+  return check == calcHash(buf, len, calcHash(&op, 1)) ? 1 : -1;
+}
+
+bool RecordLog::isLogSuperseded() {
+  File log = openFile(_fs, _log_path, 'r');
+  if (!log) return false;
+
+  uint8_t entry[1 + 4];
+  bool superseded = false;
+  size_t size = log.size();
+  if (size >= sizeof(entry) && log.seek(size - sizeof(entry)) && log.read(entry, sizeof(entry)) == sizeof(entry)) {
+    uint32_t check;
+    memcpy(&check, &entry[1], 4);
+    superseded = entry[0] == OP_COMPACTED && check == calcHash(entry, 1);
+  }
+  log.close();
+  return superseded;
+}
+
+void RecordLog::load(RecordLogVisitor& visitor) {
+  _num_saved = _num_log = 0;
+  _log_bad = false;
+
+  bool replay = true;
+  if (isLogSuperseded()) {   // compaction was interrupted after temp file was complete, so finish it
+    if (_fs->exists(_tmp_path)) {
+      _fs->remove(_snapshot_path);
+      _fs->rename(_tmp_path, _snapshot_path);
+    }
+    _fs->remove(_log_path);
+    replay = false;   // (in case remove failed)
+  } else if (_fs->exists(_tmp_path)) {   // compaction was interrupted while writing temp file, which may be incomplete
+    _fs->remove(_tmp_path);
+  }
+
+  LogMapEntry* map = new LogMapEntry[RECORD_LOG_MAX_ENTRIES];
+  int num_map = 0;
+  uint8_t* buf = new uint8_t[_rec_size];
+
+  // first pass: find the last log entry for each key
+  File log = openFile(_fs, _log_path, 'r');
+  if (log && !replay) {
+    _log_bad = true;   // don't append to it either
+  } else if (log) {
+    uint32_t pos = 0;
+    uint8_t op;
+    int res;
+    while ((res = readEntry(log, buf, op)) > 0) {
+      int i = 0;
+      while (i < num_map && memcmp(map[i].key, buf, RECORD_LOG_KEY_SIZE) != 0) i++;
+      if (i == num_map) {
+        if (num_map >= RECORD_LOG_MAX_ENTRIES) { res = -1; break; }   // shouldn't happen, appends are limited
+        memcpy(map[i].key, buf, RECORD_LOG_KEY_SIZE);
+        num_map++;
+      }
+      map[i].offset = pos + 1;
+      map[i].op = op;
+      pos += 1 + (op == OP_PUT ? _rec_size : RECORD_LOG_KEY_SIZE) + 4;
+      _num_log++;
+    }
+    if (res < 0) {
+      MESH_DEBUG_PRINTLN("RecordLog: %s is torn/corrupt after %d entries", _log_path, _num_log);
+      _log_bad = true;
+    }
+  }
+
+  // snapshot records, unless superseded by log
+  bool full = false;
+  File file = openFile(_fs, _snapshot_path, 'r');
+  if (file) {
+    while (!full && file.read(buf, _rec_size) == (size_t)_rec_size) {
+      int i = 0;
+      while (i < num_map && memcmp(map[i].key, buf, RECORD_LOG_KEY_SIZE) != 0) i++;
+      if (i < num_map) continue;
+
+      full = !visitor.onRecordLoaded(buf);
+      if (!full && !addSaved(buf)) _log_bad = true;
+    }
+    file.close();
+  }
+
+  // then the records put by log
+  for (int i = 0; i < num_map && !full; i++) {
+    if (map[i].op != OP_PUT) continue;
+
+    if (log.seek(map[i].offset) && log.read(buf, _rec_size) == (size_t)_rec_size) {
+      full = !visitor.onRecordLoaded(buf);
+      if (!full && !addSaved(buf)) _log_bad = true;
+    }
+  }
+  if (log) log.close();
+
+  delete[] buf;
+  delete[] map;
+}
+
+bool RecordLog::beginSave() {
+  _file_ok = false;
+  if (!canAppend()) return false;
+
+  _file = openFile(_fs, _log_path, 'a');
+  if (!_file) return false;
+
+  _file_ok = true;
+  for (int i = 0; i < _num_saved; i++) _seen[i] = false;
+  _hint = 0;
+  return true;
+}
+
+bool RecordLog::saveRecord(const uint8_t* rec) {
+  if (!_file_ok) return false;
+
+  uint32_t hash = calcHash(rec, _rec_size);
+  int i = findSaved(rec);
+  if (i >= 0 && _hashes[i] == hash) {   // unchanged
+    _seen[i] = true;
+    return true;
+  }
+  if (_num_log >= RECORD_LOG_MAX_ENTRIES) return false;
+  if (i < 0 && _num_saved >= _max_saved) return false;
+
+  if (!appendEntry(OP_PUT, rec, _rec_size)) return false;
+
+  if (i < 0) {
+    addSaved(rec);
+  } else {
+    _hashes[i] = hash;
+    _seen[i] = true;
+  }
+  return true;
+}
+
+bool RecordLog::endSave(bool complete) {
+  if (complete && _file_ok) {
+    for (int i = 0; i < _num_saved; i++) {
+      if (_seen[i]) continue;
+
+      if (_num_log >= RECORD_LOG_MAX_ENTRIES || !appendEntry(OP_DELETE, _keys[i], RECORD_LOG_KEY_SIZE)) {
+        complete = false;
+        break;
+      }
+      _num_saved--;   // move last into this place
+      memcpy(_keys[i], _keys[_num_saved], RECORD_LOG_KEY_SIZE);
+      _hashes[i] = _hashes[_num_saved];
+      _seen[i] = _seen[_num_saved];
+      i--;
+    }
+  }
+  if (_file) _file.close();
+  return complete && _file_ok;
+}
+
+bool RecordLog::beginCompact() {
+  _file = openFile(_fs, _tmp_path, 'w');
+  _file_ok = (bool) _file;
+  _num_saved = 0;
+  return _file_ok;
+}
+
+bool RecordLog::compactRecord(const uint8_t* rec) {
+  if (!_file_ok || _file.write(rec, _rec_size) != (size_t)_rec_size) {
+    _file_ok = false;
+    return false;
+  }
+  addSaved(rec);
+  return true;
+}
+
+bool RecordLog::endCompact(bool complete) {
+  if (_file) _file.close();
+  if (complete && _file_ok) {   // temp file is complete. Mark the log as superseded by it, before publishing it
+    _file = openFile(_fs, _log_path, 'a');
+    _file_ok = _file && appendEntry(OP_COMPACTED, NULL, 0);
+    if (_file) _file.close();
+  }
+  if (!complete || !_file_ok) {
+    _fs->remove(_tmp_path);
+    _log_bad = true;   // saved records no longer known, so compact again next time
+    return false;
+  }
+  // if interrupted from here on, load() finishes the job, and doesn't replay the log
+  _fs->remove(_snapshot_path);
+  _fs->rename(_tmp_path, _snapshot_path);
+  _fs->remove(_log_path);
+  _num_log = 0;
+  _log_bad = _fs->exists(_log_path);   // must not append after the marker, so compact again next time
+  return true;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <MeshCore.h>
+#include <helpers/IdentityStore.h>   // for FILESYSTEM
+
+#define RECORD_LOG_KEY_SIZE   PUB_KEY_SIZE    // records are identified by their first N bytes (ie. the whole pub_key)
+
+#ifndef RECORD_LOG_MAX_ENTRIES
+  #define RECORD_LOG_MAX_ENTRIES  64    // log entries, before compaction is forced
+#endif
+
+class RecordLogVisitor {
+public:
+  /** \returns  false to stop loading (eg. table is full) */
+  virtual bool onRecordLoaded(const uint8_t* rec) = 0;
+};
+
+/**
+ * \brief  Log-structured store for a table of fixed size records (eg. contacts), so that saving the table only
+ *     appends the records that changed (or were deleted) since last save, instead of re-writing the whole file.
+ *     The snapshot file is in the same format as a plain table file (records back to back), and the log file holds
+ *     'put' (whole record) and 'delete' (key) entries, each with a check value. Loading replays the log over the
+ *     snapshot, ignoring a torn last entry. Compaction writes the new snapshot to a temp file, appends a marker to
+ *     the log once that is complete, then renames the temp file over the snapshot and removes the log. If interrupted,
+ *     load() finishes the compaction if the log ends with the marker (never replaying that log over the new snapshot),
+ *     otherwise discards the temp file and loads the old snapshot and log.
+ *     RAM cost is ~37 bytes per record (key, hash of last saved contents, and a flag).
+*/
+class RecordLog {
+  FILESYSTEM* _fs;
+  const char* _snapshot_path;
+  const char* _log_path;
+  const char* _tmp_path;
+  int _rec_size;
+  uint8_t (*_keys)[RECORD_LOG_KEY_SIZE];   // records in snapshot + log (ie. as last saved)
+  uint32_t* _hashes;
+  bool* _seen;
+  int _num_saved, _max_saved;
+  int _hint;    // where next saveRecord() is likely to match
+  int _num_log;
+  bool _log_bad;  // log is torn, or didn't fit. Don't append, compact instead.
+  File _file;
+  bool _file_ok;
+
+  int findSaved(const uint8_t* key);
+  bool addSaved(const uint8_t* rec);
+  bool appendEntry(uint8_t op, const uint8_t* data, int len);
+  int readEntry(File& file, uint8_t* buf, uint8_t& op);
+  bool isLogSuperseded();
+
+public:
+  /**
+   * \param  rec_size   size of each record. The first RECORD_LOG_KEY_SIZE bytes identify the record.
+   * \param  max_records   max records in table
+  */
+  RecordLog(const char* snapshot_path, const char* log_path, const char* tmp_path, int rec_size, int max_records);
+
+  void begin(FILESYSTEM* fs) { _fs = fs; }
+
+  /** \brief  loads the table (snapshot, then log), passing each record to 'visitor' */
+  void load(RecordLogVisitor& visitor);
+
+  /**
+   * \brief  Incremental save. Call saveRecord() for every record in the table, then endSave().
+   *     If any of these return false, a compaction must be done instead.
+  */
+  bool beginSave();
+  bool saveRecord(const uint8_t* rec);
+  bool endSave(bool complete);   // appends deletes for any records not saved this time (if complete)
+
+  /**
+   * \brief  Full re-write. Call compactRecord() for every record in the table, then endCompact().
+  */
+  bool beginCompact();
+  bool compactRecord(const uint8_t* rec);
+  bool endCompact(bool complete);
+
+  bool needsCompact() const { return _log_bad || _num_log >= RECORD_LOG_MAX_ENTRIES/2; }   // for background compaction
+  bool canAppend() const { return !_log_bad && _num_log < RECORD_LOG_MAX_ENTRIES; }
+  int getNumLogEntries() const { return _num_log; }
+};
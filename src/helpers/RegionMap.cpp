@@ -47,6 +47,26 @@ RegionMap::RegionMap(TransportKeyStore& store) : _store(&store) {
   wildcard.id = wildcard.parent = 0;
   wildcard.flags = 0;  // default behaviour, allow flood and direct
   strcpy(wildcard.name, "*");
+  _index = NULL;
+  _index_stale = true;
+  _index_keys_version = 0;
+  _index_end = 0;
+}
+
+RegionMap::~RegionMap() {
+  delete _index;
+}
+
+RegionMap& RegionMap::operator=(const RegionMap& src) {
+  if (this != &src) {
+    _store = src._store;
+    next_id = src.next_id; home_id = src.home_id; default_id = src.default_id;
+    num_regions = src.num_regions;
+    memcpy(regions, src.regions, sizeof(regions[0])*num_regions);
+    wildcard = src.wildcard;
+    invalidateIndex();
+  }
+  return *this;
 }
 
 bool RegionMap::is_name_char(uint8_t c) {
@@ -82,6 +102,7 @@ bool RegionMap::load(FILESYSTEM* _fs, const char* path) {
 
       num_regions = 0; next_id = 1;
       default_id = home_id = 0;
+      invalidateIndex();
 
       bool success = file.read(pad, 3) == 3;  // reserved header
       success = success && file.read((uint8_t *) &default_id, sizeof(default_id)) == sizeof(default_id);
@@ -164,6 +185,7 @@ RegionEntry* RegionMap::putRegion(const char* name, uint16_t parent_id, uint16_t
     region->id = id == 0 ? next_id++ : id;
     StrHelper::strncpy(region->name, name, sizeof(region->name));
     region->parent = parent_id;
+    invalidateIndex();
   }
   return region;
 }
@@ -185,8 +207,44 @@ int RegionMap::getTransportKeysFor(const RegionEntry& src, TransportKey dest[],
   return num;
 }
 
+void RegionMap::rebuildIndex() {
+  if (_index == NULL) {
+    _index = new TransportCodeMatcher();
+  }
+  _index->clear();
+  _index_end = 0;
+  while (_index_end < num_regions) {
+    TransportKey keys[4];
+    int num = getTransportKeysFor(regions[_index_end], keys, 4);
+    if (_index->getCount() + num > _index->getCapacity()) break;   // remaining regions are matched the slow way
+
+    for (int j = 0; j < num; j++) {
+      _index->addKey(keys[j].key, _index_end);
+    }
+    _index_end++;
+  }
+  _index_keys_version = _store->getVersion();
+  _index_stale = false;
+}
+
 RegionEntry* RegionMap::findMatch(mesh::Packet* packet, uint8_t mask) {
-  for (int i = 0; i < num_regions; i++) {
+  if (_index_stale || _index_keys_version != _store->getVersion()) {
+    rebuildIndex();
+  }
+
+  // try the pre-computed keys first, in most-recently-matched order
+  int n = _index->getCount();
+  for (int i = 0; i < n; i++) {
+    auto region = &regions[_index->getTagAt(i)];
+    if ((region->flags & mask) == 0 && _index->matchesAt(i, packet)) {   // a match!!
+      _index->promote(i);
+      _index->countLookup(true);
+      return region;
+    }
+  }
+
+  // then any regions that didn't fit in the index
+  for (int i = _index_end; i < num_regions; i++) {
     auto region = &regions[i];
     if ((region->flags & mask) == 0) {   // does region allow this? (per 'mask' param)
       TransportKey keys[4];
@@ -194,11 +252,13 @@ RegionEntry* RegionMap::findMatch(mesh::Packet* packet, uint8_t mask) {
       for (int j = 0; j < num; j++) {
         uint16_t code = keys[j].calcTransportCode(packet);
         if (packet->transport_codes[0] == code) {   // a match!!
+          _index->countLookup(true);
           return region;
         }
       }
     }
   }
+  _index->countLookup(false);
   return NULL;  // no matches
 }
 
@@ -274,11 +334,13 @@ bool RegionMap::removeRegion(const RegionEntry& region) {
     regions[i] = regions[i + 1];
     i++;
   }
+  invalidateIndex();
   return true;  // success
 }
 
 bool RegionMap::clear() {
   num_regions = 0;
+  invalidateIndex();
   return true;  // success
 }
 
@@ -3,6 +3,7 @@
 #include <Arduino.h>   // needed for PlatformIO
 #include <Packet.h>
 #include "TransportKeyStore.h"
+#include "TransportCodeMatcher.h"
 
 #ifndef MAX_REGION_ENTRIES
   #define MAX_REGION_ENTRIES  32
@@ -26,11 +27,19 @@ class RegionMap {
   uint16_t num_regions;
   RegionEntry regions[MAX_REGION_ENTRIES];
   RegionEntry wildcard;
+  TransportCodeMatcher* _index;   // lazily created by findMatch()
+  bool _index_stale;
+  uint16_t _index_keys_version;
+  int _index_end;     // regions [0.._index_end) have their keys in _index
 
+  void invalidateIndex() { _index_stale = true; }
+  void rebuildIndex();
   void printChildRegions(int indent, const RegionEntry* parent, Stream& out) const;
 
 public:
   RegionMap(TransportKeyStore& store);
+  ~RegionMap();
+  RegionMap& operator=(const RegionMap& src);   // NOTE: does not copy the transport-code index
 
   static bool is_name_char(uint8_t c);
 
@@ -49,12 +58,13 @@ public:
   void setDefaultRegion(const RegionEntry* def);
   bool removeRegion(const RegionEntry& region);
   bool clear();
-  void resetFrom(const RegionMap& src) { num_regions = 0; next_id = src.next_id; }
+  void resetFrom(const RegionMap& src) { num_regions = 0; next_id = src.next_id; invalidateIndex(); }
   int getCount() const { return num_regions; }
   const RegionEntry* getByIdx(int i) const { return &regions[i]; }
   const RegionEntry* getRoot() const { return &wildcard; }
   int exportNamesTo(char *dest, int max_len, uint8_t mask, bool invert = false);
   int getTransportKeysFor(const RegionEntry& src, TransportKey dest[], int max_num);
+  const TransportCodeMatcher* getMatchIndex() const { return _index; }   // NOTE: NULL until first findMatch()
 
   void    exportTo(Stream& out) const;
   size_t  exportTo(char *dest, size_t max_len) const;
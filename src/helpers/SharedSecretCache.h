@@ -0,0 +1,65 @@
+#pragma once
+
+#include <MeshCore.h>
+#include <string.h>
+
+#ifndef SHARED_SECRET_CACHE_SIZE
+  #if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+    #define SHARED_SECRET_CACHE_SIZE  4
+  #else
+    #define SHARED_SECRET_CACHE_SIZE  8
+  #endif
+#endif
+
+/**
+ * \brief  Small LRU table of ECDH shared secrets, keyed on the other party's public key, so that repeated
+ *     ANON_REQs from the same (not yet known) sender don't each need a key exchange.
+ *     NOTE: secrets are only valid for the current self identity.
+*/
+class SharedSecretCache {
+  uint8_t _pub_keys[SHARED_SECRET_CACHE_SIZE][PUB_KEY_SIZE];
+  uint8_t _secrets[SHARED_SECRET_CACHE_SIZE][PUB_KEY_SIZE];
+  uint32_t _used[SHARED_SECRET_CACHE_SIZE];    // LRU stamp, 0 = empty slot
+  uint32_t _lru_clock;
+  uint32_t _hits, _misses, _evictions;
+
+public:
+  SharedSecretCache() { clear(); resetStats(); }
+
+  void clear() {
+    memset(_pub_keys, 0, sizeof(_pub_keys));
+    memset(_secrets, 0, sizeof(_secrets));
+    memset(_used, 0, sizeof(_used));
+    _lru_clock = 0;
+  }
+
+  bool get(uint8_t* secret, const uint8_t* pub_key) {
+    for (int i = 0; i < SHARED_SECRET_CACHE_SIZE; i++) {
+      if (_used[i] && memcmp(_pub_keys[i], pub_key, PUB_KEY_SIZE) == 0) {
+        _used[i] = ++_lru_clock;
+        memcpy(secret, _secrets[i], PUB_KEY_SIZE);
+        _hits++;
+        return true;
+      }
+    }
+    _misses++;
+    return false;
+  }
+
+  void put(const uint8_t* pub_key, const uint8_t* secret) {
+    int i = 0;
+    for (int j = 1; j < SHARED_SECRET_CACHE_SIZE; j++) {   // find empty or least recently used slot
+      if (_used[j] < _used[i]) i = j;
+    }
+    if (_used[i]) _evictions++;
+
+    memcpy(_pub_keys[i], pub_key, PUB_KEY_SIZE);
+    memcpy(_secrets[i], secret, PUB_KEY_SIZE);
+    _used[i] = ++_lru_clock;
+  }
+
+  uint32_t getNumHits() const { return _hits; }
+  uint32_t getNumMisses() const { return _misses; }
+  uint32_t getNumEvictions() const { return _evictions; }
+  void resetStats() { _hits = _misses = _evictions = 0; }
+};
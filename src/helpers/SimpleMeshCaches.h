@@ -0,0 +1,35 @@
+#pragma once
+
+#include <Mesh.h>
+#include "VerifiedAdvertCache.h"
+#include "SharedSecretCache.h"
+#include "CipherContextCache.h"
+
+/**
+ * \brief  The crypto caches for a node running a Mesh: verified adverts, ANON_REQ shared secrets, and cipher contexts.
+ *     Sizes are set per target (see the *_CACHE_SIZE defines), and a node (eg. a bridge) which only needs
+ *     duplicate detection just doesn't create one.
+*/
+class SimpleMeshCaches : public mesh::MeshCaches {
+  VerifiedAdvertCache _adverts;
+  SharedSecretCache _secrets;
+  CipherContextCache _ciphers;
+
+public:
+  bool isVerifiedAdvert(const uint8_t* pub_key, uint32_t timestamp, const uint8_t* signature, const uint8_t* app_data, int app_data_len) override {
+    return _adverts.contains(pub_key, timestamp, signature, app_data, app_data_len);
+  }
+  void setVerifiedAdvert(const uint8_t* pub_key, uint32_t timestamp, const uint8_t* signature, const uint8_t* app_data, int app_data_len) override {
+    _adverts.add(pub_key, timestamp, signature, app_data, app_data_len);
+  }
+  bool getSharedSecret(uint8_t* secret, const uint8_t* pub_key) override { return _secrets.get(secret, pub_key); }
+  void putSharedSecret(const uint8_t* pub_key, const uint8_t* secret) override { _secrets.put(pub_key, secret); }
+  mesh::CipherContext* getCipherContext(const uint8_t* secret) override { return _ciphers.find(secret); }
+  mesh::CipherContext* putCipherContext(const uint8_t* secret) override { return _ciphers.put(secret); }
+
+  const VerifiedAdvertCache& getAdvertCache() const { return _adverts; }
+  const SharedSecretCache& getSecretCache() const { return _secrets; }
+  const CipherContextCache& getCipherCache() const { return _ciphers; }
+
+  void resetStats() { _adverts.resetStats(); _secrets.resetStats(); _ciphers.resetStats(); }
+};
@@ -0,0 +1,249 @@
+#include "SlabPacketManager.h"
+
+SlabQueue::SlabQueue(int max_entries) {
+  _table = new SlabQueueEntry[max_entries];
+  _size = max_entries;
+  _num = 0;
+}
+
+int SlabQueue::countBefore(uint32_t now) const {
+  if (now == 0xFFFFFFFF) return _num;  // sentinel: count all entries regardless of schedule
+
+  int n = 0;
+  for (int j = 0; j < _num; j++) {
+    if ((int32_t)(_table[j].scheduled_for - now) > 0) continue;   // scheduled for future... ignore for now
+    n++;
+  }
+  return n;
+}
+
+int SlabQueue::findNext(uint32_t now, bool compacted_ok) const {
+  uint8_t min_pri = 0xFF;
+  int best_idx = -1;
+  for (int j = 0; j < _num; j++) {
+    if ((int32_t)(_table[j].scheduled_for - now) > 0) continue;   // scheduled for future... ignore for now
+    if (!compacted_ok && _table[j].slot >= 0) continue;   // can't be restored right now
+    if (_table[j].priority < min_pri) {  // select most important priority amongst non-future entries
+      min_pri = _table[j].priority;
+      best_idx = j;
+    }
+  }
+  return best_idx;
+}
+
+SlabQueueEntry SlabQueue::removeByIdx(int i) {
+  SlabQueueEntry item = _table[i];
+  _num--;
+  while (i < _num) {
+    _table[i] = _table[i+1];
+    i++;
+  }
+  return item;
+}
+
+bool SlabQueue::add(const SlabQueueEntry& entry) {
+  if (_num == _size) {
+    return false;
+  }
+  _table[_num++] = entry;
+  return true;
+}
+
+SlabPacketManager::SlabPacketManager(int num_working, int num_small, int num_medium, int num_large)
+    : send_queue(num_working + num_small + num_medium + num_large), rx_queue(num_working + num_small + num_medium + num_large) {
+  _unused = new mesh::Packet*[num_working];
+  _num_working = num_working;
+  for (_num_unused = 0; _num_unused < num_working; _num_unused++) {
+    _unused[_num_unused] = new mesh::Packet();
+  }
+
+  const int slot_sizes[SLAB_NUM_CLASSES] = { SLAB_SMALL_SLOT_SIZE, SLAB_MEDIUM_SLOT_SIZE, SLAB_LARGE_SLOT_SIZE };
+  const int num_slots[SLAB_NUM_CLASSES] = { num_small, num_medium, num_large };
+  int total_slots = 0;
+  uint32_t total_bytes = 0;
+  for (int c = 0; c < SLAB_NUM_CLASSES; c++) {
+    _first_slot[c] = total_slots;
+    _class_offset[c] = total_bytes;
+    _free_slots[c] = new uint16_t[num_slots[c] > 0 ? num_slots[c] : 1];
+    for (_num_free[c] = 0; _num_free[c] < num_slots[c]; _num_free[c]++) {
+      _free_slots[c][_num_free[c]] = total_slots + num_slots[c] - 1 - _num_free[c];   // lowest slot handed out first
+    }
+    _stats[c].slot_size = slot_sizes[c];
+    _stats[c].num_slots = num_slots[c];
+    total_slots += num_slots[c];
+    total_bytes += num_slots[c] * slot_sizes[c];
+  }
+  _slab = new uint8_t[total_bytes > 0 ? total_bytes : 1];
+  _slot_len = new uint8_t[total_slots > 0 ? total_slots : 1];
+  _slot_snr = new int8_t[total_slots > 0 ? total_slots : 1];
+  _next_peek = 0;
+  resetStats();
+}
+
+void SlabPacketManager::resetStats() {
+  for (int c = 0; c < SLAB_NUM_CLASSES; c++) {
+    _stats[c].in_use = _stats[c].max_in_use = _stats[c].num_slots - _num_free[c];
+    _stats[c].num_stored = _stats[c].num_fails = 0;
+  }
+  _n_alloc_fails = _n_uncompacted = _n_restore_waits = _n_dropped = 0;
+}
+
+size_t SlabPacketManager::calcPoolBytes(int num_working, int num_small, int num_medium, int num_large) {
+  int total_slots = num_small + num_medium + num_large;
+  return num_working * (sizeof(mesh::Packet) + sizeof(mesh::Packet*)) + SLAB_NUM_PEEK * sizeof(mesh::Packet)
+    + num_small*SLAB_SMALL_SLOT_SIZE + num_medium*SLAB_MEDIUM_SLOT_SIZE + num_large*SLAB_LARGE_SLOT_SIZE
+    + total_slots * (sizeof(uint8_t) + sizeof(int8_t) + sizeof(uint16_t))   // len, snr, free list
+    + 2 * (num_working + total_slots) * sizeof(SlabQueueEntry);
+}
+
+int SlabPacketManager::classOf(int slot) const {
+  int c = SLAB_NUM_CLASSES - 1;
+  while (c > 0 && slot < _first_slot[c]) c--;
+  return c;
+}
+
+uint8_t* SlabPacketManager::slotData(int slot) const {
+  int c = classOf(slot);
+  return &_slab[_class_offset[c] + (slot - _first_slot[c]) * _stats[c].slot_size];
+}
+
+bool SlabPacketManager::compact(SlabQueueEntry& entry, mesh::Packet* packet) {
+  if (packet->payload_len == 0) return false;   // readFrom() needs a payload
+  int len = packet->getRawLength();
+
+  for (int c = 0; c < SLAB_NUM_CLASSES; c++) {
+    if (len > _stats[c].slot_size || _stats[c].num_slots == 0) continue;
+    if (_num_free[c] == 0) {
+      _stats[c].num_fails++;
+      continue;    // try next size up
+    }
+    entry.slot = _free_slots[c][--_num_free[c]];
+    _slot_len[entry.slot] = packet->writeTo(slotData(entry.slot));
+    _slot_snr[entry.slot] = packet->_snr;
+
+    ClassStats& s = _stats[c];
+    s.num_stored++;
+    if (++s.in_use > s.max_in_use) s.max_in_use = s.in_use;
+    return true;
+  }
+  return false;
+}
+
+mesh::Packet* SlabPacketManager::restore(const SlabQueueEntry& entry, mesh::Packet* dest) {
+  dest->readFrom(slotData(entry.slot), _slot_len[entry.slot]);
+  dest->_snr = _slot_snr[entry.slot];
+  return dest;
+}
+
+mesh::Packet* SlabPacketManager::take(SlabQueue& queue, int i) {
+  const SlabQueueEntry& e = queue.itemAt(i);
+  if (e.slot < 0) return queue.removeByIdx(i).packet;
+
+  if (_num_unused == 0) {
+    _n_restore_waits++;
+    return NULL;   // leave in queue, try again after a working Packet is freed
+  }
+  SlabQueueEntry entry = queue.removeByIdx(i);
+  mesh::Packet* packet = restore(entry, _unused[--_num_unused]);
+
+  int c = classOf(entry.slot);
+  _free_slots[c][_num_free[c]++] = entry.slot;
+  _stats[c].in_use--;
+  return packet;
+}
+
+void SlabPacketManager::enqueue(SlabQueue& queue, mesh::Packet* packet, uint8_t priority, uint32_t scheduled_for) {
+  SlabQueueEntry entry;
+  entry.priority = priority;
+  entry.scheduled_for = scheduled_for;
+  if (compact(entry, packet)) {
+    entry.packet = NULL;
+    free(packet);   // working Packet can be re-used straight away
+  } else {
+    entry.packet = packet;
+    entry.slot = -1;
+    _n_uncompacted++;
+  }
+  if (!queue.add(entry)) {   // shouldn't happen, queues can hold every slot and working Packet
+    MESH_DEBUG_PRINTLN("SlabPacketManager: queue full, dropping packet");
+    _n_dropped++;
+    if (entry.slot >= 0) {
+      int c = classOf(entry.slot);
+      _free_slots[c][_num_free[c]++] = entry.slot;
+      _stats[c].in_use--;
+    } else {
+      free(packet);
+    }
+  }
+}
+
+mesh::Packet* SlabPacketManager::allocNew() {
+  if (_num_unused == 0) {
+    _n_alloc_fails++;
+    return NULL;
+  }
+  return _unused[--_num_unused];
+}
+
+void SlabPacketManager::free(mesh::Packet* packet) {
+  if (packet >= &_peek[0] && packet < &_peek[SLAB_NUM_PEEK]) return;   // not a working Packet
+
+  if (_num_unused < _num_working) {
+    _unused[_num_unused++] = packet;
+  }
+}
+
+void SlabPacketManager::queueOutbound(mesh::Packet* packet, uint8_t priority, uint32_t scheduled_for) {
+  enqueue(send_queue, packet, priority, scheduled_for);
+}
+
+mesh::Packet* SlabPacketManager::takeNext(SlabQueue& queue, uint32_t now) {
+  // when no working Packet is free, only uncompacted entries can be handed out (which then frees one up), otherwise
+  // a compacted entry would stay at the head of the queue until something else frees a working Packet
+  int i = queue.findNext(now, _num_unused > 0);
+  if (i < 0) {
+    if (_num_unused == 0 && queue.findNext(now) >= 0) _n_restore_waits++;
+    return NULL;
+  }
+  return take(queue, i);
+}
+
+mesh::Packet* SlabPacketManager::getNextOutbound(uint32_t now) {
+  return takeNext(send_queue, now);
+}
+
+int SlabPacketManager::getOutboundCount(uint32_t now) const {
+  return send_queue.countBefore(now);
+}
+
+int SlabPacketManager::getOutboundTotal() const {
+  return send_queue.count();
+}
+
+int SlabPacketManager::getFreeCount() const {
+  return _num_unused;
+}
+
+mesh::Packet* SlabPacketManager::getOutboundByIdx(int i) {
+  if (i < 0 || i >= send_queue.count()) return NULL;
+
+  const SlabQueueEntry& e = send_queue.itemAt(i);
+  if (e.slot < 0) return e.packet;
+
+  mesh::Packet* dest = &_peek[_next_peek];   // (rotated, so a few peeks in a row don't overwrite each other)
+  _next_peek = (_next_peek + 1) % SLAB_NUM_PEEK;
+  return restore(e, dest);
+}
+
+mesh::Packet* SlabPacketManager::removeOutboundByIdx(int i) {
+  if (i < 0 || i >= send_queue.count()) return NULL;  // invalid index
+  return take(send_queue, i);
+}
+
+void SlabPacketManager::queueInbound(mesh::Packet* packet, uint32_t scheduled_for) {
+  enqueue(rx_queue, packet, 0, scheduled_for);
+}
+
+mesh::Packet* SlabPacketManager::getNextInbound(uint32_t now) {
+  return takeNext(rx_queue, now);
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <Dispatcher.h>
+
+#ifndef SLAB_SMALL_SLOT_SIZE
+  #define SLAB_SMALL_SLOT_SIZE    48    // ACKs, short direct-routed packets
+#endif
+#ifndef SLAB_MEDIUM_SLOT_SIZE
+  #define SLAB_MEDIUM_SLOT_SIZE  128    // most text messages, flooded ACKs, path returns
+#endif
+#define SLAB_LARGE_SLOT_SIZE   MAX_TRANS_UNIT
+#ifndef SLAB_NUM_PEEK
+  #define SLAB_NUM_PEEK          2      // Packets that getOutboundByIdx() restores into, in turn
+#endif
+#define SLAB_NUM_CLASSES       3
+
+/**
+ * \brief  Packet queue entry, for SlabPacketManager. Refers to either a compacted copy in a slab slot (slot >= 0),
+ *     or to a full Packet (slot < 0), for packets that could not be compacted.
+*/
+struct SlabQueueEntry {
+  mesh::Packet* packet;
+  uint32_t scheduled_for;
+  int16_t slot;
+  uint8_t priority;
+};
+
+/**
+ * \brief  Same ordering as PacketQueue (most important priority amongst due entries, FIFO within a priority).
+*/
+class SlabQueue {
+  SlabQueueEntry* _table;
+  int _size, _num;
+
+public:
+  SlabQueue(int max_entries);
+  int findNext(uint32_t now, bool compacted_ok=true) const;   // index of next due entry, or -1
+  bool add(const SlabQueueEntry& entry);
+  int count() const { return _num; }
+  int countBefore(uint32_t now) const;
+  const SlabQueueEntry& itemAt(int i) const { return _table[i]; }
+  SlabQueueEntry removeByIdx(int i);
+};
+
+/**
+ * \brief  A PacketManager that only keeps a few full-size Packets (the 'working' pool: packets being built, processed
+ *     or transmitted), and stores queued packets in wire format, in slab slots of a few size classes. As most packets
+ *     are far smaller than a full Packet, this holds a lot more queued packets in the same RAM as StaticPoolPacketManager.
+ *     NOTE: the Packet* returned by getNextOutbound()/getNextInbound() is generally NOT the same instance that was
+ *     queued, and the instance that was queued must not be used after queueOutbound()/queueInbound().
+*/
+class SlabPacketManager : public mesh::PacketManager {
+public:
+  struct ClassStats {
+    uint16_t slot_size;
+    uint16_t num_slots;
+    uint16_t in_use;
+    uint16_t max_in_use;
+    uint32_t num_stored;  // packets compacted into this class
+    uint32_t num_fails;   // packets that would fit, but this class was full
+  };
+
+private:
+  mesh::Packet** _unused;
+  int _num_working, _num_unused;
+  uint8_t* _slab;
+  uint8_t* _slot_len;
+  int8_t* _slot_snr;
+  uint16_t* _free_slots[SLAB_NUM_CLASSES];
+  int _num_free[SLAB_NUM_CLASSES];
+  int _first_slot[SLAB_NUM_CLASSES];
+  uint32_t _class_offset[SLAB_NUM_CLASSES];
+  ClassStats _stats[SLAB_NUM_CLASSES];
+  uint32_t _n_alloc_fails, _n_uncompacted, _n_restore_waits, _n_dropped;
+  SlabQueue send_queue, rx_queue;
+  mesh::Packet _peek[SLAB_NUM_PEEK];   // for getOutboundByIdx()
+  int _next_peek;
+
+  int classOf(int slot) const;
+  uint8_t* slotData(int slot) const;
+  bool compact(SlabQueueEntry& entry, mesh::Packet* packet);
+  mesh::Packet* restore(const SlabQueueEntry& entry, mesh::Packet* dest);
+  mesh::Packet* take(SlabQueue& queue, int i);
+  mesh::Packet* takeNext(SlabQueue& queue, uint32_t now);
+  void enqueue(SlabQueue& queue, mesh::Packet* packet, uint8_t priority, uint32_t scheduled_for);
+
+public:
+  /**
+   * \param  num_working   number of full-size Packets
+   * \param  num_small, num_medium, num_large   number of slots in each size class
+  */
+  SlabPacketManager(int num_working, int num_small, int num_medium, int num_large);
+
+  mesh::Packet* allocNew() override;
+  void free(mesh::Packet* packet) override;
+  void queueOutbound(mesh::Packet* packet, uint8_t priority, uint32_t scheduled_for) override;
+  mesh::Packet* getNextOutbound(uint32_t now) override;
+  int getOutboundCount(uint32_t now) const override;
+  int getOutboundTotal() const override;
+  int getFreeCount() const override;
+  mesh::Packet* getOutboundByIdx(int i) override;   // returned Packet is only valid for the next SLAB_NUM_PEEK-1 calls
+  mesh::Packet* removeOutboundByIdx(int i) override;
+  void queueInbound(mesh::Packet* packet, uint32_t scheduled_for) override;
+  mesh::Packet* getNextInbound(uint32_t now) override;
+
+  int getInboundTotal() const { return rx_queue.count(); }
+  const ClassStats& getClassStats(int c) const { return _stats[c]; }
+  uint32_t getNumAllocFails() const { return _n_alloc_fails; }    // allocNew() found no free working Packet
+  uint32_t getNumUncompacted() const { return _n_uncompacted; }   // queued as full Packet, as no slot was free
+  uint32_t getNumRestoreWaits() const { return _n_restore_waits; }  // packet was due, but no working Packet to restore into
+  uint32_t getNumDropped() const { return _n_dropped; }
+  void resetStats();
+
+  /** \returns  number of bytes used by Packets and slabs, for the given configuration */
+  static size_t calcPoolBytes(int num_working, int num_small, int num_medium, int num_large);
+};
@@ -42,14 +42,16 @@ public:
                                uint32_t n_recv_flood,
                                uint32_t n_recv_direct) {
     sprintf(reply, 
-      "{\"recv\":%u,\"sent\":%u,\"flood_tx\":%u,\"direct_tx\":%u,\"flood_rx\":%u,\"direct_rx\":%u,\"recv_errors\":%u}",
+      "{\"recv\":%u,\"sent\":%u,\"flood_tx\":%u,\"direct_tx\":%u,\"flood_rx\":%u,\"direct_rx\":%u,\"recv_errors\":%u,\"hash_calcs\":%u,\"hash_reused\":%u}",
       driver.getPacketsRecv(),
       driver.getPacketsSent(),
       n_sent_flood,
       n_sent_direct,
       n_recv_flood,
       n_recv_direct,
-      driver.getPacketsRecvErrors()
+      driver.getPacketsRecvErrors(),
+      mesh::Packet::getNumHashCalcs(),
+      mesh::Packet::getNumHashReused()
     );
   }
 };
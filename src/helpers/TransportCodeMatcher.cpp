@@ -0,0 +1,103 @@
+#include "TransportCodeMatcher.h"
+#include <string.h>
+
+#define HMAC_BLOCK_SIZE   64
+#define HMAC_HASH_SIZE    32
+
+static uint16_t reserveCodes(uint16_t code) {
+  if (code == 0) {     // reserve codes 0000 and FFFF
+    code++;
+  } else if (code == 0xFFFF) {
+    code--;
+  }
+  return code;
+}
+
+TransportCodeMatcher::TransportCodeMatcher(int capacity) {
+  if (capacity > 255) capacity = 255;
+  _capacity = capacity;
+  _keys = new KeySchedule[capacity];
+  _order = new uint8_t[capacity];
+  _num_keys = 0;
+  resetStats();
+}
+
+TransportCodeMatcher::~TransportCodeMatcher() {
+  delete[] _keys;
+  delete[] _order;
+}
+
+uint16_t TransportCodeMatcher::calcCode(const uint8_t key[], const mesh::Packet* packet) {
+  uint16_t code;
+  SHA256 sha;
+  sha.resetHMAC(key, TRANSPORT_KEY_SIZE);
+  uint8_t type = packet->getPayloadType();
+  sha.update(&type, 1);
+  sha.update(packet->payload, packet->payload_len);
+  sha.finalizeHMAC(key, TRANSPORT_KEY_SIZE, &code, 2);
+  return reserveCodes(code);
+}
+
+bool TransportCodeMatcher::addKey(const uint8_t key[], uint16_t tag) {
+  if (_num_keys >= _capacity) return false;  // full
+
+  auto k = &_keys[_num_keys];
+  uint8_t pad[HMAC_BLOCK_SIZE];
+
+  memset(pad, 0x36, sizeof(pad));    // inner pad
+  for (int i = 0; i < TRANSPORT_KEY_SIZE; i++) pad[i] ^= key[i];
+  k->inner.reset();
+  k->inner.update(pad, sizeof(pad));
+
+  memset(pad, 0x5C, sizeof(pad));    // outer pad
+  for (int i = 0; i < TRANSPORT_KEY_SIZE; i++) pad[i] ^= key[i];
+  k->outer.reset();
+  k->outer.update(pad, sizeof(pad));
+
+  memset(pad, 0, sizeof(pad));
+  k->tag = tag;
+  _order[_num_keys] = _num_keys;   // new keys go to back of match order
+  _num_keys++;
+  return true;
+}
+
+uint16_t TransportCodeMatcher::calcCodeAt(int i, const mesh::Packet* packet) {
+  auto k = &_keys[_order[i]];
+  uint8_t inner_hash[HMAC_HASH_SIZE];
+  uint16_t code;
+
+  SHA256 sha = k->inner;   // resume from pre-computed inner pad state
+  uint8_t type = packet->getPayloadType();
+  sha.update(&type, 1);
+  sha.update(packet->payload, packet->payload_len);
+  sha.finalize(inner_hash, sizeof(inner_hash));
+
+  sha = k->outer;   // resume from pre-computed outer pad state
+  sha.update(inner_hash, sizeof(inner_hash));
+  sha.finalize(&code, 2);
+
+  _n_hmacs++;
+  return reserveCodes(code);
+}
+
+void TransportCodeMatcher::promote(int i) {
+  uint8_t idx = _order[i];
+  while (i > 0) {
+    _order[i] = _order[i - 1];
+    i--;
+  }
+  _order[0] = idx;
+}
+
+int TransportCodeMatcher::findMatch(const mesh::Packet* packet) {
+  for (int i = 0; i < _num_keys; i++) {
+    if (matchesAt(i, packet)) {
+      int tag = getTagAt(i);
+      promote(i);
+      countLookup(true);
+      return tag;
+    }
+  }
+  countLookup(false);
+  return -1;  // no match
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <Packet.h>
+#include <SHA256.h>
+
+#ifndef TRANSPORT_MATCHER_MAX_KEYS
+  #define TRANSPORT_MATCHER_MAX_KEYS  32
+#endif
+
+#define TRANSPORT_KEY_SIZE   16
+
+/**
+ * \brief  Matches a packet's transport code against a set of (16 byte) transport keys.
+ *     Each key's HMAC-SHA256 schedule (hash state after the inner and outer pad blocks) is computed once,
+ *     in addKey(), so each match attempt only hashes the packet type + payload, plus one outer block.
+ *     Keys are tried in most-recently-matched order, so the busy regions are found first.
+*/
+class TransportCodeMatcher {
+  struct KeySchedule {
+    SHA256 inner;     // after absorbing (key ^ ipad)
+    SHA256 outer;     // after absorbing (key ^ opad)
+    uint16_t tag;
+  };
+
+  KeySchedule* _keys;
+  uint8_t* _order;     // indexes into _keys, most recently matched first
+  int _capacity, _num_keys;
+  uint32_t _n_lookups, _n_matches, _n_hmacs;
+
+public:
+  /**
+   * \param  capacity  max number of keys (max 255)
+  */
+  TransportCodeMatcher(int capacity = TRANSPORT_MATCHER_MAX_KEYS);
+  ~TransportCodeMatcher();
+
+  /**
+   * \brief  same as TransportKey::calcTransportCode(), ie. the HMAC of packet type + payload, with codes 0000 and FFFF reserved.
+  */
+  static uint16_t calcCode(const uint8_t key[], const mesh::Packet* packet);
+
+  int getCapacity() const { return _capacity; }
+  int getCount() const { return _num_keys; }
+  void clear() { _num_keys = 0; }
+
+  /**
+   * \brief  pre-compute the HMAC schedule for given key
+   * \param  tag   caller's identifier for this key, eg. index of owning region
+   * \returns  false if full
+  */
+  bool addKey(const uint8_t key[], uint16_t tag);
+
+  /**
+   * \param  i  position in match order, 0 .. getCount()-1
+  */
+  uint16_t getTagAt(int i) const { return _keys[_order[i]].tag; }
+
+  /**
+   * \brief  calculate the transport code for key at position 'i' (in match order)
+  */
+  uint16_t calcCodeAt(int i, const mesh::Packet* packet);
+
+  /**
+   * \brief  calcCodeAt() and compare with packet's first transport code
+  */
+  bool matchesAt(int i, const mesh::Packet* packet) { return calcCodeAt(i, packet) == packet->transport_codes[0]; }
+
+  /**
+   * \brief  move key at position 'i' to the front of the match order
+  */
+  void promote(int i);
+
+  /**
+   * \brief  find the first key (in match order) that produces the packet's transport code, and promote it.
+   * \returns  the key's tag, or -1 if none match
+  */
+  int findMatch(const mesh::Packet* packet);
+
+  void countLookup(bool matched) { _n_lookups++; if (matched) _n_matches++; }
+
+  uint32_t getNumLookups() const { return _n_lookups; }
+  uint32_t getNumMatches() const { return _n_matches; }
+  uint32_t getNumHMACs() const { return _n_hmacs; }    // total HMAC evaluations (calcCodeAt() calls)
+  void resetStats() { _n_lookups = _n_matches = _n_hmacs = 0; }
+};
@@ -1,42 +1,65 @@
 #include "TransportKeyStore.h"
+#include "TransportCodeMatcher.h"
 #include <SHA256.h>
 
 uint16_t TransportKey::calcTransportCode(const mesh::Packet* packet) const {
-  uint16_t code;
-  SHA256 sha;
-  sha.resetHMAC(key, sizeof(key));
-  uint8_t type = packet->getPayloadType();
-  sha.update(&type, 1);
-  sha.update(packet->payload, packet->payload_len);
-  sha.finalizeHMAC(key, sizeof(key), &code, 2);
-  if (code == 0) {     // reserve codes 0000 and FFFF
-    code++;
-  } else if (code == 0xFFFF) {
-    code--;
-  }
-  return code;
+  return TransportCodeMatcher::calcCode(key, packet);
 }
 
 bool TransportKey::isNull() const {
-  for (int i = 0; i < sizeof(key); i++) {
+  for (size_t i = 0; i < sizeof(key); i++) {
     if (key[i]) return false;
   }
   return true;  // key is all zeroes
 }
 
-void TransportKeyStore::putCache(uint16_t id, const TransportKey& key) {
+uint32_t TransportKeyStore::hashName(const char* name) {
+  uint32_t h = 2166136261UL;   // FNV-1a
+  while (*name) {
+    h = (h ^ (uint8_t) *name++) * 16777619UL;
+  }
+  return h == 0 ? 1 : h;   // 0 is reserved for loaded keys
+}
+
+void TransportKeyStore::putCache(uint16_t id, const TransportKey& key, uint32_t name_hash) {
+  int i;
   if (num_cache < MAX_TKS_ENTRIES) {
-    cache_ids[num_cache] = id;
-    cache_keys[num_cache] = key;
-    num_cache++;
-  } else {
-    // TODO: evict oldest cache entry
+    i = num_cache++;
+  } else {   // evict least recently used entry
+    i = 0;
+    for (int j = 1; j < num_cache; j++) {
+      if (cache_used[j] < cache_used[i]) i = j;
+    }
+    _n_evictions++;
+  }
+  cache_ids[i] = id;
+  cache_keys[i] = key;
+  cache_name_hash[i] = name_hash;
+  cache_used[i] = ++_lru_clock;
+}
+
+void TransportKeyStore::invalidateCache(uint16_t id) {
+  for (int i = 0; i < num_cache; ) {
+    if (cache_ids[i] == id) {
+      if (cache_name_hash[i] != 0) _dirty = true;   // auto key dropped, persisted file is now stale
+      num_cache--;
+      cache_ids[i] = cache_ids[num_cache];   // move last entry into this slot
+      cache_keys[i] = cache_keys[num_cache];
+      cache_name_hash[i] = cache_name_hash[num_cache];
+      cache_used[i] = cache_used[num_cache];
+    } else {
+      i++;
+    }
   }
+  _version++;
 }
 
 void TransportKeyStore::getAutoKeyFor(uint16_t id, const char* name, TransportKey& dest) {
+  uint32_t name_hash = hashName(name);
   for (int i = 0; i < num_cache; i++) {  // first, check cache
-    if (cache_ids[i] == id) {   // cache hit!
+    if (cache_ids[i] == id && cache_name_hash[i] == name_hash) {   // cache hit!
+      cache_used[i] = ++_lru_clock;
+      _n_hits++;
       dest = cache_keys[i];
       return;
     }
@@ -45,30 +68,118 @@ void TransportKeyStore::getAutoKeyFor(uint16_t id, const char* name, TransportKe
   SHA256 sha;
   sha.update(name, strlen(name));
   sha.finalize(&dest.key, sizeof(dest.key));
-
-  putCache(id, dest);
+  _n_misses++;
+
+  for (int i = 0; i < num_cache; i++) {   // replace stale entry, if region was renamed
+    if (cache_ids[i] == id && cache_name_hash[i] != 0) {
+      cache_keys[i] = dest;
+      cache_name_hash[i] = name_hash;
+      cache_used[i] = ++_lru_clock;
+      _dirty = true;
+      return;
+    }
+  }
+  bool evicting = num_cache >= MAX_TKS_ENTRIES;
+  putCache(id, dest, name_hash);
+  if (!evicting) _dirty = true;   // only as many keys as fit in cache are persisted, so eviction churn isn't saved
 }
 
 int TransportKeyStore::loadKeysFor(uint16_t id, TransportKey keys[], int max_num) {
   int n = 0;
   for (int i = 0; i < num_cache && n < max_num; i++) {  // first, check cache
-    if (cache_ids[i] == id) {
+    if (cache_ids[i] == id && cache_name_hash[i] == 0) {
+      cache_used[i] = ++_lru_clock;
       keys[n++] = cache_keys[i];
     }
   }
-  if (n > 0) return n;   // cache hit!
+  if (n > 0) {   // cache hit!
+    _n_hits++;
+    return n;
+  }
+  _n_misses++;
 
   // TODO:  retrieve from difficult-to-copy keystore
 
-  // store in cache (if room)
+  // store in cache
   for (int i = 0; i < n; i++) {
-    putCache(id, keys[i]);
+    putCache(id, keys[i], 0);
   }
   return n;
 }
 
+static File openWrite(FILESYSTEM* _fs, const char* filename) {
+  #if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+    _fs->remove(filename);
+    return _fs->open(filename, FILE_O_WRITE);
+  #elif defined(RP2040_PLATFORM)
+    return _fs->open(filename, "w");
+  #else
+    return _fs->open(filename, "w", true);
+  #endif
+}
+
+bool TransportKeyStore::load(FILESYSTEM* fs, const char* path) {
+  if (fs->exists(path ? path : "/tkeys")) {
+  #if defined(RP2040_PLATFORM)
+    File file = fs->open(path ? path : "/tkeys", "r");
+  #else
+    File file = fs->open(path ? path : "/tkeys");
+  #endif
+
+    if (file) {
+      invalidateCache();
+      while (num_cache < MAX_TKS_ENTRIES) {
+        int i = num_cache;
+        bool success = file.read((uint8_t *) &cache_ids[i], sizeof(cache_ids[i])) == sizeof(cache_ids[i]);
+        success = success && file.read((uint8_t *) &cache_name_hash[i], sizeof(cache_name_hash[i])) == sizeof(cache_name_hash[i]);
+        success = success && file.read(cache_keys[i].key, sizeof(cache_keys[i].key)) == sizeof(cache_keys[i].key);
+
+        if (!success) break; // EOF
+        if (cache_name_hash[i] == 0) continue;   // not an auto key, ignore
+
+        cache_used[i] = ++_lru_clock;
+        num_cache++;
+      }
+      file.close();
+      _dirty = false;
+      return true;
+    }
+  }
+  return false;  // failed
+}
+
+bool TransportKeyStore::save(FILESYSTEM* fs, const char* path) {
+  File file = openWrite(fs, path ? path : "/tkeys");
+  if (file) {
+    bool success = true;
+    for (int i = 0; i < num_cache && success; i++) {
+      if (cache_name_hash[i] == 0) continue;   // only auto keys are persisted (private keys belong in keystore)
+
+      success = file.write((uint8_t *) &cache_ids[i], sizeof(cache_ids[i])) == sizeof(cache_ids[i]);
+      success = success && file.write((uint8_t *) &cache_name_hash[i], sizeof(cache_name_hash[i])) == sizeof(cache_name_hash[i]);
+      success = success && file.write(cache_keys[i].key, sizeof(cache_keys[i].key)) == sizeof(cache_keys[i].key);
+    }
+    file.close();
+    _dirty = !success;
+    return success;
+  }
+  return false;  // failed
+}
+
+void TransportKeyStore::loopSave(FILESYSTEM* fs, unsigned long now, unsigned long delay_millis, const char* path) {
+  if (!_dirty) {
+    _save_pending = false;
+  } else if (!_save_pending) {
+    _save_due = now + delay_millis;
+    _save_pending = true;
+  } else if ((long)(now - _save_due) > 0) {
+    save(fs, path);   // if this fails, still dirty, so is retried after another delay
+    _save_pending = false;
+  }
+}
+
 bool TransportKeyStore::saveKeysFor(uint16_t id, const TransportKey keys[], int num) {
-  invalidateCache();
+  invalidateCache(id);
 
   // TODO: update hardware keystore
 
@@ -76,7 +187,7 @@ bool TransportKeyStore::saveKeysFor(uint16_t id, const TransportKey keys[], int
 }
 
 bool TransportKeyStore::removeKeys(uint16_t id) {
-  invalidateCache();
+  invalidateCache(id);
 
   // TODO: remove from hardware keystore
 
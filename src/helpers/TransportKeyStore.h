@@ -11,21 +11,61 @@ struct TransportKey {
   bool isNull() const;
 };
 
-#define MAX_TKS_ENTRIES   16
+#ifndef MAX_TKS_ENTRIES
+  #define MAX_TKS_ENTRIES   16
+#endif
 
+/**
+ * \brief  Transport keys for regions. Keys are held in a bounded LRU cache. Auto (hashtag) keys, which are derived from
+ *     the public region name, can be persisted with save()/load() so they don't need re-deriving after a reboot.
+ *     Only as many as fit in the cache are persisted, so keys re-derived after being evicted don't make it dirty.
+*/
 class TransportKeyStore {
   uint16_t     cache_ids[MAX_TKS_ENTRIES];
   TransportKey cache_keys[MAX_TKS_ENTRIES];
+  uint32_t     cache_name_hash[MAX_TKS_ENTRIES];   // auto keys: hash of region name, or 0 for a loaded (private) key
+  uint32_t     cache_used[MAX_TKS_ENTRIES];        // LRU stamp
   int num_cache;
+  uint32_t _lru_clock;
+  uint32_t _n_hits, _n_misses, _n_evictions;
+  uint16_t _version;
+  bool _dirty;    // has auto keys not yet persisted
+  bool _save_pending;
+  unsigned long _save_due;
 
-  void putCache(uint16_t id, const TransportKey& key);
-  void invalidateCache() { num_cache = 0; }
+  static uint32_t hashName(const char* name);
+  void putCache(uint16_t id, const TransportKey& key, uint32_t name_hash);
+  void invalidateCache(uint16_t id);
+  void invalidateCache() { num_cache = 0; _version++; }
 
 public:
-  TransportKeyStore() { num_cache = 0; }
+  TransportKeyStore() { num_cache = 0; _lru_clock = 0; _version = 0; _dirty = _save_pending = false; _save_due = 0; resetStats(); }
+
+  bool load(FILESYSTEM* fs, const char* path=NULL);
+  bool save(FILESYSTEM* fs, const char* path=NULL);
+  bool isDirty() const { return _dirty; }
+
+  /**
+   * \brief  call from main loop. Lazily persists newly derived auto keys, once they have been dirty for 'delay_millis',
+   *     so that a burst of new regions costs one write.
+   * \param  now   current millis()
+   */
+  void loopSave(FILESYSTEM* fs, unsigned long now, unsigned long delay_millis, const char* path=NULL);
+
+  /**
+   * \brief  changes whenever stored keys may have changed, so that pre-computed key schedules can be refreshed.
+   */
+  uint16_t getVersion() const { return _version; }
+
   void getAutoKeyFor(uint16_t id, const char* name, TransportKey& dest);
   int loadKeysFor(uint16_t id, TransportKey keys[], int max_num);
   bool saveKeysFor(uint16_t id, const TransportKey keys[], int num);
   bool removeKeys(uint16_t id);
   bool clear();
+
+  int getCacheCount() const { return num_cache; }
+  uint32_t getNumHits() const { return _n_hits; }
+  uint32_t getNumMisses() const { return _n_misses; }
+  uint32_t getNumEvictions() const { return _n_evictions; }
+  void resetStats() { _n_hits = _n_misses = _n_evictions = 0; }
 };
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <Packet.h>
+#include <Utils.h>
+#include <string.h>
+
+#ifndef VERIFIED_ADVERT_CACHE_SIZE
+  #if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+    #define VERIFIED_ADVERT_CACHE_SIZE  16
+  #else
+    #define VERIFIED_ADVERT_CACHE_SIZE  32
+  #endif
+#endif
+
+/**
+ * \brief  Cyclic table of adverts whose signature has been verified. Entries are keyed on the full pub_key and
+ *     timestamp, plus a full width SHA-256 of the signature and app_data, so a hit means the exact same (already
+ *     verified) advert, and can't be forged by colliding with a truncated packet hash.
+ *     Only adverts go in here, so entries outlive those in the general seen-packets table on a busy mesh.
+*/
+class VerifiedAdvertCache {
+  struct Entry {
+    uint8_t pub_key[PUB_KEY_SIZE];
+    uint32_t timestamp;
+    uint8_t digest[32];   // SHA-256 of signature + app_data
+  };
+  Entry _entries[VERIFIED_ADVERT_CACHE_SIZE];
+  int _next_idx;
+  uint32_t _hits, _misses;
+
+  static void calcDigest(uint8_t* digest, const uint8_t* signature, const uint8_t* app_data, int app_data_len) {
+    mesh::Utils::sha256(digest, 32, signature, SIGNATURE_SIZE, app_data, app_data_len);
+  }
+
+public:
+  VerifiedAdvertCache() {
+    memset(_entries, 0, sizeof(_entries));
+    _next_idx = 0;
+    _hits = _misses = 0;
+  }
+
+  bool contains(const uint8_t* pub_key, uint32_t timestamp, const uint8_t* signature, const uint8_t* app_data, int app_data_len) {
+    uint8_t digest[32];
+    bool calculated = false;
+    for (int i = 0; i < VERIFIED_ADVERT_CACHE_SIZE; i++) {
+      const Entry& e = _entries[i];
+      if (e.timestamp == timestamp && memcmp(e.pub_key, pub_key, PUB_KEY_SIZE) == 0) {
+        if (!calculated) { calcDigest(digest, signature, app_data, app_data_len); calculated = true; }
+        if (memcmp(e.digest, digest, sizeof(digest)) == 0) {
+          _hits++;
+          return true;
+        }
+      }
+    }
+    _misses++;
+    return false;
+  }
+
+  void add(const uint8_t* pub_key, uint32_t timestamp, const uint8_t* signature, const uint8_t* app_data, int app_data_len) {
+    Entry& e = _entries[_next_idx];
+    memcpy(e.pub_key, pub_key, PUB_KEY_SIZE);
+    e.timestamp = timestamp;
+    calcDigest(e.digest, signature, app_data, app_data_len);
+    _next_idx = (_next_idx + 1) % VERIFIED_ADVERT_CACHE_SIZE;  // cyclic table
+  }
+
+  uint32_t getNumHits() const { return _hits; }
+  uint32_t getNumMisses() const { return _misses; }
+  void resetStats() { _hits = _misses = 0; }
+};
@@ -1,41 +1,37 @@
 #pragma once
 
 #include "helpers/bridges/BridgeBase.h"
+#include "helpers/bridges/SerialFraming.h"
 
 #include <Stream.h>
 
 #ifdef WITH_RS232_BRIDGE
 
+#ifndef RS232_BRIDGE_FRAMING_V2
+  #define RS232_BRIDGE_FRAMING_V2  1   // 0 to only ever send the original (v1) frames
+#endif
+
 /**
  * @brief Bridge implementation using RS232/UART protocol for packet transport
  *
  * This bridge enables mesh packet transport over serial/UART connections,
- * allowing nodes to communicate over wired serial links. It implements a simple
- * packet framing protocol with checksums for reliable transfer.
+ * allowing nodes to communicate over wired serial links. Framing is done by
+ * SerialFraming, see there for the wire formats.
  *
  * Features:
  * - Point-to-point communication over hardware UART
- * - Fletcher-16 checksum for data integrity verification
- * - Magic header for packet synchronization and frame alignment
+ * - v1 frames: one packet per frame, magic header and Fletcher-16 checksum
+ * - v2 frames: COBS framed, CRC-16, several packets per frame when the link is busy
+ * - v2 is negotiated with a HELLO exchange, falling back to v1 for older peers
+ * - Received bytes are read and parsed in bulk
  * - Duplicate packet detection using SimpleMeshTables tracking
  * - Configurable RX/TX pins via build defines
- * - Fixed baud rate at 115200 for consistent timing
- *
- * Packet Structure:
- * [2 bytes] Magic Header (0xC03E) - Used to identify start of RS232Bridge packets
- * [2 bytes] Payload Length - Length of the mesh packet payload
- * [n bytes] Mesh Packet Payload - The actual mesh packet data
- * [2 bytes] Fletcher-16 Checksum - Calculated over the payload for integrity verification
- *
- * The Fletcher-16 checksum is calculated over the mesh packet payload and provides
- * error detection capabilities suitable for serial communication where electrical
- * noise, timing issues, or hardware problems could corrupt data. The checksum
- * validation ensures only valid packets are forwarded to the mesh.
  *
  * Configuration:
  * - Define WITH_RS232_BRIDGE to enable this bridge
  * - Define WITH_RS232_BRIDGE_RX with the RX pin number
  * - Define WITH_RS232_BRIDGE_TX with the TX pin number
+ * - Define RS232_BRIDGE_FRAMING_V2=0 to only use v1 frames
  *
  * Platform Support:
  * Different platforms require different pin configuration methods:
@@ -44,7 +40,7 @@
  * - RP2040: Uses SerialUART::setRX(rx) and SerialUART::setTX(tx)
  * - STM32: Uses HardwareSerial::setRx(rx) and HardwareSerial::setTx(tx)
  */
-class RS232Bridge : public BridgeBase {
+class RS232Bridge : public BridgeBase, public SerialFraming::Handler {
 public:
   /**
    * @brief Constructs an RS232Bridge instance
@@ -75,25 +71,19 @@ public:
   /**
    * @brief Main loop handler for processing incoming serial data
    *
-   * Implements a state machine for packet reception:
-   * 1. Searches for magic header bytes for packet synchronization
-   * 2. Reads length field to determine expected packet size
-   * 3. Validates packet length against maximum allowed size
-   * 4. Receives complete packet payload and checksum
-   * 5. Validates Fletcher-16 checksum for data integrity
-   * 6. Creates mesh packet and forwards if valid
+   * Reads all available bytes in chunks and passes them to SerialFraming,
+   * which calls onFramedPacket() for each valid packet received. Also lets
+   * SerialFraming send any batched packets, once the link is idle.
    */
   void loop() override;
 
   /**
    * @brief Called when a packet needs to be transmitted over serial
    *
-   * Formats the mesh packet with RS232 framing protocol:
-   * - Adds magic header for synchronization
-   * - Includes payload length field
-   * - Calculates Fletcher-16 checksum over payload
-   * - Transmits complete framed packet
-   * - Uses duplicate detection to prevent retransmission
+   * Serialises the mesh packet and passes it to SerialFraming, which sends it
+   * straight away as a v1 or v2 frame, or batches it into the next v2 frame if
+   * the previous one is still going out.
+   * Uses duplicate detection to prevent retransmission.
    *
    * @param packet The mesh packet to transmit
    */
@@ -110,39 +100,27 @@ public:
    */
   void onPacketReceived(mesh::Packet *packet) override;
 
-private:
   /**
-   * RS232 Protocol Structure:
-   * - Magic header: 2 bytes (packet identification)
-   * - Length field: 2 bytes (payload length)
-   * - Payload: variable bytes (mesh packet data)
-   * - Checksum: 2 bytes (Fletcher-16 over payload)
-   * Total overhead: 6 bytes
+   * @brief Called by SerialFraming for each packet in a valid received frame
+   *
+   * Parses the mesh packet and passes it to onPacketReceived().
    */
+  void onFramedPacket(const uint8_t *data, int len) override;
 
   /**
-   * @brief The total overhead of the serial protocol in bytes.
-   * Includes: MAGIC_WORD (2) + LENGTH (2) + CHECKSUM (2) = 6 bytes
+   * @brief Called by SerialFraming to write encoded frame bytes to the serial port
    */
-  static constexpr uint16_t SERIAL_OVERHEAD = BRIDGE_MAGIC_SIZE + BRIDGE_LENGTH_SIZE + BRIDGE_CHECKSUM_SIZE;
+  void writeFramed(const uint8_t *data, int len) override;
 
-  /**
-   * @brief The maximum size of a complete packet on the serial line.
-   *
-   * This is calculated as the sum of:
-   * - MAX_TRANS_UNIT + 1 for the maximum mesh packet size
-   * - SERIAL_OVERHEAD for the framing (magic + length + checksum)
-   */
-  static constexpr uint16_t MAX_SERIAL_PACKET_SIZE = (MAX_TRANS_UNIT + 1) + SERIAL_OVERHEAD;
+private:
+  /** Size of chunks read from the serial port */
+  static constexpr uint16_t RX_CHUNK_SIZE = 64;
 
   /** Hardware serial port interface */
   Stream *_serial;
 
-  /** Buffer for building received packets */
-  uint8_t _rx_buffer[MAX_SERIAL_PACKET_SIZE];
-
-  /** Current position in the receive buffer */
-  uint16_t _rx_buffer_pos = 0;
+  /** Encodes and decodes frames on the serial link */
+  SerialFraming _framing;
 };
 
 #endif
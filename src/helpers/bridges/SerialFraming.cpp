@@ -0,0 +1,304 @@
+#include "SerialFraming.h"
+
+#include <string.h>
+
+static_assert(SERIAL_FRAMING_MAX_FRAME >= SerialFraming::V2_MIN_FRAME, "SERIAL_FRAMING_MAX_FRAME too small for a max size packet");
+
+SerialFraming::SerialFraming(Handler *handler) : _handler(handler) {
+  begin(0, 115200, false);
+}
+
+void SerialFraming::begin(unsigned long now, uint32_t baud, bool enable_v2) {
+  _v2_enabled = enable_v2;
+  _peer_v2 = false;
+  _hello_due = false;
+  _peer_max_frame = SERIAL_FRAMING_MAX_FRAME;
+  _baud = baud > 0 ? baud : 115200;
+  _tx_busy_until = now;
+  _next_hello = now + SERIAL_FRAMING_HELLO_INTERVAL;
+  _rx_errors = _tx_frames = 0;
+  _tx_len = 0;
+  _rx_v1_pos = 0;
+  _rx_v2_len = 0;
+  _rx_v2_overflow = false;
+
+  if (_v2_enabled) sendHello(false, now);
+}
+
+uint16_t SerialFraming::fletcher16(const uint8_t *data, size_t len) {
+  uint8_t sum1 = 0, sum2 = 0;
+
+  for (size_t i = 0; i < len; i++) {
+    sum1 = (sum1 + data[i]) % 255;
+    sum2 = (sum2 + sum1) % 255;
+  }
+
+  return (sum2 << 8) | sum1;
+}
+
+uint16_t SerialFraming::crc16(const uint8_t *data, size_t len) {
+  static const uint16_t nibble_table[16] = {   // (4 bits at a time, to keep the table small)
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+  };
+  uint16_t crc = 0xFFFF;
+  for (size_t i = 0; i < len; i++) {
+    crc = (crc << 4) ^ nibble_table[(crc >> 12) ^ (data[i] >> 4)];
+    crc = (crc << 4) ^ nibble_table[(crc >> 12) ^ (data[i] & 0x0F)];
+  }
+  return crc;
+}
+
+size_t SerialFraming::cobsEncode(const uint8_t *src, size_t len, uint8_t *dest) {
+  size_t code_idx = 0, out = 1;
+  uint8_t code = 1;
+  for (size_t i = 0; i < len; i++) {
+    if (src[i] == 0) {
+      dest[code_idx] = code;
+      code_idx = out++;
+      code = 1;
+    } else {
+      dest[out++] = src[i];
+      if (++code == 0xFF) {   // max run of 254 non-zero bytes
+        dest[code_idx] = code;
+        code_idx = out++;
+        code = 1;
+      }
+    }
+  }
+  dest[code_idx] = code;
+  return out;
+}
+
+int SerialFraming::cobsDecode(const uint8_t *src, size_t len, uint8_t *dest) {
+  size_t in = 0, out = 0;
+  while (in < len) {
+    uint8_t code = src[in++];
+    if (code == 0 || in + code - 1 > len) return -1;
+
+    memmove(&dest[out], &src[in], code - 1);   // (out is always behind in, so can decode in place)
+    in += code - 1;
+    out += code - 1;
+    if (code < 0xFF && in < len) dest[out++] = 0;
+  }
+  return out;
+}
+
+void SerialFraming::writeWire(const uint8_t *data, int len, unsigned long now) {
+  _handler->writeFramed(data, len);
+
+  // estimate when the UART will have shifted this out (10 bits per byte, with start and stop bits). Rounded
+  // down, so the next frame is written just before the line goes idle, rather than after
+  unsigned long start = hasPassed(now, _tx_busy_until) ? now : _tx_busy_until;
+  _tx_busy_until = start + ((uint32_t)len * 10000) / _baud;
+}
+
+void SerialFraming::sendV1(const uint8_t *data, int len, unsigned long now) {
+  uint8_t *frame = _tx_wire;
+  frame[0] = (V1_MAGIC >> 8) & 0xFF;
+  frame[1] = V1_MAGIC & 0xFF;
+  frame[2] = (len >> 8) & 0xFF;
+  frame[3] = len & 0xFF;
+  memcpy(&frame[4], data, len);
+
+  uint16_t checksum = fletcher16(data, len);
+  frame[4 + len] = (checksum >> 8) & 0xFF;
+  frame[5 + len] = checksum & 0xFF;
+
+  writeWire(frame, len + V1_OVERHEAD, now);
+  _tx_frames++;
+}
+
+void SerialFraming::sendV2(const uint8_t *body, int len, unsigned long now, bool lead_delim) {
+  int i = 0;
+  if (lead_delim) _tx_wire[i++] = 0;   // terminates any partial frame (or noise) the peer may have
+  i += cobsEncode(body, len, &_tx_wire[i]);
+  _tx_wire[i++] = 0;
+  writeWire(_tx_wire, i, now);
+}
+
+void SerialFraming::sendHello(bool ack, unsigned long now) {
+  uint8_t body[6];
+  body[0] = V2_VERSION | V2_TYPE_HELLO;
+  body[1] = ack ? V2_HELLO_FLAG_ACK : 0;
+  body[2] = (SERIAL_FRAMING_MAX_FRAME >> 8) & 0xFF;
+  body[3] = SERIAL_FRAMING_MAX_FRAME & 0xFF;
+  uint16_t crc = crc16(body, 4);
+  body[4] = (crc >> 8) & 0xFF;
+  body[5] = crc & 0xFF;
+  sendV2(body, sizeof(body), now, true);
+}
+
+void SerialFraming::flush(unsigned long now) {
+  if (_tx_len == 0) return;
+
+  uint16_t crc = crc16(_tx_body, _tx_len);
+  _tx_body[_tx_len++] = (crc >> 8) & 0xFF;
+  _tx_body[_tx_len++] = crc & 0xFF;
+  sendV2(_tx_body, _tx_len, now, false);
+  _tx_len = 0;
+  _tx_frames++;
+}
+
+bool SerialFraming::sendPacket(const uint8_t *data, int len, unsigned long now) {
+  if (len <= 0 || len > MAX_PACKET_LEN) return false;
+
+  if (!_peer_v2) {
+    sendV1(data, len, now);
+    return true;
+  }
+
+  if (_tx_len > 0 && _tx_len + 2 + len + 2 > _peer_max_frame) {
+    flush(now);   // full, send what's batched so far
+  }
+  if (_tx_len == 0) _tx_body[_tx_len++] = V2_VERSION | V2_TYPE_PACKETS;
+  _tx_body[_tx_len++] = (len >> 8) & 0xFF;
+  _tx_body[_tx_len++] = len & 0xFF;
+  memcpy(&_tx_body[_tx_len], data, len);
+  _tx_len += len;
+
+  if (hasPassed(now, _tx_busy_until)) {
+    flush(now);   // link is idle, no point waiting
+  }
+  return true;
+}
+
+void SerialFraming::loop(unsigned long now) {
+  if (_tx_len > 0 && hasPassed(now, _tx_busy_until)) {
+    flush(now);
+  }
+  if (_v2_enabled && !_peer_v2 && (_hello_due || hasPassed(now, _next_hello))) {
+    sendHello(false, now);
+    _hello_due = false;
+    _next_hello = now + SERIAL_FRAMING_HELLO_INTERVAL;
+  }
+}
+
+void SerialFraming::fallbackToV1(unsigned long now) {
+  _peer_v2 = false;
+  _hello_due = true;   // in case peer was just slow to switch
+
+  for (int i = 1; i + 2 <= _tx_len; ) {   // re-send anything batched as v1
+    int pkt_len = (_tx_body[i] << 8) | _tx_body[i + 1];
+    sendV1(&_tx_body[i + 2], pkt_len, now);
+    i += 2 + pkt_len;
+  }
+  _tx_len = 0;
+}
+
+void SerialFraming::onReceived(const uint8_t *data, int len, unsigned long now) {
+  receiveV2(data, len, now);
+  receiveV1(data, len, now);
+}
+
+void SerialFraming::receiveV1(const uint8_t *data, int len, unsigned long now) {
+  int i = 0;
+  while (i < len) {
+    if (_rx_v1_pos == 0) {
+      // Waiting for magic word, skip ahead to next possible start of it
+      const uint8_t *start = (const uint8_t *)memchr(&data[i], (V1_MAGIC >> 8) & 0xFF, len - i);
+      if (start == NULL) break;
+      i = start - data;
+    }
+    if (_rx_v1_pos < 2) {
+      uint8_t b = data[i++];
+      if ((_rx_v1_pos == 0 && b == ((V1_MAGIC >> 8) & 0xFF)) || (_rx_v1_pos == 1 && b == (V1_MAGIC & 0xFF))) {
+        _rx_v1[_rx_v1_pos++] = b;
+      } else {
+        // Invalid magic byte, reset, but this byte could be the start of a new magic word
+        _rx_v1_pos = 0;
+        if (b == ((V1_MAGIC >> 8) & 0xFF)) _rx_v1[_rx_v1_pos++] = b;
+      }
+    } else if (_rx_v1_pos < 4) {
+      _rx_v1[_rx_v1_pos++] = data[i++];
+      if (_rx_v1_pos == 4 && ((_rx_v1[2] << 8) | _rx_v1[3]) > MAX_PACKET_LEN) {
+        _rx_v1_pos = 0;   // Invalid length, reset
+      }
+    } else {
+      // Payload and checksum, copied in bulk
+      int pkt_len = (_rx_v1[2] << 8) | _rx_v1[3];
+      int n = pkt_len + V1_OVERHEAD - _rx_v1_pos;
+      if (n > len - i) n = len - i;
+      memcpy(&_rx_v1[_rx_v1_pos], &data[i], n);
+      _rx_v1_pos += n;
+      i += n;
+
+      if (_rx_v1_pos == pkt_len + V1_OVERHEAD) { // Full packet received
+        uint16_t received_checksum = (_rx_v1[4 + pkt_len] << 8) | _rx_v1[5 + pkt_len];
+        if (received_checksum == fletcher16(&_rx_v1[4], pkt_len)) {
+          if (_peer_v2) fallbackToV1(now);   // peer has gone back to older firmware
+          _handler->onFramedPacket(&_rx_v1[4], pkt_len);
+        }
+        _rx_v1_pos = 0; // Reset for next packet
+      }
+    }
+  }
+}
+
+void SerialFraming::receiveV2(const uint8_t *data, int len, unsigned long now) {
+  int i = 0;
+  while (i < len) {
+    const uint8_t *delim = (const uint8_t *)memchr(&data[i], 0, len - i);
+    int n = delim ? delim - &data[i] : len - i;
+
+    if (_rx_v2_len + n > (int)sizeof(_rx_v2)) {
+      _rx_v2_overflow = true;   // too long for a v2 frame, drop until next delimiter
+    } else if (!_rx_v2_overflow) {
+      memcpy(&_rx_v2[_rx_v2_len], &data[i], n);
+      _rx_v2_len += n;
+    }
+    i += n;
+
+    if (delim) {
+      i++;
+      if (_rx_v2_len > 0 && !_rx_v2_overflow) {
+        int frame_len = cobsDecode(_rx_v2, _rx_v2_len, _rx_v2);
+        if (frame_len > 0) onV2Frame(_rx_v2, frame_len, now);
+      }
+      _rx_v2_len = 0;
+      _rx_v2_overflow = false;
+    }
+  }
+}
+
+void SerialFraming::onV2Frame(uint8_t *frame, int len, unsigned long now) {
+  if (len < 3 || (frame[0] & 0xF0) != V2_VERSION) {
+    return;   // most likely v1 frame bytes between zeroes, not an error
+  }
+  uint16_t received_crc = (frame[len - 2] << 8) | frame[len - 1];
+  if (received_crc != crc16(frame, len - 2)) {
+    _rx_errors++;
+    return;
+  }
+  len -= 2;
+
+  uint8_t type = frame[0] & 0x0F;
+  if (type == V2_TYPE_HELLO && len >= 4) {
+    if (!_v2_enabled) return;
+
+    uint16_t peer_max = (frame[2] << 8) | frame[3];
+    if (peer_max < V2_MIN_FRAME) return;   // can't take all packets in v2, so stay with v1
+
+    _peer_max_frame = peer_max < SERIAL_FRAMING_MAX_FRAME ? peer_max : SERIAL_FRAMING_MAX_FRAME;
+    _peer_v2 = true;
+    _hello_due = false;
+    if (!(frame[1] & V2_HELLO_FLAG_ACK)) {
+      sendHello(true, now);   // peer doesn't know about us yet (eg. has just started)
+    }
+  } else if (type == V2_TYPE_PACKETS) {
+    // check all lengths first, so a malformed frame is dropped as a whole
+    int i = 1;
+    while (i + 2 <= len) {
+      i += 2 + ((frame[i] << 8) | frame[i + 1]);
+    }
+    if (i != len) {
+      _rx_errors++;
+      return;
+    }
+    for (i = 1; i < len; ) {
+      int pkt_len = (frame[i] << 8) | frame[i + 1];
+      if (pkt_len > 0 && pkt_len <= MAX_PACKET_LEN) _handler->onFramedPacket(&frame[i + 2], pkt_len);
+      i += 2 + pkt_len;
+    }
+  }
+}
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <MeshCore.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef SERIAL_FRAMING_MAX_FRAME
+  #define SERIAL_FRAMING_MAX_FRAME        512    // max v2 frame body (before COBS), ie. several max size packets
+#endif
+
+#ifndef SERIAL_FRAMING_HELLO_INTERVAL
+  #define SERIAL_FRAMING_HELLO_INTERVAL   5000   // millis, between HELLOs while the peer isn't known to speak v2
+#endif
+
+/**
+ * @brief Packet framing for a serial bridge link, independent of the UART itself
+ *
+ * Two wire formats are understood, and both are always accepted on receive:
+ *
+ * v1 (the original RS232Bridge format), one mesh packet per frame:
+ * [2 bytes] Magic Header (0xC03E)
+ * [2 bytes] Payload Length
+ * [n bytes] Mesh Packet Payload
+ * [2 bytes] Fletcher-16 Checksum over the payload
+ *
+ * v2, a COBS encoded body followed by a 0x00 delimiter, so a receiver re-syncs at the
+ * next zero byte after any corruption. The body (before encoding) is:
+ * [1 byte]  Version (high nibble, 2) and Frame Type (low nibble)
+ * [n bytes] Frame Type PACKETS: one or more of { [2 bytes] Length, [n bytes] Mesh Packet }
+ *           Frame Type HELLO: [1 byte] Flags, [2 bytes] Max Frame Body this end accepts
+ * [2 bytes] CRC-16/CCITT over all of the above
+ *
+ * Negotiation: v2 is only transmitted once a HELLO has been received from the peer, so an
+ * older peer only ever sees v1 frames (plus the occasional HELLO, which it ignores as noise).
+ * HELLOs are sent at begin(), then periodically until one is received. A HELLO without the
+ * ACK flag is answered with one that has it. If a v1 frame is received after negotiating,
+ * the peer is assumed to have been replaced with older firmware, and this end falls back to v1.
+ *
+ * In v2, packets sent while the previous frame is still going out on the wire (estimated
+ * from the baud rate) are batched into the next frame, so under bursty traffic the per-frame
+ * overhead is paid once for several packets, while a lone packet on an idle link isn't delayed.
+ */
+class SerialFraming {
+public:
+  /**
+   * @brief Callbacks from SerialFraming to the owning bridge
+   */
+  class Handler {
+  public:
+    /**
+     * @brief Called for each mesh packet in a received frame with a valid checksum
+     */
+    virtual void onFramedPacket(const uint8_t *data, int len) = 0;
+
+    /**
+     * @brief Called to send encoded frame bytes out on the serial link
+     */
+    virtual void writeFramed(const uint8_t *data, int len) = 0;
+  };
+
+  static constexpr uint16_t V1_MAGIC = 0xC03E;   // same as BridgeBase::BRIDGE_PACKET_MAGIC
+  static constexpr uint16_t V1_OVERHEAD = 6;
+  static constexpr uint16_t MAX_PACKET_LEN = MAX_TRANS_UNIT + 1;
+
+  static constexpr uint8_t V2_VERSION = 0x20;
+  static constexpr uint8_t V2_TYPE_PACKETS = 0x00;
+  static constexpr uint8_t V2_TYPE_HELLO = 0x01;
+  static constexpr uint8_t V2_HELLO_FLAG_ACK = 0x01;
+
+  /** Smallest v2 frame body which can hold a max size packet */
+  static constexpr uint16_t V2_MIN_FRAME = 1 + 2 + MAX_PACKET_LEN + 2;
+
+  /** Max size of a COBS encoded v2 frame on the wire, including the delimiter */
+  static constexpr uint16_t V2_MAX_WIRE_FRAME = SERIAL_FRAMING_MAX_FRAME + SERIAL_FRAMING_MAX_FRAME / 254 + 2;
+
+  /**
+   * @param handler Receives decoded packets, and writes encoded frames
+   */
+  SerialFraming(Handler *handler);
+
+  /**
+   * @brief Resets link state, and sends a HELLO if v2 is enabled
+   *
+   * @param now Current millis()
+   * @param baud Baud rate of the link, for estimating when a frame has finished going out
+   * @param enable_v2 false to only ever send v1 frames (and never answer HELLOs)
+   */
+  void begin(unsigned long now, uint32_t baud, bool enable_v2 = true);
+
+  /**
+   * @brief Parses received bytes, in whatever size chunks they were read
+   */
+  void onReceived(const uint8_t *data, int len, unsigned long now);
+
+  /**
+   * @brief Sends a mesh packet, immediately, or batched into the next v2 frame
+   *
+   * @return false if the packet is too large
+   */
+  bool sendPacket(const uint8_t *data, int len, unsigned long now);
+
+  /**
+   * @brief Sends any batched packets once the link is idle, and periodic HELLOs
+   */
+  void loop(unsigned long now);
+
+  /** @return true if the peer is known to accept v2 frames */
+  bool isV2() const { return _peer_v2; }
+
+  /** @return number of received frames dropped for bad checksum or format */
+  uint32_t getRxErrors() const { return _rx_errors; }
+
+  /** @return number of frames sent (not counting HELLOs) */
+  uint32_t getTxFrames() const { return _tx_frames; }
+
+  static uint16_t fletcher16(const uint8_t *data, size_t len);
+
+  /** @brief CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF) */
+  static uint16_t crc16(const uint8_t *data, size_t len);
+
+  /**
+   * @brief COBS encodes 'len' bytes, to at most len + len/254 + 1 bytes (no delimiter added)
+   *
+   * @return encoded length
+   */
+  static size_t cobsEncode(const uint8_t *src, size_t len, uint8_t *dest);
+
+  /**
+   * @brief Decodes COBS data (without the delimiter). Can be done in place (dest == src).
+   *
+   * @return decoded length, or -1 if invalid
+   */
+  static int cobsDecode(const uint8_t *src, size_t len, uint8_t *dest);
+
+private:
+  Handler *_handler;
+  bool _v2_enabled;
+  bool _peer_v2;
+  bool _hello_due;
+  uint16_t _peer_max_frame;
+  uint32_t _baud;
+  unsigned long _tx_busy_until;
+  unsigned long _next_hello;
+  uint32_t _rx_errors;
+  uint32_t _tx_frames;
+
+  uint8_t _tx_body[SERIAL_FRAMING_MAX_FRAME];   // v2 frame being batched, without CRC
+  uint16_t _tx_len;                             // 0 if nothing batched
+  uint8_t _tx_wire[V2_MAX_WIRE_FRAME + 1];      // (+1 for leading delimiter of HELLO)
+
+  uint8_t _rx_v1[MAX_PACKET_LEN + V1_OVERHEAD];
+  uint16_t _rx_v1_pos;
+  uint8_t _rx_v2[V2_MAX_WIRE_FRAME];
+  uint16_t _rx_v2_len;
+  bool _rx_v2_overflow;
+
+  static bool hasPassed(unsigned long now, unsigned long t) { return (long)(now - t) >= 0; }
+
+  void writeWire(const uint8_t *data, int len, unsigned long now);
+  void sendV1(const uint8_t *data, int len, unsigned long now);
+  void sendV2(const uint8_t *body, int len, unsigned long now, bool lead_delim);
+  void sendHello(bool ack, unsigned long now);
+  void flush(unsigned long now);
+  void fallbackToV1(unsigned long now);
+
+  void receiveV1(const uint8_t *data, int len, unsigned long now);
+  void receiveV2(const uint8_t *data, int len, unsigned long now);
+  void onV2Frame(uint8_t *frame, int len, unsigned long now);
+};
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../BaseSerialInterface.h"
+#include "../FrameQueue.h"
 #include <BLEDevice.h>
 #include <BLEServer.h>
 #include <BLEUtils.h>
@@ -18,18 +19,10 @@ class SerialBLEInterface : public BaseSerialInterface, BLESecurityCallbacks, BLE
   unsigned long _last_write;
   unsigned long adv_restart_time;
 
-  struct Frame {
-    uint8_t len;
-    uint8_t buf[MAX_FRAME_SIZE];
-  };
+  FrameQueue recv_queue;   // filled by onWrite(), in the BLE task
+  FrameQueue send_queue;
 
-  #define FRAME_QUEUE_SIZE  4
-  int recv_queue_len;
-  Frame recv_queue[FRAME_QUEUE_SIZE];
-  int send_queue_len;
-  Frame send_queue[FRAME_QUEUE_SIZE];
-
-  void clearBuffers() { recv_queue_len = 0; send_queue_len = 0; }
+  void clearBuffers() { recv_queue.clear(); send_queue.clear(); }
 
 protected:
   // BLESecurityCallbacks methods
@@ -49,7 +42,7 @@ protected:
   void onWrite(BLECharacteristic* pCharacteristic, esp_ble_gatts_cb_param_t* param) override;
 
 public:
-  SerialBLEInterface() {
+  SerialBLEInterface() : recv_queue(SERIAL_RECV_QUEUE_SIZE), send_queue(SERIAL_SEND_QUEUE_SIZE) {
     pServer = NULL;
     pService = NULL;
     deviceConnected = false;
@@ -58,7 +51,6 @@ public:
     _isEnabled = false;
     _last_write = 0;
     last_conn_id = 0;
-    send_queue_len = recv_queue_len = 0;
   }
 
   /**
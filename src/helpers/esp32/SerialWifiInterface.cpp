@@ -25,22 +25,17 @@ size_t SerialWifiInterface::writeFrame(const uint8_t src[], size_t len) {
   }
 
   if (deviceConnected && len > 0) {
-    if (send_queue_len >= FRAME_QUEUE_SIZE) {
+    if (!send_queue.push(src, len)) {
       WIFI_DEBUG_PRINTLN("writeFrame(), send_queue is full!");
       return 0;
     }
-
-    send_queue[send_queue_len].len = len;  // add to send queue
-    memcpy(send_queue[send_queue_len].buf, src, len);
-    send_queue_len++;
-
     return len;
   }
   return 0;
 }
 
 bool SerialWifiInterface::isWriteBusy() const {
-  return false;
+  return send_queue.getFreeBytes() < SERIAL_SEND_QUEUE_RESERVE;
 }
 
 bool SerialWifiInterface::hasReceivedFrameHeader() {
@@ -82,21 +77,14 @@ size_t SerialWifiInterface::checkRecvFrame(uint8_t dest[]) {
   }
 
   if (deviceConnected) {
-    if (send_queue_len > 0) {   // first, check send queue
+    if (!send_queue.isEmpty()) {   // first, check send queue
       
       _last_write = millis();
-      int len = send_queue[0].len;
-
-      uint8_t pkt[3+len]; // use same header as serial interface so client can delimit frames
-      pkt[0] = '>';
-      pkt[1] = (len & 0xFF);  // LSB
-      pkt[2] = (len >> 8);    // MSB
-      memcpy(&pkt[3], send_queue[0].buf, send_queue[0].len);
-      client.write(pkt, 3 + len);
-      send_queue_len--;
-      for (int i = 0; i < send_queue_len; i++) {   // delete top item from queue
-        send_queue[i] = send_queue[i + 1];
-      }
+
+      // use same header as serial interface so client can delimit frames, which also means
+      // several queued frames can go in one write
+      int len = send_queue.popFramed(write_buf, sizeof(write_buf), '>');
+      client.write(write_buf, len);
     } else {
 
       // check if we are waiting for a frame header
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../BaseSerialInterface.h"
+#include "../FrameQueue.h"
 #include <WiFi.h>
 
 class SerialWifiInterface : public BaseSerialInterface {
@@ -17,29 +18,23 @@ class SerialWifiInterface : public BaseSerialInterface {
     uint16_t length;
   };
 
-  struct Frame {
-    uint8_t len;
-    uint8_t buf[MAX_FRAME_SIZE];
-  };
-
   FrameHeader received_frame_header;
 
-  #define FRAME_QUEUE_SIZE  4
-  int recv_queue_len;
-  Frame recv_queue[FRAME_QUEUE_SIZE];
-  int send_queue_len;
-  Frame send_queue[FRAME_QUEUE_SIZE];
+  #ifndef WIFI_WRITE_BATCH_SIZE
+    #define WIFI_WRITE_BATCH_SIZE  1436   // one TCP segment (typical MSS)
+  #endif
+  FrameQueue send_queue;
+  uint8_t write_buf[WIFI_WRITE_BATCH_SIZE];   // queued frames, coalesced into one write
 
-  void clearBuffers() { recv_queue_len = 0; send_queue_len = 0; }
+  void clearBuffers() { send_queue.clear(); }
 
 protected:
 
 public:
-  SerialWifiInterface() : server(WiFiServer()), client(WiFiClient()) {
+  SerialWifiInterface() : server(WiFiServer()), client(WiFiClient()), send_queue(SERIAL_SEND_QUEUE_SIZE) {
     deviceConnected = false;
     _isEnabled = false;
     _last_write = 0;
-    send_queue_len = recv_queue_len = 0;
     received_frame_header.type = 0;
     received_frame_header.length = 0;
   }
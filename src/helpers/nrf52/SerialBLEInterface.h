@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../BaseSerialInterface.h"
+#include "../FrameQueue.h"
 #include <bluefruit.h>
 
 #ifndef BLE_TX_POWER
@@ -16,22 +17,10 @@ class SerialBLEInterface : public BaseSerialInterface {
   unsigned long _last_health_check;
   unsigned long _last_retry_attempt;
 
-  struct Frame {
-    uint8_t len;
-    uint8_t buf[MAX_FRAME_SIZE];
-  };
-
-  #define FRAME_QUEUE_SIZE  12
-  
-  uint8_t send_queue_len;
-  Frame send_queue[FRAME_QUEUE_SIZE];
-  
-  uint8_t recv_queue_len;
-  Frame recv_queue[FRAME_QUEUE_SIZE];
+  FrameQueue send_queue;
+  FrameQueue recv_queue;   // filled by onBleUartRX()
 
   void clearBuffers();
-  void shiftSendQueueLeft();
-  void shiftRecvQueueLeft();
   bool isValidConnection(uint16_t handle, bool requireWaitingForSecurity = false) const;
   bool isAdvertising() const;
   static void onConnect(uint16_t connection_handle);
@@ -43,14 +32,12 @@ class SerialBLEInterface : public BaseSerialInterface {
   static void onBleUartRX(uint16_t conn_handle);
 
 public:
-  SerialBLEInterface() {
+  SerialBLEInterface() : send_queue(SERIAL_SEND_QUEUE_SIZE), recv_queue(SERIAL_RECV_QUEUE_SIZE) {
     _isEnabled = false;
     _isDeviceConnected = false;
     _conn_handle = BLE_CONN_HANDLE_INVALID;
     _last_health_check = 0;
     _last_retry_attempt = 0;
-    send_queue_len = 0;
-    recv_queue_len = 0;
   }
 
   /**
@@ -0,0 +1,14 @@
+#pragma once
+
+// Mock Arduino.h for native testing
+// Only provides the C headers that sources expect it to pull in, plus the few non-standard helpers they use
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static inline char* ltoa(long value, char* dest, int radix) {
+  sprintf(dest, radix == 16 ? "%lx" : "%ld", value);
+  return dest;
+}
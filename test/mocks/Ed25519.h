@@ -0,0 +1,16 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#define ED25519_NO_SEED  1
+#include <ed_25519.h>
+
+// Mock of the Crypto library's Ed25519 class for native testing
+// Signature verification is done with lib/ed25519 (as used for signing and key exchange)
+
+class Ed25519 {
+public:
+  static bool verify(const uint8_t* signature, const uint8_t* public_key, const void* message, size_t len) {
+    return ed25519_verify(signature, (const unsigned char*) message, len, public_key) != 0;
+  }
+};
@@ -0,0 +1,68 @@
+#pragma once
+
+// Mock of the ESP32 style FS / File classes, for native testing
+// Files are kept in a host directory, and bytes written are counted (eg. for flash wear comparisons)
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <unistd.h>
+#include <sys/stat.h>
+
+class File {
+  FILE* _f;
+  uint32_t* _bytes_written;
+public:
+  File() : _f(NULL), _bytes_written(NULL) { }
+  File(FILE* f, uint32_t* bytes_written) : _f(f), _bytes_written(bytes_written) { }
+
+  operator bool() const { return _f != NULL; }
+  size_t read(uint8_t* buf, size_t len) { return _f ? fread(buf, 1, len, _f) : 0; }
+  size_t write(const uint8_t* buf, size_t len) {
+    size_t n = _f ? fwrite(buf, 1, len, _f) : 0;
+    if (_bytes_written) *_bytes_written += n;
+    return n;
+  }
+  bool seek(uint32_t pos) { return _f && fseek(_f, pos, SEEK_SET) == 0; }
+  size_t position() { return _f ? ftell(_f) : 0; }
+  size_t size() {
+    if (!_f) return 0;
+    long pos = ftell(_f);
+    fseek(_f, 0, SEEK_END);
+    long len = ftell(_f);
+    fseek(_f, pos, SEEK_SET);
+    return len;
+  }
+  void close() { if (_f) fclose(_f); _f = NULL; }
+};
+
+namespace fs {
+
+class FS {
+  std::string _root;
+  std::string path(const char* p) const { return _root + p; }
+public:
+  uint32_t bytes_written = 0;
+  int meta_ops_left = -1;   // simulates power loss: remove()/rename() do nothing once this reaches 0
+
+  bool metaOp() {
+    if (meta_ops_left == 0) return false;
+    if (meta_ops_left > 0) meta_ops_left--;
+    return true;
+  }
+
+  FS(const char* root_dir) : _root(root_dir) { ::mkdir(root_dir, 0755); }
+
+  File open(const char* p, const char* mode="r", bool create=false) {
+    if (mode[0] == 'r' && !exists(p)) return File();
+    FILE* f = fopen(path(p).c_str(), strcmp(mode, "r") == 0 ? "rb" : strcmp(mode, "r+") == 0 ? "r+b" : strcmp(mode, "a") == 0 ? "ab" : "wb");
+    return File(f, &bytes_written);
+  }
+  bool exists(const char* p) const { struct stat st; return stat(path(p).c_str(), &st) == 0; }
+  bool remove(const char* p) { return metaOp() && ::remove(path(p).c_str()) == 0; }
+  bool rename(const char* from, const char* to) { return metaOp() && ::rename(path(from).c_str(), path(to).c_str()) == 0; }
+  bool mkdir(const char* p) { return ::mkdir(path(p).c_str(), 0755) == 0; }
+};
+
+}
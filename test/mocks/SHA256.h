@@ -4,11 +4,51 @@
 #include <stddef.h>
 
 // Mock SHA256 class for testing
-// Provides minimal interface to allow Utils.cpp to compile
+// Provides minimal interface to allow Utils.cpp to compile.
+// finalize() gives a deterministic (non-cryptographic) digest of the data, so that
+// different packets get different hashes. The HMAC methods follow the real (ipad/opad) construction
+// over that digest.
 class SHA256 {
+  uint64_t _state = 0xcbf29ce484222325ULL;   // FNV-1a
+
+  void padKey(const uint8_t* key, size_t keyLen, uint8_t pad) {
+    uint8_t block[64];
+    for (size_t i = 0; i < sizeof(block); i++) {
+      block[i] = pad ^ (i < keyLen ? key[i] : 0);
+    }
+    update(block, sizeof(block));
+  }
 public:
-  void update(const uint8_t* data, size_t len) {}
-  void finalize(uint8_t* hash, size_t hashLen) {}
-  void resetHMAC(const uint8_t* key, size_t keyLen) {}
-  void finalizeHMAC(const uint8_t* key, size_t keyLen, uint8_t* hash, size_t hashLen) {}
+  void reset() { _state = 0xcbf29ce484222325ULL; }
+  void update(const void* data, size_t len) {
+    const uint8_t* p = (const uint8_t*) data;
+    for (size_t i = 0; i < len; i++) {
+      _state = (_state ^ p[i]) * 0x100000001b3ULL;
+    }
+  }
+  void finalize(void* hash, size_t hashLen) {
+    uint8_t* dest = (uint8_t*) hash;
+    uint64_t x = _state;
+    for (size_t i = 0; i < hashLen; i++) {
+      if ((i & 7) == 0) {   // splitmix64 step
+        x += 0x9e3779b97f4a7c15ULL;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        x ^= x >> 31;
+      }
+      dest[i] = (uint8_t) (x >> ((i & 7) * 8));
+    }
+  }
+  void resetHMAC(const uint8_t* key, size_t keyLen) {
+    reset();
+    padKey(key, keyLen, 0x36);
+  }
+  void finalizeHMAC(const uint8_t* key, size_t keyLen, void* hash, size_t hashLen) {
+    uint8_t inner[32];
+    finalize(inner, sizeof(inner));
+    reset();
+    padKey(key, keyLen, 0x5C);
+    update(inner, sizeof(inner));
+    finalize(hash, hashLen);
+  }
 };
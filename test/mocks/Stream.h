@@ -1,10 +1,16 @@
 #pragma once
 
+#include <stdint.h>
+#include <stddef.h>
+
 // Mock Stream class for native testing
-// Provides minimal interface needed by Utils.h
+// Provides minimal interface needed by Utils.h and Identity
 
 class Stream {
 public:
+    virtual size_t write(const uint8_t* src, size_t len) { return len; }
+    virtual size_t readBytes(uint8_t* dest, size_t len) { return 0; }
     virtual void print(char c) {}
     virtual void print(const char* str) {}
+    void println() { print('\n'); }
 };
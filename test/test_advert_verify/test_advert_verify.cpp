@@ -0,0 +1,206 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <stdio.h>
+#include <vector>
+#include <algorithm>
+#include <random>
+#include "helpers/SimpleMeshTables.h"
+#include "helpers/HashedMeshTables.h"
+#include "helpers/SimpleMeshCaches.h"
+#define ED25519_NO_SEED  1
+#include <ed_25519.h>
+
+using namespace mesh;
+
+struct TestNode {
+  uint8_t pub_key[PUB_KEY_SIZE];
+  uint8_t prv_key[64];
+};
+
+static void makeNode(TestNode& node, uint32_t id) {
+  uint8_t seed[32];
+  memset(seed, 0, sizeof(seed));
+  memcpy(seed, &id, sizeof(id));
+  ed25519_create_keypair(node.pub_key, node.prv_key, seed);
+}
+
+// same layout as Mesh::createAdvert()
+static void makeAdvert(Packet& pkt, const TestNode& node, uint32_t timestamp, const char* name) {
+  pkt.header = (PAYLOAD_TYPE_ADVERT << PH_TYPE_SHIFT) | ROUTE_TYPE_FLOOD;
+  pkt.path_len = 0;
+  int len = 0;
+  memcpy(&pkt.payload[len], node.pub_key, PUB_KEY_SIZE); len += PUB_KEY_SIZE;
+  memcpy(&pkt.payload[len], &timestamp, 4); len += 4;
+  uint8_t* signature = &pkt.payload[len]; len += SIGNATURE_SIZE;
+  int app_data_len = strlen(name);
+  memcpy(&pkt.payload[len], name, app_data_len); len += app_data_len;
+  pkt.payload_len = len;
+
+  uint8_t message[PUB_KEY_SIZE + 4 + MAX_ADVERT_DATA_SIZE];
+  int msg_len = 0;
+  memcpy(&message[msg_len], node.pub_key, PUB_KEY_SIZE); msg_len += PUB_KEY_SIZE;
+  memcpy(&message[msg_len], &timestamp, 4); msg_len += 4;
+  memcpy(&message[msg_len], name, app_data_len); msg_len += app_data_len;
+  ed25519_sign(signature, message, msg_len, node.pub_key, node.prv_key);
+  pkt.invalidateHash();
+}
+
+static void makeOther(Packet& pkt, uint32_t id) {
+  pkt.header = (PAYLOAD_TYPE_ACK << PH_TYPE_SHIFT) | ROUTE_TYPE_FLOOD;
+  pkt.path_len = 0;
+  pkt.payload_len = 4;
+  memcpy(pkt.payload, &id, 4);
+  pkt.invalidateHash();
+}
+
+// emulates the ADVERT part of Mesh::onRecvPacket(), returns true if advert was accepted
+// (caches NULL for no cache)
+static bool recvAdvert(MeshTables& tables, MeshCaches* caches, const Packet* pkt, uint32_t& n_verifies) {
+  if (tables.hasSeen(pkt)) return false;
+
+  const uint8_t* pub_key = pkt->payload;
+  uint32_t timestamp;
+  memcpy(&timestamp, &pkt->payload[PUB_KEY_SIZE], 4);
+  const uint8_t* signature = &pkt->payload[PUB_KEY_SIZE + 4];
+  const uint8_t* app_data = &pkt->payload[PUB_KEY_SIZE + 4 + SIGNATURE_SIZE];
+  int app_data_len = pkt->payload_len - (PUB_KEY_SIZE + 4 + SIGNATURE_SIZE);
+
+  if (caches && caches->isVerifiedAdvert(pub_key, timestamp, signature, app_data, app_data_len)) return true;
+
+  uint8_t message[PUB_KEY_SIZE + 4 + MAX_ADVERT_DATA_SIZE];
+  int msg_len = 0;
+  memcpy(&message[msg_len], pub_key, PUB_KEY_SIZE + 4); msg_len += PUB_KEY_SIZE + 4;
+  memcpy(&message[msg_len], app_data, app_data_len); msg_len += app_data_len;
+  n_verifies++;
+  bool is_ok = ed25519_verify(signature, message, msg_len, pub_key);
+  if (is_ok && caches) caches->setVerifiedAdvert(pub_key, timestamp, signature, app_data, app_data_len);
+  return is_ok;
+}
+
+TEST(VerifiedAdvertCache, SkipsReVerify) {
+  SimpleMeshTables tables;
+  SimpleMeshCaches caches;
+  TestNode node;
+  makeNode(node, 1);
+  Packet advert, other;
+  makeAdvert(advert, node, 1000, "node1");
+
+  uint32_t n_verifies = 0;
+  EXPECT_TRUE(recvAdvert(tables, &caches, &advert, n_verifies));
+  EXPECT_EQ(1u, n_verifies);
+  EXPECT_FALSE(recvAdvert(tables, &caches, &advert, n_verifies));   // dup, via seen table
+  EXPECT_EQ(1u, n_verifies);
+
+  for (uint32_t i = 0; i < MAX_PACKET_HASHES; i++) {   // flush seen table
+    makeOther(other, i);
+    tables.hasSeen(&other);
+  }
+  EXPECT_TRUE(recvAdvert(tables, &caches, &advert, n_verifies));   // 'new' again, but already verified
+  EXPECT_EQ(1u, n_verifies);
+  EXPECT_EQ(1u, caches.getAdvertCache().getNumHits());
+
+  makeAdvert(advert, node, 1001, "node1");   // new timestamp, must be verified
+  EXPECT_TRUE(recvAdvert(tables, &caches, &advert, n_verifies));
+  EXPECT_EQ(2u, n_verifies);
+}
+
+TEST(VerifiedAdvertCache, ForgedNotCached) {
+  HashedMeshTables tables(16);
+  SimpleMeshCaches caches;
+  TestNode node;
+  makeNode(node, 2);
+  Packet advert;
+  makeAdvert(advert, node, 1000, "node2");
+  advert.payload[PUB_KEY_SIZE + 4 + SIGNATURE_SIZE] ^= 1;   // tamper with app_data
+  advert.invalidateHash();
+
+  uint32_t n_verifies = 0;
+  EXPECT_FALSE(recvAdvert(tables, &caches, &advert, n_verifies));
+  const uint8_t* p = advert.payload;
+  uint32_t ts = 1000;
+  EXPECT_FALSE(caches.isVerifiedAdvert(p, ts, &p[PUB_KEY_SIZE + 4], &p[PUB_KEY_SIZE + 4 + SIGNATURE_SIZE], 5));
+}
+
+TEST(VerifiedAdvertCache, SamePacketHashPrefixStillVerified) {
+  SimpleMeshTables tables;
+  SimpleMeshCaches caches;
+  TestNode node;
+  makeNode(node, 3);
+  Packet advert, forged;
+  makeAdvert(advert, node, 1000, "node3");
+
+  uint32_t n_verifies = 0;
+  ASSERT_TRUE(recvAdvert(tables, &caches, &advert, n_verifies));
+
+  // same pub_key and timestamp, different app_data and a bogus signature: even if its (truncated) packet hash
+  // happened to collide with the genuine advert's, the cache must miss, and verify must reject it
+  makeAdvert(forged, node, 1000, "node3!");
+  forged.payload[PUB_KEY_SIZE + 4] ^= 0x80;
+  forged.invalidateHash();
+  EXPECT_FALSE(recvAdvert(tables, &caches, &forged, n_verifies));
+  EXPECT_EQ(2u, n_verifies);
+  EXPECT_EQ(0u, caches.getAdvertCache().getNumHits());
+
+  const uint8_t* p = advert.payload;
+  const uint8_t* sig = &p[PUB_KEY_SIZE + 4];
+  uint8_t other_sig[SIGNATURE_SIZE];
+  memcpy(other_sig, sig, SIGNATURE_SIZE);
+  other_sig[SIGNATURE_SIZE - 1] ^= 1;
+  uint32_t ts = 1000;
+  EXPECT_TRUE(caches.isVerifiedAdvert(p, ts, sig, (const uint8_t*)"node3", 5));
+  EXPECT_FALSE(caches.isVerifiedAdvert(p, ts, other_sig, (const uint8_t*)"node3", 5));
+  EXPECT_FALSE(caches.isVerifiedAdvert(p, ts + 1, sig, (const uint8_t*)"node3", 5));
+}
+
+// Busy mesh: each round every node sends a new advert (new timestamp), heard 4 times via different repeaters
+// spread over the round, with 3 other packets per advert copy flowing through the seen-packets table.
+static void benchAdverts(int num_nodes, bool use_cache) {
+  const int ROUNDS = 2, COPIES = 4, OTHERS = 3;
+  std::vector<TestNode> nodes(num_nodes);
+  for (int i = 0; i < num_nodes; i++) makeNode(nodes[i], i + 100);
+
+  std::vector<Packet> adverts(num_nodes * ROUNDS);
+  std::vector<int> events;   // >= 0: advert index, < 0: other packet
+  std::mt19937 rng(42);
+  for (int r = 0; r < ROUNDS; r++) {
+    std::vector<int> round;
+    for (int i = 0; i < num_nodes; i++) {
+      makeAdvert(adverts[r*num_nodes + i], nodes[i], 1000 + r*3600, "repeater");
+      for (int c = 0; c < COPIES; c++) round.push_back(r*num_nodes + i);
+      for (int c = 0; c < COPIES*OTHERS; c++) round.push_back(-1);
+    }
+    std::shuffle(round.begin(), round.end(), rng);
+    events.insert(events.end(), round.begin(), round.end());
+  }
+
+  SimpleMeshTables tables;
+  SimpleMeshCaches caches;
+  Packet other;
+  uint32_t n_verifies = 0, n_accepted = 0, n_other = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < events.size(); i++) {
+    if (events[i] >= 0) {
+      n_accepted += recvAdvert(tables, use_cache ? &caches : NULL, &adverts[events[i]], n_verifies);
+    } else {
+      makeOther(other, n_other++);
+      tables.hasSeen(&other);
+    }
+  }
+  double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  printf("  %4d nodes, %s: %u adverts accepted, %u verifies, %.0f adverts/sec\n", num_nodes,
+    use_cache ? "verified cache" : "no cache      ", n_accepted, n_verifies, n_accepted / secs);
+}
+
+TEST(VerifiedAdvertBenchmark, BusyMesh) {
+  printf("\n");
+  const int sizes[] = { 50, 300 };
+  for (int i = 0; i < 2; i++) {
+    benchAdverts(sizes[i], false);
+    benchAdverts(sizes[i], true);
+  }
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
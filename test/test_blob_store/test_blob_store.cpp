@@ -0,0 +1,227 @@
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <random>
+#include <vector>
+#include "helpers/BlobStore.h"
+
+#define MAX_LEN  166   // as per companion MAX_ADVERT_PKT_LEN
+#define SLOT_SIZE  180   // header + MAX_LEN, padded
+
+class BlobStoreTest : public ::testing::Test {
+protected:
+  char dir[64];
+  fs::FS* fs;
+  std::mt19937 rng{1};
+
+  void SetUp() override {
+    strcpy(dir, "/tmp/blobstoreXXXXXX");
+    ASSERT_TRUE(mkdtemp(dir) != NULL);
+    fs = new fs::FS(dir);
+  }
+  void TearDown() override {
+    fs->remove("/blobs");
+    rmdir(dir);
+    delete fs;
+  }
+  std::vector<uint8_t> randomBytes(int len) {
+    std::vector<uint8_t> v(len);
+    for (auto& b : v) b = rng() & 0xFF;
+    return v;
+  }
+  long fileSize() {
+    File f = fs->open("/blobs", "r");
+    long len = f ? f.size() : -1;
+    f.close();
+    return len;
+  }
+};
+
+TEST_F(BlobStoreTest, PutGetRemove) {
+  BlobStore store("/blobs", 10, MAX_LEN);
+  ASSERT_TRUE(store.begin(fs));
+  EXPECT_EQ(10 * SLOT_SIZE, fileSize());
+
+  auto key = randomBytes(32);
+  auto blob = randomBytes(100);
+  uint8_t buf[255];
+  EXPECT_EQ(0, store.get(key.data(), buf));
+  ASSERT_TRUE(store.put(key.data(), blob.data(), blob.size(), 1000));
+  ASSERT_EQ(100, store.get(key.data(), buf));
+  EXPECT_EQ(0, memcmp(buf, blob.data(), 100));
+
+  auto blob2 = randomBytes(MAX_LEN);   // replace
+  ASSERT_TRUE(store.put(key.data(), blob2.data(), blob2.size(), 1001));
+  EXPECT_EQ(1, store.getNumBlobs());
+  ASSERT_EQ(MAX_LEN, store.get(key.data(), buf));
+  EXPECT_EQ(0, memcmp(buf, blob2.data(), MAX_LEN));
+
+  EXPECT_FALSE(store.put(key.data(), blob2.data(), MAX_LEN + 1, 1002));   // too long
+
+  auto other = key;
+  other[6] ^= 1;   // differs in key prefix
+  EXPECT_EQ(0, store.get(other.data(), buf));
+  other = key;
+  other[7] ^= 1;   // only matched by 7 byte prefix
+  EXPECT_EQ(MAX_LEN, store.get(other.data(), buf));
+
+  EXPECT_TRUE(store.remove(key.data()));
+  EXPECT_EQ(0, store.get(key.data(), buf));
+  EXPECT_EQ(0, store.getNumBlobs());
+  EXPECT_TRUE(store.remove(key.data()));   // not found is ok
+}
+
+TEST_F(BlobStoreTest, ReloadsIndex) {
+  std::vector<std::vector<uint8_t>> keys, blobs;
+  {
+    BlobStore store("/blobs", 50, MAX_LEN);
+    ASSERT_TRUE(store.begin(fs));
+    for (int i = 0; i < 40; i++) {
+      keys.push_back(randomBytes(32));
+      blobs.push_back(randomBytes(100 + i));
+      ASSERT_TRUE(store.put(keys[i].data(), blobs[i].data(), blobs[i].size(), 1000 + i));
+    }
+    store.remove(keys[5].data());
+  }
+  BlobStore store("/blobs", 50, MAX_LEN);
+  ASSERT_TRUE(store.begin(fs));
+  EXPECT_EQ(39, store.getNumBlobs());
+  uint8_t buf[255];
+  for (int i = 0; i < 40; i++) {
+    if (i == 5) {
+      EXPECT_EQ(0, store.get(keys[i].data(), buf));
+    } else {
+      ASSERT_EQ(blobs[i].size(), store.get(keys[i].data(), buf));
+      EXPECT_EQ(0, memcmp(buf, blobs[i].data(), blobs[i].size()));
+    }
+  }
+}
+
+TEST_F(BlobStoreTest, LoadsLegacyFile) {
+  // as per original NRF52 "/adv_blobs": BlobRec[20], pre-allocated with zeroes
+  struct BlobRec {
+    uint32_t timestamp;
+    uint8_t  key[7];
+    uint8_t  len;
+    uint8_t  data[MAX_LEN];
+  } recs[20];
+  memset(recs, 0, sizeof(recs));
+  auto key = randomBytes(32);
+  recs[3].timestamp = 1234;
+  memcpy(recs[3].key, key.data(), 7);
+  recs[3].len = 120;
+  memset(recs[3].data, 0x55, 120);
+  File f = fs->open("/blobs", "w", true);
+  f.write((uint8_t *)recs, sizeof(recs));
+  f.close();
+
+  BlobStore store("/blobs", 30, MAX_LEN);   // more slots than file has
+  ASSERT_TRUE(store.begin(fs));
+  EXPECT_EQ(30 * (long)sizeof(BlobRec), fileSize());
+  EXPECT_EQ(1, store.getNumBlobs());
+  uint8_t buf[255];
+  ASSERT_EQ(120, store.get(key.data(), buf));
+  EXPECT_EQ(0x55, buf[119]);
+}
+
+TEST_F(BlobStoreTest, ReplacesLeastRecentlyUsed) {
+  BlobStore store("/blobs", 4, MAX_LEN);
+  ASSERT_TRUE(store.begin(fs));
+  std::vector<std::vector<uint8_t>> keys;
+  auto blob = randomBytes(100);
+  for (int i = 0; i < 4; i++) {
+    keys.push_back(randomBytes(32));
+    ASSERT_TRUE(store.put(keys[i].data(), blob.data(), blob.size(), 1000 + i));
+  }
+  uint8_t buf[255];
+  EXPECT_EQ(100, store.get(keys[0].data(), buf));   // 0 now most recently used, 1 is least
+
+  keys.push_back(randomBytes(32));
+  ASSERT_TRUE(store.put(keys[4].data(), blob.data(), blob.size(), 1004));
+  EXPECT_EQ(4, store.getNumBlobs());
+  EXPECT_EQ(0, store.get(keys[1].data(), buf));
+  EXPECT_EQ(100, store.get(keys[0].data(), buf));
+  EXPECT_EQ(100, store.get(keys[2].data(), buf));
+
+  // after reboot, order is by timestamp (time of put), so 0 is now the oldest
+  BlobStore store2("/blobs", 4, MAX_LEN);
+  ASSERT_TRUE(store2.begin(fs));
+  keys.push_back(randomBytes(32));
+  ASSERT_TRUE(store2.put(keys[5].data(), blob.data(), blob.size(), 1005));
+  EXPECT_EQ(0, store2.get(keys[0].data(), buf));
+  EXPECT_EQ(100, store2.get(keys[3].data(), buf));
+  EXPECT_EQ(100, store2.get(keys[4].data(), buf));
+  EXPECT_EQ(100, store2.get(keys[5].data(), buf));
+}
+
+TEST_F(BlobStoreTest, RecreatesBadFile) {
+  File f = fs->open("/blobs", "w", true);
+  uint8_t junk[50];
+  memset(junk, 0xAA, sizeof(junk));
+  f.write(junk, sizeof(junk));
+  f.close();
+
+  BlobStore store("/blobs", 8, MAX_LEN);
+  ASSERT_TRUE(store.begin(fs));
+  EXPECT_EQ(8 * SLOT_SIZE, fileSize());
+  EXPECT_EQ(0, store.getNumBlobs());
+}
+
+// ------------- benchmark (timings only, no pass/fail) -------------
+
+// the original NRF52 getBlobByKey(), ie. sequential scan of the records
+static uint8_t scanGet(fs::FS* fs, const uint8_t key[], uint8_t dest[]) {
+  File file = fs->open("/blobs", "r");
+  uint8_t rec[SLOT_SIZE];
+  uint8_t len = 0;
+  while (file.read(rec, sizeof(rec)) == sizeof(rec)) {
+    if (memcmp(key, &rec[4], BLOB_STORE_KEY_SIZE) == 0) {
+      len = rec[BLOB_STORE_HEADER_SIZE - 1];
+      memcpy(dest, &rec[BLOB_STORE_HEADER_SIZE], len);
+      break;
+    }
+  }
+  file.close();
+  return len;
+}
+
+TEST_F(BlobStoreTest, BenchmarkLookup) {
+  const int SIZES[] = { 20, 100, 350, 1000 };
+  const int LOOKUPS = 2000;
+  printf("\n  records | scan us/lookup | index us/lookup | scan bytes read/lookup | index bytes read/lookup\n");
+  for (int n : SIZES) {
+    fs->remove("/blobs");
+    BlobStore store("/blobs", n, MAX_LEN);
+    ASSERT_TRUE(store.begin(fs));
+    std::vector<std::vector<uint8_t>> keys;
+    for (int i = 0; i < n; i++) {
+      keys.push_back(randomBytes(32));
+      auto blob = randomBytes(MAX_LEN);
+      ASSERT_TRUE(store.put(keys[i].data(), blob.data(), blob.size(), i));
+    }
+    std::vector<int> order;
+    for (int i = 0; i < LOOKUPS; i++) order.push_back(rng() % n);
+
+    uint8_t buf[255];
+    int found = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i : order) found += scanGet(fs, keys[i].data(), buf) > 0;
+    auto t1 = std::chrono::steady_clock::now();
+    for (int i : order) found += store.get(keys[i].data(), buf) > 0;
+    auto t2 = std::chrono::steady_clock::now();
+    EXPECT_EQ(2 * LOOKUPS, found);
+
+    // file bytes read: scan reads half the file on average, index reads just the blob
+    double scan_bytes = (n + 1) / 2.0 * SLOT_SIZE;
+    printf("  %7d | %14.2f | %15.2f | %22.0f | %23d\n", n,
+        std::chrono::duration<double, std::micro>(t1 - t0).count() / LOOKUPS,
+        std::chrono::duration<double, std::micro>(t2 - t1).count() / LOOKUPS,
+        scan_bytes, MAX_LEN);
+  }
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,196 @@
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include <random>
+#include "helpers/BaseChatMesh.h"
+#include "helpers/SimpleMeshTables.h"
+#include "helpers/StaticPoolPacketManager.h"
+
+using namespace mesh;
+
+class TestClock : public MillisecondClock {
+public:
+  unsigned long now = 1000;
+  unsigned long getMillis() override { return now; }
+};
+
+class TestRTC : public RTCClock {
+public:
+  uint32_t now = 1700000000;
+  uint32_t getCurrentTime() override { return now; }
+  void setCurrentTime(uint32_t time) override { now = time; }
+};
+
+class TestRNG : public RNG {
+  std::mt19937 _rng;
+public:
+  TestRNG(uint32_t seed) : _rng(seed) { }
+  void random(uint8_t* dest, size_t sz) override { for (size_t i = 0; i < sz; i++) dest[i] = _rng() & 0xFF; }
+};
+
+// hands out one queued frame per recvRaw(), transmitted frames are dropped
+class LoopbackRadio : public Radio {
+public:
+  uint8_t rx_frame[MAX_TRANS_UNIT];
+  int rx_len = 0;
+
+  int recvRaw(uint8_t* bytes, int sz) override {
+    int len = rx_len;
+    if (len > 0) {
+      memcpy(bytes, rx_frame, len);
+      rx_len = 0;
+    }
+    return len;
+  }
+  uint32_t getEstAirtimeFor(int len_bytes) override { return 0; }
+  float packetScore(float snr, int packet_len) override { return 1.0f; }
+  bool startSendRaw(const uint8_t* bytes, int len) override { return true; }
+  bool isSendComplete() override { return true; }
+  void onSendFinished() override { }
+  bool isInRecvMode() const override { return true; }
+};
+
+// records kept in RAM, counting storage reads (as flash reads are the expensive part)
+class RamColdStore : public ContactColdStore {
+  std::vector<ContactInfo> _recs;
+public:
+  int reads = 0;
+
+  RamColdStore(int max_records) : ContactColdStore(max_records), _recs(max_records) { }
+
+protected:
+  bool readRecord(int rec, ContactInfo& dest) override { reads++; dest = _recs[rec]; return true; }
+  bool writeRecord(int rec, const ContactInfo& src) override { _recs[rec] = src; return true; }
+  bool eraseRecord(int rec) override { memset(_recs[rec].id.pub_key, 0, PUB_KEY_SIZE); return true; }
+};
+
+class TestChatMesh : public BaseChatMesh {
+public:
+  int num_msgs = 0;
+  uint8_t last_from[PUB_KEY_SIZE];
+  char last_text[64];
+
+  TestChatMesh(Radio& radio, MillisecondClock& ms, RNG& rng, RTCClock& rtc, PacketManager& mgr, MeshTables& tables)
+    : BaseChatMesh(radio, ms, rng, rtc, mgr, tables) { }
+
+  using BaseChatMesh::setColdStore;
+
+protected:
+  float getAirtimeBudgetFactor() const override { return 0.0f; }
+  void onDiscoveredContact(ContactInfo& contact, bool is_new, uint8_t path_len, const uint8_t* path) override { }
+  ContactInfo* processAck(const uint8_t *data) override { return NULL; }
+  void onContactPathUpdated(const ContactInfo& contact) override { }
+  void onMessageRecv(const ContactInfo& contact, mesh::Packet* pkt, uint32_t sender_timestamp, const char *text) override {
+    num_msgs++;
+    memcpy(last_from, contact.id.pub_key, PUB_KEY_SIZE);
+    snprintf(last_text, sizeof(last_text), "%s", text);
+  }
+  void onCommandDataRecv(const ContactInfo& contact, mesh::Packet* pkt, uint32_t sender_timestamp, const char *text) override { }
+  void onSignedMessageRecv(const ContactInfo& contact, mesh::Packet* pkt, uint32_t sender_timestamp, const uint8_t *sender_prefix, const char *text) override { }
+  uint32_t calcFloodTimeoutMillisFor(uint32_t pkt_airtime_millis) const override { return 1000; }
+  uint32_t calcDirectTimeoutMillisFor(uint32_t pkt_airtime_millis, uint8_t path_len) const override { return 1000; }
+  void onSendTimeout() override { }
+  void onChannelMessageRecv(const mesh::GroupChannel& channel, mesh::Packet* pkt, uint32_t timestamp, const char *text) override { }
+  uint8_t onContactRequest(const ContactInfo& contact, uint32_t sender_timestamp, const uint8_t* data, uint8_t len, uint8_t* reply) override { return 0; }
+  void onContactResponse(const ContactInfo& contact, const uint8_t* data, uint8_t len) override { }
+};
+
+class ChatColdPeersTest : public ::testing::Test {
+protected:
+  TestClock ms;
+  TestRTC rtc;
+  TestRNG rng{1};
+  LoopbackRadio radio;
+  StaticPoolPacketManager mgr{8};
+  SimpleMeshTables tables;
+  TestChatMesh mesh{radio, ms, rng, rtc, mgr, tables};
+  RamColdStore cold{8};
+
+  void SetUp() override {
+    mesh.self_id = LocalIdentity(&rng);
+    mesh.begin();
+    mesh.setColdStore(&cold);
+  }
+
+  // a new identity, whose 1-byte hash is 'hash'
+  LocalIdentity makeIdentity(uint8_t hash) {
+    for (;;) {
+      LocalIdentity id(&rng);
+      if (id.pub_key[0] == hash) return id;
+    }
+  }
+
+  static ContactInfo makeContact(const Identity& id) {
+    ContactInfo c = ContactInfo();
+    c.id = id;
+    c.type = ADV_TYPE_CHAT;
+    c.out_path_len = OUT_PATH_UNKNOWN;
+    return c;
+  }
+
+  // delivers a plain text message, sent directly (zero hop) to 'mesh' by 'sender'
+  void receiveMessage(const LocalIdentity& sender, const char* text) {
+    uint8_t secret[PUB_KEY_SIZE];
+    sender.calcSharedSecret(secret, mesh.self_id);
+
+    uint8_t data[5 + 32];
+    uint32_t timestamp = rtc.now;
+    memcpy(data, &timestamp, 4);
+    data[4] = TXT_TYPE_PLAIN << 2;
+    int len = 5 + strlen(text);
+    memcpy(&data[5], text, len - 5);
+
+    // the datagram is built by a node with the sender's identity
+    TestClock sender_ms;
+    LoopbackRadio sender_radio;
+    StaticPoolPacketManager sender_mgr(1);
+    SimpleMeshTables sender_tables;
+    TestChatMesh sender_mesh(sender_radio, sender_ms, rng, rtc, sender_mgr, sender_tables);
+    sender_mesh.self_id = sender;
+    Packet* pkt = sender_mesh.createDatagram(PAYLOAD_TYPE_TXT_MSG, mesh.self_id, secret, data, len);
+    ASSERT_TRUE(pkt != NULL);
+    pkt->header = (pkt->header & ~PH_ROUTE_MASK) | ROUTE_TYPE_DIRECT;
+    pkt->path_len = 0;
+    radio.rx_len = pkt->writeTo(radio.rx_frame);
+    sender_mgr.free(pkt);
+
+    ms.now++;
+    mesh.loop();
+  }
+};
+
+TEST_F(ChatColdPeersTest, ColdContactSharingHashWithHotContactStillDecrypts) {
+  LocalIdentity hot = makeIdentity(0x5A);
+  LocalIdentity other = makeIdentity(0x5A);
+  ASSERT_TRUE(mesh.addContact(makeContact(hot)));
+  ASSERT_TRUE(mesh.addContact(makeContact(other)));
+
+  LocalIdentity sender = makeIdentity(0x5A);   // same hash as both hot contacts
+  ASSERT_TRUE(cold.store(makeContact(sender)));
+
+  receiveMessage(sender, "from the cold store");
+  ASSERT_EQ(1, mesh.num_msgs);
+  EXPECT_EQ(0, memcmp(sender.pub_key, mesh.last_from, PUB_KEY_SIZE));
+  EXPECT_STREQ("from the cold store", mesh.last_text);
+  EXPECT_EQ(3u, mesh.getNumPeerTries());   // both hot contacts were tried first
+  EXPECT_TRUE(mesh.lookupContactByPubKey(sender.pub_key, PUB_KEY_SIZE) != NULL);   // paged in
+}
+
+TEST_F(ChatColdPeersTest, ColdStoreNotReadWhenHotContactMatches) {
+  LocalIdentity hot = makeIdentity(0x33);
+  ASSERT_TRUE(mesh.addContact(makeContact(hot)));
+  LocalIdentity spilled = makeIdentity(0x33);
+  ASSERT_TRUE(cold.store(makeContact(spilled)));
+
+  receiveMessage(hot, "hello");
+  ASSERT_EQ(1, mesh.num_msgs);
+  EXPECT_EQ(0, memcmp(hot.pub_key, mesh.last_from, PUB_KEY_SIZE));
+  EXPECT_EQ(1u, mesh.getNumPeerTries());
+  EXPECT_EQ(0, cold.reads);
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,139 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <stdio.h>
+#include "Utils.h"
+#include "CipherContext.h"
+#include "helpers/CipherContextCache.h"
+
+using namespace mesh;
+
+static void makeSecret(uint8_t* secret, uint8_t seed) {
+  for (int i = 0; i < PUB_KEY_SIZE; i++) secret[i] = (uint8_t) (seed * 31 + i * 7);
+}
+
+TEST(CipherContext, SameResultAsSecret) {
+  uint8_t secret[PUB_KEY_SIZE];
+  makeSecret(secret, 1);
+  CipherContext ctx;
+  ctx.setKey(secret);
+
+  uint8_t plain[100], a[MAX_PACKET_PAYLOAD], b[MAX_PACKET_PAYLOAD], out[MAX_PACKET_PAYLOAD];
+  for (int i = 0; i < (int)sizeof(plain); i++) plain[i] = i;
+
+  for (int len = 1; len <= (int)sizeof(plain); len += 13) {
+    int a_len = Utils::encryptThenMAC(secret, a, plain, len);
+    int b_len = Utils::encryptThenMAC(ctx, b, plain, len);
+    ASSERT_EQ(a_len, b_len);
+    ASSERT_EQ(0, memcmp(a, b, a_len));
+
+    ASSERT_GE(Utils::MACThenDecrypt(ctx, out, a, a_len), len);
+    EXPECT_EQ(0, memcmp(out, plain, len));
+    ASSERT_GE(Utils::MACThenDecrypt(secret, out, b, b_len), len);
+    EXPECT_EQ(0, memcmp(out, plain, len));
+  }
+}
+
+TEST(CipherContext, RejectsBadMAC) {
+  uint8_t secret[PUB_KEY_SIZE], other[PUB_KEY_SIZE];
+  makeSecret(secret, 1);
+  makeSecret(other, 2);
+  CipherContext ctx, other_ctx;
+  ctx.setKey(secret);
+  other_ctx.setKey(other);
+
+  uint8_t plain[20], enc[MAX_PACKET_PAYLOAD], out[MAX_PACKET_PAYLOAD];
+  memset(plain, 0x55, sizeof(plain));
+  int len = Utils::encryptThenMAC(ctx, enc, plain, sizeof(plain));
+  EXPECT_EQ(0, Utils::MACThenDecrypt(other_ctx, out, enc, len));
+  enc[0] ^= 1;
+  EXPECT_EQ(0, Utils::MACThenDecrypt(ctx, out, enc, len));
+  EXPECT_EQ(0, Utils::MACThenDecrypt(ctx, out, enc, CIPHER_MAC_SIZE));   // no data
+}
+
+TEST(CipherContextCache, LRUEviction) {
+  CipherContextCache cache;
+  uint8_t secret[PUB_KEY_SIZE];
+  for (int i = 0; i < CIPHER_CONTEXT_CACHE_SIZE; i++) {
+    makeSecret(secret, i);
+    cache.get(secret);
+  }
+  EXPECT_EQ((uint32_t) CIPHER_CONTEXT_CACHE_SIZE, cache.getNumMisses());
+  makeSecret(secret, 0);
+  CipherContext* first = cache.get(secret);   // touch first entry, so second becomes least recently used
+  EXPECT_EQ(1u, cache.getNumHits());
+
+  makeSecret(secret, 100);
+  cache.get(secret);
+  EXPECT_EQ(1u, cache.getNumEvictions());
+  makeSecret(secret, 0);
+  EXPECT_EQ(first, cache.get(secret));
+  makeSecret(secret, 1);
+  cache.get(secret);   // was evicted
+  EXPECT_EQ(2u, cache.getNumHits());
+  EXPECT_EQ(2u, cache.getNumEvictions());
+}
+
+TEST(CipherContextCache, FindDoesNotInsert) {
+  CipherContextCache cache;
+  uint8_t secret[PUB_KEY_SIZE];
+  for (int i = 0; i < CIPHER_CONTEXT_CACHE_SIZE; i++) {
+    makeSecret(secret, i);
+    cache.put(secret);
+  }
+  for (int i = 0; i < 50; i++) {   // eg. junk packets, or mis-matched candidates: lookups only
+    makeSecret(secret, 100 + i);
+    EXPECT_TRUE(cache.find(secret) == NULL);
+  }
+  EXPECT_EQ(0u, cache.getNumEvictions());
+  for (int i = 0; i < CIPHER_CONTEXT_CACHE_SIZE; i++) {
+    makeSecret(secret, i);
+    EXPECT_TRUE(cache.find(secret) != NULL);
+  }
+}
+
+// ------------- benchmark (timings only, no pass/fail) -------------
+
+// Group channel receive: each packet is tried against 'candidates' channels (matching 1-byte hash), right one last.
+TEST(CipherContextBenchmark, DecryptThroughput) {
+  const int PACKETS = 20000;
+  const int sizes[] = { 16, 48, 96, 160 };   // plaintext bytes (ACK-like, short msg, typical msg, long msg)
+  printf("\n  plain  candidates  secret(ns/pkt)  cached ctx(ns/pkt)\n");
+  for (int s = 0; s < 4; s++) {
+    for (int candidates = 1; candidates <= 4; candidates *= 2) {
+      uint8_t secrets[4][PUB_KEY_SIZE];
+      for (int c = 0; c < candidates; c++) makeSecret(secrets[c], c + 1);
+      CipherContextCache cache;
+
+      uint8_t plain[MAX_PACKET_PAYLOAD], enc[MAX_PACKET_PAYLOAD], out[MAX_PACKET_PAYLOAD];
+      memset(plain, 0x41, sizes[s]);
+      int enc_len = Utils::encryptThenMAC(secrets[candidates - 1], enc, plain, sizes[s]);
+
+      volatile int total = 0;
+      auto start = std::chrono::steady_clock::now();
+      for (int i = 0; i < PACKETS; i++) {
+        enc[CIPHER_MAC_SIZE] = plain[0];   // keep compiler honest
+        for (int c = 0; c < candidates; c++) {
+          int len = Utils::MACThenDecrypt(secrets[c], out, enc, enc_len);
+          if (len > 0) { total += len; break; }
+        }
+      }
+      double t_secret = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / PACKETS;
+
+      start = std::chrono::steady_clock::now();
+      for (int i = 0; i < PACKETS; i++) {
+        enc[CIPHER_MAC_SIZE] = plain[0];
+        for (int c = 0; c < candidates; c++) {
+          int len = Utils::MACThenDecrypt(*cache.get(secrets[c]), out, enc, enc_len);
+          if (len > 0) { total += len; break; }
+        }
+      }
+      double t_ctx = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / PACKETS;
+      printf("  %5d  %10d  %14.1f  %18.1f\n", sizes[s], candidates, t_secret, t_ctx);
+    }
+  }
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
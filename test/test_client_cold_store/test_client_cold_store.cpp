@@ -0,0 +1,137 @@
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <random>
+#include "helpers/ClientColdStore.h"
+
+class ClientColdStoreTest : public ::testing::Test {
+protected:
+  char dir[64];
+  fs::FS* fs;
+  std::mt19937 rng;
+
+  void SetUp() override {
+    strcpy(dir, "/tmp/clientcoldXXXXXX");
+    ASSERT_TRUE(mkdtemp(dir) != NULL);
+    fs = new fs::FS(dir);
+    rng.seed(7);
+  }
+  void TearDown() override {
+    fs->remove("/cold");
+    rmdir(dir);
+    delete fs;
+  }
+
+  void makeClient(ClientInfo& c) {
+    memset(&c, 0, sizeof(c));
+    for (int i = 0; i < PUB_KEY_SIZE; i++) c.id.pub_key[i] = rng() & 0xFF;
+    for (int i = 0; i < PUB_KEY_SIZE; i++) c.shared_secret[i] = rng() & 0xFF;
+    c.permissions = PERM_ACL_READ_WRITE;
+    c.out_path_len = 2;
+    c.out_path[0] = 0x11; c.out_path[1] = 0x22;
+    c.extra.room.sync_since = 123456;
+    c.last_activity = 999;   // transient, not stored
+  }
+};
+
+TEST_F(ClientColdStoreTest, StoreAndLoad) {
+  ClientColdStore store("/cold", 8);
+  ASSERT_TRUE(store.begin(fs));
+
+  ClientInfo a, b, loaded;
+  makeClient(a);
+  makeClient(b);
+  ASSERT_TRUE(store.store(a));
+  ASSERT_TRUE(store.store(b));
+  EXPECT_EQ(2, store.getNumClients());
+
+  int rec = store.findByPubKey(b.id.pub_key, PUB_KEY_SIZE);
+  ASSERT_GE(rec, 0);
+  ASSERT_TRUE(store.load(rec, loaded));
+  EXPECT_EQ(0, memcmp(loaded.id.pub_key, b.id.pub_key, PUB_KEY_SIZE));
+  EXPECT_EQ(0, memcmp(loaded.shared_secret, b.shared_secret, PUB_KEY_SIZE));
+  EXPECT_EQ(b.permissions, loaded.permissions);
+  EXPECT_EQ(b.extra.room.sync_since, loaded.extra.room.sync_since);
+  EXPECT_EQ(2, loaded.out_path_len);
+  EXPECT_EQ(0x22, loaded.out_path[1]);
+  EXPECT_EQ(0u, loaded.last_activity);
+
+  EXPECT_EQ(rec, store.findByPubKey(b.id.pub_key, 4));   // by prefix
+}
+
+TEST_F(ClientColdStoreTest, StoreReplacesSameClient) {
+  ClientColdStore store("/cold", 8);
+  store.begin(fs);
+
+  ClientInfo a, loaded;
+  makeClient(a);
+  store.store(a);
+  a.extra.room.sync_since = 777;
+  ASSERT_TRUE(store.store(a));
+  EXPECT_EQ(1, store.getNumClients());
+
+  ASSERT_TRUE(store.load(store.findByPubKey(a.id.pub_key, PUB_KEY_SIZE), loaded));
+  EXPECT_EQ(777u, loaded.extra.room.sync_since);
+}
+
+TEST_F(ClientColdStoreTest, FindByHash) {
+  ClientColdStore store("/cold", 8);
+  store.begin(fs);
+
+  ClientInfo c;
+  for (int i = 0; i < 5; i++) {
+    makeClient(c);
+    c.id.pub_key[0] = (i < 3) ? 0x5A : 0x10 + i;
+    store.store(c);
+  }
+  int dest[8];
+  EXPECT_EQ(3, store.findByHash(0x5A, dest, 8));
+  EXPECT_EQ(1, store.findByHash(0x5A, dest, 1));
+  EXPECT_EQ(0, store.findByHash(0x99, dest, 8));
+}
+
+TEST_F(ClientColdStoreTest, RemovedRecordIsReused) {
+  ClientColdStore store("/cold", 2);
+  store.begin(fs);
+
+  ClientInfo a, b, c, loaded;
+  makeClient(a);
+  makeClient(b);
+  makeClient(c);
+  ASSERT_TRUE(store.store(a));
+  ASSERT_TRUE(store.store(b));
+  EXPECT_FALSE(store.store(c));   // full
+
+  int rec = store.findByPubKey(a.id.pub_key, PUB_KEY_SIZE);
+  store.remove(rec);
+  EXPECT_EQ(1, store.getNumClients());
+  EXPECT_FALSE(store.load(rec, loaded));
+  EXPECT_EQ(-1, store.findByPubKey(a.id.pub_key, PUB_KEY_SIZE));
+
+  ASSERT_TRUE(store.store(c));
+  EXPECT_EQ(rec, store.findByPubKey(c.id.pub_key, PUB_KEY_SIZE));
+  ASSERT_TRUE(store.load(rec, loaded));
+  EXPECT_EQ(0, memcmp(loaded.id.pub_key, c.id.pub_key, PUB_KEY_SIZE));
+
+  File file = fs->open("/cold", "r");
+  EXPECT_EQ((size_t)(2 * CLIENT_COLD_REC_SIZE), file.size());   // file didn't grow
+  file.close();
+}
+
+TEST_F(ClientColdStoreTest, BeginStartsEmpty) {
+  ClientColdStore store("/cold", 4);
+  store.begin(fs);
+  ClientInfo a;
+  makeClient(a);
+  store.store(a);
+
+  ASSERT_TRUE(store.begin(fs));
+  EXPECT_EQ(0, store.getNumClients());
+  EXPECT_EQ(-1, store.findByPubKey(a.id.pub_key, PUB_KEY_SIZE));
+  EXPECT_FALSE(fs->exists("/cold"));
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
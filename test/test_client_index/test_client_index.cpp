@@ -0,0 +1,146 @@
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+#include "helpers/ClientIndex.h"
+
+static void makeClient(ClientInfo& c, std::mt19937& rng) {
+  memset(&c, 0, sizeof(c));
+  for (int i = 0; i < PUB_KEY_SIZE; i++) c.id.pub_key[i] = rng() & 0xFF;
+}
+
+// what ClientACL did before the index
+static int linearFind(const ClientInfo* table, int num, const uint8_t* key, int len) {
+  for (int i = 0; i < num; i++) {
+    if (memcmp(table[i].id.pub_key, key, len) == 0) return i;
+  }
+  return -1;
+}
+
+TEST(ClientIndexTest, FindsEveryClient) {
+  std::mt19937 rng(1);
+  std::vector<ClientInfo> table(100);
+  ClientIndex index(table.data(), table.size());
+  for (int i = 0; i < (int)table.size(); i++) {
+    makeClient(table[i], rng);
+    ASSERT_TRUE(index.add(i));
+  }
+  EXPECT_EQ(100, index.count());
+
+  for (int i = 0; i < (int)table.size(); i++) {
+    EXPECT_EQ(i, index.find(table[i].id.pub_key, PUB_KEY_SIZE));
+  }
+  uint8_t unknown[PUB_KEY_SIZE];
+  memcpy(unknown, table[5].id.pub_key, PUB_KEY_SIZE);
+  unknown[PUB_KEY_SIZE - 1] ^= 0xFF;
+  EXPECT_EQ(-1, index.find(unknown, PUB_KEY_SIZE));
+}
+
+TEST(ClientIndexTest, FindByHashReturnsAllMatches) {
+  std::mt19937 rng(2);
+  std::vector<ClientInfo> table(8);
+  ClientIndex index(table.data(), table.size());
+  for (int i = 0; i < (int)table.size(); i++) {
+    makeClient(table[i], rng);
+    table[i].id.pub_key[0] = (i % 2) ? 0x42 : 0x43 + i;   // slots 1,3,5,7 share a hash
+    index.add(i);
+  }
+
+  int dest[8];
+  int n = index.findByHash(0x42, dest, 8);
+  ASSERT_EQ(4, n);
+  std::sort(dest, dest + n);
+  EXPECT_EQ(1, dest[0]);
+  EXPECT_EQ(3, dest[1]);
+  EXPECT_EQ(5, dest[2]);
+  EXPECT_EQ(7, dest[3]);
+
+  EXPECT_EQ(2, index.findByHash(0x42, dest, 2));   // limited by max_num
+  EXPECT_EQ(0, index.findByHash(0x01, dest, 8));
+}
+
+TEST(ClientIndexTest, RemoveKeepsProbeRunsIntact) {
+  std::mt19937 rng(3);
+  std::vector<ClientInfo> table(32);
+  ClientIndex index(table.data(), table.size());
+  for (int i = 0; i < (int)table.size(); i++) {
+    makeClient(table[i], rng);
+    table[i].id.pub_key[0] = 0x3F + (i % 3);   // long colliding runs, which also wrap around the end of the buckets
+    index.add(i);
+  }
+
+  std::vector<bool> present(table.size(), true);
+  for (int round = 0; round < 200; round++) {
+    int slot = rng() % table.size();
+    if (present[slot]) {
+      index.remove(slot);
+      present[slot] = false;
+    } else {
+      makeClient(table[slot], rng);   // slot re-used for a new client
+      table[slot].id.pub_key[0] = 0x3F + (rng() % 3);
+      index.add(slot);
+      present[slot] = true;
+    }
+
+    int num = 0;
+    for (int i = 0; i < (int)table.size(); i++) {
+      if (present[i]) {
+        ASSERT_EQ(i, index.find(table[i].id.pub_key, PUB_KEY_SIZE)) << "round " << round;
+        num++;
+      }
+    }
+    ASSERT_EQ(num, index.count());
+  }
+}
+
+TEST(ClientIndexTest, FullIndexRejectsAdd) {
+  std::mt19937 rng(4);
+  std::vector<ClientInfo> table(4);
+  ClientIndex index(table.data(), 3);
+  for (int i = 0; i < 4; i++) makeClient(table[i], rng);
+  EXPECT_TRUE(index.add(0));
+  EXPECT_TRUE(index.add(1));
+  EXPECT_TRUE(index.add(2));
+  EXPECT_FALSE(index.add(3));
+
+  index.remove(1);
+  EXPECT_TRUE(index.add(3));
+  EXPECT_EQ(3, index.find(table[3].id.pub_key, 4));   // prefix match
+  EXPECT_EQ(-1, index.find(table[1].id.pub_key, PUB_KEY_SIZE));
+}
+
+// ------------- benchmark (lookup time, linear scan vs index, no pass/fail) -------------
+
+TEST(ClientIndexBenchmark, LookupTime) {
+  const int sizes[] = { 20, 32, 100, 256 };
+  for (int size : sizes) {
+    std::mt19937 rng(size);
+    std::vector<ClientInfo> table(size);
+    ClientIndex index(table.data(), size);
+    for (int i = 0; i < size; i++) {
+      makeClient(table[i], rng);
+      index.add(i);
+    }
+    const int LOOKUPS = 200000;
+    std::vector<int> keys(LOOKUPS);
+    for (int i = 0; i < LOOKUPS; i++) keys[i] = rng() % size;
+
+    volatile int sink = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int k : keys) sink += linearFind(table.data(), size, table[k].id.pub_key, PUB_KEY_SIZE);
+    auto t1 = std::chrono::steady_clock::now();
+    for (int k : keys) sink += index.find(table[k].id.pub_key, PUB_KEY_SIZE);
+    auto t2 = std::chrono::steady_clock::now();
+
+    double linear_ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / LOOKUPS;
+    double index_ns = std::chrono::duration<double, std::nano>(t2 - t1).count() / LOOKUPS;
+    printf("  %3d clients: linear scan %7.1f ns/lookup, index %5.1f ns/lookup\n", size, linear_ns, index_ns);
+  }
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,270 @@
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <map>
+#include <string>
+#include <vector>
+#include <random>
+#include "helpers/ContactChangeLog.h"
+#include "helpers/AdvertDataHelpers.h"
+
+#define FRAME_SIZE     176   // as per MAX_FRAME_SIZE
+#define CONTACT_FRAME  148   // RESP_CODE_CONTACT frame length, see MyMesh::writeContactRespFrame()
+
+// emulates the contacts[] table, and its mutations, as per BaseChatMesh
+class Device : public ContactSyncSource {
+public:
+  std::vector<ContactInfo> contacts;
+  ContactChangeLog log;
+  std::mt19937 rng{1};
+  uint32_t now = 1000;
+
+  bool getContactForSync(uint32_t idx, ContactInfo& dest) override {
+    if (idx >= contacts.size()) return false;
+    dest = contacts[idx];
+    return true;
+  }
+  void add() {
+    ContactInfo c;
+    memset(&c, 0, sizeof(c));
+    for (int i = 0; i < PUB_KEY_SIZE; i++) c.id.pub_key[i] = rng() & 0xFF;
+    sprintf(c.name, "Node %u", (unsigned) (rng() % 10000));
+    c.type = ADV_TYPE_CHAT;
+    c.out_path_len = rng() % 4;
+    for (int i = 0; i < c.out_path_len; i++) c.out_path[i] = rng() & 0xFF;
+    c.lastmod = ++now;
+    log.onChanged(c);
+    contacts.push_back(c);
+  }
+  void update(int idx) {
+    contacts[idx].lastmod = ++now;
+    contacts[idx].out_path_len = OUT_PATH_UNKNOWN;
+    log.onChanged(contacts[idx]);
+  }
+  void remove(int idx) {
+    log.onDeleted(contacts[idx]);
+    contacts.erase(contacts.begin() + idx);
+  }
+};
+
+// emulates a client app
+class Client {
+public:
+  std::map<std::string, ContactInfo> contacts;
+  bool has_since = false;
+  uint32_t epoch = 0, seq = 0;
+  int frames = 0, bytes = 0;
+  bool was_full = false;
+
+  static std::string key(const uint8_t* pub_key) { return std::string((const char *) pub_key, PUB_KEY_SIZE); }
+
+  void applyFrame(const uint8_t* frame, int len) {
+    int count = frame[0];
+    int i = 1;
+    while (count-- > 0) {
+      std::string k = key(&frame[i]); i += PUB_KEY_SIZE;
+      uint8_t type = frame[i++];
+      if (type == ADV_TYPE_NONE) {
+        contacts.erase(k);
+        continue;
+      }
+      ContactInfo c;
+      memset(&c, 0, sizeof(c));
+      memcpy(c.id.pub_key, k.data(), PUB_KEY_SIZE);
+      c.type = type;
+      c.flags = frame[i++];
+      c.out_path_len = frame[i++];
+      int path_bytes = c.out_path_len == OUT_PATH_UNKNOWN ? 0 : (c.out_path_len & 63) * ((c.out_path_len >> 6) + 1);
+      memcpy(c.out_path, &frame[i], path_bytes); i += path_bytes;
+      memcpy(&c.last_advert_timestamp, &frame[i], 4); i += 4;
+      memcpy(&c.gps_lat, &frame[i], 4); i += 4;
+      memcpy(&c.gps_lon, &frame[i], 4); i += 4;
+      memcpy(&c.lastmod, &frame[i], 4); i += 4;
+      int name_len = frame[i++];
+      memcpy(c.name, &frame[i], name_len); i += name_len;
+      contacts[k] = c;
+    }
+    ASSERT_EQ(len, i);
+  }
+
+  // as per MyMesh: CMD_GET_CONTACT_CHANGES, then checkSerialInterface() until finished
+  void sync(Device& dev) {
+    frames = 2;   // START and END
+    bytes = 10 + 5;
+    was_full = dev.log.startSync(has_since, epoch, seq);
+    if (was_full) contacts.clear();
+    uint8_t frame[FRAME_SIZE];
+    int n;
+    while ((n = dev.log.writeSyncFrame(&dev, &frame[1], FRAME_SIZE - 1)) > 0) {
+      ASSERT_LE(1 + n, FRAME_SIZE);
+      applyFrame(&frame[1], n);
+      frames++;
+      bytes += 1 + n;
+    }
+    has_since = true;
+    epoch = dev.log.getEpoch();
+    seq = dev.log.getSyncEndSeq();
+  }
+
+  void expectSameAs(const Device& dev) {
+    ASSERT_EQ(dev.contacts.size(), contacts.size());
+    for (auto& c : dev.contacts) {
+      auto it = contacts.find(key(c.id.pub_key));
+      ASSERT_TRUE(it != contacts.end());
+      EXPECT_STREQ(c.name, it->second.name);
+      EXPECT_EQ(c.out_path_len, it->second.out_path_len);
+      EXPECT_EQ(c.lastmod, it->second.lastmod);
+    }
+  }
+};
+
+TEST(ContactChangeLog, FullThenDeltas) {
+  Device dev;
+  dev.log.reset(1234);
+  for (int i = 0; i < 50; i++) dev.add();
+
+  Client app;
+  app.sync(dev);
+  EXPECT_TRUE(app.was_full);
+  app.expectSameAs(dev);
+
+  app.sync(dev);   // no changes
+  EXPECT_FALSE(app.was_full);
+  EXPECT_EQ(2, app.frames);
+
+  dev.update(3);
+  dev.update(40);
+  dev.remove(10);
+  dev.add();
+  app.sync(dev);
+  EXPECT_FALSE(app.was_full);
+  EXPECT_EQ(4, app.frames);   // 4 entries, in 2 batch frames
+  app.expectSameAs(dev);
+}
+
+TEST(ContactChangeLog, DeletedThenReAdded) {
+  Device dev;
+  dev.log.reset(1);
+  for (int i = 0; i < 5; i++) dev.add();
+  Client app;
+  app.sync(dev);
+
+  ContactInfo c = dev.contacts[2];
+  dev.remove(2);
+  dev.log.onChanged(c);   // eg. paged back in from cold store
+  dev.contacts.push_back(c);
+  app.sync(dev);
+  EXPECT_FALSE(app.was_full);
+  app.expectSameAs(dev);
+}
+
+TEST(ContactChangeLog, FullSyncWhenDeletesLost) {
+  Device dev;
+  dev.log.reset(1);
+  for (int i = 0; i < CONTACT_CHANGE_LOG_DELETES + 20; i++) dev.add();
+  Client app;
+  app.sync(dev);
+
+  for (int i = 0; i < CONTACT_CHANGE_LOG_DELETES + 1; i++) dev.remove(0);
+  app.sync(dev);
+  EXPECT_TRUE(app.was_full);
+  app.expectSameAs(dev);
+}
+
+TEST(ContactChangeLog, FullSyncWhenEpochChanged) {
+  Device dev;
+  dev.log.reset(1);
+  for (int i = 0; i < 10; i++) dev.add();
+  Client app;
+  app.sync(dev);
+
+  dev.log.reset(2);   // eg. rebooted
+  for (auto& c : dev.contacts) dev.log.onChanged(c);
+  app.sync(dev);
+  EXPECT_TRUE(app.was_full);
+  app.expectSameAs(dev);
+}
+
+TEST(ContactChangeLog, DeleteDuringSyncRepeatsSync) {
+  Device dev;
+  dev.log.reset(1);
+  for (int i = 0; i < 30; i++) dev.add();
+  Client app;
+  app.sync(dev);
+  uint32_t seq = app.seq;
+
+  for (int i = 0; i < 30; i++) dev.update(i);
+  dev.log.startSync(true, app.epoch, app.seq);
+  uint8_t frame[FRAME_SIZE];
+  int n = dev.log.writeSyncFrame(&dev, frame, FRAME_SIZE - 1);
+  app.applyFrame(frame, n);
+  dev.remove(0);   // contacts[] shifts under the sync
+  while ((n = dev.log.writeSyncFrame(&dev, frame, FRAME_SIZE - 1)) > 0) app.applyFrame(frame, n);
+  EXPECT_EQ(seq, dev.log.getSyncEndSeq());   // so app asks for same changes again
+
+  app.sync(dev);
+  app.expectSameAs(dev);
+}
+
+TEST(ContactChangeLog, TransientContactsIgnored) {
+  Device dev;
+  dev.log.reset(1);
+  for (int i = 0; i < 3; i++) dev.add();
+  Client app;
+  app.sync(dev);
+  dev.contacts[1].type = ADV_TYPE_NONE;   // eg. anon contact
+  dev.remove(1);
+  app.sync(dev);
+  EXPECT_EQ(2, app.frames);
+}
+
+// ------------- benchmark (counts only, no pass/fail) -------------
+
+// Frames sent on re-connect: CMD_GET_CONTACTS with no 'since' (the only way an app learns of deletions), with 'since'
+// (one frame per changed contact), and CMD_GET_CONTACT_CHANGES.
+TEST(ContactChangeLog, BenchmarkReconnectFrames) {
+  const int SIZES[] = { 100, 350 };
+  const int CHANGES[] = { 0, 5, 50 };
+  printf("\n  contacts | changed | full: frames / bytes | since: frames / bytes | changes: frames / bytes\n");
+  for (int n : SIZES) {
+    for (int changes : CHANGES) {
+      Device dev;
+      dev.log.reset(1);
+      for (int i = 0; i < n; i++) dev.add();
+      Client app;
+      app.sync(dev);
+
+      uint32_t since = dev.now;
+      for (int i = 0; i < changes; i++) {
+        if (i % 5 == 4) {
+          dev.remove(dev.rng() % dev.contacts.size());
+          dev.add();
+        } else {
+          dev.update(dev.rng() % dev.contacts.size());
+        }
+      }
+      int num_since = 0;
+      for (auto& c : dev.contacts) if (c.lastmod > since) num_since++;
+
+      app.sync(dev);
+      app.expectSameAs(dev);
+      int full_frames = 2 + (int) dev.contacts.size();
+      printf("  %8d | %7d | %6d / %12d | %7d / %13d | %9d / %13d\n", n, changes,
+          full_frames, 10 + (full_frames - 2) * CONTACT_FRAME,
+          2 + num_since, 10 + num_since * CONTACT_FRAME,
+          app.frames, app.bytes);
+    }
+  }
+  // first connect, for comparison
+  Device dev;
+  dev.log.reset(1);
+  for (int i = 0; i < 350; i++) dev.add();
+  Client app;
+  app.sync(dev);
+  printf("  first connect, 350 contacts: %d frames (vs %d)\n", app.frames, 2 + 350);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,182 @@
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <vector>
+#include <random>
+#include "helpers/ContactColdStore.h"
+
+// records kept in RAM, counting storage reads (as flash reads are the expensive part)
+class RamColdStore : public ContactColdStore {
+  std::vector<ContactInfo> _recs;
+public:
+  int reads = 0, writes = 0;
+
+  RamColdStore(int max_records) : ContactColdStore(max_records), _recs(max_records) { }
+
+  // as if re-opening the storage, eg. after reboot
+  void rescan() {
+    clearRecords();
+    for (int rec = 0; rec < getMaxContacts(); rec++) {
+      ContactInfo& c = _recs[rec];
+      uint8_t zeroes[PUB_KEY_SIZE] = {0};
+      if (memcmp(c.id.pub_key, zeroes, PUB_KEY_SIZE) != 0) setRecordUsed(rec, c.id.pub_key[0]);
+    }
+  }
+
+protected:
+  bool readRecord(int rec, ContactInfo& dest) override { reads++; dest = _recs[rec]; return true; }
+  bool writeRecord(int rec, const ContactInfo& src) override { writes++; _recs[rec] = src; return true; }
+  bool eraseRecord(int rec) override { writes++; memset(_recs[rec].id.pub_key, 0, PUB_KEY_SIZE); return true; }
+};
+
+static void makeContact(ContactInfo& c, std::mt19937& rng) {
+  memset(&c, 0, sizeof(c));
+  for (int i = 0; i < PUB_KEY_SIZE; i++) c.id.pub_key[i] = rng() & 0xFF;
+  snprintf(c.name, sizeof(c.name), "node-%02X%02X", c.id.pub_key[0], c.id.pub_key[1]);
+}
+
+TEST(ContactColdStore, StoreLoadRemove) {
+  std::mt19937 rng(1);
+  RamColdStore store(10);
+  ContactInfo a, b, c;
+  makeContact(a, rng);
+  makeContact(b, rng);
+  ASSERT_TRUE(store.store(a));
+  ASSERT_TRUE(store.store(b));
+  EXPECT_EQ(2, store.getNumContacts());
+
+  int rec = store.findByPubKey(b.id.pub_key, PUB_KEY_SIZE);
+  ASSERT_GE(rec, 0);
+  EXPECT_EQ(rec, store.findByPubKey(b.id.pub_key, 6));   // prefix
+  ASSERT_TRUE(store.load(rec, c));
+  EXPECT_STREQ(b.name, c.name);
+  EXPECT_FALSE(c.shared_secret_valid);
+
+  store.remove(rec);
+  EXPECT_EQ(1, store.getNumContacts());
+  EXPECT_EQ(-1, store.findByPubKey(b.id.pub_key, PUB_KEY_SIZE));
+  EXPECT_FALSE(store.load(rec, c));
+}
+
+TEST(ContactColdStore, KeepsSharedSecret) {
+  std::mt19937 rng(6);
+  RamColdStore store(4);
+  ContactInfo a, loaded;
+  makeContact(a, rng);
+  uint8_t secret[PUB_KEY_SIZE], out[PUB_KEY_SIZE];
+  for (int i = 0; i < PUB_KEY_SIZE; i++) secret[i] = rng() & 0xFF;
+  a.setSharedSecret(secret);
+  ASSERT_TRUE(store.store(a));
+
+  ASSERT_TRUE(store.load(store.findByPubKey(a.id.pub_key, PUB_KEY_SIZE), loaded));
+  ASSERT_TRUE(loaded.copySharedSecret(out));   // no key exchange needed when tried as a peer
+  EXPECT_EQ(0, memcmp(secret, out, PUB_KEY_SIZE));
+}
+
+TEST(ContactColdStore, ReplacesSamePubKey) {
+  std::mt19937 rng(2);
+  RamColdStore store(4);
+  ContactInfo a, c;
+  makeContact(a, rng);
+  ASSERT_TRUE(store.store(a));
+  strcpy(a.name, "renamed");
+  ASSERT_TRUE(store.store(a));
+  EXPECT_EQ(1, store.getNumContacts());
+  ASSERT_TRUE(store.load(store.findByPubKey(a.id.pub_key, PUB_KEY_SIZE), c));
+  EXPECT_STREQ("renamed", c.name);
+}
+
+TEST(ContactColdStore, FullThenReusesRemoved) {
+  std::mt19937 rng(3);
+  RamColdStore store(3);
+  ContactInfo c[4];
+  for (int i = 0; i < 4; i++) makeContact(c[i], rng);
+  for (int i = 0; i < 3; i++) ASSERT_TRUE(store.store(c[i]));
+  EXPECT_FALSE(store.store(c[3]));   // full
+
+  store.remove(store.findByPubKey(c[1].id.pub_key, PUB_KEY_SIZE));
+  ASSERT_TRUE(store.store(c[3]));
+  EXPECT_EQ(3, store.getNumContacts());
+  EXPECT_GE(store.findByPubKey(c[3].id.pub_key, PUB_KEY_SIZE), 0);
+}
+
+TEST(ContactColdStore, HashMatchWithoutReads) {
+  std::mt19937 rng(4);
+  RamColdStore store(100);
+  ContactInfo c;
+  int expected = 0;
+  for (int i = 0; i < 100; i++) {
+    makeContact(c, rng);
+    if (i % 10 == 0) c.id.pub_key[0] = 0x42;
+    if (c.id.pub_key[0] == 0x42) expected++;
+    store.store(c);
+  }
+  store.reads = 0;
+  uint16_t recs[16];
+  int n = store.findByHash(0x42, recs, 16);
+  EXPECT_EQ(expected, n);
+  EXPECT_EQ(0, store.reads);
+  for (int j = 0; j < n; j++) {
+    ASSERT_TRUE(store.load(recs[j], c));
+    EXPECT_EQ(0x42, c.id.pub_key[0]);
+  }
+}
+
+TEST(ContactColdStore, RescanAfterReboot) {
+  std::mt19937 rng(5);
+  RamColdStore store(20);
+  ContactInfo c[20];
+  for (int i = 0; i < 20; i++) {
+    makeContact(c[i], rng);
+    store.store(c[i]);
+  }
+  for (int i = 0; i < 20; i += 3) store.remove(store.findByPubKey(c[i].id.pub_key, PUB_KEY_SIZE));
+  int num = store.getNumContacts();
+
+  store.rescan();
+  EXPECT_EQ(num, store.getNumContacts());
+  for (int i = 0; i < 20; i++) {
+    int rec = store.findByPubKey(c[i].id.pub_key, PUB_KEY_SIZE);
+    if (i % 3 == 0) EXPECT_EQ(-1, rec); else EXPECT_GE(rec, 0);
+  }
+}
+
+// ------------- benchmark (counts only, no pass/fail) -------------
+
+// RAM for N contacts all in contacts[] vs. a 350 contact hot table plus cold store. Also the cold candidates for a
+// 1-byte src hash (found without storage reads, each one read only if no hot contact's MAC matched), and the
+// storage reads for a pub_key lookup that misses contacts[].
+TEST(ContactColdStoreBenchmark, RamAndReads) {
+  const int HOT = 350;
+  const int SIZES[] = { 1000, 2000, 4000 };
+  std::mt19937 rng(6);
+  printf("\n  contacts | all in RAM bytes | hot+cold RAM bytes | candidates per hash | reads per pubkey lookup\n");
+  for (int n : SIZES) {
+    int cold = n - HOT;
+    RamColdStore store(cold);
+    std::vector<ContactInfo> contacts(cold);
+    for (int i = 0; i < cold; i++) {
+      makeContact(contacts[i], rng);
+      store.store(contacts[i]);
+    }
+    store.reads = 0;
+    const int LOOKUPS = 2000;
+    int candidates = 0;
+    for (int i = 0; i < LOOKUPS; i++) {
+      uint16_t recs[8];
+      candidates += store.findByHash(contacts[rng() % cold].id.pub_key[0], recs, 8);
+    }
+    int reads_before = store.reads;
+    for (int i = 0; i < LOOKUPS; i++) {
+      store.findByPubKey(contacts[rng() % cold].id.pub_key, PUB_KEY_SIZE);
+    }
+    size_t all_ram = (size_t)n * sizeof(ContactInfo);
+    size_t tiered_ram = (size_t)HOT * sizeof(ContactInfo) + cold + (cold + 7) / 8;
+    printf("  %8d | %16zu | %18zu | %19.2f | %.2f\n", n, all_ram, tiered_ram,
+      (double)candidates / LOOKUPS, (double)(store.reads - reads_before) / LOOKUPS);
+  }
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,232 @@
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <vector>
+#include <random>
+#include "helpers/ContactIndex.h"
+
+static void makeContact(ContactInfo& c, std::mt19937& rng, uint32_t timestamp) {
+  memset(&c, 0, sizeof(c));
+  for (int i = 0; i < PUB_KEY_SIZE; i++) c.id.pub_key[i] = rng() & 0xFF;
+  c.last_advert_timestamp = timestamp;
+}
+
+static int linearFind(const ContactInfo* table, int num, const uint8_t* key, int len) {
+  for (int i = 0; i < num; i++) {
+    if (memcmp(table[i].id.pub_key, key, len) == 0) return i;
+  }
+  return -1;
+}
+
+TEST(ContactIndex, FindByKeyAndPrefix) {
+  std::mt19937 rng(1);
+  ContactInfo table[50];
+  ContactIndex index(table, 50);
+  for (int i = 0; i < 50; i++) {
+    makeContact(table[i], rng, i);
+    ASSERT_TRUE(index.add(i));
+  }
+  EXPECT_EQ(50, index.count());
+  for (int i = 0; i < 50; i++) {
+    EXPECT_EQ(i, index.find(table[i].id.pub_key, PUB_KEY_SIZE));
+    EXPECT_EQ(i, index.find(table[i].id.pub_key, 6));
+  }
+  uint8_t key[PUB_KEY_SIZE];
+  memcpy(key, table[7].id.pub_key, PUB_KEY_SIZE);
+  key[PUB_KEY_SIZE-1] ^= 0x01;
+  EXPECT_EQ(-1, index.find(key, PUB_KEY_SIZE));
+  EXPECT_EQ(7, index.find(key, 6));
+}
+
+TEST(ContactIndex, HashBuckets) {
+  std::mt19937 rng(2);
+  ContactInfo table[40];
+  ContactIndex index(table, 40);
+  for (int i = 0; i < 40; i++) {
+    makeContact(table[i], rng, 0);
+    table[i].id.pub_key[0] = i % 4;   // 4 buckets of 10
+    index.add(i);
+  }
+  for (int h = 0; h < 256; h++) {
+    const uint16_t* slots;
+    int n = index.findByHash(h, slots);
+    EXPECT_EQ(h < 4 ? 10 : 0, n);
+    for (int j = 0; j < n; j++) EXPECT_EQ(h, table[slots[j]].id.pub_key[0]);
+  }
+}
+
+TEST(ContactIndex, RemoveAndShiftDown) {
+  std::mt19937 rng(3);
+  ContactInfo table[20];
+  ContactIndex index(table, 20);
+  int num = 20;
+  for (int i = 0; i < num; i++) {
+    makeContact(table[i], rng, i);
+    index.add(i);
+  }
+  // remove like BaseChatMesh::removeContact()
+  int idx = 5;
+  index.remove(idx, true);
+  num--;
+  for (int i = idx; i < num; i++) table[i] = table[i + 1];
+
+  EXPECT_EQ(num, index.count());
+  for (int i = 0; i < num; i++) {
+    EXPECT_EQ(i, index.find(table[i].id.pub_key, PUB_KEY_SIZE));
+  }
+  const uint16_t* recent = index.sortByRecent();
+  for (int i = 0; i < num; i++) EXPECT_EQ(num - 1 - i, recent[i]);
+}
+
+TEST(ContactIndex, OverwriteSlot) {
+  std::mt19937 rng(4);
+  ContactInfo table[10];
+  ContactIndex index(table, 10);
+  for (int i = 0; i < 10; i++) {
+    makeContact(table[i], rng, 100 + i);
+    index.add(i);
+  }
+  uint8_t old_key[PUB_KEY_SIZE];
+  memcpy(old_key, table[3].id.pub_key, PUB_KEY_SIZE);
+
+  // overwrite like BaseChatMesh::allocateContactSlot()
+  index.remove(3);
+  makeContact(table[3], rng, 500);
+  index.add(3);
+
+  EXPECT_EQ(10, index.count());
+  EXPECT_EQ(-1, index.find(old_key, PUB_KEY_SIZE));
+  EXPECT_EQ(3, index.find(table[3].id.pub_key, PUB_KEY_SIZE));
+  EXPECT_EQ(3, index.sortByRecent()[0]);
+}
+
+TEST(ContactIndex, RecentOrderRepairedAfterUpdates) {
+  std::mt19937 rng(5);
+  ContactInfo table[30];
+  ContactIndex index(table, 30);
+  for (int i = 0; i < 30; i++) {
+    makeContact(table[i], rng, rng() % 1000);
+    index.add(i);
+  }
+  for (int k = 0; k < 10; k++) {
+    table[rng() % 30].last_advert_timestamp = 1000 + (rng() % 1000);  // eg. new adverts
+    const uint16_t* recent = index.sortByRecent();
+    for (int i = 1; i < 30; i++) {
+      EXPECT_GE(table[recent[i-1]].last_advert_timestamp, table[recent[i]].last_advert_timestamp);
+    }
+  }
+}
+
+TEST(ContactIndex, MatchesLinearScan) {
+  std::mt19937 rng(6);
+  const int MAX = 200;
+  ContactInfo table[MAX];
+  ContactIndex index(table, MAX);
+  int num = 0;
+  for (int step = 0; step < 2000; step++) {
+    int op = rng() % 4;
+    if (op < 2 && num < MAX) {
+      makeContact(table[num], rng, rng());
+      table[num].id.pub_key[0] &= 0x0F;   // crowded buckets
+      index.add(num++);
+    } else if (op == 2 && num > 0) {
+      int idx = rng() % num;
+      index.remove(idx, true);
+      num--;
+      for (int i = idx; i < num; i++) table[i] = table[i + 1];
+    } else if (num > 0) {
+      int idx = rng() % num;
+      index.remove(idx);
+      makeContact(table[idx], rng, rng());
+      index.add(idx);
+    }
+    ASSERT_EQ(num, index.count());
+    if (num > 0) {
+      const uint8_t* key = table[rng() % num].id.pub_key;
+      int found = index.find(key, PUB_KEY_SIZE);
+      ASSERT_GE(found, 0);
+      EXPECT_EQ(0, memcmp(table[found].id.pub_key, key, PUB_KEY_SIZE));
+      EXPECT_EQ(linearFind(table, num, key, PUB_KEY_SIZE), found);
+    }
+  }
+}
+
+// ------------- benchmark (timings only, no pass/fail) -------------
+
+// Per-lookup cost of the linear scans BaseChatMesh used to do, vs. ContactIndex, at typical contact table sizes.
+// 'scan recent' is one scanRecentContacts() after a handful of adverts have changed timestamps (qsort of all vs. repair).
+static ContactInfo* cmp_table;
+static int cmp_adv_timestamp(const void *a, const void *b) {
+  int a_idx = *((int *)a);
+  int b_idx = *((int *)b);
+  if (cmp_table[b_idx].last_advert_timestamp > cmp_table[a_idx].last_advert_timestamp) return 1;
+  if (cmp_table[b_idx].last_advert_timestamp < cmp_table[a_idx].last_advert_timestamp) return -1;
+  return 0;
+}
+
+TEST(ContactIndexBenchmark, LookupCost) {
+  typedef std::chrono::high_resolution_clock Clock;
+  const int SIZES[] = { 100, 350, 1000 };
+  const int LOOKUPS = 200000, SCANS = 2000;
+
+  printf("\n  contacts | pubkey lookup ns (linear / index) | hash search ns (linear / index) | scan recent us (qsort / index)\n");
+  for (int n : SIZES) {
+    std::mt19937 rng(n);
+    std::vector<ContactInfo> table(n);
+    ContactIndex index(table.data(), n);
+    for (int i = 0; i < n; i++) {
+      makeContact(table[i], rng, rng() % 100000);
+      index.add(i);
+    }
+    std::vector<int> targets(LOOKUPS);
+    for (int i = 0; i < LOOKUPS; i++) targets[i] = rng() % n;
+
+    volatile int sink = 0;
+    auto t0 = Clock::now();
+    for (int i = 0; i < LOOKUPS; i++) sink += linearFind(table.data(), n, table[targets[i]].id.pub_key, PUB_KEY_SIZE);
+    auto t1 = Clock::now();
+    for (int i = 0; i < LOOKUPS; i++) sink += index.find(table[targets[i]].id.pub_key, PUB_KEY_SIZE);
+    auto t2 = Clock::now();
+    for (int i = 0; i < LOOKUPS; i++) {
+      uint8_t hash = table[targets[i]].id.pub_key[0];
+      for (int j = 0; j < n; j++) {
+        if (table[j].id.pub_key[0] == hash) sink += j;
+      }
+    }
+    auto t3 = Clock::now();
+    for (int i = 0; i < LOOKUPS; i++) {
+      const uint16_t* slots;
+      int num = index.findByHash(table[targets[i]].id.pub_key[0], slots);
+      for (int j = 0; j < num; j++) sink += slots[j];
+    }
+    auto t4 = Clock::now();
+
+    std::vector<int> sort_array(n);
+    cmp_table = table.data();
+    double qsort_ns = 0, index_ns = 0;
+    for (int s = 0; s < SCANS; s++) {
+      for (int k = 0; k < 4; k++) table[rng() % n].last_advert_timestamp = 100000 + s * 10 + k;
+      auto a = Clock::now();
+      for (int i = 0; i < n; i++) sort_array[i] = i;
+      qsort(sort_array.data(), n, sizeof(int), cmp_adv_timestamp);
+      auto b = Clock::now();
+      sink += index.sortByRecent()[0];
+      auto c = Clock::now();
+      qsort_ns += std::chrono::duration<double, std::nano>(b - a).count();
+      index_ns += std::chrono::duration<double, std::nano>(c - b).count();
+      ASSERT_EQ(table[sort_array[0]].last_advert_timestamp, table[index.sortByRecent()[0]].last_advert_timestamp);
+    }
+
+    auto ns = [](Clock::time_point a, Clock::time_point b) {
+      return std::chrono::duration<double, std::nano>(b - a).count() / LOOKUPS;
+    };
+    printf("  %8d | %15.1f / %-15.1f | %14.1f / %-14.1f | %13.2f / %.2f\n", n,
+      ns(t0, t1), ns(t1, t2), ns(t2, t3), ns(t3, t4), qsort_ns / SCANS / 1000, index_ns / SCANS / 1000);
+  }
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,169 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include "Dispatcher.h"
+#include "helpers/StaticPoolPacketManager.h"
+
+using namespace mesh;
+
+class TestClock : public MillisecondClock {
+public:
+  unsigned long now = 1000;
+  unsigned long getMillis() override { return now; }
+  void tick() { now++; }
+};
+
+// hands out one queued frame per recvRaw(), and keeps a copy of the last transmitted frame
+class LoopbackRadio : public Radio {
+public:
+  uint8_t rx_frame[MAX_TRANS_UNIT], tx_frame[MAX_TRANS_UNIT];
+  int rx_len = 0, tx_len = 0;
+  bool sending = false;
+  uint32_t n_sent = 0;
+
+  int recvRaw(uint8_t* bytes, int sz) override {
+    int len = rx_len;
+    if (len > 0) {
+      memcpy(bytes, rx_frame, len);
+      rx_len = 0;
+    }
+    return len;
+  }
+  uint32_t getEstAirtimeFor(int len_bytes) override { return 0; }
+  float packetScore(float snr, int packet_len) override { return 1.0f; }
+  bool startSendRaw(const uint8_t* bytes, int len) override {
+    memcpy(tx_frame, bytes, len);
+    tx_len = len;
+    sending = true;
+    n_sent++;
+    return true;
+  }
+  bool isSendComplete() override { return sending; }
+  void onSendFinished() override { sending = false; }
+  bool isInRecvMode() const override { return !sending; }
+};
+
+// re-transmits everything it receives, straight away
+class ForwardingDispatcher : public Dispatcher {
+public:
+  ForwardingDispatcher(Radio& radio, MillisecondClock& ms, PacketManager& mgr) : Dispatcher(radio, ms, mgr) { }
+protected:
+  DispatcherAction onRecvPacket(Packet* pkt) override { return ACTION_RETRANSMIT(0); }
+  float getAirtimeBudgetFactor() const override { return 0.0f; }   // no duty-cycle limit
+};
+
+static int makeFrame(uint8_t* frame, uint8_t route, int path_hashes, int payload_len, uint32_t id) {
+  int len = 0;
+  frame[len++] = (PAYLOAD_TYPE_TXT_MSG << PH_TYPE_SHIFT) | route;
+  if (route == ROUTE_TYPE_TRANSPORT_DIRECT || route == ROUTE_TYPE_TRANSPORT_FLOOD) {
+    frame[len++] = 0x34; frame[len++] = 0x12;
+    frame[len++] = 0x78; frame[len++] = 0x56;
+  }
+  frame[len++] = path_hashes;
+  for (int i = 0; i < path_hashes; i++) frame[len++] = (uint8_t) (0xA0 + i);
+  for (int i = 0; i < payload_len; i++) frame[len++] = (uint8_t) (id + i);
+  return len;
+}
+
+TEST(Dispatcher, ForwardedFrameIsIdentical) {
+  TestClock ms;
+  LoopbackRadio radio;
+  StaticPoolPacketManager mgr(4);
+  ForwardingDispatcher dispatcher(radio, ms, mgr);
+  dispatcher.begin();
+
+  const uint8_t routes[] = { ROUTE_TYPE_DIRECT, ROUTE_TYPE_TRANSPORT_DIRECT };
+  for (int r = 0; r < 2; r++) {
+    radio.rx_len = makeFrame(radio.rx_frame, routes[r], 5, 100, r);
+    uint8_t expected[MAX_TRANS_UNIT];
+    int expected_len = radio.rx_len;
+    memcpy(expected, radio.rx_frame, expected_len);
+
+    ms.tick(); dispatcher.loop();
+    ASSERT_EQ(expected_len, radio.tx_len);
+    EXPECT_EQ(0, memcmp(expected, radio.tx_frame, expected_len));
+    ms.tick(); dispatcher.loop();   // send complete
+  }
+  EXPECT_EQ(4, mgr.getFreeCount());
+}
+
+TEST(Dispatcher, TryParseRejectsBadFrames) {
+  TestClock ms;
+  LoopbackRadio radio;
+  StaticPoolPacketManager mgr(1);
+  ForwardingDispatcher dispatcher(radio, ms, mgr);
+  Packet pkt;
+  uint8_t frame[MAX_TRANS_UNIT];
+
+  int len = makeFrame(frame, ROUTE_TYPE_DIRECT, 5, 10, 0);
+  EXPECT_TRUE(dispatcher.tryParsePacket(&pkt, frame, len));
+  EXPECT_EQ(5, pkt.path_len);
+  EXPECT_EQ(10, pkt.payload_len);
+  EXPECT_FALSE(dispatcher.tryParsePacket(&pkt, frame, 5));   // truncated path
+  frame[1] = 0xC1;   // path mode 3
+  EXPECT_FALSE(dispatcher.tryParsePacket(&pkt, frame, len));
+}
+
+// packets/sec through the whole receive -> parse -> queue -> serialise -> send path
+TEST(DispatcherBenchmark, ForwardingThroughput) {
+  TestClock ms;
+  LoopbackRadio radio;
+  StaticPoolPacketManager mgr(16);
+  ForwardingDispatcher dispatcher(radio, ms, mgr);
+  dispatcher.begin();
+
+  const int PACKETS = 200000;
+  const int sizes[][2] = { { 0, 10 }, { 8, 60 }, { 63, 184 } };   // path hashes, payload len
+  printf("\n");
+  for (int s = 0; s < 3; s++) {
+    uint8_t frame[MAX_TRANS_UNIT];
+    int len = makeFrame(frame, ROUTE_TYPE_DIRECT, sizes[s][0], sizes[s][1], s);
+    uint32_t sent = radio.n_sent;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < PACKETS; i++) {
+      memcpy(radio.rx_frame, frame, len);
+      radio.rx_len = len;
+      ms.tick(); dispatcher.loop();   // recv + send
+      ms.tick(); dispatcher.loop();   // send complete
+    }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    EXPECT_EQ((uint32_t) PACKETS, radio.n_sent - sent);
+    printf("  %3d byte frames: %.0f packets/sec (%.0f ns/packet)\n", len, PACKETS / secs, secs * 1e9 / PACKETS);
+
+    secs = 0;
+    Packet pkt;
+    uint8_t out[MAX_TRANS_UNIT];
+    volatile int total = 0;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < PACKETS; i++) {
+      dispatcher.tryParsePacket(&pkt, frame, len);
+      total += pkt.writeTo(out);
+    }
+    secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("       tryParsePacket + writeTo only: %.0f ns/packet\n", secs * 1e9 / PACKETS);
+
+    // what checkSend() spends building the TX frame, vs. a plain copy of it
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < PACKETS; i++) {
+      total += pkt.writeTo(out);
+    }
+    secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("       writeTo only: %.0f ns/packet", secs * 1e9 / PACKETS);
+
+    uint8_t copy[MAX_TRANS_UNIT];
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < PACKETS; i++) {
+      memcpy(copy, out, len);
+      total += copy[i % len];
+    }
+    secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf(", memcpy of frame: %.0f ns/packet\n", secs * 1e9 / PACKETS);
+  }
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,276 @@
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <string.h>
+#include <random>
+#include <vector>
+#include "Dispatcher.h"
+#include "helpers/StaticPoolPacketManager.h"
+#include "helpers/FairQueuePacketManager.h"
+
+using namespace mesh;
+
+class TestClock : public MillisecondClock {
+public:
+  unsigned long now = 1000;
+  unsigned long getMillis() override { return now; }
+};
+
+// airtime is proportional to length, and a send completes once its airtime has passed
+class TimedRadio : public Radio {
+  MillisecondClock* _ms;
+  unsigned long tx_end = 0;
+public:
+  std::vector<std::vector<uint8_t>> sent;
+  bool sending = false;
+
+  TimedRadio(MillisecondClock& ms) : _ms(&ms) { }
+
+  int recvRaw(uint8_t* bytes, int sz) override { return 0; }
+  uint32_t getEstAirtimeFor(int len_bytes) override { return 20 + 2*len_bytes; }
+  float packetScore(float snr, int packet_len) override { return 1.0f; }
+  bool startSendRaw(const uint8_t* bytes, int len) override {
+    sent.push_back(std::vector<uint8_t>(bytes, bytes + len));
+    tx_end = _ms->getMillis() + getEstAirtimeFor(len);
+    sending = true;
+    return true;
+  }
+  bool isSendComplete() override { return sending && (long)(_ms->getMillis() - tx_end) >= 0; }
+  void onSendFinished() override { sending = false; }
+  bool isInRecvMode() const override { return !sending; }
+};
+
+static Packet* makePacket(PacketManager& mgr, uint8_t type, uint8_t route, int payload_len, uint32_t tag) {
+  Packet* pkt = mgr.allocNew();
+  if (pkt == NULL) return NULL;
+  pkt->header = (type << PH_TYPE_SHIFT) | route;
+  pkt->path_len = 0;
+  pkt->payload_len = payload_len;
+  memset(pkt->payload, 0, payload_len);
+  memcpy(pkt->payload, &tag, 4);
+  return pkt;
+}
+static uint32_t tagOf(const Packet* pkt) {
+  uint32_t tag;
+  memcpy(&tag, pkt->payload, 4);
+  return tag;
+}
+
+class FairQueueTest : public ::testing::Test {
+protected:
+  TestClock ms;
+  TimedRadio radio;
+  StaticPoolPacketManager pool;
+  FairQueuePacketManager mgr;
+
+  FairQueueTest() : radio(ms), pool(64), mgr(pool, radio, 64) { }
+
+  void queue(uint8_t type, uint8_t route, int payload_len, uint32_t tag, uint8_t priority=0, uint32_t scheduled_for=0) {
+    mgr.queueOutbound(makePacket(mgr, type, route, payload_len, tag), priority, scheduled_for);
+  }
+  // tags in order sent, for next 'n' packets
+  std::vector<uint32_t> drain(int n, uint32_t now=1000) {
+    std::vector<uint32_t> tags;
+    Packet* pkt;
+    while ((int)tags.size() < n && (pkt = mgr.getNextOutbound(now)) != NULL) {
+      tags.push_back(tagOf(pkt));
+      mgr.free(pkt);
+    }
+    return tags;
+  }
+};
+
+TEST_F(FairQueueTest, Classifies) {
+  Packet pkt;
+  pkt.header = (PAYLOAD_TYPE_ACK << PH_TYPE_SHIFT) | ROUTE_TYPE_FLOOD;
+  EXPECT_EQ(TX_CLASS_ACK, FairQueuePacketManager::defaultClassOf(&pkt));
+  pkt.header = (PAYLOAD_TYPE_PATH << PH_TYPE_SHIFT) | ROUTE_TYPE_DIRECT;
+  EXPECT_EQ(TX_CLASS_ACK, FairQueuePacketManager::defaultClassOf(&pkt));
+  pkt.header = (PAYLOAD_TYPE_TXT_MSG << PH_TYPE_SHIFT) | ROUTE_TYPE_TRANSPORT_DIRECT;
+  EXPECT_EQ(TX_CLASS_DIRECT, FairQueuePacketManager::defaultClassOf(&pkt));
+  pkt.header = (PAYLOAD_TYPE_GRP_TXT << PH_TYPE_SHIFT) | ROUTE_TYPE_FLOOD;
+  EXPECT_EQ(TX_CLASS_FLOOD, FairQueuePacketManager::defaultClassOf(&pkt));
+  pkt.header = (PAYLOAD_TYPE_ADVERT << PH_TYPE_SHIFT) | ROUTE_TYPE_TRANSPORT_FLOOD;
+  EXPECT_EQ(TX_CLASS_ADVERT, FairQueuePacketManager::defaultClassOf(&pkt));
+}
+
+TEST_F(FairQueueTest, PriorityOrderWithinClass) {
+  queue(PAYLOAD_TYPE_GRP_TXT, ROUTE_TYPE_FLOOD, 20, 1, 3);
+  queue(PAYLOAD_TYPE_GRP_TXT, ROUTE_TYPE_FLOOD, 20, 2, 1);
+  queue(PAYLOAD_TYPE_GRP_TXT, ROUTE_TYPE_FLOOD, 20, 3, 1);
+  queue(PAYLOAD_TYPE_GRP_TXT, ROUTE_TYPE_FLOOD, 20, 4, 0, 2000);   // not due yet
+  EXPECT_EQ(4, mgr.getOutboundTotal());
+  EXPECT_EQ(3, mgr.getOutboundCount(1000));
+  EXPECT_EQ(4, mgr.getOutboundCount(0xFFFFFFFF));
+
+  EXPECT_EQ(std::vector<uint32_t>({ 2, 3, 1 }), drain(10));
+  EXPECT_EQ(std::vector<uint32_t>({ 4 }), drain(10, 2000));
+  EXPECT_EQ(64, mgr.getFreeCount());
+}
+
+TEST_F(FairQueueTest, SharesByWeight) {
+  for (int i = 0; i < 30; i++) {
+    queue(PAYLOAD_TYPE_ADVERT, ROUTE_TYPE_FLOOD, 100, 1000 + i);
+    queue(PAYLOAD_TYPE_ACK, ROUTE_TYPE_DIRECT, 100, 2000 + i);   // (same size, so same airtime)
+  }
+  auto tags = drain(27);
+  int adverts = 0;
+  for (auto t : tags) adverts += t < 2000;
+  EXPECT_EQ(3, adverts);   // weights are 8:1
+
+  // once ACKs run out, adverts get all of it
+  tags = drain(100);
+  EXPECT_EQ(33u, tags.size());
+  for (int i = 8; i < 33; i++) EXPECT_LT(tags[i], 2000u);
+}
+
+TEST_F(FairQueueTest, ChargesByAirtime) {
+  mgr.setWeight(TX_CLASS_DIRECT, 1);
+  mgr.setWeight(TX_CLASS_FLOOD, 1);
+  for (int i = 0; i < 30; i++) {
+    queue(PAYLOAD_TYPE_TXT_MSG, ROUTE_TYPE_DIRECT, 10, 1000 + i);     // 44ms
+    queue(PAYLOAD_TYPE_TXT_MSG, ROUTE_TYPE_FLOOD, 178, 2000 + i);     // 380ms
+  }
+  auto tags = drain(27);
+  int big = 0;
+  for (auto t : tags) big += t >= 2000;
+  EXPECT_NEAR(3, big, 1);   // equal airtime, so ~8x as many of the short packets
+  EXPECT_NEAR(mgr.getClassStats(TX_CLASS_DIRECT).airtime_sent, mgr.getClassStats(TX_CLASS_FLOOD).airtime_sent, 380);
+}
+
+TEST_F(FairQueueTest, IdleClassGetsNoCredit) {
+  for (int i = 0; i < 50; i++) queue(PAYLOAD_TYPE_ADVERT, ROUTE_TYPE_FLOOD, 100, 1000 + i);
+  drain(50);   // flood class was idle all this time
+
+  for (int i = 0; i < 20; i++) {
+    queue(PAYLOAD_TYPE_ADVERT, ROUTE_TYPE_FLOOD, 100, 1000 + i);
+    queue(PAYLOAD_TYPE_GRP_TXT, ROUTE_TYPE_FLOOD, 100, 2000 + i);
+  }
+  auto tags = drain(30);
+  int adverts = 0, run = 0, max_run = 0;
+  for (auto t : tags) {
+    adverts += t < 2000;
+    run = t < 2000 ? 0 : run + 1;
+    if (run > max_run) max_run = run;
+  }
+  EXPECT_NEAR(10, adverts, 1);   // 2:1 straight away,
+  EXPECT_LE(max_run, 3);         // ..not a burst of GRP_TXT to 'catch up'
+}
+
+TEST_F(FairQueueTest, FullQueueEvictsLowerWeight) {
+  StaticPoolPacketManager small_pool(8);
+  FairQueuePacketManager q(small_pool, radio, 4);
+  for (int i = 0; i < 4; i++) q.queueOutbound(makePacket(q, PAYLOAD_TYPE_ADVERT, ROUTE_TYPE_FLOOD, 50, i), 0, 0);
+  q.queueOutbound(makePacket(q, PAYLOAD_TYPE_ACK, ROUTE_TYPE_DIRECT, 10, 10), 0, 0);
+  EXPECT_EQ(4, q.getOutboundTotal());
+  EXPECT_EQ(1, q.getQueuedCount(TX_CLASS_ACK));
+  EXPECT_EQ(1u, q.getClassStats(TX_CLASS_ADVERT).num_dropped);
+
+  q.queueOutbound(makePacket(q, PAYLOAD_TYPE_ADVERT, ROUTE_TYPE_FLOOD, 50, 5), 0, 0);   // nothing lower to evict
+  EXPECT_EQ(2u, q.getClassStats(TX_CLASS_ADVERT).num_dropped);
+  EXPECT_EQ(4, q.getFreeCount());   // dropped packets went back to pool
+
+  std::vector<uint32_t> tags;
+  Packet* pkt;
+  while ((pkt = q.getNextOutbound(0)) != NULL) { tags.push_back(tagOf(pkt)); q.free(pkt); }
+  EXPECT_EQ(std::vector<uint32_t>({ 10, 0, 1, 2 }), tags);   // newest advert was evicted
+}
+
+TEST_F(FairQueueTest, DelayStats) {
+  queue(PAYLOAD_TYPE_GRP_TXT, ROUTE_TYPE_FLOOD, 20, 1, 0, 1000);
+  queue(PAYLOAD_TYPE_GRP_TXT, ROUTE_TYPE_FLOOD, 20, 2, 0, 1000);
+  drain(1, 1500);
+  drain(1, 1000 + TX_STARVED_MILLIS + 1);
+  const auto& s = mgr.getClassStats(TX_CLASS_FLOOD);
+  EXPECT_EQ(2u, s.num_sent);
+  EXPECT_EQ(1u, s.num_starved);
+  EXPECT_EQ(500u + TX_STARVED_MILLIS + 1, s.delay_sum);
+  EXPECT_EQ(TX_STARVED_MILLIS + 1u, s.delay_max);
+  mgr.resetStats();
+  EXPECT_EQ(0u, mgr.getClassStats(TX_CLASS_FLOOD).num_sent);
+}
+
+// ------------- benchmark (class delays only, no pass/fail) -------------
+
+class StormDispatcher : public Dispatcher {
+public:
+  StormDispatcher(Radio& radio, MillisecondClock& ms, PacketManager& mgr) : Dispatcher(radio, ms, mgr) { }
+protected:
+  DispatcherAction onRecvPacket(Packet* pkt) override { return ACTION_RELEASE; }
+  unsigned long getDutyCycleWindowMs() const override { return 20000; }   // small, so budget runs out during the storm
+};
+
+struct BenchClass {
+  const char* name;
+  int queued, sent;
+  uint64_t delay_sum;
+  uint32_t delay_max;
+};
+
+// an advert storm (low hop counts, so priority 0..2, and more than the duty cycle allows), while a few ACKs,
+// direct messages and channel messages need to get out. Delays measured from queueing to start of transmit.
+static void runStorm(PacketManager& mgr, TestClock& ms, TimedRadio& radio, BenchClass* classes, StormDispatcher& d) {
+  std::mt19937 rng(5);
+  std::vector<uint32_t> queued_at;
+  d.begin();
+  const uint8_t types[] = { PAYLOAD_TYPE_ACK, PAYLOAD_TYPE_TXT_MSG, PAYLOAD_TYPE_GRP_TXT, PAYLOAD_TYPE_ADVERT };
+  const uint8_t routes[] = { ROUTE_TYPE_DIRECT, ROUTE_TYPE_DIRECT, ROUTE_TYPE_FLOOD, ROUTE_TYPE_FLOOD };
+  const int lens[] = { 4, 60, 60, 110 };
+  size_t n_seen = 0;
+
+  unsigned long end = ms.now + 120000;
+  for (; ms.now < end; ms.now++) {
+    int c = -1;
+    unsigned long t = ms.now;
+    if (t % 3000 == 0) c = 0;
+    else if (t % 7000 == 1) c = 1;
+    else if (t % 5000 == 2) c = 2;
+    else if (t < end - 60000 && t % 150 == 3) c = 3;
+    if (c >= 0) {
+      classes[c].queued++;
+      Packet* pkt = makePacket(mgr, types[c], routes[c], lens[c], queued_at.size());
+      queued_at.push_back(t);
+      if (pkt) d.sendPacket(pkt, c == 3 ? rng() % 2 : c == 2 ? 3 : 0);   // (as Mesh: floods by hop count, direct are 0)
+    }
+    d.loop();
+    for (; n_seen < radio.sent.size(); n_seen++) {
+      const auto& raw = radio.sent[n_seen];
+      uint32_t tag;
+      memcpy(&tag, &raw[2], 4);
+      int k = 0;
+      while (types[k] != (raw[0] >> PH_TYPE_SHIFT)) k++;
+      uint32_t delay = t - queued_at[tag];
+      classes[k].sent++;
+      classes[k].delay_sum += delay;
+      if (delay > classes[k].delay_max) classes[k].delay_max = delay;
+    }
+  }
+}
+
+TEST(FairQueueBenchmark, AdvertStorm) {
+  printf("\n  scheduler  | class   | queued |   sent | dropped | avg delay ms | max delay ms\n");
+  for (int fair = 0; fair < 2; fair++) {
+    TestClock ms;
+    TimedRadio radio(ms);
+    StaticPoolPacketManager pool(32);
+    FairQueuePacketManager fq(pool, radio, 32);
+    PacketManager& mgr = fair ? (PacketManager&)fq : (PacketManager&)pool;
+    StormDispatcher d(radio, ms, mgr);
+    BenchClass classes[] = { { "ACK" }, { "direct" }, { "channel" }, { "advert" } };
+
+    runStorm(mgr, ms, radio, classes, d);
+    for (auto& c : classes) {
+      int left = 0;
+      for (int i = 0; i < mgr.getOutboundTotal(); i++) {
+        left += FairQueuePacketManager::defaultClassOf(mgr.getOutboundByIdx(i)) == (&c - classes);
+      }
+      printf("  %-10s | %-7s | %6d | %6d | %7d | %12.0f | %12u\n", fair ? "fair" : "priority", c.name, c.queued, c.sent,
+             c.queued - c.sent - left, c.sent ? (double)c.delay_sum / c.sent : 0.0, c.delay_max);
+    }
+    printf("  %-10s | budget utilisation %.0f%%, budget holds %u\n", "", d.getTxBudgetUtilisation() * 100, d.getNumBudgetHolds());
+  }
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
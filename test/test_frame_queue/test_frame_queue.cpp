@@ -0,0 +1,249 @@
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <string.h>
+#include <random>
+#include <thread>
+#include <vector>
+#include "helpers/BaseSerialInterface.h"
+#include "helpers/FrameQueue.h"
+
+static std::vector<uint8_t> makeFrame(int len, uint8_t seed) {
+  std::vector<uint8_t> f(len);
+  for (int i = 0; i < len; i++) f[i] = seed + i;
+  return f;
+}
+
+TEST(FrameQueueTest, PushPopInOrder) {
+  FrameQueue q(100);
+  EXPECT_TRUE(q.isEmpty());
+  EXPECT_EQ(0, q.count());
+
+  auto a = makeFrame(10, 1), b = makeFrame(1, 50), c = makeFrame(30, 99);
+  EXPECT_TRUE(q.push(a.data(), a.size()));
+  EXPECT_TRUE(q.push(b.data(), b.size()));
+  EXPECT_TRUE(q.push(c.data(), c.size()));
+  EXPECT_EQ(3, q.count());
+  EXPECT_EQ(100 - 44, (int)q.getFreeBytes());
+
+  uint8_t buf[256];
+  EXPECT_EQ(10, (int)q.peekLen());
+  EXPECT_EQ(10, (int)q.peek(buf));
+  EXPECT_EQ(3, q.count());   // peek doesn't remove
+  EXPECT_EQ(10, (int)q.pop(buf));
+  EXPECT_EQ(0, memcmp(buf, a.data(), a.size()));
+  EXPECT_EQ(1, (int)q.pop(buf));
+  EXPECT_EQ(0, memcmp(buf, b.data(), b.size()));
+  EXPECT_EQ(30, (int)q.pop(buf));
+  EXPECT_EQ(0, memcmp(buf, c.data(), c.size()));
+
+  EXPECT_TRUE(q.isEmpty());
+  EXPECT_EQ(0, (int)q.pop(buf));
+  EXPECT_EQ(100, (int)q.getFreeBytes());
+}
+
+TEST(FrameQueueTest, RejectsWhenFull) {
+  FrameQueue q(50);
+  auto f = makeFrame(20, 7);
+  EXPECT_TRUE(q.push(f.data(), f.size()));
+  EXPECT_TRUE(q.push(f.data(), f.size()));
+  EXPECT_EQ(7, (int)q.getFreeSpace());   // 8 bytes left, less the length byte
+  EXPECT_FALSE(q.push(f.data(), f.size()));
+  EXPECT_EQ(2, q.count());   // unchanged
+  EXPECT_TRUE(q.push(f.data(), 7));
+  EXPECT_EQ(0, (int)q.getFreeSpace());
+  EXPECT_FALSE(q.push(f.data(), 1));
+
+  EXPECT_FALSE(q.push(f.data(), 0));   // empty frames not allowed
+  FrameQueue big(1000);
+  uint8_t huge[300] = {0};
+  EXPECT_FALSE(big.push(huge, 256));   // length must fit in a byte
+  EXPECT_TRUE(big.push(huge, 255));
+}
+
+TEST(FrameQueueTest, WrapsAround) {
+  FrameQueue q(64);
+  std::mt19937 rng(3);
+  std::vector<std::vector<uint8_t>> expected;
+  uint8_t buf[256];
+  int n_pushed = 0, n_popped = 0;
+  for (int step = 0; step < 5000; step++) {
+    if (rng() % 2) {
+      auto f = makeFrame(1 + rng() % 40, step);
+      bool fits = f.size() + 1 <= q.getFreeBytes();
+      EXPECT_EQ(fits, q.push(f.data(), f.size()));
+      if (fits) { expected.push_back(f); n_pushed++; }
+    } else if (n_popped < n_pushed) {
+      size_t len = q.pop(buf);
+      ASSERT_EQ(expected[n_popped].size(), len);
+      ASSERT_EQ(0, memcmp(buf, expected[n_popped].data(), len));
+      n_popped++;
+    } else {
+      EXPECT_TRUE(q.isEmpty());
+    }
+    ASSERT_EQ(n_pushed - n_popped, q.count());
+  }
+}
+
+TEST(FrameQueueTest, Clear) {
+  FrameQueue q(64);
+  auto f = makeFrame(20, 7);
+  q.push(f.data(), f.size());
+  q.push(f.data(), f.size());
+  q.clear();
+  EXPECT_TRUE(q.isEmpty());
+  EXPECT_EQ(0, q.count());
+  EXPECT_EQ(64, (int)q.getFreeBytes());
+}
+
+// parse back the serial framing, ie. '>', len LSB, len MSB, frame
+static int unframe(const uint8_t* buf, int len, std::vector<std::vector<uint8_t>>& out) {
+  int i = 0;
+  while (i < len) {
+    if (buf[i] != '>' || i + 3 > len) return -1;
+    int n = buf[i + 1] | (buf[i + 2] << 8);
+    if (i + 3 + n > len) return -1;
+    out.push_back(std::vector<uint8_t>(&buf[i + 3], &buf[i + 3 + n]));
+    i += 3 + n;
+  }
+  return out.size();
+}
+
+TEST(FrameQueueTest, PopFramedCoalesces) {
+  FrameQueue q(1000);
+  std::vector<std::vector<uint8_t>> frames;
+  for (int i = 0; i < 10; i++) {
+    frames.push_back(makeFrame(5 + i * 7, i));   // 5..68
+    q.push(frames[i].data(), frames[i].size());
+  }
+
+  uint8_t buf[150];
+  std::vector<std::vector<uint8_t>> got;
+  int total = 0, writes = 0;
+  while (!q.isEmpty()) {
+    int len = q.popFramed(buf, sizeof(buf), '>');
+    ASSERT_GT(len, 0);
+    ASSERT_LE(len, (int)sizeof(buf));
+    ASSERT_GT(unframe(buf, len, got), 0);
+    total += len;
+    writes++;
+  }
+  EXPECT_EQ(frames, got);
+  EXPECT_LT(writes, 10);
+  EXPECT_EQ(5*10 + 7*45 + 3*10, total);
+
+  // next frame doesn't fit, so nothing written
+  auto f = makeFrame(100, 0);
+  q.push(f.data(), f.size());
+  EXPECT_EQ(0, (int)q.popFramed(buf, 50, '>'));
+  EXPECT_EQ(1, q.count());
+}
+
+TEST(FrameQueueTest, ProducerAndConsumerThreads) {
+  FrameQueue q(300);
+  const int N = 20000;
+  std::thread producer([&q]() {
+    for (int i = 0; i < N; ) {
+      auto f = makeFrame(1 + i % 60, i);
+      if (q.push(f.data(), f.size())) i++; else std::this_thread::yield();
+    }
+  });
+  uint8_t buf[256];
+  for (int i = 0; i < N; ) {
+    size_t len = q.pop(buf);
+    if (len == 0) { std::this_thread::yield(); continue; }
+    auto f = makeFrame(1 + i % 60, i);
+    ASSERT_EQ(f.size(), len);
+    ASSERT_EQ(0, memcmp(buf, f.data(), len));
+    i++;
+  }
+  producer.join();
+  EXPECT_TRUE(q.isEmpty());
+}
+
+// ------------- benchmark (frame counts only, no pass/fail) -------------
+
+// the original queues: fixed slots of MAX_FRAME_SIZE, shifted on dequeue
+struct ShiftQueue {
+  struct Frame {
+    uint8_t len;
+    uint8_t buf[MAX_FRAME_SIZE];
+  };
+  std::vector<Frame> q;
+  int len = 0;
+  ShiftQueue(int size) : q(size) { }
+  bool push(const uint8_t* src, int n) {
+    if (len >= (int)q.size()) return false;
+    q[len].len = n;
+    memcpy(q[len].buf, src, n);
+    len++;
+    return true;
+  }
+  int pop(uint8_t* dest) {
+    if (len == 0) return 0;
+    int n = q[0].len;
+    memcpy(dest, q[0].buf, n);
+    len--;
+    for (int i = 0; i < len; i++) q[i] = q[i + 1];
+    return n;
+  }
+};
+
+// a burst, as when the app connects and a contacts sync runs while messages arrive: each loop the sync
+// writes a frame (unless busy), every 3rd loop a push notification (1 byte) and a log frame (~60 bytes) arrive,
+// and the transport drains one frame every 4 loops
+template <class Q, class BusyFn>
+static void runBurst(Q& q, BusyFn busy, int& sent, int& dropped, int& pushes_dropped) {
+  uint8_t frame[MAX_FRAME_SIZE], buf[MAX_FRAME_SIZE];
+  memset(frame, 0x55, sizeof(frame));
+  int sync_left = 200;
+  sent = dropped = pushes_dropped = 0;
+  for (int loop = 0; loop < 4000; loop++) {
+    if (sync_left > 0 && !busy()) {
+      if (q.push(frame, 150)) { sync_left--; } else { dropped++; }
+    }
+    if (loop % 3 == 0 && loop < 600) {
+      if (!q.push(frame, 1)) { dropped++; pushes_dropped++; }
+      if (!busy() && !q.push(frame, 60)) dropped++;
+    }
+    if (loop % 4 == 0 && q.pop(buf) > 0) sent++;
+  }
+}
+
+TEST(FrameQueueTest, BenchmarkBurst) {
+  printf("\n  queue                     | RAM bytes | frames sent | dropped | push notifications dropped\n");
+  int sent, dropped, pushes_dropped;
+  for (int slots : { 4, 12 }) {
+    ShiftQueue sq(slots);
+    runBurst(sq, [&]() { return sq.len >= slots * 2 / 3; }, sent, dropped, pushes_dropped);
+    printf("  %2d slots (original)       | %9d | %11d | %7d | %d\n", slots, (int)(slots * sizeof(ShiftQueue::Frame)), sent, dropped, pushes_dropped);
+  }
+  for (int size : { 4*(MAX_FRAME_SIZE+1), SERIAL_SEND_QUEUE_SIZE }) {
+    FrameQueue fq(size);
+    runBurst(fq, [&]() { return fq.getFreeBytes() < SERIAL_SEND_QUEUE_RESERVE; }, sent, dropped, pushes_dropped);
+    printf("  FrameQueue                | %9d | %11d | %7d | %d\n", size, sent, dropped, pushes_dropped);
+  }
+}
+
+TEST(FrameQueueTest, BenchmarkWifiWrites) {
+  const int SIZES[] = { 1, 10, 60, 150 };
+  printf("\n  frame len | frames | writes (one per frame) | writes (coalesced, 1436 bytes) | shift copies avoided (bytes)\n");
+  for (int len : SIZES) {
+    FrameQueue q(16*(MAX_FRAME_SIZE+1));
+    ShiftQueue sq(16);
+    uint8_t frame[MAX_FRAME_SIZE], buf[1436];
+    memset(frame, 0xAA, sizeof(frame));
+    int n = 0;
+    while (q.push(frame, len) && sq.push(frame, len)) n++;
+
+    long shift_bytes = 0;
+    for (int i = sq.len - 1; i > 0; i--) shift_bytes += (long)i * sizeof(ShiftQueue::Frame);
+    int writes = 0;
+    while (q.popFramed(buf, sizeof(buf), '>') > 0) writes++;
+    printf("  %9d | %6d | %21d | %30d | %ld\n", len, n, n, writes, shift_bytes);
+  }
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
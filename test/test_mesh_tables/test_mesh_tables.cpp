@@ -0,0 +1,190 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <stdio.h>
+#include <vector>
+#include "helpers/SimpleMeshTables.h"
+#include "helpers/HashedMeshTables.h"
+
+using namespace mesh;
+
+static void makePacket(Packet& pkt, uint32_t id, bool direct = false) {
+  pkt.header = (PAYLOAD_TYPE_GRP_TXT << PH_TYPE_SHIFT) | (direct ? ROUTE_TYPE_DIRECT : ROUTE_TYPE_FLOOD);
+  pkt.path_len = 0;
+  pkt.payload_len = 16;
+  memset(pkt.payload, 0, pkt.payload_len);
+  memcpy(pkt.payload, &id, sizeof(id));
+  pkt.invalidateHash();   // Packet instance is being re-used
+}
+
+TEST(HashedMeshTables, SeenAndDupStats) {
+  HashedMeshTables tables(16);
+  Packet a, b, c;
+  makePacket(a, 1);
+  makePacket(b, 2);
+  makePacket(c, 3, true);
+
+  EXPECT_FALSE(tables.hasSeen(&a));
+  EXPECT_FALSE(tables.hasSeen(&b));
+  EXPECT_FALSE(tables.hasSeen(&c));
+  EXPECT_TRUE(tables.hasSeen(&a));
+  EXPECT_TRUE(tables.hasSeen(&b));
+  EXPECT_TRUE(tables.hasSeen(&c));
+  EXPECT_EQ(3, tables.getCount());
+  EXPECT_EQ(2u, tables.getNumFloodDups());
+  EXPECT_EQ(1u, tables.getNumDirectDups());
+
+  tables.resetStats();
+  EXPECT_EQ(0u, tables.getNumFloodDups());
+  EXPECT_EQ(0u, tables.getNumDirectDups());
+}
+
+TEST(HashedMeshTables, Clear) {
+  HashedMeshTables tables(16);
+  Packet a, b;
+  makePacket(a, 1);
+  makePacket(b, 2);
+
+  tables.hasSeen(&a);
+  tables.hasSeen(&b);
+  tables.clear(&a);
+  EXPECT_EQ(1, tables.getCount());
+  EXPECT_FALSE(tables.hasSeen(&a));   // forgotten, so is 'new' again
+  EXPECT_TRUE(tables.hasSeen(&b));
+}
+
+// with same capacity, must give exactly the same answers as SimpleMeshTables (FIFO eviction)
+TEST(HashedMeshTables, MatchesSimpleMeshTables) {
+  SimpleMeshTables ref;
+  HashedMeshTables tables(MAX_PACKET_HASHES);
+
+  srand(99);
+  Packet pkt;
+  for (int i = 0; i < 50000; i++) {
+    makePacket(pkt, rand() % 400);   // enough repeats to hit both dups and evictions
+    if (rand() % 20 == 0) {
+      ref.clear(&pkt);
+      tables.clear(&pkt);
+    } else {
+      ASSERT_EQ(ref.hasSeen(&pkt), tables.hasSeen(&pkt)) << "at step " << i;
+    }
+  }
+  EXPECT_EQ(ref.getNumFloodDups(), tables.getNumFloodDups());
+}
+
+TEST(HashedMeshTables, RebuildIndex) {
+  HashedMeshTables tables(64);
+  Packet pkt;
+  for (int i = 0; i < 100; i++) {
+    makePacket(pkt, i);
+    tables.hasSeen(&pkt);
+  }
+  tables.rebuildIndex();
+  EXPECT_EQ(64, tables.getCount());
+  makePacket(pkt, 99);
+  EXPECT_TRUE(tables.hasSeen(&pkt));
+  makePacket(pkt, 10);   // evicted
+  EXPECT_FALSE(tables.hasSeen(&pkt));
+}
+
+TEST(PacketHash, CalculatedOncePerPacket) {
+  SimpleMeshTables simple;
+  HashedMeshTables tables(16);
+  Packet pkt;
+  makePacket(pkt, 1);
+
+  Packet::resetHashStats();
+  simple.hasSeen(&pkt);
+  tables.hasSeen(&pkt);
+  tables.clear(&pkt);
+  EXPECT_EQ(1u, Packet::getNumHashCalcs());
+  EXPECT_EQ(2u, Packet::getNumHashReused());
+
+  uint8_t before[MAX_HASH_SIZE];
+  pkt.calculatePacketHash(before);
+
+  pkt.payload_len++;   // length change is detected
+  EXPECT_NE(0, memcmp(before, pkt.getPacketHash(), MAX_HASH_SIZE));
+  EXPECT_EQ(2u, Packet::getNumHashCalcs());
+
+  pkt.payload_len--;
+  pkt.payload[0] ^= 1;   // in-place change must be flagged
+  pkt.invalidateHash();
+  EXPECT_NE(0, memcmp(before, pkt.getPacketHash(), MAX_HASH_SIZE));
+  EXPECT_EQ(3u, Packet::getNumHashCalcs());
+}
+
+TEST(PacketHash, TracePathLenIncluded) {
+  Packet pkt;
+  makePacket(pkt, 1, true);
+  pkt.header = (PAYLOAD_TYPE_TRACE << PH_TYPE_SHIFT) | ROUTE_TYPE_DIRECT;
+
+  uint8_t before[MAX_HASH_SIZE];
+  pkt.calculatePacketHash(before);
+  pkt.path_len++;   // TRACE appends SNRs to path as it goes
+  EXPECT_NE(0, memcmp(before, pkt.getPacketHash(), MAX_HASH_SIZE));
+}
+
+// ------------- benchmark (timings only, no pass/fail) -------------
+
+template <class T>
+static double benchLookups(T& tables, int capacity, int lookups) {
+  std::vector<Packet> pkts(capacity);
+  for (int i = 0; i < capacity; i++) {
+    makePacket(pkts[i], i);
+    tables.hasSeen(&pkts[i]);   // fill table
+  }
+  // precompute hashes so timing is of the table, not of the hashing
+  std::vector<uint8_t> hashes(lookups*MAX_HASH_SIZE);
+  Packet pkt;
+  for (int i = 0; i < lookups; i++) {
+    makePacket(pkt, (i & 1) ? (i % capacity) : 1000000 + i);   // 50% hits, 50% new
+    pkt.calculatePacketHash(&hashes[i*MAX_HASH_SIZE]);
+  }
+
+  volatile int seen = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < lookups; i++) {
+    seen += tables.hasSeenHash(&hashes[i*MAX_HASH_SIZE], false);
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  return std::chrono::duration<double, std::nano>(elapsed).count() / lookups;
+}
+
+// exposes SimpleMeshTables' linear scan with a pre-computed hash (same logic as SimpleMeshTables::hasSeen)
+class ScanTables {
+  uint8_t _hashes[MAX_PACKET_HASHES*MAX_HASH_SIZE];
+  int _next_idx;
+public:
+  ScanTables() { memset(_hashes, 0, sizeof(_hashes)); _next_idx = 0; }
+  bool hasSeen(const Packet* packet) {
+    uint8_t hash[MAX_HASH_SIZE];
+    packet->calculatePacketHash(hash);
+    return hasSeenHash(hash, false);
+  }
+  bool hasSeenHash(const uint8_t* hash, bool is_direct) {
+    const uint8_t* sp = _hashes;
+    for (int i = 0; i < MAX_PACKET_HASHES; i++, sp += MAX_HASH_SIZE) {
+      if (memcmp(hash, sp, MAX_HASH_SIZE) == 0) return true;
+    }
+    memcpy(&_hashes[_next_idx*MAX_HASH_SIZE], hash, MAX_HASH_SIZE);
+    _next_idx = (_next_idx + 1) % MAX_PACKET_HASHES;
+    return false;
+  }
+};
+
+TEST(MeshTablesBenchmark, LookupCost) {
+  const int LOOKUPS = 200000;
+  ScanTables scan;
+  printf("\n  SimpleMeshTables scan, %d entries: %.1f ns/lookup\n", MAX_PACKET_HASHES, benchLookups(scan, MAX_PACKET_HASHES, LOOKUPS));
+
+  const int sizes[] = { 160, 1024, 4096 };
+  for (int i = 0; i < 3; i++) {
+    HashedMeshTables tables(sizes[i]);
+    printf("  HashedMeshTables, %d entries: %.1f ns/lookup\n", sizes[i], benchLookups(tables, sizes[i], LOOKUPS));
+  }
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
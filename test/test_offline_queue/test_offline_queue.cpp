@@ -0,0 +1,250 @@
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <deque>
+#include <random>
+#include <vector>
+#include "helpers/OfflineQueue.h"
+
+#define CHANNEL_MSG  8   // as per RESP_CODE_CHANNEL_MSG_RECV
+#define CONTACT_MSG  7
+
+static bool isChannelMsg(const uint8_t frame[], int len) {
+  return frame[0] == CHANNEL_MSG;
+}
+
+class OfflineQueueTest : public ::testing::Test {
+protected:
+  char dir[64];
+  fs::FS* fs;
+
+  void SetUp() override {
+    strcpy(dir, "/tmp/offlinequeueXXXXXX");
+    ASSERT_TRUE(mkdtemp(dir) != NULL);
+    fs = new fs::FS(dir);
+  }
+  void TearDown() override {
+    fs->remove("/offline_q");
+    rmdir(dir);
+    delete fs;
+  }
+
+  // frame with a type and a unique id
+  static std::vector<uint8_t> makeFrame(uint8_t type, uint32_t id) {
+    std::vector<uint8_t> f(10 + id % 100);
+    f[0] = type;
+    memcpy(&f[1], &id, 4);
+    for (size_t i = 5; i < f.size(); i++) f[i] = id + i;
+    return f;
+  }
+  static uint32_t idOf(const uint8_t* frame) {
+    uint32_t id;
+    memcpy(&id, &frame[1], 4);
+    return id;
+  }
+  bool push(OfflineQueue& q, uint8_t type, uint32_t id) {
+    auto f = makeFrame(type, id);
+    return q.push(f.data(), f.size());
+  }
+  // pops a frame, checking its contents. \returns id, or -1 if empty
+  long pop(OfflineQueue& q) {
+    uint8_t buf[MAX_FRAME_SIZE];
+    int len = q.pop(buf);
+    if (len == 0) return -1;
+    auto f = makeFrame(buf[0], idOf(buf));
+    EXPECT_EQ(f, std::vector<uint8_t>(buf, buf + len));
+    return idOf(buf);
+  }
+};
+
+TEST_F(OfflineQueueTest, RamOnlyKeepsOldBehaviour) {
+  OfflineQueue q("/offline_q", 4, 0, isChannelMsg);
+  ASSERT_TRUE(q.begin(fs));
+  EXPECT_FALSE(fs->exists("/offline_q"));
+
+  EXPECT_TRUE(push(q, CONTACT_MSG, 1));
+  EXPECT_TRUE(push(q, CHANNEL_MSG, 2));
+  EXPECT_TRUE(push(q, CONTACT_MSG, 3));
+  EXPECT_TRUE(push(q, CHANNEL_MSG, 4));
+  EXPECT_TRUE(push(q, CONTACT_MSG, 5));   // full, so oldest channel msg (2) is evicted
+  EXPECT_EQ(4, q.count());
+  EXPECT_EQ(1u, q.getNumEvicted());
+  EXPECT_TRUE(push(q, CONTACT_MSG, 6));   // evicts 4
+  EXPECT_FALSE(push(q, CONTACT_MSG, 7));  // no channel msgs left, so dropped
+  EXPECT_EQ(1u, q.getNumDropped());
+
+  EXPECT_EQ(1, pop(q));
+  EXPECT_EQ(3, pop(q));
+  EXPECT_EQ(5, pop(q));
+  EXPECT_EQ(6, pop(q));
+  EXPECT_EQ(-1, pop(q));
+  EXPECT_EQ(0u, q.getTotalSpilled());
+}
+
+TEST_F(OfflineQueueTest, SpillsInOrder) {
+  OfflineQueue q("/offline_q", 16, 200, isChannelMsg);
+  ASSERT_TRUE(q.begin(fs));
+  for (int i = 0; i < 150; i++) {
+    ASSERT_TRUE(push(q, i % 3 ? CHANNEL_MSG : CONTACT_MSG, i));
+  }
+  EXPECT_EQ(150, q.count());
+  EXPECT_EQ(134, q.getNumSpilled());
+  EXPECT_EQ(134u, q.getTotalSpilled());
+
+  for (int i = 0; i < 100; i++) ASSERT_EQ(i, pop(q));
+  for (int i = 150; i < 200; i++) {   // still goes to end, even though RAM window has room
+    ASSERT_TRUE(push(q, CONTACT_MSG, i));
+  }
+  for (int i = 100; i < 200; i++) ASSERT_EQ(i, pop(q));
+  EXPECT_EQ(-1, pop(q));
+  EXPECT_EQ(0, q.count());
+  EXPECT_EQ(0u, q.getNumDropped());
+}
+
+TEST_F(OfflineQueueTest, SpilledFramesSurviveReboot) {
+  {
+    OfflineQueue q("/offline_q", 16, 64, isChannelMsg);
+    ASSERT_TRUE(q.begin(fs));
+    for (int i = 0; i < 50; i++) push(q, CONTACT_MSG, i);
+    EXPECT_EQ(0, pop(q));
+  }
+  OfflineQueue q("/offline_q", 16, 64, isChannelMsg);
+  ASSERT_TRUE(q.begin(fs));
+  EXPECT_EQ(34, q.count());   // RAM window is lost
+  push(q, CONTACT_MSG, 50);
+  for (int i = 16; i <= 50; i++) ASSERT_EQ(i, pop(q));
+  EXPECT_EQ(-1, pop(q));
+
+  // and an empty queue stays empty
+  OfflineQueue q2("/offline_q", 16, 64, isChannelMsg);
+  ASSERT_TRUE(q2.begin(fs));
+  EXPECT_EQ(0, q2.count());
+}
+
+TEST_F(OfflineQueueTest, FullSpillEvictsChannelMsgs) {
+  OfflineQueue q("/offline_q", 4, 8, isChannelMsg);
+  ASSERT_TRUE(q.begin(fs));
+  for (int i = 0; i < 12; i++) ASSERT_TRUE(push(q, i == 1 || i == 2 ? CHANNEL_MSG : CONTACT_MSG, i));
+  EXPECT_EQ(12, q.count());
+
+  EXPECT_TRUE(push(q, CONTACT_MSG, 12));   // evicts 1, and 4 moves into RAM window
+  EXPECT_TRUE(push(q, CONTACT_MSG, 13));   // evicts 2
+  EXPECT_FALSE(push(q, CONTACT_MSG, 14));  // nothing evictable, in RAM window or file
+  EXPECT_EQ(2u, q.getNumEvicted());
+  EXPECT_EQ(1u, q.getNumDropped());
+
+  std::vector<long> got;
+  long id;
+  while ((id = pop(q)) >= 0) got.push_back(id);
+  EXPECT_EQ(std::vector<long>({ 0, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13 }), got);
+}
+
+TEST_F(OfflineQueueTest, FullSpillEvictsOldestSpilledChannelMsg) {
+  OfflineQueue q("/offline_q", 2, 4, isChannelMsg);
+  ASSERT_TRUE(q.begin(fs));
+  for (int i = 0; i < 6; i++) ASSERT_TRUE(push(q, i == 3 || i == 5 ? CHANNEL_MSG : CONTACT_MSG, i));
+
+  EXPECT_TRUE(push(q, CONTACT_MSG, 6));   // nothing to evict in RAM window, so 3 from file
+  EXPECT_EQ(1u, q.getNumEvicted());
+  EXPECT_TRUE(push(q, CONTACT_MSG, 7));   // then 5
+  EXPECT_FALSE(push(q, CHANNEL_MSG, 8));
+  EXPECT_EQ(6, q.count());
+
+  OfflineQueue q2("/offline_q", 2, 4, isChannelMsg);   // and order is kept after reboot
+  ASSERT_TRUE(q2.begin(fs));
+  EXPECT_EQ(4, q2.count());
+  EXPECT_EQ(2, pop(q2));
+  EXPECT_EQ(4, pop(q2));
+  EXPECT_EQ(6, pop(q2));
+  EXPECT_EQ(7, pop(q2));
+  EXPECT_EQ(-1, pop(q2));
+}
+
+TEST_F(OfflineQueueTest, SkipsJunkSlot) {
+  {
+    OfflineQueue q("/offline_q", 2, 8, isChannelMsg);
+    ASSERT_TRUE(q.begin(fs));
+    for (int i = 0; i < 6; i++) push(q, CONTACT_MSG, i);   // 2..5 are in slots 0..3
+  }
+  File f = fs->open("/offline_q", "r+");
+  uint8_t junk[5] = { 0xAA, 0xBB, 0xCC, 0xDD, MAX_FRAME_SIZE + 1 };
+  f.seek(2 * 184);   // frame 4
+  f.write(junk, sizeof(junk));
+  f.close();
+
+  OfflineQueue q("/offline_q", 2, 8, isChannelMsg);
+  ASSERT_TRUE(q.begin(fs));
+  EXPECT_EQ(3, q.count());
+  EXPECT_EQ(2, pop(q));
+  EXPECT_EQ(3, pop(q));
+  EXPECT_EQ(5, pop(q));
+  EXPECT_EQ(-1, pop(q));
+}
+
+TEST_F(OfflineQueueTest, RandomOpsMatchReference) {
+  std::mt19937 rng(9);
+  std::deque<uint32_t> ref;
+  OfflineQueue* q = new OfflineQueue("/offline_q", 8, 40, NULL);
+  ASSERT_TRUE(q->begin(fs));
+  uint32_t next_id = 0;
+  for (int step = 0; step < 3000; step++) {
+    int r = rng() % 100;
+    if (r < 50) {
+      bool full = q->getNumSpilled() == 40;   // (RAM window may have room, but new frames go after spilled ones)
+      ASSERT_EQ(!full, push(*q, CONTACT_MSG, next_id));
+      if (!full) ref.push_back(next_id);
+      next_id++;
+    } else if (r < 98) {
+      long id = pop(*q);
+      if (ref.empty()) {
+        ASSERT_EQ(-1, id);
+      } else {
+        ASSERT_EQ((long)ref.front(), id);
+        ref.pop_front();
+      }
+    } else {   // reboot: RAM window is lost
+      int in_ram = q->count() - q->getNumSpilled();
+      for (int i = 0; i < in_ram; i++) ref.pop_front();
+      delete q;
+      q = new OfflineQueue("/offline_q", 8, 40, NULL);
+      ASSERT_TRUE(q->begin(fs));
+    }
+    ASSERT_EQ((int)ref.size(), q->count());
+  }
+  delete q;
+}
+
+// ------------- benchmark (delivery counts only, no pass/fail) -------------
+
+// a phone disconnected overnight: 'n' messages arrive (1 in 4 a direct message, rest channel msgs), then the app drains
+TEST_F(OfflineQueueTest, BenchmarkOvernight) {
+  const int COUNTS[] = { 16, 100, 300, 1000 };
+  printf("\n  messages | queue               | DMs delivered | channel delivered | evicted | dropped | flash bytes/msg\n");
+  for (int n : COUNTS) {
+    for (int spill : { 0, 256 }) {
+      fs->remove("/offline_q");
+      fs->bytes_written = 0;
+      OfflineQueue q("/offline_q", 16, spill, isChannelMsg);
+      ASSERT_TRUE(q.begin(fs));
+      uint32_t prealloc = fs->bytes_written;
+      int dms = 0;
+      for (int i = 0; i < n; i++) {
+        bool dm = i % 4 == 0;
+        dms += dm;
+        push(q, dm ? CONTACT_MSG : CHANNEL_MSG, i);
+      }
+      int got_dm = 0, got_ch = 0;
+      uint8_t buf[MAX_FRAME_SIZE];
+      while (q.pop(buf) > 0) {
+        if (buf[0] == CONTACT_MSG) got_dm++; else got_ch++;
+      }
+      printf("  %8d | %-19s | %6d of %4d | %9d of %4d | %7u | %7u | %.1f\n", n, spill ? "RAM 16 + flash 256" : "RAM 16 (original)",
+             got_dm, dms, got_ch, n - dms, q.getNumEvicted(), q.getNumDropped(), (double)(fs->bytes_written - prealloc) / n);
+    }
+  }
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
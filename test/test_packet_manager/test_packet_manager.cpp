@@ -0,0 +1,404 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include "helpers/StaticPoolPacketManager.h"
+#include "helpers/HeapPacketManager.h"
+#include "helpers/SlabPacketManager.h"
+
+using namespace mesh;
+
+// packets are tagged (via payload_len) so results from different managers can be compared
+static Packet* allocTagged(PacketManager& mgr, int tag) {
+  Packet* pkt = mgr.allocNew();
+  if (pkt) pkt->payload_len = tag;
+  return pkt;
+}
+
+TEST(HeapPacketManager, PoolAllocFree) {
+  HeapPacketManager mgr(4);
+  EXPECT_EQ(4, mgr.getFreeCount());
+
+  Packet* a = mgr.allocNew();
+  Packet* b = mgr.allocNew();
+  ASSERT_NE(nullptr, a);
+  ASSERT_NE(nullptr, b);
+  EXPECT_NE(a, b);
+  EXPECT_EQ(2, mgr.getFreeCount());
+
+  mgr.allocNew();
+  mgr.allocNew();
+  EXPECT_EQ(nullptr, mgr.allocNew());
+
+  mgr.free(a);
+  EXPECT_EQ(1, mgr.getFreeCount());
+  EXPECT_EQ(a, mgr.allocNew());
+}
+
+TEST(HeapPacketManager, PriorityAmongstDue) {
+  HeapPacketManager mgr(8);
+  mgr.queueOutbound(allocTagged(mgr, 1), 3, 100);
+  mgr.queueOutbound(allocTagged(mgr, 2), 1, 100);
+  mgr.queueOutbound(allocTagged(mgr, 3), 0, 500);   // most important, but not due yet
+  mgr.queueOutbound(allocTagged(mgr, 4), 1, 50);
+
+  EXPECT_EQ(0, mgr.getOutboundCount(10));
+  EXPECT_EQ(nullptr, mgr.getNextOutbound(10));
+  EXPECT_EQ(3, mgr.getOutboundCount(100));
+  EXPECT_EQ(4, mgr.getOutboundCount(0xFFFFFFFF));
+  EXPECT_EQ(4, mgr.getOutboundTotal());
+
+  EXPECT_EQ(2, mgr.getNextOutbound(200)->payload_len);   // priority 1, FIFO
+  EXPECT_EQ(4, mgr.getNextOutbound(200)->payload_len);
+  EXPECT_EQ(1, mgr.getNextOutbound(200)->payload_len);
+  EXPECT_EQ(nullptr, mgr.getNextOutbound(200));
+  EXPECT_EQ(3, mgr.getNextOutbound(500)->payload_len);
+  EXPECT_EQ(0, mgr.getOutboundTotal());
+}
+
+TEST(HeapPacketManager, MillisWrapAround) {
+  HeapPacketManager mgr(4);
+  mgr.queueOutbound(allocTagged(mgr, 1), 1, 0xFFFFFFF0);
+  mgr.queueOutbound(allocTagged(mgr, 2), 1, 0x00000010);   // after wrap
+
+  EXPECT_EQ(1, mgr.getOutboundCount(0xFFFFFFF8));
+  EXPECT_EQ(1, mgr.getNextOutbound(0x00000005)->payload_len);
+  EXPECT_EQ(nullptr, mgr.getNextOutbound(0x00000005));
+  EXPECT_EQ(2, mgr.getNextOutbound(0x00000010)->payload_len);
+}
+
+TEST(HeapPacketManager, RemoveByIdx) {
+  HeapPacketManager mgr(8);
+  for (int i = 1; i <= 5; i++) {
+    mgr.queueOutbound(allocTagged(mgr, i), i % 3, i*10);
+  }
+  mgr.getOutboundCount(25);   // some due, some not
+
+  int removed = mgr.removeOutboundByIdx(2)->payload_len;
+  EXPECT_EQ(4, mgr.getOutboundTotal());
+  EXPECT_EQ(nullptr, mgr.removeOutboundByIdx(4));
+
+  int seen = 0;
+  Packet* pkt;
+  while ((pkt = mgr.getNextOutbound(1000)) != NULL) {
+    EXPECT_NE(removed, pkt->payload_len);
+    seen++;
+  }
+  EXPECT_EQ(4, seen);
+}
+
+// random workload, both managers must hand out packets in exactly the same order
+TEST(HeapPacketManager, MatchesStaticPoolOrder) {
+  const int POOL = 32;
+  StaticPoolPacketManager ref(POOL);
+  HeapPacketManager heap(POOL);
+
+  srand(1234);
+  uint32_t now = 0xFFFF0000;   // cross the wrap-around too
+  int tag = 1;
+  for (int step = 0; step < 20000; step++) {
+    now += rand() % 50;
+    int op = rand() % 4;
+    if (op < 2) {
+      Packet* a = allocTagged(ref, tag);
+      Packet* b = allocTagged(heap, tag);
+      ASSERT_EQ(a == NULL, b == NULL);
+      if (a) {
+        uint8_t pri = rand() % 6;
+        uint32_t when = now + rand() % 2000;
+        if (op == 0) {
+          ref.queueOutbound(a, pri, when);
+          heap.queueOutbound(b, pri, when);
+        } else {
+          ref.queueInbound(a, when);
+          heap.queueInbound(b, when);
+        }
+        tag++;
+      }
+    } else if (op == 2) {
+      ASSERT_EQ(ref.getOutboundCount(now), heap.getOutboundCount(now));
+      Packet* a = ref.getNextOutbound(now);
+      Packet* b = heap.getNextOutbound(now);
+      ASSERT_EQ(a == NULL, b == NULL);
+      if (a) {
+        ASSERT_EQ(a->payload_len, b->payload_len);
+        ref.free(a);
+        heap.free(b);
+      }
+    } else {
+      Packet* a = ref.getNextInbound(now);
+      Packet* b = heap.getNextInbound(now);
+      ASSERT_EQ(a == NULL, b == NULL);
+      if (a) {
+        ASSERT_EQ(a->payload_len, b->payload_len);
+        ref.free(a);
+        heap.free(b);
+      }
+    }
+    ASSERT_EQ(ref.getOutboundTotal(), heap.getOutboundTotal());
+    ASSERT_EQ(ref.getFreeCount(), heap.getFreeCount());
+  }
+}
+
+// tag goes in the payload too, as SlabPacketManager re-builds packets from wire format
+static Packet* allocSized(PacketManager& mgr, int tag, int path_hashes, int payload_len) {
+  Packet* pkt = mgr.allocNew();
+  if (pkt) {
+    pkt->header = (PAYLOAD_TYPE_TXT_MSG << PH_TYPE_SHIFT) | (tag % 2 ? ROUTE_TYPE_TRANSPORT_FLOOD : ROUTE_TYPE_FLOOD);
+    pkt->transport_codes[0] = tag;
+    pkt->transport_codes[1] = ~tag;
+    pkt->path_len = path_hashes;
+    for (int i = 0; i < path_hashes; i++) pkt->path[i] = tag + i;
+    pkt->payload_len = payload_len;
+    memset(pkt->payload, tag, payload_len);
+    memcpy(pkt->payload, &tag, sizeof(tag));
+    pkt->_snr = (int8_t) tag;
+  }
+  return pkt;
+}
+
+static int tagOf(const Packet* pkt) {
+  int tag;
+  memcpy(&tag, pkt->payload, sizeof(tag));
+  return tag;
+}
+
+TEST(SlabPacketManager, RoundTrip) {
+  SlabPacketManager mgr(2, 4, 4, 4);
+  const int sizes[][2] = { { 0, 10 }, { 8, 60 }, { 63, 184 }, { 3, 4 } };   // path hashes, payload len
+  Packet expected[4];
+  for (int i = 0; i < 4; i++) {
+    Packet* pkt = allocSized(mgr, 100 + i, sizes[i][0], sizes[i][1]);
+    ASSERT_NE(nullptr, pkt);
+    expected[i] = *pkt;
+    mgr.queueOutbound(pkt, 0, 10);
+    EXPECT_EQ(2, mgr.getFreeCount());   // working Packet handed back straight away
+  }
+  EXPECT_EQ(2, mgr.getClassStats(0).in_use);
+  EXPECT_EQ(1, mgr.getClassStats(1).in_use);
+  EXPECT_EQ(1, mgr.getClassStats(2).in_use);
+  EXPECT_EQ(100, tagOf(mgr.getOutboundByIdx(0)));
+
+  for (int i = 0; i < 4; i++) {
+    Packet* pkt = mgr.getNextOutbound(10);
+    ASSERT_NE(nullptr, pkt);
+    EXPECT_EQ(expected[i].header, pkt->header);
+    EXPECT_EQ(expected[i].path_len, pkt->path_len);
+    EXPECT_EQ(expected[i].payload_len, pkt->payload_len);
+    EXPECT_EQ(expected[i]._snr, pkt->_snr);
+    EXPECT_EQ(0, memcmp(expected[i].path, pkt->path, pkt->getPathByteLen()));
+    EXPECT_EQ(0, memcmp(expected[i].payload, pkt->payload, pkt->payload_len));
+    if (pkt->hasTransportCodes()) {
+      EXPECT_EQ(expected[i].transport_codes[0], pkt->transport_codes[0]);
+      EXPECT_EQ(expected[i].transport_codes[1], pkt->transport_codes[1]);
+    }
+    mgr.free(pkt);
+  }
+  for (int c = 0; c < SLAB_NUM_CLASSES; c++) EXPECT_EQ(0, mgr.getClassStats(c).in_use);
+}
+
+TEST(SlabPacketManager, SpillsToLargerClassThenFullPacket) {
+  SlabPacketManager mgr(2, 1, 1, 0);
+  mgr.queueOutbound(allocSized(mgr, 1, 0, 10), 0, 0);
+  mgr.queueOutbound(allocSized(mgr, 2, 0, 10), 0, 0);   // small class full, goes in medium
+  EXPECT_EQ(1u, mgr.getClassStats(0).num_fails);
+  EXPECT_EQ(1, mgr.getClassStats(1).in_use);
+
+  mgr.queueInbound(allocSized(mgr, 3, 0, 10), 0);   // no slots left, keeps the working Packet
+  mgr.queueOutbound(allocSized(mgr, 4, 63, 184), 0, 0);   // too big for any class
+  EXPECT_EQ(2u, mgr.getNumUncompacted());
+  EXPECT_EQ(0, mgr.getFreeCount());
+  EXPECT_EQ(nullptr, mgr.allocNew());
+  EXPECT_EQ(1u, mgr.getNumAllocFails());
+
+  Packet* in = mgr.getNextInbound(0);
+  EXPECT_EQ(3, tagOf(in));
+  Packet* out = mgr.getNextOutbound(0);   // no working Packet to restore 1 into, so the uncompacted one goes first
+  EXPECT_EQ(4, tagOf(out));
+  mgr.free(in);
+  mgr.free(out);
+  EXPECT_EQ(1, tagOf(mgr.getNextOutbound(0)));
+  EXPECT_EQ(1, mgr.getOutboundTotal());
+}
+
+// all working Packets held by uncompacted entries, behind a compacted one, used to stall the queue for good
+TEST(SlabPacketManager, NoStallWhenWorkingPacketsQueued) {
+  SlabPacketManager mgr(2, 1, 0, 0);
+  mgr.queueOutbound(allocSized(mgr, 1, 0, 10), 0, 0);    // compacted, into the only slot
+  mgr.queueOutbound(allocSized(mgr, 2, 0, 10), 1, 0);    // no slot, holds a working Packet
+  mgr.queueOutbound(allocSized(mgr, 3, 0, 10), 1, 0);    // ditto
+  EXPECT_EQ(0, mgr.getFreeCount());
+
+  int order[3];
+  for (int i = 0; i < 3; i++) {
+    Packet* pkt = mgr.getNextOutbound(0);
+    ASSERT_NE(nullptr, pkt) << "stalled after " << i;
+    order[i] = tagOf(pkt);
+    mgr.free(pkt);
+  }
+  EXPECT_EQ(2, order[0]);
+  EXPECT_EQ(1, order[1]);   // most important again, as soon as there is a working Packet for it
+  EXPECT_EQ(3, order[2]);
+  EXPECT_EQ(0, mgr.getOutboundTotal());
+  EXPECT_EQ(2, mgr.getFreeCount());
+}
+
+TEST(SlabPacketManager, PeeksDontAlias) {
+  SlabPacketManager mgr(1, 4, 0, 0);
+  mgr.queueOutbound(allocSized(mgr, 1, 0, 10), 0, 0);
+  mgr.queueOutbound(allocSized(mgr, 2, 0, 10), 0, 0);
+  Packet* a = mgr.getOutboundByIdx(0);
+  Packet* b = mgr.getOutboundByIdx(1);
+  EXPECT_NE(a, b);
+  EXPECT_EQ(1, tagOf(a));
+  EXPECT_EQ(2, tagOf(b));
+  mgr.free(a);   // not a working Packet, ignored
+  EXPECT_EQ(1, mgr.getFreeCount());
+}
+
+TEST(SlabPacketManager, WaitsForWorkingPacket) {
+  SlabPacketManager mgr(1, 4, 0, 0);
+  mgr.queueOutbound(allocSized(mgr, 1, 0, 10), 0, 0);
+  Packet* busy = mgr.allocNew();   // eg. packet currently being transmitted
+  EXPECT_EQ(1, mgr.getOutboundCount(0));
+  EXPECT_EQ(nullptr, mgr.getNextOutbound(0));
+  EXPECT_EQ(1u, mgr.getNumRestoreWaits());
+  EXPECT_EQ(1, mgr.getOutboundTotal());
+
+  mgr.free(busy);
+  EXPECT_EQ(1, tagOf(mgr.getNextOutbound(0)));
+  EXPECT_EQ(0, mgr.getOutboundTotal());
+}
+
+// random workload, must hand out packets in exactly the same order as StaticPoolPacketManager
+TEST(SlabPacketManager, MatchesStaticPoolOrder) {
+  const int POOL = 32;
+  StaticPoolPacketManager ref(POOL);
+  SlabPacketManager slab(POOL, POOL, POOL, POOL);
+
+  srand(4321);
+  uint32_t now = 0xFFFF0000;   // cross the wrap-around too
+  int tag = 1;
+  for (int step = 0; step < 20000; step++) {
+    now += rand() % 50;
+    int op = rand() % 4;
+    if (op < 2) {
+      int path_hashes = rand() % 64, payload_len = 4 + rand() % (MAX_PACKET_PAYLOAD - 3);
+      Packet* a = allocSized(ref, tag, path_hashes, payload_len);
+      if (a) {
+        Packet* b = allocSized(slab, tag, path_hashes, payload_len);
+        ASSERT_NE(nullptr, b);
+        uint8_t pri = rand() % 6;
+        uint32_t when = now + rand() % 2000;
+        if (op == 0) {
+          ref.queueOutbound(a, pri, when);
+          slab.queueOutbound(b, pri, when);
+        } else {
+          ref.queueInbound(a, when);
+          slab.queueInbound(b, when);
+        }
+        tag++;
+      }
+    } else if (op == 2) {
+      ASSERT_EQ(ref.getOutboundCount(now), slab.getOutboundCount(now));
+      Packet* a = ref.getNextOutbound(now);
+      Packet* b = slab.getNextOutbound(now);
+      ASSERT_EQ(a == NULL, b == NULL);
+      if (a) {
+        ASSERT_EQ(tagOf(a), tagOf(b));
+        ASSERT_EQ(a->payload_len, b->payload_len);
+        ref.free(a);
+        slab.free(b);
+      }
+    } else {
+      Packet* a = ref.getNextInbound(now);
+      Packet* b = slab.getNextInbound(now);
+      ASSERT_EQ(a == NULL, b == NULL);
+      if (a) {
+        ASSERT_EQ(tagOf(a), tagOf(b));
+        ASSERT_EQ(a->path_len, b->path_len);
+        ref.free(a);
+        slab.free(b);
+      }
+    }
+    ASSERT_EQ(ref.getOutboundTotal(), slab.getOutboundTotal());
+  }
+  EXPECT_EQ(0u, slab.getNumUncompacted());
+}
+
+// ------------- benchmark (timings only, no pass/fail) -------------
+
+// Simulates a busy repeater: queue kept ~3/4 full of packets with random retransmit delays, and the
+// Dispatcher polling getOutboundCount() every loop(), only occasionally sending/receiving.
+static double benchLoop(PacketManager& mgr, int pool_size, int loops) {
+  srand(42);
+  uint32_t now = 0;
+  int target = pool_size * 3 / 4;
+  volatile int sink = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < loops; i++) {
+    now++;
+    if (mgr.getOutboundTotal() < target) {
+      Packet* pkt = mgr.allocNew();
+      if (pkt) mgr.queueOutbound(pkt, rand() % 6, now + rand() % 5000);
+    }
+    sink += mgr.getOutboundCount(now);
+    if ((i & 15) == 0) {
+      Packet* pkt = mgr.getNextOutbound(now);
+      if (pkt) mgr.free(pkt);
+    }
+    Packet* pkt = mgr.getNextInbound(now);
+    if (pkt) mgr.free(pkt);
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  return std::chrono::duration<double, std::nano>(elapsed).count() / loops;
+}
+
+TEST(PacketManagerBenchmark, StaticPoolVsHeap) {
+  const int LOOPS = 200000;
+  printf("\n  pool  StaticPool(ns/loop)  Heap(ns/loop)\n");
+  for (int pool_size = 16; pool_size <= 256; pool_size *= 2) {
+    StaticPoolPacketManager ref(pool_size);
+    HeapPacketManager heap(pool_size);
+    double t_ref = benchLoop(ref, pool_size, LOOPS);
+    double t_heap = benchLoop(heap, pool_size, LOOPS);
+    printf("  %4d  %19.1f  %13.1f\n", pool_size, t_ref, t_heap);
+  }
+}
+
+// How many packets can be queued in (about) the RAM of a StaticPoolPacketManager(32), with a typical repeater mix
+TEST(PacketManagerBenchmark, SlabQueueDepth) {
+  const int POOL = 32;
+  size_t static_bytes = POOL * (sizeof(Packet) + 3*(sizeof(Packet*) + sizeof(uint8_t) + sizeof(uint32_t)));
+  const int configs[][4] = { { 8, 24, 16, 8 }, { 6, 32, 24, 6 } };
+  printf("\n  StaticPool(%d): %u bytes, %d packets\n", POOL, (unsigned) static_bytes, POOL);
+
+  for (int k = 0; k < 2; k++) {
+    const int* c = configs[k];
+    SlabPacketManager mgr(c[0], c[1], c[2], c[3]);
+    srand(7);
+    int queued = 0;
+    while (true) {   // 50% ACKs/short direct, 40% text/flood-ACK, 10% big floods (eg. adverts, long paths)
+      int r = rand() % 100;
+      Packet* pkt = r < 50 ? allocSized(mgr, queued, rand() % 8, 4 + rand() % 20)
+                  : r < 90 ? allocSized(mgr, queued, rand() % 16, 20 + rand() % 60)
+                           : allocSized(mgr, queued, rand() % 64, 100 + rand() % 84);
+      if (pkt == NULL) break;
+      mgr.queueOutbound(pkt, 1, 0);   // once slots run out, the working Packets are queued as-is
+      queued++;
+    }
+    printf("  Slab(%d, %d/%d/%d): %u bytes, %d packets queued (", c[0], c[1], c[2], c[3],
+      (unsigned) SlabPacketManager::calcPoolBytes(c[0], c[1], c[2], c[3]), queued);
+    for (int i = 0; i < SLAB_NUM_CLASSES; i++) {
+      const SlabPacketManager::ClassStats& s = mgr.getClassStats(i);
+      printf("%s%d-byte: %d/%d, %u fails", i ? "; " : "", s.slot_size, s.max_in_use, s.num_slots, s.num_fails);
+    }
+    printf(")\n");
+  }
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,108 @@
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <vector>
+#include <random>
+#include "helpers/PeerCandidates.h"
+
+TEST(PeerCandidates, MostRecentFirst) {
+  int idx[8];
+  PeerCandidates found(idx, 8);
+  found.add(0, 100);
+  found.add(1, 300);
+  found.add(2, 0);     // never heard from
+  found.add(3, 200);
+  found.add(4, 300);   // tie, keeps table order
+  ASSERT_EQ(5, found.count());
+  const int expected[] = { 1, 4, 3, 0, 2 };
+  for (int i = 0; i < 5; i++) EXPECT_EQ(expected[i], idx[i]);
+}
+
+TEST(PeerCandidates, DropsLeastRecentWhenFull) {
+  int idx[3];
+  PeerCandidates found(idx, 3);
+  found.add(0, 10);
+  found.add(1, 20);
+  found.add(2, 30);
+  found.add(3, 5);    // less recent than all, dropped
+  found.add(4, 25);
+  ASSERT_EQ(3, found.count());
+  EXPECT_EQ(2, idx[0]);
+  EXPECT_EQ(4, idx[1]);
+  EXPECT_EQ(1, idx[2]);
+}
+
+TEST(PeerCandidates, CappedAtMax) {
+  int idx[32];
+  PeerCandidates found(idx, 32);
+  for (int i = 0; i < 20; i++) found.add(i, i);
+  ASSERT_EQ(MAX_PEER_CANDIDATES, found.count());
+  EXPECT_EQ(19, idx[0]);
+}
+
+TEST(PeerCandidates, CallerBufferNotCapped) {
+  int idx[32];
+  uint32_t last_heard[32];
+  PeerCandidates found(idx, last_heard, 32);
+  for (int i = 0; i < 20; i++) found.add(i, i);
+  ASSERT_EQ(20, found.count());
+  for (int i = 0; i < 20; i++) EXPECT_EQ(19 - i, idx[i]);
+}
+
+// ------------- benchmark (counts only, no pass/fail) -------------
+
+// Companion with 350 contacts (eg. simple_bot_ping), messages mostly from a few regular correspondents.
+// Counts the candidates tried (MAC checks) per packet, and lazy ECDH calculations, with contacts tried in
+// table order (as before) vs. most recently heard first.
+TEST(PeerCandidatesBenchmark, CandidatesPerPacket) {
+  const int CONTACTS = 350, ACTIVE = 30, PACKETS = 20000, MAX_RESULTS = 8;
+  std::mt19937 rng(42);
+  std::vector<uint8_t> hash(CONTACTS);
+  for (int i = 0; i < CONTACTS; i++) hash[i] = rng() & 0xFF;
+
+  std::vector<int> active(ACTIVE);
+  for (int i = 0; i < ACTIVE; i++) active[i] = rng() % CONTACTS;
+  std::vector<double> weights(ACTIVE);
+  for (int i = 0; i < ACTIVE; i++) weights[i] = 1.0 / (i + 1);   // zipf-ish
+  std::discrete_distribution<int> pick(weights.begin(), weights.end());
+
+  printf("\n");
+  for (int by_recency = 0; by_recency < 2; by_recency++) {
+    std::mt19937 traffic(7);
+    std::vector<uint32_t> last_rx(CONTACTS, 0);
+    std::vector<bool> secret_valid(CONTACTS, false);
+    uint32_t tries = 0, ecdh = 0, searches = 0, missed = 0;
+
+    for (int p = 0; p < PACKETS; p++) {
+      int sender = active[pick(traffic)];
+      int idx[MAX_RESULTS];
+      int num = 0;
+      if (by_recency) {
+        PeerCandidates found(idx, MAX_RESULTS);
+        for (int i = 0; i < CONTACTS; i++) {
+          if (hash[i] == hash[sender]) found.add(i, last_rx[i]);
+        }
+        num = found.count();
+      } else {
+        for (int i = 0; i < CONTACTS && num < MAX_RESULTS; i++) {
+          if (hash[i] == hash[sender]) idx[num++] = i;
+        }
+      }
+      searches++;
+      bool matched = false;
+      for (int j = 0; j < num; j++) {
+        if (!secret_valid[idx[j]]) { secret_valid[idx[j]] = true; ecdh++; }
+        tries++;
+        if (idx[j] == sender) { matched = true; break; }   // first MAC match wins
+      }
+      if (matched) last_rx[sender] = p + 1;
+      else missed++;
+    }
+    printf("  %-16s %.3f candidates/packet, %u ECDH, %u unmatched\n", by_recency ? "recent first:" : "table order:",
+      (double) tries / searches, ecdh, missed);
+  }
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include "helpers/PostBatch.h"
+#include "helpers/TxtDataHelpers.h"
+
+static const uint8_t AUTHOR_A[4] = { 0xA1, 0xA2, 0xA3, 0xA4 };
+static const uint8_t AUTHOR_B[4] = { 0xB1, 0xB2, 0xB3, 0xB4 };
+
+TEST(PostBatchTest, RoundTrip) {
+  uint8_t buf[POST_BATCH_MAX_LEN];
+  PostBatchWriter w(buf, sizeof(buf), 2);
+  ASSERT_TRUE(w.add(1000, AUTHOR_A, "hello"));
+  ASSERT_TRUE(w.add(1005, AUTHOR_B, ""));
+  ASSERT_TRUE(w.add(1010, AUTHOR_A, "world"));
+  int len = w.finish();
+  EXPECT_EQ(POST_BATCH_HEADER_SIZE + 3*POST_BATCH_ENTRY_SIZE + 10, len);
+  EXPECT_EQ(3, w.getCount());
+  EXPECT_EQ(1000u, w.getFirstTimestamp());
+  EXPECT_EQ(1010u, w.getLastTimestamp());
+
+  uint32_t ts;
+  memcpy(&ts, buf, 4);
+  EXPECT_EQ(1010u, ts);   // header has newest
+  EXPECT_EQ(TXT_TYPE_SIGNED_BATCH, buf[4] >> 2);
+  EXPECT_EQ(2, buf[4] & 3);
+
+  PostBatchReader r(buf, len);
+  const uint8_t* prefix;
+  char text[256];
+  ASSERT_TRUE(r.next(ts, prefix, text));
+  EXPECT_EQ(1000u, ts);
+  EXPECT_EQ(0, memcmp(prefix, AUTHOR_A, 4));
+  EXPECT_STREQ("hello", text);
+  ASSERT_TRUE(r.next(ts, prefix, text));
+  EXPECT_EQ(1005u, ts);
+  EXPECT_EQ(0, memcmp(prefix, AUTHOR_B, 4));
+  EXPECT_STREQ("", text);
+  ASSERT_TRUE(r.next(ts, prefix, text));
+  EXPECT_STREQ("world", text);
+  EXPECT_FALSE(r.next(ts, prefix, text));
+  EXPECT_EQ(len, r.getEnd());
+}
+
+TEST(PostBatchTest, StopsAtPadding) {
+  uint8_t buf[POST_BATCH_MAX_LEN + 16];
+  memset(buf, 0, sizeof(buf));
+  PostBatchWriter w(buf, POST_BATCH_MAX_LEN, 0);
+  w.add(2000, AUTHOR_A, "abc");
+  int len = w.finish();
+
+  PostBatchReader r(buf, (len + 15) & ~15);   // as decrypted, padded to cipher block
+  uint32_t ts;
+  const uint8_t* prefix;
+  char text[256];
+  ASSERT_TRUE(r.next(ts, prefix, text));
+  EXPECT_FALSE(r.next(ts, prefix, text));
+  EXPECT_EQ(len, r.getEnd());   // so ACK hash is over same bytes as the sender's
+}
+
+TEST(PostBatchTest, TruncatedEntryIsIgnored) {
+  uint8_t buf[POST_BATCH_MAX_LEN];
+  PostBatchWriter w(buf, sizeof(buf), 0);
+  w.add(3000, AUTHOR_A, "0123456789");
+  int len = w.finish();
+
+  PostBatchReader r(buf, len - 1);
+  uint32_t ts;
+  const uint8_t* prefix;
+  char text[256];
+  EXPECT_FALSE(r.next(ts, prefix, text));
+}
+
+TEST(PostBatchTest, FillsToMaxLen) {
+  uint8_t buf[MAX_PACKET_PAYLOAD];
+  PostBatchWriter w(buf, sizeof(buf), 0);   // clamped to what createDatagram() allows
+  std::string text(40, 'x');
+  int n = 0;
+  while (w.add(4000 + n, AUTHOR_A, text.c_str())) n++;
+  EXPECT_EQ((POST_BATCH_MAX_LEN - POST_BATCH_HEADER_SIZE) / PostBatchWriter::entrySize(40), n);
+  EXPECT_LE(w.finish(), POST_BATCH_MAX_LEN);
+
+  EXPECT_TRUE(w.add(5000, AUTHOR_B, ""));   // something smaller can still fit
+  EXPECT_EQ(n + 1, w.getCount());
+}
+
+TEST(PostBatchTest, LongestSinglePostFits) {
+  uint8_t buf[POST_BATCH_MAX_LEN];
+  PostBatchWriter w(buf, sizeof(buf), 0);
+  std::string text(POST_BATCH_MAX_LEN - POST_BATCH_HEADER_SIZE - POST_BATCH_ENTRY_SIZE, 'y');
+  EXPECT_TRUE(w.add(6000, AUTHOR_A, text.c_str()));
+  EXPECT_EQ(POST_BATCH_MAX_LEN, w.finish());
+}
+
+// ------------- benchmark (bytes on air per post, no pass/fail) -------------
+
+static int onAirBytes(int data_len) {   // TXT_MSG, direct with 2 hop path: header, path len, path, dest, src, MAC, cipher text
+  return 1 + 1 + 2 + 1 + 1 + CIPHER_MAC_SIZE + ((data_len + CIPHER_BLOCK_SIZE - 1) / CIPHER_BLOCK_SIZE) * CIPHER_BLOCK_SIZE;
+}
+
+TEST(PostBatchBenchmark, BytesPerPost) {
+  const int text_lens[] = { 10, 30, 60, 120 };
+  for (int t : text_lens) {
+    int single = onAirBytes(9 + t) + 20;   // plus the ACK packet (approx)
+    uint8_t buf[POST_BATCH_MAX_LEN];
+    PostBatchWriter w(buf, sizeof(buf), 0);
+    std::string text(t, 'z');
+    while (w.add(7000 + w.getCount(), AUTHOR_A, text.c_str())) ;
+    int batch = onAirBytes(w.finish()) + 20;
+    printf("  text %3d chars: single %3d bytes/post, batch of %d %3d bytes/post\n", t, single, w.getCount(), batch / w.getCount());
+  }
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
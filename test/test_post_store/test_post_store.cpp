@@ -0,0 +1,329 @@
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include "helpers/PostStore.h"
+
+class PostStoreTest : public ::testing::Test {
+protected:
+  char dir[64];
+  fs::FS* fs;
+  uint8_t alice[PUB_KEY_SIZE], bob[PUB_KEY_SIZE], carol[PUB_KEY_SIZE];
+
+  void SetUp() override {
+    strcpy(dir, "/tmp/poststoreXXXXXX");
+    ASSERT_TRUE(mkdtemp(dir) != NULL);
+    fs = new fs::FS(dir);
+
+    memset(alice, 0xA1, sizeof(alice));
+    memset(bob, 0xB0, sizeof(bob));
+    memcpy(carol, bob, sizeof(carol));   // same prefix as bob
+    carol[PUB_KEY_SIZE - 1] = 0xCC;
+  }
+  void TearDown() override {
+    fs->remove("/posts");
+    rmdir(dir);
+    delete fs;
+  }
+
+  static std::string textOf(uint32_t ts) { return "post #" + std::to_string(ts); }
+
+  void expectPost(PostStore& s, uint32_t ts, const uint8_t* author) {
+    auto p = s.getPost(ts);
+    ASSERT_TRUE(p != NULL) << ts;
+    EXPECT_EQ(ts, p->post_timestamp);
+    EXPECT_EQ(0, memcmp(author, p->author, PUB_KEY_SIZE));
+    EXPECT_EQ(textOf(ts), p->text);
+  }
+};
+
+TEST_F(PostStoreTest, RamOnlyIsCyclic) {
+  PostStore s("/posts", 64, 4);
+  ASSERT_TRUE(s.begin(NULL));
+  EXPECT_EQ(4, s.getCapacity());
+  EXPECT_FALSE(s.isPersistent());
+
+  for (uint32_t ts = 10; ts <= 60; ts += 10) {
+    EXPECT_EQ(ts, s.addPost(alice, ts, textOf(ts).c_str()));
+  }
+  EXPECT_EQ(4, s.count());
+  EXPECT_TRUE(s.getPost(10) == NULL);   // replaced
+  EXPECT_TRUE(s.getPost(20) == NULL);
+  expectPost(s, 30, alice);
+  expectPost(s, 60, alice);
+  EXPECT_EQ(30u, s.getNextTimestamp(0, NULL));
+  EXPECT_FALSE(fs->exists("/posts"));
+}
+
+TEST_F(PostStoreTest, NextAfterSkipsAuthor) {
+  PostStore s("/posts", 16, 4);
+  ASSERT_TRUE(s.begin(fs));
+  s.addPost(alice, 100, textOf(100).c_str());
+  s.addPost(bob, 110, textOf(110).c_str());
+  s.addPost(carol, 120, textOf(120).c_str());
+  s.addPost(alice, 130, textOf(130).c_str());
+
+  EXPECT_EQ(100u, s.getNextTimestamp(0, NULL));
+  EXPECT_EQ(110u, s.getNextTimestamp(100, NULL));
+  EXPECT_EQ(110u, s.getNextTimestamp(105, NULL));
+  EXPECT_EQ(110u, s.getNextTimestamp(0, alice));
+  EXPECT_EQ(120u, s.getNextTimestamp(100, bob));   // carol has same prefix, but isn't bob
+  EXPECT_EQ(0u, s.getNextTimestamp(120, alice));
+  EXPECT_EQ(0u, s.getNextTimestamp(130, NULL));
+
+  EXPECT_EQ(4, s.countSince(0, NULL));
+  EXPECT_EQ(2, s.countSince(0, alice));
+  EXPECT_EQ(2, s.countSince(0, bob));   // (just compares prefix)
+  EXPECT_EQ(1, s.countSince(110, alice));
+  EXPECT_EQ(0, s.countSince(130, bob));
+
+  EXPECT_TRUE(s.getPost(115) == NULL);
+  EXPECT_TRUE(s.getPost(0) == NULL);
+}
+
+TEST_F(PostStoreTest, TimestampsKeptIncreasing) {
+  PostStore s("/posts", 16, 4);
+  ASSERT_TRUE(s.begin(fs));
+  EXPECT_EQ(500u, s.addPost(alice, 500, "a"));
+  EXPECT_EQ(501u, s.addPost(alice, 200, "b"));   // eg. RTC went backwards
+  EXPECT_EQ(502u, s.addPost(alice, 501, "c"));
+  EXPECT_EQ(600u, s.addPost(alice, 600, "d"));
+  EXPECT_EQ(502u, s.getNextTimestamp(501, NULL));
+  EXPECT_STREQ("b", s.getPost(501)->text);
+}
+
+TEST_F(PostStoreTest, SurvivesReboot) {
+  {
+    PostStore s("/posts", 16, 2);
+    ASSERT_TRUE(s.begin(fs));
+    for (uint32_t ts = 1; ts <= 5; ts++) s.addPost(ts & 1 ? alice : bob, ts, textOf(ts).c_str());
+  }
+  PostStore s("/posts", 16, 2);
+  ASSERT_TRUE(s.begin(fs));
+  EXPECT_TRUE(s.isPersistent());
+  EXPECT_EQ(5, s.count());
+  EXPECT_EQ(5u, s.getNewestTimestamp());
+  for (uint32_t ts = 1; ts <= 5; ts++) expectPost(s, ts, ts & 1 ? alice : bob);
+  EXPECT_EQ(5u, s.getNumFlashReads());   // cache is empty after reboot
+
+  EXPECT_EQ(6u, s.addPost(alice, 3, textOf(6).c_str()));   // still increasing, after reboot
+  expectPost(s, 6, alice);
+  EXPECT_EQ(1u, s.getNumCacheHits());
+}
+
+TEST_F(PostStoreTest, WrapsWhenFull) {
+  {
+    PostStore s("/posts", 8, 2);
+    ASSERT_TRUE(s.begin(fs));
+    for (uint32_t ts = 1; ts <= 21; ts++) s.addPost(alice, ts, textOf(ts).c_str());
+    EXPECT_EQ(8, s.count());
+    EXPECT_EQ(14u, s.getNextTimestamp(0, NULL));
+  }
+  PostStore s("/posts", 8, 2);
+  ASSERT_TRUE(s.begin(fs));
+  EXPECT_EQ(8, s.count());
+  EXPECT_EQ(14u, s.getNextTimestamp(0, NULL));
+  EXPECT_EQ(21u, s.getNewestTimestamp());
+  uint32_t ts = 0;
+  for (int n = 0; n < 8; n++) {
+    ts = s.getNextTimestamp(ts, NULL);
+    EXPECT_EQ(14u + n, ts);
+    expectPost(s, ts, alice);
+  }
+  s.addPost(alice, 22, textOf(22).c_str());   // replaces oldest again
+  EXPECT_EQ(15u, s.getNextTimestamp(0, NULL));
+}
+
+TEST_F(PostStoreTest, SkipsTornSlot) {
+  {
+    PostStore s("/posts", 8, 2);
+    ASSERT_TRUE(s.begin(fs));
+    for (uint32_t ts = 1; ts <= 3; ts++) s.addPost(alice, ts, textOf(ts).c_str());
+  }
+  File f = fs->open("/posts", "r+");
+  ASSERT_TRUE(f.seek(1 * POST_STORE_REC_SIZE + POST_STORE_HEADER_SIZE));   // slot of post #2, in text
+  f.write((const uint8_t *)"X", 1);
+  f.close();
+
+  PostStore s("/posts", 8, 2);
+  ASSERT_TRUE(s.begin(fs));
+  EXPECT_EQ(2, s.count());
+  EXPECT_TRUE(s.getPost(2) == NULL);
+  EXPECT_EQ(3u, s.getNextTimestamp(1, NULL));
+  for (uint32_t ts = 4; ts <= 9; ts++) s.addPost(alice, ts, textOf(ts).c_str());   // torn slot is re-used
+  EXPECT_EQ(8, s.count());
+  EXPECT_EQ(1u, s.getNextTimestamp(0, NULL));
+}
+
+TEST_F(PostStoreTest, CorruptSlotNotReturned) {
+  PostStore s("/posts", 8, 2);
+  ASSERT_TRUE(s.begin(fs));
+  for (uint32_t ts = 1; ts <= 4; ts++) s.addPost(alice, ts, textOf(ts).c_str());   // #1 and #2 no longer cached
+
+  File f = fs->open("/posts", "r+");
+  ASSERT_TRUE(f.seek(0 * POST_STORE_REC_SIZE + POST_STORE_HEADER_SIZE));   // slot of post #1, in text
+  f.write((const uint8_t *)"X", 1);
+  uint32_t other_ts = 99;
+  ASSERT_TRUE(f.seek(1 * POST_STORE_REC_SIZE));   // slot of post #2, timestamp (check then fails too)
+  f.write((const uint8_t *)&other_ts, 4);
+  f.close();
+
+  EXPECT_TRUE(s.getPost(1) == NULL);
+  EXPECT_TRUE(s.getPost(2) == NULL);
+  expectPost(s, 3, alice);
+}
+
+TEST_F(PostStoreTest, WriteFailureNotIndexed) {
+  PostStore s("/posts", 4, 2);
+  ASSERT_TRUE(s.begin(fs));
+  EXPECT_EQ(1u, s.addPost(alice, 1, textOf(1).c_str()));
+  fs->remove("/posts");   // so writes fail
+
+  EXPECT_EQ(0u, s.addPost(alice, 2, textOf(2).c_str()));
+  EXPECT_EQ(1, s.count());
+  EXPECT_TRUE(s.getPost(2) == NULL);
+  EXPECT_EQ(0u, s.getNextTimestamp(1, NULL));
+
+  ASSERT_TRUE(s.begin(fs));   // re-created
+  for (uint32_t ts = 1; ts <= 4; ts++) EXPECT_EQ(ts, s.addPost(alice, ts, textOf(ts).c_str()));   // all slots usable
+  EXPECT_EQ(4, s.count());
+}
+
+TEST_F(PostStoreTest, BadSizeRecreates) {
+  File f = fs->open("/posts", "w");
+  f.write((const uint8_t *)"junk", 4);
+  f.close();
+
+  PostStore s("/posts", 8, 2);
+  ASSERT_TRUE(s.begin(fs));
+  EXPECT_EQ(0, s.count());
+  f = fs->open("/posts", "r");
+  EXPECT_EQ((size_t)8 * POST_STORE_REC_SIZE, f.size());
+  f.close();
+}
+
+TEST_F(PostStoreTest, RandomOpsMatchReference) {
+  struct Ref { uint32_t ts; const uint8_t* author; };
+  std::vector<Ref> ref;
+  const uint8_t* authors[] = { alice, bob, carol };
+  std::mt19937 rng(7);
+  PostStore* s = new PostStore("/posts", 24, 4);
+  ASSERT_TRUE(s->begin(fs));
+  uint32_t clock = 1000;
+
+  for (int op = 0; op < 2000; op++) {
+    int r = rng() % 100;
+    if (r < 40) {
+      clock += rng() % 3;   // sometimes the same, so gets bumped
+      const uint8_t* a = authors[rng() % 3];
+      uint32_t want = ref.empty() || clock > ref.back().ts ? clock : ref.back().ts + 1;
+      uint32_t ts = s->addPost(a, clock, textOf(want).c_str());
+      ASSERT_EQ(want, ts);
+      ref.push_back({ ts, a });
+      if (ref.size() > 24) ref.erase(ref.begin());
+      if (ts > clock) clock = ts;
+    } else if (r < 42) {   // reboot
+      delete s;
+      s = new PostStore("/posts", 24, 4);
+      ASSERT_TRUE(s->begin(fs));
+    } else {
+      uint32_t since = ref.empty() ? 0 : ref[0].ts - 1 + rng() % (ref.back().ts - ref[0].ts + 3);
+      const uint8_t* not_author = (r & 1) ? authors[rng() % 3] : NULL;
+      const Ref* expected = NULL;
+      int expected_count = 0;
+      for (auto& e : ref) {
+        if (e.ts > since && (not_author == NULL || e.author != not_author)) {
+          if (expected == NULL) expected = &e;
+        }
+        if (e.ts > since && (not_author == NULL || memcmp(e.author, not_author, 4) != 0)) expected_count++;
+      }
+      ASSERT_EQ(expected ? expected->ts : 0, s->getNextTimestamp(since, not_author)) << "op " << op;
+      ASSERT_EQ(expected_count, s->countSince(since, not_author));
+      if (expected) expectPost(*s, expected->ts, expected->author);
+    }
+    ASSERT_EQ((int)ref.size(), s->count());
+  }
+  delete s;
+}
+
+// ------------- benchmark (lookup times only, no pass/fail) -------------
+
+TEST_F(PostStoreTest, BenchmarkNextPostLookup) {
+  const int num_posts = 512, num_clients = 20, rounds = 200;
+  PostStore s("/posts", num_posts, 16);
+  ASSERT_TRUE(s.begin(fs));
+
+  // previous style: cyclic array, scanned in full for each lookup
+  struct Post { uint8_t author[PUB_KEY_SIZE]; uint32_t post_timestamp; };
+  std::vector<Post> posts(num_posts);
+  struct Key { uint8_t pub_key[PUB_KEY_SIZE]; };
+  std::vector<Key> keys(num_clients);
+  std::mt19937 rng(3);
+  for (int c = 0; c < num_clients; c++) {
+    for (int k = 0; k < PUB_KEY_SIZE; k++) keys[c].pub_key[k] = rng();
+  }
+  for (int i = 0; i < num_posts; i++) {
+    int c = rng() % num_clients;
+    posts[i].post_timestamp = s.addPost(keys[c].pub_key, 1000 + i, "hello");
+    memcpy(posts[i].author, keys[c].pub_key, PUB_KEY_SIZE);
+  }
+
+  std::vector<uint32_t> since(num_clients);
+  for (int c = 0; c < num_clients; c++) since[c] = 1000 + rng() % num_posts;
+
+  // next post for each client (as per each push)
+  uint64_t sum_scan = 0, sum_index = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  for (int r = 0; r < rounds; r++) {
+    for (int c = 0; c < num_clients; c++) {
+      uint32_t next = 0;
+      for (int k = 0; k < num_posts; k++) {
+        if (posts[k].post_timestamp > since[c] && memcmp(posts[k].author, keys[c].pub_key, PUB_KEY_SIZE) != 0
+            && (next == 0 || posts[k].post_timestamp < next)) {
+          next = posts[k].post_timestamp;
+        }
+      }
+      sum_scan += next;
+    }
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  for (int r = 0; r < rounds; r++) {
+    for (int c = 0; c < num_clients; c++) sum_index += s.getNextTimestamp(since[c], keys[c].pub_key);
+  }
+  auto t2 = std::chrono::steady_clock::now();
+  EXPECT_EQ(sum_scan, sum_index);
+
+  double n = rounds * num_clients;
+  printf("\n  %d posts, %d clients, per lookup\n", num_posts, num_clients);
+  printf("  next post:      full scan %6.0f ns, index %6.0f ns (%u flash reads, to confirm own posts)\n",
+         std::chrono::duration<double, std::nano>(t1 - t0).count() / n,
+         std::chrono::duration<double, std::nano>(t2 - t1).count() / n, s.getNumFlashReads());
+
+  // unsynced count (as per each keep-alive)
+  sum_scan = sum_index = 0;
+  t0 = std::chrono::steady_clock::now();
+  for (int r = 0; r < rounds; r++) {
+    for (int c = 0; c < num_clients; c++) {
+      for (int k = 0; k < num_posts; k++) {
+        if (posts[k].post_timestamp > since[c] && memcmp(posts[k].author, keys[c].pub_key, PUB_KEY_SIZE) != 0) sum_scan++;
+      }
+    }
+  }
+  t1 = std::chrono::steady_clock::now();
+  for (int r = 0; r < rounds; r++) {
+    for (int c = 0; c < num_clients; c++) sum_index += s.countSince(since[c], keys[c].pub_key);
+  }
+  t2 = std::chrono::steady_clock::now();
+  EXPECT_EQ(sum_scan, sum_index);
+  printf("  unsynced count: full scan %6.0f ns, index %6.0f ns\n",
+         std::chrono::duration<double, std::nano>(t1 - t0).count() / n,
+         std::chrono::duration<double, std::nano>(t2 - t1).count() / n);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
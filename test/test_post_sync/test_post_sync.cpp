@@ -0,0 +1,335 @@
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <string.h>
+#include <random>
+#include <vector>
+#include "helpers/PostSyncWindow.h"
+
+static PostSyncWindow newWindow(uint32_t since, uint32_t now) {
+  PostSyncWindow w;
+  memset(&w, 0, sizeof(w));
+  w.reset(since, now);
+  return w;
+}
+
+TEST(PostSyncWindowTest, AllZeroesIsEmpty) {
+  PostSyncWindow w;
+  memset(&w, 0, sizeof(w));
+  EXPECT_EQ(0, w.numInFlight());
+  EXPECT_EQ(SYNC_WINDOW_INIT, w.getWindow());
+  EXPECT_TRUE(w.canPush(0));
+  EXPECT_EQ(0u, w.getResendTimestamp());
+  EXPECT_EQ(0u, w.getPostsPerMin(1000));
+}
+
+TEST(PostSyncWindowTest, PushesUpToWindowWithoutWaiting) {
+  auto w = newWindow(100, 1000);
+  ASSERT_TRUE(w.canPush(1000));
+  w.onPushed(110, 0xA1, 1000, 8000, 0);
+  ASSERT_TRUE(w.canPush(1000));
+  w.onPushed(120, 0xA2, 1000, 8000, 0);
+  EXPECT_EQ(2, w.numInFlight());
+  EXPECT_EQ(120u, w.cursor);
+  EXPECT_FALSE(w.canPush(1000));   // window is full, until an ACK comes in
+  EXPECT_FALSE(w.canPush(5000));
+}
+
+TEST(PostSyncWindowTest, PacingGap) {
+  auto w = newWindow(100, 1000);
+  w.onPushed(110, 0xA1, 1000, 8000, 1200);
+  EXPECT_FALSE(w.canPush(1500));
+  EXPECT_TRUE(w.canPush(2200));
+}
+
+TEST(PostSyncWindowTest, SinceOnlyAdvancesOverAckedRun) {
+  auto w = newWindow(100, 1000);
+  w.onPushed(110, 0xA1, 1000, 8000, 0);
+  w.onPushed(120, 0xA2, 1000, 8000, 0);
+
+  uint32_t through;
+  ASSERT_TRUE(w.onAck(0xA2, 2000, through));   // out of order
+  EXPECT_EQ(0u, through);                      // 110 still outstanding
+  EXPECT_EQ(2, w.numInFlight());
+  EXPECT_FALSE(w.onAck(0xA2, 2000, through));  // duplicate ACK is ignored
+
+  ASSERT_TRUE(w.onAck(0xA1, 2100, through));
+  EXPECT_EQ(120u, through);
+  EXPECT_EQ(0, w.numInFlight());
+  EXPECT_EQ(2u, w.num_synced);
+  EXPECT_FALSE(w.onAck(0xBEEF, 2200, through));
+}
+
+TEST(PostSyncWindowTest, LateAckForEarlierAttempt) {
+  auto w = newWindow(100, 1000);
+  w.onPushed(110, 0xA1, 1000, 8000, 0);
+
+  EXPECT_EQ(0, w.checkTimeouts(8999));
+  EXPECT_EQ(1, w.checkTimeouts(9000));
+  EXPECT_EQ(110u, w.getResendTimestamp());
+  EXPECT_EQ(1, w.getWindow());   // halved
+  EXPECT_TRUE(w.canPush(9000));  // can re-send
+
+  w.onPushed(110, 0xB1, 9000, 8000, 0);   // re-send, with different ACK
+  EXPECT_EQ(0u, w.getResendTimestamp());
+  EXPECT_EQ(1, w.numInFlight());
+
+  uint32_t through;
+  ASSERT_TRUE(w.onAck(0xA1, 9500, through));   // ACK for the first attempt finally arrives
+  EXPECT_EQ(110u, w.cursor);
+  EXPECT_EQ(110u, through);
+  EXPECT_EQ(0u, w.srtt);   // no RTT sample, as not sure which attempt was ACK'd
+  EXPECT_FALSE(w.onAck(0xB1, 9600, through));
+}
+
+TEST(PostSyncWindowTest, AckWhileLost) {
+  auto w = newWindow(100, 1000);
+  w.onPushed(110, 0xA1, 1000, 8000, 0);
+  w.checkTimeouts(9000);
+
+  uint32_t through;
+  ASSERT_TRUE(w.onAck(0xA1, 9100, through));   // before re-send
+  EXPECT_EQ(110u, through);
+  EXPECT_EQ(0u, w.getResendTimestamp());
+}
+
+TEST(PostSyncWindowTest, RttEstimateAndTimeout) {
+  auto w = newWindow(100, 1000);
+  uint32_t through;
+  w.onPushed(110, 0xA1, 1000, 8000, 0);
+  w.onAck(0xA1, 4000, through);
+  EXPECT_EQ(3000, w.srtt);
+  EXPECT_EQ(1500, w.rttvar);
+
+  // timeout is now srtt + 4*rttvar, instead of the fallback
+  w.onPushed(120, 0xA2, 5000, 30000, 0);
+  EXPECT_EQ(0, w.checkTimeouts(5000 + 8999));
+  EXPECT_EQ(1, w.checkTimeouts(5000 + 9000));
+
+  // and paced at srtt/window
+  w.onPushed(120, 0xA3, 14000, 30000, 99999);
+  EXPECT_EQ(14000u + 3000 / w.getWindow(), w.next_push_at);
+}
+
+TEST(PostSyncWindowTest, BackoffOnRepeatedTimeouts) {
+  auto w = newWindow(100, 0);
+  w.onPushed(110, 0xA1, 0, 4000, 0);
+  w.checkTimeouts(4000);
+  w.onPushed(110, 0xA2, 4000, 4000, 0);
+  EXPECT_EQ(0, w.checkTimeouts(4000 + 7999));   // 2x
+  EXPECT_EQ(1, w.checkTimeouts(4000 + 8000));
+  w.onPushed(110, 0xA3, 12000, 20000, 0);
+  EXPECT_EQ(1, w.checkTimeouts(12000 + SYNC_RTO_MAX));   // clamped
+
+  uint32_t through;
+  w.onPushed(110, 0xA4, 50000, 4000, 0);
+  w.onAck(0xA4, 51000, through);
+  EXPECT_EQ(0, w.backoff);
+}
+
+TEST(PostSyncWindowTest, WindowGrowsWithAcks) {
+  auto w = newWindow(0, 0);
+  uint32_t ts = 10, through;
+  int expected[] = { 2, 3, 4, 4 };
+  for (int round = 0; round < 4; round++) {
+    int n = w.getWindow();
+    EXPECT_EQ(expected[round], n);
+    for (int i = 0; i < n; i++) {
+      w.onPushed(ts, ts, round * 1000, 8000, 0);
+      ts += 10;
+    }
+    for (uint32_t t = ts - 10*n; t < ts; t += 10) w.onAck(t, round * 1000 + 500, through);
+    EXPECT_EQ(ts - 10, through);
+  }
+}
+
+TEST(PostSyncWindowTest, DropPost) {
+  auto w = newWindow(100, 0);
+  w.onPushed(110, 0xA1, 0, 4000, 0);
+  w.onPushed(120, 0xA2, 0, 4000, 0);
+
+  uint32_t through;
+  w.onAck(0xA2, 500, through);
+  w.checkTimeouts(4000);
+  ASSERT_EQ(110u, w.getResendTimestamp());
+
+  w.dropPost(110, 4000, through);   // eg. overwritten, so can't be re-sent
+  EXPECT_EQ(120u, through);
+  EXPECT_EQ(0, w.numInFlight());
+}
+
+TEST(PostSyncWindowTest, PostsPerMinOnlyCountsBusyTime) {
+  auto w = newWindow(0, 0);
+  uint32_t through;
+  w.onPushed(10, 1, 0, 8000, 0);
+  w.onPushed(20, 2, 0, 8000, 0);
+  w.onAck(1, 5000, through);
+  w.onAck(2, 10000, through);   // 2 posts in 10 secs
+
+  EXPECT_EQ(12u, w.getPostsPerMin(100000));   // idle time doesn't count
+
+  w.onPushed(30, 3, 200000, 8000, 0);
+  EXPECT_EQ(6u, w.getPostsPerMin(210000));   // still in flight, counts so far
+}
+
+TEST(PostSyncWindowTest, ResetForgetsInFlight) {
+  auto w = newWindow(0, 0);
+  w.onPushed(10, 1, 0, 8000, 0);
+  w.checkTimeouts(8000);
+  w.reset(5, 9000);
+  EXPECT_EQ(0, w.numInFlight());
+  EXPECT_EQ(5u, w.cursor);
+  EXPECT_EQ(SYNC_WINDOW_INIT, w.getWindow());
+
+  uint32_t through;
+  EXPECT_FALSE(w.onAck(1, 9100, through));
+}
+
+TEST(PostSyncWindowTest, BatchIsOneSlot) {
+  auto w = newWindow(100, 1000);
+  w.onPushed(140, 0xB1, 1000, 8000, 0, 110, 4);   // posts 110..140, in one packet
+  EXPECT_EQ(1, w.numInFlight());
+  EXPECT_EQ(140u, w.cursor);
+
+  EXPECT_EQ(1, w.checkTimeouts(9000));
+  uint32_t first;
+  EXPECT_EQ(140u, w.getResendTimestamp(&first));
+  EXPECT_EQ(110u, first);
+
+  w.onPushed(140, 0xB2, 9000, 8000, 0, 120, 3);   // re-built, and oldest post has gone
+  EXPECT_EQ(1, w.numInFlight());
+  uint32_t through;
+  ASSERT_TRUE(w.onAck(0xB2, 10000, through));
+  EXPECT_EQ(140u, through);
+  EXPECT_EQ(3u, w.num_synced);
+}
+
+TEST(PostSyncWindowTest, SinglePostResendTimestamp) {
+  auto w = newWindow(100, 1000);
+  w.onPushed(110, 0xA1, 1000, 8000, 0);
+  w.checkTimeouts(9000);
+  uint32_t first;
+  EXPECT_EQ(110u, w.getResendTimestamp(&first));
+  EXPECT_EQ(110u, first);
+}
+
+// ------------- benchmark (catch-up times only, no pass/fail) -------------
+
+#define BENCH_NUM_POSTS     32
+#define BENCH_TIMEOUT     12000   // as room server, for a 3 hop path (PUSH_TIMEOUT_BASE + PUSH_ACK_TIMEOUT_FACTOR * 4)
+#define BENCH_INTERVAL     1200   // SYNC_PUSH_INTERVAL
+#define BENCH_GAP           300   // SYNC_PUSH_GAP
+
+// a returning client, over a multi-hop direct path. Each post (and ACK) takes 'one_way' millis (+ jitter), and is
+// lost with probability 'loss'.
+struct Link {
+  std::mt19937 rng;
+  uint32_t one_way;
+  float loss;
+
+  struct InFlight { uint32_t arrive_at, crc; };
+  std::vector<InFlight> acks;
+
+  Link(uint32_t seed, uint32_t one_way, float loss) : rng(seed), one_way(one_way), loss(loss) { }
+
+  bool lost() { return std::uniform_real_distribution<float>(0, 1)(rng) < loss; }
+  uint32_t delay() { return one_way + std::uniform_int_distribution<uint32_t>(0, one_way / 2)(rng); }
+
+  void push(uint32_t crc, uint32_t now) {
+    if (lost()) return;
+    uint32_t t = now + delay();
+    if (lost()) return;
+    acks.push_back({ t + delay(), crc });
+  }
+  bool nextAck(uint32_t now, uint32_t& crc) {
+    for (size_t i = 0; i < acks.size(); i++) {
+      if (acks[i].arrive_at <= now) {
+        crc = acks[i].crc;
+        acks.erase(acks.begin() + i);
+        return true;
+      }
+    }
+    return false;
+  }
+};
+
+struct BenchResult { uint32_t millis, pushes; };
+
+// previous engine: one post in flight, ACKs for earlier attempts are forgotten
+static BenchResult runStopAndWait(Link& link) {
+  uint32_t since = 0, pending = 0, pending_ts = 0, timeout_at = 0, next_push = 0, next_crc = 1, pushes = 0;
+  uint32_t now;
+  for (now = 0; since < BENCH_NUM_POSTS && now < 3600000; now += 10) {
+    uint32_t crc;
+    while (link.nextAck(now, crc)) {
+      if (pending && crc == pending) {
+        since = pending_ts;
+        pending = 0;
+      }
+    }
+    if (now >= next_push) {
+      if (pending && now >= timeout_at) pending = 0;
+      if (pending == 0) {
+        pending_ts = since + 1;
+        pending = next_crc++;
+        timeout_at = now + BENCH_TIMEOUT;
+        link.push(pending, now);
+        pushes++;
+        next_push = now + BENCH_INTERVAL;
+      } else {
+        next_push = now + BENCH_INTERVAL / 8;
+      }
+    }
+  }
+  return { now, pushes };
+}
+
+static BenchResult runWindowed(Link& link) {
+  auto w = newWindow(0, 0);
+  uint32_t since = 0, next_push = 0, next_crc = 1, pushes = 0;
+  uint32_t now;
+  for (now = 0; since < BENCH_NUM_POSTS && now < 3600000; now += 10) {
+    uint32_t crc, through;
+    while (link.nextAck(now, crc)) {
+      if (w.onAck(crc, now, through) && through > since) since = through;
+    }
+    if (now >= next_push) {
+      w.checkTimeouts(now);
+      uint32_t ts = w.getResendTimestamp();
+      if (ts == 0) ts = (since > w.cursor ? since : w.cursor) + 1;
+      if (w.canPush(now) && ts <= BENCH_NUM_POSTS) {
+        uint32_t c = next_crc++;
+        w.onPushed(ts, c, now, BENCH_TIMEOUT, BENCH_INTERVAL);
+        link.push(c, now);
+        pushes++;
+        next_push = now + BENCH_GAP;
+      } else {
+        next_push = now + BENCH_INTERVAL / 8;
+      }
+    }
+  }
+  return { now, pushes };
+}
+
+TEST(PostSyncBenchmark, ReturningClientCatchUp) {
+  struct { const char* name; uint32_t one_way; float loss; } links[] = {
+    { "1 hop, no loss", 600, 0.0f },
+    { "3 hops, 10% loss", 1800, 0.1f },
+    { "5 hops, 25% loss", 3000, 0.25f },
+  };
+
+  printf("\n  catch-up of %d posts, returning client\n", BENCH_NUM_POSTS);
+  printf("  %-18s | %-16s %8s %8s | %-16s %8s %8s\n", "link", "stop-and-wait", "posts/min", "pushes", "window", "posts/min", "pushes");
+  for (auto& l : links) {
+    Link a(42, l.one_way, l.loss), b(42, l.one_way, l.loss);
+    auto old_r = runStopAndWait(a);
+    auto new_r = runWindowed(b);
+    printf("  %-18s | %13.1f s %8.1f %8u | %13.1f s %8.1f %8u\n", l.name,
+           old_r.millis / 1000.0f, BENCH_NUM_POSTS * 60000.0f / old_r.millis, old_r.pushes,
+           new_r.millis / 1000.0f, BENCH_NUM_POSTS * 60000.0f / new_r.millis, new_r.pushes);
+  }
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
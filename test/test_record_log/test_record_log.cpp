@@ -0,0 +1,303 @@
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <map>
+#include <string>
+#include <vector>
+#include <random>
+#include "helpers/RecordLog.h"
+
+#define REC_SIZE  152   // as per companion contact records
+
+typedef std::vector<uint8_t> Record;
+typedef std::map<std::string, Record> Table;   // by key
+
+static std::string keyOf(const uint8_t* rec) { return std::string((const char*)rec, RECORD_LOG_KEY_SIZE); }
+
+class TableLoader : public RecordLogVisitor {
+public:
+  Table table;
+  int max_num = 100000;
+  bool onRecordLoaded(const uint8_t* rec) override {
+    if ((int)table.size() >= max_num) return false;
+    table[keyOf(rec)] = Record(rec, rec + REC_SIZE);
+    return true;
+  }
+};
+
+static Record makeRecord(std::mt19937& rng) {
+  Record r(REC_SIZE);
+  for (auto& b : r) b = rng() & 0xFF;
+  return r;
+}
+
+// as per DataStore::saveContacts()/compactContacts()
+static void compact(RecordLog& log, const Table& table) {
+  bool success = log.beginCompact();
+  for (auto& kv : table) {
+    if (!success) break;
+    success = log.compactRecord(kv.second.data());
+  }
+  log.endCompact(success);
+}
+
+static void save(RecordLog& log, const Table& table) {
+  bool success = log.beginSave();
+  for (auto& kv : table) {
+    if (!success) break;
+    success = log.saveRecord(kv.second.data());
+  }
+  if (!log.endSave(success)) compact(log, table);
+}
+
+static Table reload(fs::FS& fs, int max_records = 1000) {
+  RecordLog log("/recs", "/recs.log", "/recs.tmp", REC_SIZE, max_records);
+  log.begin(&fs);
+  TableLoader loader;
+  log.load(loader);
+  return loader.table;
+}
+
+class RecordLogTest : public ::testing::Test {
+protected:
+  char dir[64];
+  fs::FS* fs;
+  std::mt19937 rng{1};
+
+  void SetUp() override {
+    strcpy(dir, "/tmp/recordlogXXXXXX");
+    ASSERT_TRUE(mkdtemp(dir) != NULL);
+    fs = new fs::FS(dir);
+  }
+  void TearDown() override {
+    fs->remove("/recs");
+    fs->remove("/recs.log");
+    fs->remove("/recs.tmp");
+    rmdir(dir);
+    delete fs;
+  }
+  Table makeTable(int n) {
+    Table t;
+    for (int i = 0; i < n; i++) {
+      Record r = makeRecord(rng);
+      t[keyOf(r.data())] = r;
+    }
+    return t;
+  }
+  long fileSize(const char* path) {
+    File f = fs->open(path, "r");
+    long len = f ? f.size() : -1;
+    f.close();
+    return len;
+  }
+};
+
+TEST_F(RecordLogTest, AppendsOnlyChanges) {
+  RecordLog log("/recs", "/recs.log", "/recs.tmp", REC_SIZE, 1000);
+  log.begin(fs);
+  Table table = makeTable(50);
+  save(log, table);   // all new
+  EXPECT_EQ(50, log.getNumLogEntries());
+  compact(log, table);
+  EXPECT_EQ(0, log.getNumLogEntries());
+  EXPECT_EQ(-1, fileSize("/recs.log"));
+  EXPECT_EQ(50 * REC_SIZE, fileSize("/recs"));
+
+  auto it = table.begin();
+  std::advance(it, 7);
+  it->second[100] ^= 0xFF;   // change one record
+  save(log, table);
+  EXPECT_EQ(1, log.getNumLogEntries());
+  EXPECT_EQ(1 + REC_SIZE + 4, fileSize("/recs.log"));
+
+  save(log, table);   // nothing changed
+  EXPECT_EQ(1, log.getNumLogEntries());
+
+  EXPECT_EQ(table, reload(*fs));
+}
+
+TEST_F(RecordLogTest, AddsAndDeletes) {
+  RecordLog log("/recs", "/recs.log", "/recs.tmp", REC_SIZE, 1000);
+  log.begin(fs);
+  Table table = makeTable(20);
+  compact(log, table);
+
+  table.erase(table.begin());
+  table.erase(std::next(table.begin(), 5));
+  Record r = makeRecord(rng);
+  table[keyOf(r.data())] = r;
+  save(log, table);
+  EXPECT_EQ(3, log.getNumLogEntries());
+  EXPECT_EQ(table, reload(*fs));
+
+  // re-add a deleted key
+  Table more = makeTable(1);
+  table.insert(more.begin(), more.end());
+  save(log, table);
+  EXPECT_EQ(table, reload(*fs));
+}
+
+TEST_F(RecordLogTest, LoadsLegacySnapshot) {
+  Table table = makeTable(10);
+  File f = fs->open("/recs", "w", true);
+  for (auto& kv : table) f.write(kv.second.data(), REC_SIZE);
+  f.close();
+  EXPECT_EQ(table, reload(*fs));
+}
+
+TEST_F(RecordLogTest, IgnoresTornEntry) {
+  RecordLog log("/recs", "/recs.log", "/recs.tmp", REC_SIZE, 1000);
+  log.begin(fs);
+  Table table = makeTable(10);
+  compact(log, table);
+  Table before = table;
+
+  std::next(table.begin(), 2)->second[50] ^= 1;
+  save(log, table);
+  Table after_first = table;
+  std::next(table.begin(), 4)->second[50] ^= 1;
+  save(log, table);
+  ASSERT_EQ(2, log.getNumLogEntries());
+
+  // power lost while writing 2nd entry
+  ASSERT_EQ(0, truncate((std::string(dir) + "/recs.log").c_str(), 2 * (1 + REC_SIZE + 4) - 20));
+
+  RecordLog log2("/recs", "/recs.log", "/recs.tmp", REC_SIZE, 1000);
+  log2.begin(fs);
+  TableLoader loader;
+  log2.load(loader);
+  EXPECT_EQ(after_first, loader.table);
+  EXPECT_TRUE(log2.needsCompact());
+  EXPECT_FALSE(log2.canAppend());
+
+  save(log2, loader.table);   // compacts, instead of appending after torn entry
+  EXPECT_EQ(0, log2.getNumLogEntries());
+  EXPECT_EQ(after_first, reload(*fs));
+}
+
+TEST_F(RecordLogTest, RecoversInterruptedCompaction) {
+  RecordLog log("/recs", "/recs.log", "/recs.tmp", REC_SIZE, 1000);
+  log.begin(fs);
+  Table table = makeTable(10);
+  compact(log, table);
+  std::next(table.begin(), 3)->second[50] ^= 1;
+  save(log, table);
+
+  // incomplete temp file, old snapshot still there
+  File f = fs->open("/recs.tmp", "w", true);
+  f.write(table.begin()->second.data(), 10);
+  f.close();
+  EXPECT_EQ(table, reload(*fs));
+  EXPECT_FALSE(fs->exists("/recs.tmp"));
+}
+
+TEST_F(RecordLogTest, CrashDuringCompactionDoesNotReplayOldLog) {
+  // power lost after each of the remove()/rename() steps that publish the new snapshot
+  for (int steps = 0; steps <= 3; steps++) {
+    SCOPED_TRACE(steps);
+    fs->remove("/recs"); fs->remove("/recs.log"); fs->remove("/recs.tmp");
+
+    RecordLog log("/recs", "/recs.log", "/recs.tmp", REC_SIZE, 1000);
+    log.begin(fs);
+    Table table = makeTable(10);
+    compact(log, table);
+    auto changed = std::next(table.begin(), 3);
+    auto deleted = std::next(table.begin(), 6);
+    Record removed = deleted->second;
+    changed->second[50] ^= 1;
+    table.erase(deleted);
+    save(log, table);   // log: PUT changed, DELETE removed
+    ASSERT_EQ(2, log.getNumLogEntries());
+
+    changed->second[51] ^= 1;   // newer than the PUT in the log
+    table[keyOf(removed.data())] = removed;   // re-added, after the DELETE in the log
+    fs->meta_ops_left = steps;
+    compact(log, table);
+    fs->meta_ops_left = -1;
+
+    EXPECT_EQ(table, reload(*fs));
+    EXPECT_FALSE(fs->exists("/recs.tmp"));
+    EXPECT_FALSE(fs->exists("/recs.log"));
+    EXPECT_EQ(table, reload(*fs));
+  }
+}
+
+TEST_F(RecordLogTest, FullLogForcesCompaction) {
+  RecordLog log("/recs", "/recs.log", "/recs.tmp", REC_SIZE, 1000);
+  log.begin(fs);
+  Table table = makeTable(RECORD_LOG_MAX_ENTRIES + 10);
+  compact(log, table);
+
+  for (auto& kv : table) kv.second[60] ^= 1;   // change all
+  bool success = log.beginSave();
+  for (auto& kv : table) {
+    if (!success) break;
+    success = log.saveRecord(kv.second.data());
+  }
+  EXPECT_FALSE(log.endSave(success));
+  EXPECT_FALSE(log.canAppend());
+  compact(log, table);
+  EXPECT_EQ(table, reload(*fs));
+}
+
+TEST_F(RecordLogTest, StopsWhenHostFull) {
+  RecordLog log("/recs", "/recs.log", "/recs.tmp", REC_SIZE, 1000);
+  log.begin(fs);
+  Table table = makeTable(20);
+  save(log, table);
+
+  RecordLog log2("/recs", "/recs.log", "/recs.tmp", REC_SIZE, 1000);
+  log2.begin(fs);
+  TableLoader loader;
+  loader.max_num = 5;
+  log2.load(loader);
+  EXPECT_EQ(5u, loader.table.size());
+}
+
+// ------------- benchmark (counts only, no pass/fail) -------------
+
+// Flash bytes written per contact update, re-writing the whole file on each save (as before) vs. appending to
+// the log (including the compactions). Each save has 1 changed contact (eg. an advert, or path update).
+TEST_F(RecordLogTest, BenchmarkBytesPerUpdate) {
+  const int SIZES[] = { 100, 350, 1000 };
+  const int UPDATES = 500;
+  printf("\n  contacts | full re-write bytes/update | log bytes/update | compactions\n");
+  for (int n : SIZES) {
+    Table table = makeTable(n);
+    std::vector<std::string> keys;
+    for (auto& kv : table) keys.push_back(kv.first);
+
+    fs->bytes_written = 0;
+    for (int u = 0; u < UPDATES; u++) {
+      table[keys[rng() % n]][120] ^= 1;
+      File f = fs->open("/recs", "w", true);
+      for (auto& kv : table) f.write(kv.second.data(), REC_SIZE);
+      f.close();
+    }
+    uint32_t full_bytes = fs->bytes_written;
+    fs->remove("/recs");
+
+    RecordLog log("/recs", "/recs.log", "/recs.tmp", REC_SIZE, n);
+    log.begin(fs);
+    compact(log, table);
+    fs->bytes_written = 0;
+    int compactions = 0;
+    for (int u = 0; u < UPDATES; u++) {
+      table[keys[rng() % n]][120] ^= 1;
+      save(log, table);
+      if (log.needsCompact()) {   // as per MyMesh, when idle
+        compact(log, table);
+        compactions++;
+      }
+    }
+    EXPECT_EQ(table, reload(*fs, n));
+    printf("  %8d | %26.1f | %16.1f | %d\n", n, (double)full_bytes / UPDATES, (double)fs->bytes_written / UPDATES, compactions);
+    fs->remove("/recs");
+    fs->remove("/recs.log");
+  }
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,143 @@
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <vector>
+#include "Utils.h"
+#include "helpers/SimpleMeshTables.h"
+#include "helpers/SimpleMeshCaches.h"
+#define ED25519_NO_SEED  1
+#include <ed_25519.h>
+
+using namespace mesh;
+
+struct TestNode {
+  uint8_t pub_key[PUB_KEY_SIZE];
+  uint8_t prv_key[64];
+};
+
+static void makeNode(TestNode& node, uint32_t id) {
+  uint8_t seed[32];
+  memset(seed, 0, sizeof(seed));
+  memcpy(seed, &id, sizeof(id));
+  ed25519_create_keypair(node.pub_key, node.prv_key, seed);
+}
+
+// same layout as Mesh::createAnonDatagram()
+static void makeAnonReq(Packet& pkt, const TestNode& client, const TestNode& server, uint32_t timestamp) {
+  pkt.header = (PAYLOAD_TYPE_ANON_REQ << PH_TYPE_SHIFT) | ROUTE_TYPE_DIRECT;
+  pkt.path_len = 0;
+  int len = 0;
+  pkt.payload[len++] = server.pub_key[0];   // dest_hash
+  memcpy(&pkt.payload[len], client.pub_key, PUB_KEY_SIZE); len += PUB_KEY_SIZE;
+
+  uint8_t secret[PUB_KEY_SIZE];
+  ed25519_key_exchange(secret, server.pub_key, client.prv_key);
+  uint8_t data[20];
+  memset(data, 0, sizeof(data));
+  memcpy(data, &timestamp, 4);
+  memcpy(&data[4], "password", 8);
+  len += Utils::encryptThenMAC(secret, &pkt.payload[len], data, sizeof(data));
+  pkt.payload_len = len;
+  pkt.invalidateHash();
+}
+
+// emulates the ANON_REQ part of Mesh::onRecvPacket(), returns true if MAC was valid
+static bool recvAnonReq(MeshTables& tables, MeshCaches& caches, const TestNode& self, const Packet* pkt, uint32_t& n_ecdh) {
+  if (tables.hasSeen(pkt)) return false;
+
+  const uint8_t* sender_pub_key = &pkt->payload[1];
+  uint8_t secret[PUB_KEY_SIZE];
+  bool is_cached = caches.getSharedSecret(secret, sender_pub_key);
+  if (!is_cached) {
+    ed25519_key_exchange(secret, sender_pub_key, self.prv_key);
+    n_ecdh++;
+  }
+  uint8_t data[MAX_PACKET_PAYLOAD];
+  int len = Utils::MACThenDecrypt(secret, data, &pkt->payload[1 + PUB_KEY_SIZE], pkt->payload_len - 1 - PUB_KEY_SIZE);
+  if (len > 0) {
+    if (!is_cached) caches.putSharedSecret(sender_pub_key, secret);
+    return true;
+  }
+  return false;
+}
+
+TEST(SharedSecretCache, LRUEviction) {
+  SharedSecretCache cache;
+  uint8_t pub[PUB_KEY_SIZE], secret[PUB_KEY_SIZE], out[PUB_KEY_SIZE];
+  for (int i = 0; i < SHARED_SECRET_CACHE_SIZE; i++) {
+    memset(pub, i + 1, sizeof(pub));
+    memset(secret, 0x80 + i, sizeof(secret));
+    cache.put(pub, secret);
+  }
+  memset(pub, 1, sizeof(pub));
+  ASSERT_TRUE(cache.get(out, pub));   // touch first entry, so second becomes least recently used
+  EXPECT_EQ(0x80, out[0]);
+
+  memset(pub, 0x7F, sizeof(pub));
+  cache.put(pub, secret);
+  EXPECT_EQ(1u, cache.getNumEvictions());
+
+  memset(pub, 2, sizeof(pub));
+  EXPECT_FALSE(cache.get(out, pub));   // evicted
+  memset(pub, 1, sizeof(pub));
+  EXPECT_TRUE(cache.get(out, pub));
+  EXPECT_EQ(2u, cache.getNumHits());
+  EXPECT_EQ(1u, cache.getNumMisses());
+}
+
+TEST(SharedSecretCache, ForgedNotCached) {
+  SimpleMeshTables tables;
+  SimpleMeshCaches caches;
+  TestNode server, client;
+  makeNode(server, 1);
+  makeNode(client, 2);
+  Packet pkt;
+  makeAnonReq(pkt, client, server, 1000);
+  pkt.payload[1 + PUB_KEY_SIZE] ^= 1;   // bad MAC
+  pkt.invalidateHash();
+
+  uint32_t n_ecdh = 0;
+  EXPECT_FALSE(recvAnonReq(tables, caches, server, &pkt, n_ecdh));
+  uint8_t secret[PUB_KEY_SIZE];
+  EXPECT_FALSE(caches.getSharedSecret(secret, client.pub_key));
+
+  makeAnonReq(pkt, client, server, 1001);
+  EXPECT_TRUE(recvAnonReq(tables, caches, server, &pkt, n_ecdh));
+  EXPECT_TRUE(caches.getSharedSecret(secret, client.pub_key));
+  EXPECT_EQ(2u, n_ecdh);
+}
+
+// A few clients retrying login (or clock/regions queries) many times, mixed with one-off requests from others.
+TEST(SharedSecretCache, LoginStorm) {
+  const int CLIENTS = 4, RETRIES = 25, ONE_OFFS = 50;
+  TestNode server;
+  makeNode(server, 1);
+  std::vector<TestNode> clients(CLIENTS + ONE_OFFS);
+  for (size_t i = 0; i < clients.size(); i++) makeNode(clients[i], 100 + i);
+
+  SimpleMeshTables tables;
+  SimpleMeshCaches caches;
+  Packet pkt;
+  uint32_t n_ecdh = 0, n_valid = 0, n_reqs = 0, ts = 1000;
+  int next_one_off = CLIENTS;
+  for (int r = 0; r < RETRIES; r++) {
+    for (int c = 0; c < CLIENTS; c++) {
+      makeAnonReq(pkt, clients[c], server, ts++);   // new timestamp, so not a dup packet
+      n_valid += recvAnonReq(tables, caches, server, &pkt, n_ecdh);
+      n_reqs++;
+    }
+    if (r % 2 == 0 && next_one_off < (int)clients.size()) {
+      makeAnonReq(pkt, clients[next_one_off++], server, ts++);
+      n_valid += recvAnonReq(tables, caches, server, &pkt, n_ecdh);
+      n_reqs++;
+    }
+  }
+  EXPECT_EQ(n_reqs, n_valid);
+  EXPECT_LT(n_ecdh, n_reqs / 2);
+  printf("\n  %u ANON_REQs, %u ECDH calls (%u saved), cache size %d, %u evictions\n", n_reqs, n_ecdh, n_reqs - n_ecdh,
+    SHARED_SECRET_CACHE_SIZE, caches.getSecretCache().getNumEvictions());
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
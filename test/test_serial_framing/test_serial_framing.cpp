@@ -0,0 +1,315 @@
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <deque>
+#include <random>
+#include <vector>
+#include "helpers/bridges/SerialFraming.h"
+
+typedef std::vector<uint8_t> Bytes;
+
+class TestEnd : public SerialFraming::Handler {
+public:
+  SerialFraming framing;
+  std::deque<uint8_t> out;      // written, not yet on the wire
+  std::vector<Bytes> received;
+
+  TestEnd() : framing(this) { }
+
+  void onFramedPacket(const uint8_t *data, int len) override { received.push_back(Bytes(data, data + len)); }
+  void writeFramed(const uint8_t *data, int len) override { out.insert(out.end(), data, data + len); }
+};
+
+// two ends joined by a full duplex serial link, simulated 1 millis at a time
+class Link {
+  double _credit_ab = 0, _credit_ba = 0;
+  uint32_t _baud;
+
+  void transfer(TestEnd& from, TestEnd& to, double& credit, int chunk) {
+    credit += _baud / 10.0 / 1000.0;   // bytes per millis
+    while (credit >= 1.0 && !from.out.empty()) {
+      int n = (int)credit;
+      if (n > (int)from.out.size()) n = from.out.size();
+      if (n > chunk) n = chunk;
+      uint8_t buf[256];
+      for (int i = 0; i < n; i++) { buf[i] = from.out.front(); from.out.pop_front(); }
+      to.framing.onReceived(buf, n, now);
+      credit -= n;
+    }
+    if (from.out.empty() && credit > 1.0) credit = 1.0;   // idle line doesn't bank time
+  }
+
+public:
+  TestEnd a, b;
+  unsigned long now = 1000;
+  int chunk = 64;   // as RS232Bridge::RX_CHUNK_SIZE
+
+  Link(uint32_t baud = 115200) : _baud(baud) { }
+
+  void begin(bool a_v2, bool b_v2) {
+    a.framing.begin(now, _baud, a_v2);
+    b.framing.begin(now, _baud, b_v2);
+  }
+  void run(int millis) {
+    for (int i = 0; i < millis; i++) {
+      now++;
+      transfer(a, b, _credit_ab, chunk);
+      transfer(b, a, _credit_ba, chunk);
+      a.framing.loop(now);
+      b.framing.loop(now);
+    }
+  }
+  bool idle() const { return a.out.empty() && b.out.empty(); }
+};
+
+static Bytes makePacket(std::mt19937& rng, int len) {
+  Bytes p(len);
+  for (auto& b : p) b = rng() & 0xFF;
+  return p;
+}
+
+TEST(SerialFramingTest, CobsRoundTrip) {
+  std::mt19937 rng(1);
+  const int lens[] = { 0, 1, 2, 253, 254, 255, 256, 508, 600 };
+  for (int len : lens) {
+    for (int zeroes = 0; zeroes < 3; zeroes++) {   // none, some, mostly zeroes
+      Bytes src(len);
+      for (auto& b : src) b = (zeroes == 0) ? (rng() % 255) + 1 : (zeroes == 1 ? rng() & 0xFF : (rng() % 8 == 0));
+      Bytes enc(len + len / 254 + 1);
+      size_t enc_len = SerialFraming::cobsEncode(src.data(), len, enc.data());
+      ASSERT_LE(enc_len, enc.size());
+      EXPECT_EQ(nullptr, memchr(enc.data(), 0, enc_len)) << "len " << len;
+
+      int dec_len = SerialFraming::cobsDecode(enc.data(), enc_len, enc.data());   // in place
+      ASSERT_EQ(len, dec_len);
+      EXPECT_EQ(0, memcmp(src.data(), enc.data(), len));
+    }
+  }
+}
+
+TEST(SerialFramingTest, CobsRejectsTruncated) {
+  uint8_t enc[] = { 0x05, 'a', 'b' };   // says 4 bytes follow
+  uint8_t dest[8];
+  EXPECT_EQ(-1, SerialFraming::cobsDecode(enc, sizeof(enc), dest));
+}
+
+TEST(SerialFramingTest, Crc16KnownValue) {
+  EXPECT_EQ(0x29B1, SerialFraming::crc16((const uint8_t *)"123456789", 9));
+}
+
+TEST(SerialFramingTest, NegotiatesV2) {
+  Link link;
+  link.begin(true, true);
+  link.run(50);
+  EXPECT_TRUE(link.a.framing.isV2());
+  EXPECT_TRUE(link.b.framing.isV2());
+
+  std::mt19937 rng(2);
+  std::vector<Bytes> sent;
+  for (int i = 0; i < 20; i++) {
+    sent.push_back(makePacket(rng, 10 + i * 10));
+    ASSERT_TRUE(link.a.framing.sendPacket(sent.back().data(), sent.back().size(), link.now));
+  }
+  link.run(500);
+  EXPECT_EQ(sent, link.b.received);
+  EXPECT_EQ(0u, link.b.framing.getRxErrors());
+}
+
+TEST(SerialFramingTest, HelloIsIgnoredByOlderPeer) {
+  Link link;
+  link.a.framing.begin(link.now, 115200, true);
+  Bytes hello(link.a.out.begin(), link.a.out.end());
+  ASSERT_FALSE(hello.empty());
+
+  // the original receiver only syncs on the magic word, so HELLO must never contain it
+  for (size_t i = 0; i + 1 < hello.size(); i++) {
+    EXPECT_FALSE(hello[i] == 0xC0 && hello[i + 1] == 0x3E);
+  }
+}
+
+TEST(SerialFramingTest, StaysV1WithOlderPeer) {
+  Link link;
+  link.begin(true, false);   // b doesn't do v2
+  link.run(SERIAL_FRAMING_HELLO_INTERVAL * 3);
+  EXPECT_FALSE(link.a.framing.isV2());
+  EXPECT_FALSE(link.b.framing.isV2());
+
+  std::mt19937 rng(3);
+  Bytes pkt = makePacket(rng, 100);
+  link.run(SERIAL_FRAMING_HELLO_INTERVAL - 100);   // (not in the middle of a HELLO)
+  ASSERT_TRUE(link.a.out.empty());
+  link.a.framing.sendPacket(pkt.data(), pkt.size(), link.now);
+  ASSERT_EQ((size_t)pkt.size() + SerialFraming::V1_OVERHEAD, link.a.out.size());
+  EXPECT_EQ(0xC0, link.a.out[0]);   // v1 frame
+  link.run(50);
+  ASSERT_EQ(1u, link.b.received.size());
+  EXPECT_EQ(pkt, link.b.received[0]);
+}
+
+TEST(SerialFramingTest, PeerStartingLaterNegotiates) {
+  Link link;
+  link.a.framing.begin(link.now, 115200, true);
+  link.run(SERIAL_FRAMING_HELLO_INTERVAL / 2);
+  link.b.framing.begin(link.now, 115200, true);   // a's first HELLO was lost
+  link.run(50);
+  EXPECT_TRUE(link.a.framing.isV2());
+  EXPECT_TRUE(link.b.framing.isV2());
+}
+
+TEST(SerialFramingTest, FallsBackWhenPeerDowngrades) {
+  Link link;
+  link.begin(true, true);
+  link.run(50);
+  ASSERT_TRUE(link.a.framing.isV2());
+
+  link.b.framing.begin(link.now, 115200, false);   // b restarts with older firmware
+  std::mt19937 rng(4);
+  Bytes pkt = makePacket(rng, 40);
+  link.b.framing.sendPacket(pkt.data(), pkt.size(), link.now);
+  link.run(50);
+  ASSERT_EQ(1u, link.a.received.size());
+  EXPECT_FALSE(link.a.framing.isV2());
+
+  link.a.framing.sendPacket(pkt.data(), pkt.size(), link.now);
+  link.run(50);
+  ASSERT_EQ(1u, link.b.received.size());
+  EXPECT_EQ(pkt, link.b.received[0]);
+}
+
+TEST(SerialFramingTest, BatchesWhileLinkBusy) {
+  Link link;
+  link.begin(true, true);
+  link.run(50);
+  uint32_t frames = link.a.framing.getTxFrames();
+
+  std::mt19937 rng(5);
+  std::vector<Bytes> sent;
+  for (int i = 0; i < 12; i++) {   // a burst, all at once
+    sent.push_back(makePacket(rng, 60));
+    link.a.framing.sendPacket(sent.back().data(), sent.back().size(), link.now);
+  }
+  // first goes straight out, the rest are batched into frames of up to SERIAL_FRAMING_MAX_FRAME
+  int per_frame = (SERIAL_FRAMING_MAX_FRAME - 3) / (2 + 60);
+  int expected_frames = 1 + (11 + per_frame - 1) / per_frame;
+  link.run(500);
+  EXPECT_EQ(sent, link.b.received);
+  EXPECT_EQ((uint32_t)expected_frames, link.a.framing.getTxFrames() - frames);
+}
+
+TEST(SerialFramingTest, LonePacketNotDelayed) {
+  Link link;
+  link.begin(true, true);
+  link.run(50);
+  ASSERT_TRUE(link.idle());
+
+  std::mt19937 rng(6);
+  Bytes pkt = makePacket(rng, 30);
+  link.a.framing.sendPacket(pkt.data(), pkt.size(), link.now);
+  EXPECT_FALSE(link.a.out.empty());   // written immediately
+}
+
+TEST(SerialFramingTest, CorruptFrameIsDropped) {
+  Link link;
+  link.begin(true, true);
+  link.run(50);
+
+  std::mt19937 rng(7);
+  Bytes p1 = makePacket(rng, 80), p2 = makePacket(rng, 80);
+  link.a.framing.sendPacket(p1.data(), p1.size(), link.now);
+  link.a.out[20] ^= 0x01;   // (not changed to/from zero)
+  link.run(50);
+  EXPECT_TRUE(link.b.received.empty());
+  EXPECT_EQ(1u, link.b.framing.getRxErrors());
+
+  link.a.framing.sendPacket(p2.data(), p2.size(), link.now);
+  link.run(50);
+  ASSERT_EQ(1u, link.b.received.size());
+  EXPECT_EQ(p2, link.b.received[0]);
+}
+
+TEST(SerialFramingTest, ByteAtATime) {
+  Link link;
+  link.chunk = 1;
+  link.begin(true, true);
+  link.run(50);
+  ASSERT_TRUE(link.a.framing.isV2());
+
+  std::mt19937 rng(8);
+  std::vector<Bytes> sent;
+  for (int i = 0; i < 10; i++) {
+    sent.push_back(makePacket(rng, 1 + i * 25));
+    link.a.framing.sendPacket(sent.back().data(), sent.back().size(), link.now);
+  }
+  link.run(500);
+  EXPECT_EQ(sent, link.b.received);
+}
+
+TEST(SerialFramingTest, RejectsOversizePacket) {
+  Link link;
+  link.begin(true, true);
+  uint8_t big[SerialFraming::MAX_PACKET_LEN + 1] = {0};
+  EXPECT_FALSE(link.a.framing.sendPacket(big, sizeof(big), link.now));
+  EXPECT_TRUE(link.a.framing.sendPacket(big, SerialFraming::MAX_PACKET_LEN, link.now));
+}
+
+// ------------- benchmark (packets/sec over a simulated 115200 baud loopback, no pass/fail) -------------
+
+static double burstRate(bool v2, int pkt_len, int num_pkts) {
+  Link link(115200);
+  link.begin(v2, v2);
+  link.run(50);
+
+  std::mt19937 rng(pkt_len);
+  for (int i = 0; i < num_pkts; i++) {   // a flood, arriving faster than the link can take it
+    Bytes pkt = makePacket(rng, pkt_len);
+    link.a.framing.sendPacket(pkt.data(), pkt.size(), link.now);
+    link.run(1);
+  }
+  unsigned long start = link.now - num_pkts;
+  while (!link.idle() || link.b.received.size() < (size_t)num_pkts) {
+    link.run(1);
+    if (link.now - start > 600000) break;
+  }
+  return link.b.received.size() * 1000.0 / (link.now - start);
+}
+
+TEST(SerialFramingBenchmark, PacketsPerSecond) {
+  const int lens[] = { 20, 50, 100, 180 };
+  for (int len : lens) {
+    double v1 = burstRate(false, len, 1000);
+    double v2 = burstRate(true, len, 1000);
+    printf("  %3d byte packets: v1 %6.1f pkts/sec, v2 %6.1f pkts/sec (%+.1f%%)\n", len, v1, v2, (v2 / v1 - 1) * 100);
+  }
+}
+
+TEST(SerialFramingBenchmark, ParseCost) {
+  std::mt19937 rng(9);
+  const int NUM = 20000;
+  for (int v2 = 0; v2 <= 1; v2++) {
+    Link link;
+    link.begin(v2, v2);
+    link.run(50);
+    link.a.out.clear();
+    for (int i = 0; i < NUM; i++) {
+      Bytes pkt = makePacket(rng, 60);
+      link.a.framing.sendPacket(pkt.data(), pkt.size(), link.now);   // link 'busy', so batched in v2
+    }
+    link.a.framing.loop(link.now + 10000000);
+    Bytes wire(link.a.out.begin(), link.a.out.end());
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < wire.size(); i += 64) {
+      link.b.framing.onReceived(&wire[i], wire.size() - i < 64 ? wire.size() - i : 64, link.now);
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    double us = std::chrono::duration<double, std::micro>(t1 - t0).count();
+    printf("  v%d: %zu packets parsed, %.2f us/packet on host, %.1f wire bytes/packet\n",
+        v2 + 1, link.b.received.size(), us / link.b.received.size(), (double)wire.size() / NUM);
+  }
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,142 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <stdio.h>
+#include <vector>
+#include "helpers/TransportCodeMatcher.h"
+
+using namespace mesh;
+
+static void makeKey(uint8_t key[], uint32_t id) {
+  SHA256 sha;
+  sha.update(&id, sizeof(id));
+  sha.finalize(key, TRANSPORT_KEY_SIZE);
+}
+
+static void makePacket(Packet& pkt, uint32_t id, const uint8_t key[]) {
+  pkt.header = (PAYLOAD_TYPE_GRP_TXT << PH_TYPE_SHIFT) | ROUTE_TYPE_TRANSPORT_FLOOD;
+  pkt.path_len = 0;
+  pkt.payload_len = 40 + (id % 100);
+  for (int i = 0; i < pkt.payload_len; i++) pkt.payload[i] = (uint8_t) (id * 31 + i);
+  pkt.transport_codes[0] = key ? TransportCodeMatcher::calcCode(key, &pkt) : 0;   // 0 is never a valid code
+  pkt.transport_codes[1] = 0;
+  pkt.invalidateHash();
+}
+
+TEST(TransportCodeMatcher, SameCodeAsFullHMAC) {
+  TransportCodeMatcher matcher(8);
+  uint8_t keys[8][TRANSPORT_KEY_SIZE];
+  for (int i = 0; i < 8; i++) {
+    makeKey(keys[i], i);
+    ASSERT_TRUE(matcher.addKey(keys[i], i));
+  }
+  Packet pkt;
+  for (uint32_t id = 0; id < 200; id++) {
+    makePacket(pkt, id, NULL);
+    for (int i = 0; i < 8; i++) {
+      EXPECT_EQ(TransportCodeMatcher::calcCode(keys[matcher.getTagAt(i)], &pkt), matcher.calcCodeAt(i, &pkt));
+    }
+  }
+}
+
+TEST(TransportCodeMatcher, MostRecentlyMatchedFirst) {
+  TransportCodeMatcher matcher(4);
+  uint8_t keys[5][TRANSPORT_KEY_SIZE];
+  for (int i = 0; i < 5; i++) {
+    makeKey(keys[i], 100 + i);
+  }
+  for (int i = 0; i < 4; i++) {
+    ASSERT_TRUE(matcher.addKey(keys[i], i));
+  }
+  EXPECT_FALSE(matcher.addKey(keys[4], 4));   // full
+  EXPECT_EQ(4, matcher.getCount());
+
+  Packet pkt;
+  makePacket(pkt, 1, keys[2]);
+  EXPECT_EQ(2, matcher.findMatch(&pkt));
+  EXPECT_EQ(3u, matcher.getNumHMACs());   // tried 0, 1, then 2
+  EXPECT_EQ(2, matcher.getTagAt(0));
+  EXPECT_EQ(0, matcher.getTagAt(1));
+  EXPECT_EQ(1, matcher.getTagAt(2));
+  EXPECT_EQ(3, matcher.getTagAt(3));
+
+  makePacket(pkt, 2, keys[2]);
+  EXPECT_EQ(2, matcher.findMatch(&pkt));
+  EXPECT_EQ(4u, matcher.getNumHMACs());   // first one tried now matches
+
+  makePacket(pkt, 3, keys[4]);    // not in matcher
+  EXPECT_EQ(-1, matcher.findMatch(&pkt));
+  EXPECT_EQ(8u, matcher.getNumHMACs());
+  EXPECT_EQ(3u, matcher.getNumLookups());
+  EXPECT_EQ(2u, matcher.getNumMatches());
+
+  matcher.resetStats();
+  EXPECT_EQ(0u, matcher.getNumHMACs());
+}
+
+// emulates previous RegionMap::findMatch(), ie. full HMAC per key, in region table order
+static int linearMatch(const std::vector<std::vector<uint8_t>>& keys, const Packet* pkt, uint32_t& hmacs) {
+  for (size_t i = 0; i < keys.size(); i++) {
+    hmacs++;
+    if (TransportCodeMatcher::calcCode(keys[i].data(), pkt) == pkt->transport_codes[0]) return i;
+  }
+  return -1;
+}
+
+// 70% of traffic from 4 busy regions, 20% spread over all regions, 10% unknown regions (no match)
+static int pickKey(int num_keys, uint32_t& rnd) {
+  rnd = rnd * 1103515245 + 12345;
+  uint32_t r = (rnd >> 8) % 100;
+  if (r < 70) return num_keys - 1 - (r % 4);   // busy regions at end of table: worst case for linear order
+  if (r < 90) return (rnd >> 16) % num_keys;
+  return -1;
+}
+
+TEST(TransportCodeBenchmark, MatchCost) {
+  const int PACKETS = 2000;
+  const int sizes[] = { 32, 64, 128 };
+  printf("\n  NOTE: mock SHA256 (test/mocks), so times are relative only\n");
+  for (int s = 0; s < 3; s++) {
+    int num_keys = sizes[s];
+    std::vector<std::vector<uint8_t>> keys(num_keys, std::vector<uint8_t>(TRANSPORT_KEY_SIZE));
+    TransportCodeMatcher matcher(num_keys);
+    for (int i = 0; i < num_keys; i++) {
+      makeKey(keys[i].data(), i);
+      matcher.addKey(keys[i].data(), i);
+    }
+    uint8_t unknown_key[TRANSPORT_KEY_SIZE];
+    makeKey(unknown_key, 999999);
+
+    std::vector<Packet> packets(PACKETS);
+    std::vector<int> expected(PACKETS);
+    uint32_t rnd = 7;
+    for (int i = 0; i < PACKETS; i++) {
+      expected[i] = pickKey(num_keys, rnd);
+      makePacket(packets[i], i, expected[i] < 0 ? unknown_key : keys[expected[i]].data());
+    }
+
+    // NOTE: 16-bit codes, so an occasional false match on another key is expected (by either method)
+    uint32_t linear_hmacs = 0;
+    volatile int linear_hits = 0, matcher_hits = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < PACKETS; i++) {
+      linear_hits += linearMatch(keys, &packets[i], linear_hmacs) == expected[i];
+    }
+    double linear_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / PACKETS;
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < PACKETS; i++) {
+      matcher_hits += matcher.findMatch(&packets[i]) == expected[i];
+    }
+    double matcher_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / PACKETS;
+
+    printf("  %3d keys: linear %.1f HMACs/pkt %.2f us/match, indexed %.1f HMACs/pkt %.2f us/match\n", num_keys,
+      (double)linear_hmacs / PACKETS, linear_us, (double)matcher.getNumHMACs() / PACKETS, matcher_us);
+    EXPECT_GT(linear_hits, PACKETS*99/100);
+    EXPECT_GT(matcher_hits, PACKETS*99/100);
+  }
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,151 @@
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "helpers/TransportKeyStore.h"
+
+static void regionName(char* dest, int n) { sprintf(dest, "#region%d", n); }
+
+static void getKey(TransportKeyStore& store, int n, TransportKey& dest) {
+  char name[32];
+  regionName(name, n);
+  store.getAutoKeyFor(100 + n, name, dest);
+}
+
+class TransportKeyStoreTest : public ::testing::Test {
+protected:
+  char dir[64];
+  fs::FS* fs;
+
+  void SetUp() override {
+    strcpy(dir, "/tmp/tkeysXXXXXX");
+    ASSERT_TRUE(mkdtemp(dir) != NULL);
+    fs = new fs::FS(dir);
+  }
+  void TearDown() override {
+    fs->remove("/tkeys");
+    rmdir(dir);
+    delete fs;
+  }
+};
+
+TEST_F(TransportKeyStoreTest, HitsAndMisses) {
+  TransportKeyStore store;
+  TransportKey a, b;
+  getKey(store, 1, a);
+  getKey(store, 1, b);
+  EXPECT_EQ(0, memcmp(a.key, b.key, sizeof(a.key)));
+  EXPECT_EQ(1u, store.getNumMisses());
+  EXPECT_EQ(1u, store.getNumHits());
+  EXPECT_EQ(1, store.getCacheCount());
+
+  store.getAutoKeyFor(101, "#other", b);   // same id, different name (ie. renamed), replaces entry
+  EXPECT_NE(0, memcmp(a.key, b.key, sizeof(a.key)));
+  EXPECT_EQ(2u, store.getNumMisses());
+  EXPECT_EQ(1, store.getCacheCount());
+}
+
+TEST_F(TransportKeyStoreTest, EvictsLeastRecentlyUsed) {
+  TransportKeyStore store;
+  TransportKey k;
+  for (int n = 0; n < MAX_TKS_ENTRIES; n++) getKey(store, n, k);
+  EXPECT_EQ(MAX_TKS_ENTRIES, store.getCacheCount());
+  EXPECT_EQ(0u, store.getNumEvictions());
+
+  getKey(store, 0, k);                 // region 1 is now least recently used
+  getKey(store, MAX_TKS_ENTRIES, k);   // new region, evicts it
+  EXPECT_EQ(1u, store.getNumEvictions());
+  EXPECT_EQ(MAX_TKS_ENTRIES, store.getCacheCount());
+
+  store.resetStats();
+  getKey(store, 0, k);
+  getKey(store, MAX_TKS_ENTRIES, k);
+  EXPECT_EQ(2u, store.getNumHits());
+  getKey(store, 1, k);
+  EXPECT_EQ(1u, store.getNumMisses());
+  EXPECT_EQ(1u, store.getNumEvictions());
+}
+
+TEST_F(TransportKeyStoreTest, InvalidatesOnlyAffectedRegion) {
+  TransportKeyStore store;
+  TransportKey k;
+  for (int n = 0; n < 3; n++) getKey(store, n, k);
+  uint16_t version = store.getVersion();
+
+  store.removeKeys(101);
+  EXPECT_NE(version, store.getVersion());
+  EXPECT_EQ(2, store.getCacheCount());
+
+  store.resetStats();
+  getKey(store, 0, k);
+  getKey(store, 2, k);
+  EXPECT_EQ(2u, store.getNumHits());
+  getKey(store, 1, k);
+  EXPECT_EQ(1u, store.getNumMisses());
+
+  store.clear();
+  EXPECT_EQ(0, store.getCacheCount());
+}
+
+TEST_F(TransportKeyStoreTest, SaveLoadRoundTrip) {
+  TransportKeyStore store;
+  TransportKey keys[3];
+  for (int n = 0; n < 3; n++) getKey(store, n, keys[n]);
+  EXPECT_TRUE(store.isDirty());
+  ASSERT_TRUE(store.save(fs));
+  EXPECT_FALSE(store.isDirty());
+
+  TransportKeyStore loaded;
+  ASSERT_TRUE(loaded.load(fs));
+  EXPECT_FALSE(loaded.isDirty());
+  EXPECT_EQ(3, loaded.getCacheCount());
+  for (int n = 0; n < 3; n++) {
+    TransportKey k;
+    getKey(loaded, n, k);
+    EXPECT_EQ(0, memcmp(keys[n].key, k.key, sizeof(k.key)));
+  }
+  EXPECT_EQ(3u, loaded.getNumHits());
+  EXPECT_EQ(0u, loaded.getNumMisses());
+}
+
+TEST_F(TransportKeyStoreTest, LoopSaveIsLazy) {
+  TransportKeyStore store;
+  TransportKey k;
+  getKey(store, 0, k);
+
+  store.loopSave(fs, 1000, 5000);
+  store.loopSave(fs, 5999, 5000);
+  EXPECT_FALSE(fs->exists("/tkeys"));
+  getKey(store, 1, k);   // more keys in the meantime, still one write
+  store.loopSave(fs, 6001, 5000);
+  EXPECT_TRUE(fs->exists("/tkeys"));
+  EXPECT_FALSE(store.isDirty());
+
+  uint32_t written = fs->bytes_written;
+  for (unsigned long now = 7000; now < 30000; now += 1000) store.loopSave(fs, now, 5000);
+  EXPECT_EQ(written, fs->bytes_written);
+}
+
+TEST_F(TransportKeyStoreTest, EvictionChurnDoesNotRewrite) {
+  TransportKeyStore store;
+  TransportKey k;
+  for (int n = 0; n < MAX_TKS_ENTRIES; n++) getKey(store, n, k);
+  ASSERT_TRUE(store.save(fs));
+  uint32_t written = fs->bytes_written;
+
+  // more regions than fit, used round robin, so every lookup misses
+  unsigned long now = 0;
+  for (int round = 0; round < 5; round++) {
+    for (int n = 0; n < MAX_TKS_ENTRIES + 4; n++) {
+      getKey(store, n, k);
+      store.loopSave(fs, now += 1000, 5000);
+    }
+  }
+  EXPECT_GT(store.getNumEvictions(), 0u);
+  EXPECT_FALSE(store.isDirty());
+  EXPECT_EQ(written, fs->bytes_written);
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}